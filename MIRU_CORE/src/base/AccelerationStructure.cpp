@@ -87,7 +87,7 @@ DeviceAddress miru::base::GetBufferDeviceAddress(void* device, const BufferRef&
 	{
 	case GraphicsAPI::API::D3D12:
 		#if defined (MIRU_D3D12)
-		return ref_cast<d3d12::Buffer>(buffer)->m_Buffer->GetGPUVirtualAddress();
+		return ref_cast<d3d12::Buffer>(buffer)->m_Buffer->GetGPUVirtualAddress() + buffer->GetOffset();
 		#else
 		return 0;
 		#endif
@@ -97,7 +97,7 @@ DeviceAddress miru::base::GetBufferDeviceAddress(void* device, const BufferRef&
 		info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
 		info.pNext = nullptr;
 		info.buffer = ref_cast<vulkan::Buffer>(buffer)->m_Buffer;
-		return vulkan::vkGetBufferDeviceAddress(*reinterpret_cast<VkDevice*>(device), &info);
+		return vulkan::vkGetBufferDeviceAddress(*reinterpret_cast<VkDevice*>(device), &info) + buffer->GetOffset();
 		#else
 		return 0;
 		#endif
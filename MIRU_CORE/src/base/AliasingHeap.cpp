@@ -0,0 +1,178 @@
+#include "miru_core_common.h"
+#if defined (MIRU_D3D12)
+#include "d3d12/D3D12AliasingHeap.h"
+#endif
+#if defined (MIRU_VULKAN)
+#include "vulkan/VKAliasingHeap.h"
+#endif
+
+using namespace miru;
+using namespace base;
+
+AliasingHeapRef AliasingHeap::Create(CreateInfo* pCreateInfo)
+{
+	switch (GraphicsAPI::GetAPI())
+	{
+	case GraphicsAPI::API::D3D12:
+		#if defined (MIRU_D3D12)
+		return CreateRef<d3d12::AliasingHeap>(pCreateInfo);
+		#else
+		return nullptr;
+		#endif
+	case GraphicsAPI::API::VULKAN:
+		#if defined (MIRU_VULKAN)
+		return CreateRef<vulkan::AliasingHeap>(pCreateInfo);
+		#else
+		return nullptr;
+		#endif
+	case GraphicsAPI::API::UNKNOWN:
+	default:
+		MIRU_FATAL(true, "ERROR: BASE: Unknown GraphicsAPI."); return nullptr;
+	}
+}
+
+AliasingHeap::ResourceHandle AliasingHeap::AddImage(const Image::CreateInfo& imageCI, const Lifetime& lifetime)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	MIRU_FATAL(m_Built, "ERROR: BASE: Can not add resources to an AliasingHeap that has been built.");
+	MIRU_FATAL(lifetime.firstPass > lifetime.lastPass, "ERROR: BASE: Invalid Lifetime for the AliasingHeap resource.");
+
+	Resource resource = {};
+	resource.imageCI = imageCI;
+	resource.imageCI.data = nullptr;
+	resource.imageCI.allocator = nullptr;
+	resource.imageCI.externalImage = nullptr;
+	resource.isImage = true;
+	resource.lifetime = lifetime;
+	m_Resources.push_back(resource);
+	return static_cast<ResourceHandle>(m_Resources.size() - 1);
+}
+
+AliasingHeap::ResourceHandle AliasingHeap::AddBuffer(const Buffer::CreateInfo& bufferCI, const Lifetime& lifetime)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	MIRU_FATAL(m_Built, "ERROR: BASE: Can not add resources to an AliasingHeap that has been built.");
+	MIRU_FATAL(lifetime.firstPass > lifetime.lastPass, "ERROR: BASE: Invalid Lifetime for the AliasingHeap resource.");
+
+	Resource resource = {};
+	resource.bufferCI = bufferCI;
+	resource.bufferCI.data = nullptr;
+	resource.bufferCI.allocator = nullptr;
+	resource.bufferCI.arena = nullptr;
+	resource.isImage = false;
+	resource.lifetime = lifetime;
+	m_Resources.push_back(resource);
+	return static_cast<ResourceHandle>(m_Resources.size() - 1);
+}
+
+void AliasingHeap::Build()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	MIRU_FATAL(m_Built, "ERROR: BASE: AliasingHeap has already been built.");
+	if (m_Resources.empty())
+		return;
+
+	//Create the resources without memory
+	size_t alignment = 1;
+	uint32_t memoryTypeBits = ~0u;
+	m_UnaliasedSize = 0;
+	for (Resource& resource : m_Resources)
+	{
+		if (resource.isImage)
+			resource.image = Image::Create(&resource.imageCI);
+		else
+			resource.buffer = Buffer::Create(&resource.bufferCI);
+
+		GetMemoryRequirements(resource);
+		alignment = std::max<size_t>(alignment, resource.alignment);
+		memoryTypeBits &= resource.memoryTypeBits;
+		m_UnaliasedSize += resource.size;
+	}
+	MIRU_FATAL(memoryTypeBits == 0, "ERROR: BASE: AliasingHeap's resources do not share a common memory type.");
+
+	PackResources();
+
+	AllocateMemory(m_HeapSize, alignment, memoryTypeBits);
+	for (Resource& resource : m_Resources)
+		BindMemory(resource);
+
+	m_Built = true;
+}
+
+void AliasingHeap::Reset()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	for (Resource& resource : m_Resources)
+	{
+		resource.image = nullptr;
+		resource.buffer = nullptr;
+	}
+	m_Resources.clear();
+
+	FreeMemory();
+
+	m_HeapSize = 0;
+	m_UnaliasedSize = 0;
+	m_Built = false;
+}
+
+const ImageRef& AliasingHeap::GetImage(ResourceHandle handle)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	MIRU_FATAL(handle >= m_Resources.size() || !m_Resources[handle].isImage, "ERROR: BASE: Invalid AliasingHeap Image handle.");
+	return m_Resources[handle].image;
+}
+
+const BufferRef& AliasingHeap::GetBuffer(ResourceHandle handle)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	MIRU_FATAL(handle >= m_Resources.size() || m_Resources[handle].isImage, "ERROR: BASE: Invalid AliasingHeap Buffer handle.");
+	return m_Resources[handle].buffer;
+}
+
+void AliasingHeap::PackResources()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	//Greedy by size: place the largest resources first at the lowest offset that does not
+	//overlap any placed resource whose lifetime intersects with its own.
+	std::vector<size_t> order(m_Resources.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return m_Resources[a].size > m_Resources[b].size; });
+
+	std::vector<size_t> placed;
+	m_HeapSize = 0;
+	for (const size_t& index : order)
+	{
+		Resource& resource = m_Resources[index];
+
+		std::vector<std::pair<size_t, size_t>> occupied;
+		for (const size_t& placedIndex : placed)
+		{
+			const Resource& other = m_Resources[placedIndex];
+			const bool& overlapping = resource.lifetime.firstPass <= other.lifetime.lastPass && other.lifetime.firstPass <= resource.lifetime.lastPass;
+			if (overlapping)
+				occupied.push_back({ other.offset, other.offset + other.size });
+		}
+		std::sort(occupied.begin(), occupied.end());
+
+		size_t offset = 0;
+		for (const std::pair<size_t, size_t>& range : occupied)
+		{
+			if (arc::Align<size_t>(offset, resource.alignment) + resource.size <= range.first)
+				break;
+			offset = std::max(offset, range.second);
+		}
+
+		resource.offset = arc::Align<size_t>(offset, resource.alignment);
+		m_HeapSize = std::max(m_HeapSize, resource.offset + resource.size);
+		placed.push_back(index);
+	}
+}
\ No newline at end of file
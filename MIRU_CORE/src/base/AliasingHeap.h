@@ -0,0 +1,88 @@
+#pragma once
+
+#include "miru_core_common.h"
+#include "Allocator.h"
+#include "Buffer.h"
+#include "Image.h"
+
+namespace miru
+{
+namespace base
+{
+	//One device memory allocation shared by transient Images and Buffers.
+	//Resources are declared with the range of passes in which they are used. Build() packs resources with
+	//non-overlapping lifetimes into the same bytes, allocates the heap and binds every resource at its offset.
+	//Aliased resources have undefined contents at the start of their lifetime: the first use must transition
+	//from Image::Layout::UNKNOWN and must not read. Resources must be released before the AliasingHeap.
+	class MIRU_API AliasingHeap
+	{
+		//enums/structs
+	public:
+		struct CreateInfo
+		{
+			std::string		debugName;
+			ContextRef		context;
+			AllocatorRef	allocator;	//Provides the memory properties and the native allocator for the heap.
+		};
+		struct Lifetime
+		{
+			uint32_t		firstPass;
+			uint32_t		lastPass;	//Inclusive.
+		};
+		typedef uint32_t ResourceHandle;
+
+		//Methods
+	public:
+		static AliasingHeapRef Create(CreateInfo* pCreateInfo);
+		virtual ~AliasingHeap() = default;
+		const CreateInfo& GetCreateInfo() { return m_CI; }
+
+		//The allocator member of the CreateInfo is ignored. The resource is created when Build() is called.
+		ResourceHandle AddImage(const Image::CreateInfo& imageCI, const Lifetime& lifetime);
+		ResourceHandle AddBuffer(const Buffer::CreateInfo& bufferCI, const Lifetime& lifetime);
+
+		//Creates all declared resources, packs them by lifetime, and allocates and binds the heap.
+		void Build();
+		//Destroys all resources and the heap, and clears all declarations.
+		void Reset();
+
+		const ImageRef& GetImage(ResourceHandle handle);
+		const BufferRef& GetBuffer(ResourceHandle handle);
+		const size_t& GetHeapSize() { return m_HeapSize; }
+		//Sum of the sizes of all resources, i.e. the memory required without aliasing.
+		const size_t& GetUnaliasedSize() { return m_UnaliasedSize; }
+
+	protected:
+		struct Resource
+		{
+			Image::CreateInfo	imageCI;
+			Buffer::CreateInfo	bufferCI;
+			bool				isImage;
+			Lifetime			lifetime;
+			ImageRef			image;
+			BufferRef			buffer;
+			size_t				size;
+			size_t				alignment;
+			uint32_t			memoryTypeBits;
+			size_t				offset;
+		};
+
+		//Fills out size, alignment and memoryTypeBits for the resource, which has been created without memory.
+		virtual void GetMemoryRequirements(Resource& resource) = 0;
+		virtual void AllocateMemory(size_t size, size_t alignment, uint32_t memoryTypeBits) = 0;
+		virtual void BindMemory(Resource& resource) = 0;
+		virtual void FreeMemory() = 0;
+
+	private:
+		void PackResources();
+
+		//Members
+	protected:
+		CreateInfo m_CI = {};
+		std::vector<Resource> m_Resources;
+		size_t m_HeapSize = 0;
+		size_t m_UnaliasedSize = 0;
+		bool m_Built = false;
+	};
+}
+}
\ No newline at end of file
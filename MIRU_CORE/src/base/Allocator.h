@@ -1,6 +1,7 @@
 #pragma once
 
 #include "miru_core_common.h"
+#include <functional>
 
 namespace miru
 {
@@ -17,6 +18,8 @@ namespace base
 		size_t				rowPadding;
 		size_t				slicePitch;
 		size_t				sliceCount;
+		void*				mappedData = nullptr; //Only valid for host visible allocations from a persistently mapped Allocator. Includes the offset.
+		size_t				offset = 0; //Offset of the resource in the native allocation.
 	};
 
 	class MIRU_API Allocator
@@ -50,7 +53,36 @@ namespace base
 			ContextRef		context;
 			BlockSize		blockSize;
 			PropertiesBit	properties;
+			bool			persistentlyMapped = false; //Host visible allocations are mapped once at creation and stay mapped for their lifetime.
+			uint32_t		minBlockCount = 0;			//Number of blocks preallocated in the Allocator's memory pools.
+			uint32_t		maxBlockCount = 0;			//Maximum number of blocks in the Allocator's memory pools. 0 for no limit.
+			bool			linearAlgorithm = false;	//For stack or ring-style lifetimes. Linear pools are not defragmented.
+			uint32_t		framesInFlight = 2;			//Number of Defragment() calls, one per frame, that the previous native resources of moved resources are kept alive for.
 		};
+		struct Statistics
+		{
+			uint32_t	blockCount;
+			uint32_t	allocationCount;
+			uint32_t	unusedRangeCount;
+			uint64_t	blockBytes;				//Total size of the memory blocks allocated from the device.
+			uint64_t	allocationBytes;		//Total size of the allocations within the blocks.
+			uint64_t	largestUnusedRangeBytes;
+			float		fragmentation;			//0.0 when all free space is contiguous, approaching 1.0 as it splits in to small ranges.
+		};
+		struct HeapBudget
+		{
+			uint32_t	heapIndex;
+			bool		deviceLocal;
+			uint64_t	usageBytes;				//Estimated usage by the whole process.
+			uint64_t	budgetBytes;			//Estimated memory available to the process.
+			Statistics	statistics;				//Usage by this Allocator only.
+		};
+		struct DefragmentationMove
+		{
+			Buffer*		buffer;					//The Buffer's native handle and memory have been replaced. Views, descriptors and device addresses must be recreated.
+			Image*		image;					//The Image's native handle and memory have been replaced. ImageViews and descriptors must be recreated.
+		};
+		typedef std::function<void(const DefragmentationMove&)> DefragmentationCallback;
 
 		//Methods
 	public:
@@ -63,9 +95,27 @@ namespace base
 		virtual void SubmitData(const Allocation& allocation, size_t offset, size_t size, void* data) = 0;
 		virtual void AccessData(const Allocation& allocation, size_t offset, size_t size, void* data) = 0;
 
+		virtual Statistics GetStatistics() = 0;
+		virtual std::vector<HeapBudget> GetHeapBudgets() = 0;
+		virtual std::string GetStatisticsJSON(bool detailedMap = false) = 0;
+
+		//Performs one incremental defragmentation pass bounded by the budgets. Returns true when no more moves are required.
+		//Call once per frame, between submitting a frame and recording the next. The copies are submitted to the first graphics
+		//queue and never waited on: a pass completes on a later call, once its copies have finished and framesInFlight calls have
+		//passed, and the previous native resources are then destroyed. The callback is invoked as soon as a resource has been
+		//replaced, so CommandBuffers recorded before the call must not be submitted after it. Resources written on other queues
+		//must not be in use. Images are moved only if they have transfer usages and their layouts are tracked by the
+		//ResourceStateTracker. Host visible allocations are not moved.
+		virtual bool Defragment(size_t budgetBytes, uint32_t budgetMoves) = 0;
+		void SetDefragmentationCallback(const DefragmentationCallback& callback) { m_DefragmentationCallback = callback; }
+
+		//Returns nullptr if the allocation is not persistently mapped.
+		void* GetMappedPointer(const Allocation& allocation) { return allocation.mappedData; }
+
 		//Members
 	protected:
 		CreateInfo m_CI = {};
+		DefragmentationCallback m_DefragmentationCallback;
 	};
 }
 }
\ No newline at end of file
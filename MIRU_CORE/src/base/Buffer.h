@@ -57,7 +57,8 @@ namespace base
 			ImageDimension	imageDimension = { 0, 0, 0, 0 }; //For D3D12 only: If this buffer is an upload for an image.
 			size_t			size;
 			void*			data;
-			AllocatorRef	allocator;
+			AllocatorRef	allocator;	//If nullptr, the resource is created without memory. See AliasingHeap.
+			BufferArenaRef	arena = nullptr; //If set, the Buffer is suballocated from the arena and allocator is ignored.
 		};
 
 		//Methods
@@ -66,6 +67,9 @@ namespace base
 		virtual ~Buffer() = default;
 		const CreateInfo& GetCreateInfo() { return m_CI; }
 		const Allocation& GetAllocation() { return m_Allocation; }
+		void* GetMappedPointer() { return m_Allocation.mappedData; }
+		//Offset of the Buffer in its native buffer. Non-zero only for Buffers suballocated from a BufferArena.
+		const size_t& GetOffset() { return m_Allocation.offset; }
 
 		//Members
 	protected:
@@ -0,0 +1,49 @@
+#include "miru_core_common.h"
+#if defined (MIRU_D3D12)
+#include "d3d12/D3D12BufferArena.h"
+#endif
+#if defined (MIRU_VULKAN)
+#include "vulkan/VKBufferArena.h"
+#endif
+
+using namespace miru;
+using namespace base;
+
+BufferArenaRef BufferArena::Create(CreateInfo* pCreateInfo)
+{
+	switch (GraphicsAPI::GetAPI())
+	{
+	case GraphicsAPI::API::D3D12:
+		#if defined (MIRU_D3D12)
+		return CreateRef<d3d12::BufferArena>(pCreateInfo);
+		#else
+		return nullptr;
+		#endif
+	case GraphicsAPI::API::VULKAN:
+		#if defined (MIRU_VULKAN)
+		return CreateRef<vulkan::BufferArena>(pCreateInfo);
+		#else
+		return nullptr;
+		#endif
+	case GraphicsAPI::API::UNKNOWN:
+	default:
+		MIRU_FATAL(true, "ERROR: BASE: Unknown GraphicsAPI."); return nullptr;
+	}
+}
+
+void BufferArena::CreateBuffer()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_CI.size = arc::Align<size_t>(m_CI.size, m_Alignment);
+
+	Buffer::CreateInfo bufferCI;
+	bufferCI.debugName = m_CI.debugName + ": Buffer";
+	bufferCI.device = m_CI.context->GetDevice();
+	bufferCI.usage = m_CI.usage;
+	bufferCI.imageDimension = { 0, 0, 0, 0 };
+	bufferCI.size = m_CI.size;
+	bufferCI.data = nullptr;
+	bufferCI.allocator = m_CI.allocator;
+	m_Buffer = Buffer::Create(&bufferCI);
+}
\ No newline at end of file
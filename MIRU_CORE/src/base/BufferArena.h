@@ -0,0 +1,54 @@
+#pragma once
+
+#include "miru_core_common.h"
+#include "Allocator.h"
+#include "Buffer.h"
+#include <mutex>
+
+namespace miru
+{
+namespace base
+{
+	//One large Buffer from which many small Buffers are suballocated with a virtual allocator.
+	//Buffers created with Buffer::CreateInfo::arena set share the arena's native buffer and do not own any memory.
+	//Their position in the native buffer is Buffer::GetOffset(), which is applied by BufferViews, vertex/index buffer
+	//binds, descriptor writes, copies, barriers and Allocator::SubmitData()/AccessData().
+	class MIRU_API BufferArena
+	{
+		//enums/structs
+	public:
+		struct CreateInfo
+		{
+			std::string			debugName;
+			ContextRef			context;
+			AllocatorRef		allocator;
+			Buffer::UsageBit	usage;		//Must include the usages of all suballocated Buffers.
+			size_t				size;
+			size_t				alignment;	//If 0, the device's minimum offset alignment for the usage is used. For D3D12 structured views, must be a multiple of the stride.
+		};
+
+		//Methods
+	public:
+		static BufferArenaRef Create(CreateInfo* pCreateInfo);
+		virtual ~BufferArena() = default;
+		const CreateInfo& GetCreateInfo() { return m_CI; }
+		const BufferRef& GetBuffer() { return m_Buffer; }
+		const size_t& GetAlignment() { return m_Alignment; }
+
+		//Returns false if there is no space left in the arena.
+		virtual bool Allocate(size_t size, size_t& offset) = 0;
+		virtual void Free(size_t offset) = 0;
+		virtual size_t GetUsedSize() = 0;
+
+	protected:
+		void CreateBuffer();
+
+		//Members
+	protected:
+		CreateInfo m_CI = {};
+		BufferRef m_Buffer;
+		size_t m_Alignment = 0;
+		std::mutex m_Mutex;
+	};
+}
+}
\ No newline at end of file
@@ -0,0 +1,164 @@
+#include "miru_core_common.h"
+#include "CommandBufferAllocator.h"
+
+using namespace miru;
+using namespace base;
+
+CommandBufferAllocatorRef CommandBufferAllocator::Create(CreateInfo* pCreateInfo)
+{
+	return CreateRef<CommandBufferAllocator>(pCreateInfo);
+}
+
+CommandBufferAllocator::CommandBufferAllocator(CreateInfo* pCreateInfo)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_CI = *pCreateInfo;
+	m_CI.commandBuffersPerBlock = std::max<uint32_t>(m_CI.commandBuffersPerBlock, 1);
+
+	MIRU_FATAL(!m_CI.semaphore || m_CI.semaphore->GetCreateInfo().type != Semaphore::Type::TIMELINE, "ERROR: BASE: CommandBufferAllocator requires a timeline Semaphore.");
+}
+
+CommandBufferAllocator::~CommandBufferAllocator()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_CI.semaphore->Wait(m_MaxRetiredValue, UINT64_MAX);
+
+	m_PrimaryBlocks.clear();
+	m_SecondaryBlocks.clear();
+}
+
+CommandBufferAllocator::Allocation CommandBufferAllocator::Allocate(CommandBuffer::Level level)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	std::vector<Block>& blocks = level == CommandBuffer::Level::PRIMARY ? m_PrimaryBlocks : m_SecondaryBlocks;
+	Block* block = nullptr;
+	for (Block& _block : blocks)
+	{
+		if (!_block.freeIndices.empty())
+		{
+			block = &_block;
+			break;
+		}
+	}
+
+	if (!block)
+	{
+		RecycleBlocks(blocks, m_CI.semaphore->GetCurrentValue());
+		for (Block& _block : blocks)
+		{
+			if (!_block.freeIndices.empty())
+			{
+				block = &_block;
+				break;
+			}
+		}
+	}
+
+	if (!block)
+	{
+		const std::string& blockName = m_CI.debugName + ": Block " + std::to_string(m_BlockCount++);
+
+		Block newBlock;
+		CommandPool::CreateInfo cmdPoolCI;
+		cmdPoolCI.debugName = blockName + ": CommandPool";
+		cmdPoolCI.context = m_CI.context;
+		cmdPoolCI.flags = CommandPool::FlagBit::TRANSIENT_BIT | CommandPool::FlagBit::RESET_COMMAND_BUFFER_BIT;
+		cmdPoolCI.queueType = m_CI.queueType;
+		newBlock.commandPool = CommandPool::Create(&cmdPoolCI);
+
+		CommandBuffer::CreateInfo cmdBufferCI;
+		cmdBufferCI.debugName = blockName + ": CommandBuffer";
+		cmdBufferCI.commandPool = newBlock.commandPool;
+		cmdBufferCI.level = level;
+		cmdBufferCI.commandBufferCount = m_CI.commandBuffersPerBlock;
+		newBlock.commandBuffer = CommandBuffer::Create(&cmdBufferCI);
+
+		//Hand out the lowest index first.
+		for (uint32_t i = m_CI.commandBuffersPerBlock; i > 0; i--)
+			newBlock.freeIndices.push_back(i - 1);
+		newBlock.resetPool = false;
+
+		blocks.push_back(std::move(newBlock));
+		block = &blocks.back();
+	}
+
+	const uint32_t index = block->freeIndices.back();
+	block->freeIndices.pop_back();
+	return { block->commandBuffer, index };
+}
+
+void CommandBufferAllocator::Retire(const Allocation& allocation, uint64_t value)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	std::vector<Block>& blocks = allocation.commandBuffer->GetCreateInfo().level == CommandBuffer::Level::PRIMARY ? m_PrimaryBlocks : m_SecondaryBlocks;
+	for (Block& block : blocks)
+	{
+		if (block.commandBuffer == allocation.commandBuffer)
+		{
+			block.retired.push_back({ allocation.index, value });
+			m_MaxRetiredValue = std::max(m_MaxRetiredValue, value);
+			return;
+		}
+	}
+	MIRU_FATAL(true, "ERROR: BASE: The CommandBuffer was not allocated by this CommandBufferAllocator.");
+}
+
+void CommandBufferAllocator::Recycle()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	const uint64_t& completedValue = m_CI.semaphore->GetCurrentValue();
+	RecycleBlocks(m_PrimaryBlocks, completedValue);
+	RecycleBlocks(m_SecondaryBlocks, completedValue);
+}
+
+void CommandBufferAllocator::RecycleBlocks(std::vector<Block>& blocks, uint64_t completedValue)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	uint32_t idleBlockCount = 0;
+	for (auto it = blocks.begin(); it != blocks.end();)
+	{
+		Block& block = *it;
+		for (size_t i = 0; i < block.retired.size();)
+		{
+			if (block.retired[i].value <= completedValue)
+			{
+				block.freeIndices.push_back(block.retired[i].index);
+				block.retired[i] = block.retired.back();
+				block.retired.pop_back();
+				block.resetPool = true;
+			}
+			else
+			{
+				i++;
+			}
+		}
+
+		const bool& idle = block.freeIndices.size() == m_CI.commandBuffersPerBlock;
+		if (idle && idleBlockCount >= m_CI.maxIdleBlocks)
+		{
+			it = blocks.erase(it);
+			continue;
+		}
+		if (idle)
+		{
+			//All CommandBuffers have completed, so reset the CommandPool once rather than each CommandBuffer at Begin().
+			if (block.resetPool)
+				block.commandPool->Reset(false);
+			block.resetPool = false;
+			idleBlockCount++;
+		}
+		it++;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "miru_core_common.h"
+#include "CommandPoolBuffer.h"
+#include "Sync.h"
+#include <mutex>
+
+namespace miru
+{
+namespace base
+{
+	//Hands out primary and secondary CommandBuffers on demand and recycles them by timeline Semaphore value.
+	//CommandBuffers are allocated in blocks, each with its own CommandPool. A CommandBuffer retired with the value of its
+	//submission is recycled once the Semaphore reaches that value. When every CommandBuffer in a block has completed, its
+	//CommandPool is reset as a whole. Blocks are added as needed and idle blocks beyond maxIdleBlocks are destroyed.
+	//All methods can be called from any thread.
+	class MIRU_API CommandBufferAllocator
+	{
+		//enums/structs
+	public:
+		struct CreateInfo
+		{
+			std::string				debugName;
+			ContextRef				context;
+			CommandPool::QueueType	queueType;
+			SemaphoreRef			semaphore;					//Type::TIMELINE. Signalled by the submissions of the allocated CommandBuffers.
+			uint32_t				commandBuffersPerBlock;		//Number of CommandBuffers allocated from each CommandPool.
+			uint32_t				maxIdleBlocks;				//Number of completed blocks per Level that are kept for reuse.
+		};
+		struct Allocation
+		{
+			CommandBufferRef	commandBuffer;
+			uint32_t			index;
+		};
+
+		//Methods
+	public:
+		static CommandBufferAllocatorRef Create(CreateInfo* pCreateInfo);
+		CommandBufferAllocator(CreateInfo* pCreateInfo);
+		~CommandBufferAllocator();
+		const CreateInfo& GetCreateInfo() { return m_CI; }
+
+		//Returns a CommandBuffer that is ready to Begin(). Completed CommandBuffers are recycled before a block is added.
+		Allocation Allocate(CommandBuffer::Level level);
+		//Returns the CommandBuffer for recycling once the Semaphore reaches value. Call after submitting it.
+		//For Level::SECONDARY, use the value of the submission of the primary CommandBuffer that executes it.
+		void Retire(const Allocation& allocation, uint64_t value);
+		//Recycles the completed CommandBuffers and destroys idle blocks beyond CreateInfo::maxIdleBlocks.
+		void Recycle();
+
+	private:
+		struct Block;
+		void RecycleBlocks(std::vector<Block>& blocks, uint64_t completedValue);
+
+		//Members
+	private:
+		struct Retired
+		{
+			uint32_t	index;
+			uint64_t	value;
+		};
+		struct Block
+		{
+			CommandPoolRef			commandPool;
+			CommandBufferRef		commandBuffer;
+			std::vector<uint32_t>	freeIndices;
+			std::vector<Retired>	retired;
+			bool					resetPool;	//Set when a CommandBuffer is recycled, so the CommandPool is reset once the block is idle.
+		};
+
+		CreateInfo m_CI = {};
+
+		std::vector<Block> m_PrimaryBlocks;
+		std::vector<Block> m_SecondaryBlocks;
+		uint32_t m_BlockCount = 0;		//Total number of blocks created, for debug names.
+		uint64_t m_MaxRetiredValue = 0;
+		std::mutex m_Mutex;
+	};
+}
+}
\ No newline at end of file
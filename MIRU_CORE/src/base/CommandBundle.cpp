@@ -0,0 +1,156 @@
+#include "miru_core_common.h"
+#include "CommandBundle.h"
+
+using namespace miru;
+using namespace base;
+
+CommandBundleRef CommandBundle::Create(CreateInfo* pCreateInfo)
+{
+	return CreateRef<CommandBundle>(pCreateInfo);
+}
+
+CommandBundle::CommandBundle(CreateInfo* pCreateInfo)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	MIRU_FATAL(GraphicsAPI::IsD3D12(), "ERROR: BASE: CommandBundle is not supported with D3D12.");
+
+	m_CI = *pCreateInfo;
+	m_CI.frameCount = std::max<uint32_t>(m_CI.frameCount, 1);
+
+	CommandPool::CreateInfo cmdPoolCI;
+	cmdPoolCI.debugName = m_CI.debugName + ": CommandPool";
+	cmdPoolCI.context = m_CI.context;
+	cmdPoolCI.flags = CommandPool::FlagBit::RESET_COMMAND_BUFFER_BIT;
+	cmdPoolCI.queueType = m_CI.queueType;
+	m_CmdPool = CommandPool::Create(&cmdPoolCI);
+
+	CommandBuffer::CreateInfo cmdBufferCI;
+	cmdBufferCI.debugName = m_CI.debugName + ": CommandBuffer";
+	cmdBufferCI.commandPool = m_CmdPool;
+	cmdBufferCI.level = CommandBuffer::Level::SECONDARY;
+	cmdBufferCI.commandBufferCount = m_CI.frameCount;
+	m_CmdBuffer = CommandBuffer::Create(&cmdBufferCI);
+
+	m_RecordedRevisions.resize(m_CI.frameCount, 0);
+}
+
+CommandBundle::~CommandBundle()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_CmdBuffer = nullptr;
+	m_CmdPool = nullptr;
+}
+
+void CommandBundle::SetRecordFunction(const RecordFunction& recordFunction)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_CI.recordFunction = recordFunction;
+	Invalidate();
+}
+
+void CommandBundle::SetInheritanceInfo(const CommandBuffer::InheritanceInfo& inheritanceInfo)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_CI.inheritanceInfo = inheritanceInfo;
+	Invalidate();
+}
+
+void CommandBundle::Invalidate()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_Revision++;
+}
+
+bool CommandBundle::IsValid()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	if (m_DependencyRevision != m_Revision)
+		return false;
+
+	for (const Dependency& dependency : m_Dependencies)
+	{
+		if (dependency.object.expired())
+			return false;
+
+		if (!dependency.shader.expired())
+		{
+			const ShaderRef& shader = dependency.shader.lock();
+			if (shader && shader->GetRevision() != dependency.shaderRevision)
+				return false;
+		}
+	}
+	return true;
+}
+
+void CommandBundle::Execute(const CommandBufferRef& primaryCommandBuffer, uint32_t primaryIndex, uint32_t frameIndex)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	frameIndex = frameIndex % m_CI.frameCount;
+	if (!IsValid())
+		Invalidate();
+
+	if (m_RecordedRevisions[frameIndex] != m_Revision)
+		Record(frameIndex);
+
+	primaryCommandBuffer->ExecuteSecondaryCommandBuffers(primaryIndex, m_CmdBuffer, { frameIndex });
+}
+
+void CommandBundle::AddDependency(const Ref<void>& object)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	if (!m_CollectDependencies || !object)
+		return;
+
+	m_Dependencies.push_back({ object, {}, 0 });
+}
+
+void CommandBundle::AddDependency(const ShaderRef& shader)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	if (!m_CollectDependencies || !shader)
+		return;
+
+	m_Dependencies.push_back({ shader, shader, shader->GetRevision() });
+}
+
+void CommandBundle::AddDependency(const PipelineRef& pipeline)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	if (!m_CollectDependencies || !pipeline)
+		return;
+
+	m_Dependencies.push_back({ pipeline, {}, 0 });
+	for (const ShaderRef& shader : pipeline->GetCreateInfo().shaders)
+		AddDependency(shader);
+}
+
+void CommandBundle::Record(uint32_t frameIndex)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	MIRU_FATAL(!m_CI.recordFunction, "ERROR: BASE: CommandBundle has no RecordFunction.");
+
+	m_CollectDependencies = m_DependencyRevision != m_Revision;
+	if (m_CollectDependencies)
+		m_Dependencies.clear();
+
+	m_CmdBuffer->Reset(frameIndex, false);
+	m_CmdBuffer->Begin(frameIndex, CommandBuffer::UsageBit::SIMULTANEOUS, m_CI.inheritanceInfo);
+	m_CI.recordFunction(*this, m_CmdBuffer, frameIndex);
+	m_CmdBuffer->End(frameIndex);
+
+	m_DependencyRevision = m_Revision;
+	m_CollectDependencies = false;
+	m_RecordedRevisions[frameIndex] = m_Revision;
+	m_RecordCount++;
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "miru_core_common.h"
+#include "CommandPoolBuffer.h"
+#include "Shader.h"
+#include <functional>
+
+namespace miru
+{
+namespace base
+{
+	//Records commands once into a Level::SECONDARY CommandBuffer and executes them every frame, until the bundle is invalidated.
+	//The RecordFunction declares the objects that the recording depends on with AddDependency(). The bundle is invalidated when
+	//a dependency is destroyed, e.g. when it is recreated after Swapchain::Resize(), when a Shader it depends on is recompiled,
+	//or by Invalidate(), SetRecordFunction() and SetInheritanceInfo(). Each frame in flight has its own recording, which
+	//Execute() re-records lazily if the bundle was invalidated since it was recorded. Not thread safe.
+	//Vulkan only: D3D12 secondary CommandBuffers are bundles, which can not bind DescriptorSets or set viewports and scissors.
+	class MIRU_API CommandBundle
+	{
+		//enums/structs
+	public:
+		typedef std::function<void(CommandBundle& bundle, const CommandBufferRef& commandBuffer, uint32_t index)> RecordFunction;
+		struct CreateInfo
+		{
+			std::string						debugName;
+			ContextRef						context;
+			CommandPool::QueueType			queueType;
+			uint32_t						frameCount;			//Number of frames in flight.
+			CommandBuffer::InheritanceInfo	inheritanceInfo;
+			RecordFunction					recordFunction;		//Must only record into the CommandBuffer passed to it.
+		};
+
+		//Methods
+	public:
+		static CommandBundleRef Create(CreateInfo* pCreateInfo);
+		CommandBundle(CreateInfo* pCreateInfo);
+		~CommandBundle();
+		const CreateInfo& GetCreateInfo() { return m_CI; }
+		inline uint64_t GetRecordCount() const { return m_RecordCount; }
+
+		void SetRecordFunction(const RecordFunction& recordFunction);
+		void SetInheritanceInfo(const CommandBuffer::InheritanceInfo& inheritanceInfo);
+		void Invalidate();
+		//Returns false if the bundle has been invalidated or any dependency has changed since the last recording.
+		bool IsValid();
+
+		//Re-records the frame's CommandBuffer if needed and executes it in the primary CommandBuffer, which must have begun the
+		//RenderPass or dynamic rendering matching the InheritanceInfo. The frame's previous submission must have completed on the device.
+		void Execute(const CommandBufferRef& primaryCommandBuffer, uint32_t primaryIndex, uint32_t frameIndex);
+
+		//Call from the RecordFunction. Dependencies are only collected by the first recording after an invalidation.
+		void AddDependency(const Ref<void>& object);
+		void AddDependency(const ShaderRef& shader);
+		void AddDependency(const PipelineRef& pipeline);	//Also depends on the Pipeline's Shaders.
+		template<typename T>
+		void AddDependency(const Handle<T>& handle) { AddDependency(GetHandlePool<T>().GetRef(handle)); }
+
+	private:
+		void Record(uint32_t frameIndex);
+
+		//Members
+	private:
+		struct Dependency
+		{
+			std::weak_ptr<void>		object;
+			std::weak_ptr<Shader>	shader;			//If set, the revision of the Shader is also checked.
+			uint64_t				shaderRevision;
+		};
+
+		CreateInfo m_CI = {};
+
+		CommandPoolRef m_CmdPool;
+		CommandBufferRef m_CmdBuffer;						//One CommandBuffer per frame.
+		std::vector<uint64_t> m_RecordedRevisions;			//The revision of the bundle that each frame was recorded at.
+		uint64_t m_Revision = 1;							//Incremented by each invalidation.
+		uint64_t m_DependencyRevision = 0;					//The revision of the bundle that the dependencies were collected at.
+		bool m_CollectDependencies = false;
+		std::vector<Dependency> m_Dependencies;
+		uint64_t m_RecordCount = 0;
+	};
+}
+}
\ No newline at end of file
@@ -51,4 +51,279 @@ CommandBufferRef CommandBuffer::Create(CommandBuffer::CreateInfo* pCreateInfo)
 	default:
 		MIRU_FATAL(true, "ERROR: BASE: Unknown GraphicsAPI."); return nullptr;
 	}
+}
+
+SubmissionQueueRef SubmissionQueue::Create(SubmissionQueue::CreateInfo* pCreateInfo)
+{
+	switch (GraphicsAPI::GetAPI())
+	{
+	case GraphicsAPI::API::D3D12:
+		#if defined (MIRU_D3D12)
+		return CreateRef<d3d12::SubmissionQueue>(pCreateInfo);
+		#else
+		return nullptr;
+		#endif
+	case GraphicsAPI::API::VULKAN:
+		#if defined (MIRU_VULKAN)
+		return CreateRef<vulkan::SubmissionQueue>(pCreateInfo);
+		#else
+		return nullptr;
+		#endif
+	case GraphicsAPI::API::UNKNOWN:
+	default:
+		MIRU_FATAL(true, "ERROR: BASE: Unknown GraphicsAPI."); return nullptr;
+	}
+}
+
+void CommandBuffer::BuildAccelerationStructure(uint32_t index, const std::vector<AccelerationStructureBuildInfoRef>& buildGeometryInfos, const std::vector<std::vector<AccelerationStructureBuildInfo::BuildRangeInfo>>& buildRangeInfos)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	MIRU_FATAL(buildGeometryInfos.size() != buildRangeInfos.size(), "ERROR: BASE: Size mismatch between buildGeometryInfos.size() and buildRangeInfos.size().");
+
+	ScratchAllocator::Scope scope(m_Scratch[index]);
+	const AccelerationStructureBuildInfo::BuildRangeInfo** ppBuildRangeInfos = m_Scratch[index].Allocate<const AccelerationStructureBuildInfo::BuildRangeInfo*>(buildRangeInfos.size());
+	for (size_t i = 0; i < buildRangeInfos.size(); i++)
+	{
+		MIRU_FATAL(buildGeometryInfos[i]->GetBuildGeometryInfo().geometries.size() != buildRangeInfos[i].size(), "ERROR: BASE: Size mismatch between BuildGeometryInfo::geometries.size() and buildRangeInfos[i].size().");
+		ppBuildRangeInfos[i] = buildRangeInfos[i].data();
+	}
+
+	BuildAccelerationStructure(index, buildGeometryInfos.data(), static_cast<uint32_t>(buildGeometryInfos.size()), ppBuildRangeInfos);
+}
+
+void CommandBuffer::ResetBoundState(uint32_t index)
+{
+	m_BoundStates[index].statistics = { 0, 0 };
+	InvalidateBoundState(index);
+}
+
+void CommandBuffer::InvalidateBoundState(uint32_t index)
+{
+	BoundState& state = m_BoundStates[index];
+	state.pipeline = nullptr;
+	state.descriptorSetPipeline = nullptr;
+	state.descriptorSets.fill(nullptr);
+	state.vertexBufferCount = 0;
+	state.indexBuffer = nullptr;
+	state.viewportCount = 0;
+	state.scissorCount = 0;
+}
+
+bool CommandBuffer::FilterPipeline(uint32_t index, const Pipeline* pipeline)
+{
+	if (!m_CI.filterRedundantState)
+		return false;
+
+	BoundState& state = m_BoundStates[index];
+	const bool& redundant = state.pipeline == pipeline;
+	state.pipeline = pipeline;
+	return CountFiltered(state, redundant);
+}
+
+bool CommandBuffer::FilterIndexBuffer(uint32_t index, const BufferView* indexBufferView)
+{
+	if (!m_CI.filterRedundantState)
+		return false;
+
+	BoundState& state = m_BoundStates[index];
+	const bool& redundant = state.indexBuffer == indexBufferView;
+	state.indexBuffer = indexBufferView;
+	return CountFiltered(state, redundant);
+}
+
+bool CommandBuffer::FilterViewports(uint32_t index, const Viewport* pViewports, uint32_t viewportCount)
+{
+	if (!m_CI.filterRedundantState)
+		return false;
+
+	BoundState& state = m_BoundStates[index];
+	const bool& redundant = viewportCount > 0 && viewportCount == state.viewportCount
+		&& memcmp(state.viewports.data(), pViewports, sizeof(Viewport) * viewportCount) == 0;
+	if (!redundant)
+	{
+		const bool& tracked = viewportCount <= BoundState::MaxViewports;
+		if (tracked)
+			memcpy(state.viewports.data(), pViewports, sizeof(Viewport) * viewportCount);
+		state.viewportCount = tracked ? viewportCount : 0;
+	}
+	return CountFiltered(state, redundant);
+}
+
+bool CommandBuffer::FilterScissors(uint32_t index, const Rect2D* pScissors, uint32_t scissorCount)
+{
+	if (!m_CI.filterRedundantState)
+		return false;
+
+	BoundState& state = m_BoundStates[index];
+	const bool& redundant = scissorCount > 0 && scissorCount == state.scissorCount
+		&& memcmp(state.scissors.data(), pScissors, sizeof(Rect2D) * scissorCount) == 0;
+	if (!redundant)
+	{
+		const bool& tracked = scissorCount <= BoundState::MaxViewports;
+		if (tracked)
+			memcpy(state.scissors.data(), pScissors, sizeof(Rect2D) * scissorCount);
+		state.scissorCount = tracked ? scissorCount : 0;
+	}
+	return CountFiltered(state, redundant);
+}
+
+void CommandBuffer::Transition(uint32_t index, const BufferRef& buffer, const ResourceState& desiredState)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	MIRU_FATAL(!m_CI.trackResourceStates, "ERROR: BASE: CommandBuffer::Transition() requires CreateInfo::trackResourceStates.");
+
+	TrackedResource& trackedResource = m_TrackedResources[index][buffer.get()];
+	if (trackedResource.resource.expired())
+	{
+		trackedResource.resource = buffer;
+		trackedResource.initialStates = ResourceStateTracker::Get().GetStates(buffer);
+		trackedResource.states = trackedResource.initialStates;
+	}
+
+	Barrier2::CreateInfo barrierCI = {};
+	barrierCI.type = Barrier::Type::BUFFER;
+	barrierCI.srcQueueFamilyIndex = Barrier2::QueueFamilyIgnored;
+	barrierCI.dstQueueFamilyIndex = Barrier2::QueueFamilyIgnored;
+	barrierCI.buffer = buffer;
+	barrierCI.offset = 0;
+	barrierCI.size = buffer->GetCreateInfo().size;
+	if (ResolveTransition(trackedResource.states[0], desiredState, barrierCI))
+	{
+		const Barrier2Handle barrier = CreateHandle(Barrier2::Create(&barrierCI));
+		PipelineBarrier2(index, DependencyBit::NONE_BIT, &barrier, 1);
+		DestroyHandle(barrier);
+	}
+}
+
+void CommandBuffer::Transition(uint32_t index, const ImageRef& image, const Image::SubresourceRange& subresourceRange, const ResourceState& desiredState)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	MIRU_FATAL(!m_CI.trackResourceStates, "ERROR: BASE: CommandBuffer::Transition() requires CreateInfo::trackResourceStates.");
+
+	TrackedResource& trackedResource = m_TrackedResources[index][image.get()];
+	if (trackedResource.resource.expired())
+	{
+		trackedResource.resource = image;
+		trackedResource.initialStates = ResourceStateTracker::Get().GetStates(image);
+		trackedResource.states = trackedResource.initialStates;
+	}
+
+	const Image::CreateInfo& imageCI = image->GetCreateInfo();
+	const uint32_t& mipEnd = static_cast<uint32_t>(std::min<uint64_t>(imageCI.mipLevels, static_cast<uint64_t>(subresourceRange.baseMipLevel) + subresourceRange.mipLevelCount));
+	const uint32_t& layerEnd = static_cast<uint32_t>(std::min<uint64_t>(imageCI.arrayLayers, static_cast<uint64_t>(subresourceRange.baseArrayLayer) + subresourceRange.arrayLayerCount));
+
+	Barrier2::CreateInfo barrierCI = {};
+	barrierCI.type = Barrier::Type::IMAGE;
+	barrierCI.srcQueueFamilyIndex = Barrier2::QueueFamilyIgnored;
+	barrierCI.dstQueueFamilyIndex = Barrier2::QueueFamilyIgnored;
+	barrierCI.image = image;
+
+	//The barriers are held by the HandlePool until they are recorded.
+	ScratchAllocator::Scope scope(m_Scratch[index]);
+	const uint32_t& maxBarrierCount = (mipEnd > subresourceRange.baseMipLevel ? mipEnd - subresourceRange.baseMipLevel : 0) * (layerEnd > subresourceRange.baseArrayLayer ? layerEnd - subresourceRange.baseArrayLayer : 0);
+	Barrier2Handle* barriers = m_Scratch[index].Allocate<Barrier2Handle>(maxBarrierCount);
+	uint32_t barrierCount = 0;
+	for (uint32_t mip = subresourceRange.baseMipLevel; mip < mipEnd; mip++)
+	{
+		//Consecutive array layers that need the same barrier share one.
+		bool pending = false;
+		for (uint32_t layer = subresourceRange.baseArrayLayer; layer < layerEnd; layer++)
+		{
+			Barrier2::CreateInfo layerBarrierCI = barrierCI;
+			if (!ResolveTransition(trackedResource.states[mip + layer * imageCI.mipLevels], desiredState, layerBarrierCI))
+			{
+				if (pending)
+					barriers[barrierCount++] = CreateHandle(Barrier2::Create(&barrierCI));
+				pending = false;
+				continue;
+			}
+
+			if (pending && layerBarrierCI.srcStageMask == barrierCI.srcStageMask && layerBarrierCI.srcAccess == barrierCI.srcAccess && layerBarrierCI.oldLayout == barrierCI.oldLayout)
+			{
+				barrierCI.subresourceRange.arrayLayerCount++;
+				continue;
+			}
+
+			if (pending)
+				barriers[barrierCount++] = CreateHandle(Barrier2::Create(&barrierCI));
+			barrierCI = layerBarrierCI;
+			barrierCI.subresourceRange = { subresourceRange.aspect, mip, 1, layer, 1 };
+			pending = true;
+		}
+		if (pending)
+			barriers[barrierCount++] = CreateHandle(Barrier2::Create(&barrierCI));
+	}
+
+	if (barrierCount > 0)
+		PipelineBarrier2(index, DependencyBit::NONE_BIT, barriers, barrierCount);
+	for (uint32_t i = 0; i < barrierCount; i++)
+		DestroyHandle(barriers[i]);
+}
+
+void CommandBuffer::ResetResourceStates(uint32_t index)
+{
+	if (!m_CI.trackResourceStates)
+		return;
+
+	m_TrackedResources[index].clear();
+}
+
+void CommandBuffer::CommitResourceStates(uint32_t index)
+{
+	if (!m_CI.trackResourceStates || !CheckValidIndex(index))
+		return;
+
+	for (auto& trackedResource : m_TrackedResources[index])
+	{
+		const Ref<void>& resource = trackedResource.second.resource.lock();
+		if (!resource)
+			continue;
+
+		const bool& expected = ResourceStateTracker::Get().SetStates(resource, trackedResource.second.initialStates, trackedResource.second.states);
+		MIRU_FATAL(!expected, "ERROR: BASE: A resource used with CommandBuffer::Transition() was not in the state that the CommandBuffer was recorded with. Re-record the CommandBuffer after the submissions that it depends on.");
+	}
+}
+
+bool CommandBuffer::ResolveTransition(ResourceState& state, const ResourceState& desiredState, Barrier2::CreateInfo& barrierCI)
+{
+	//A resource that has not been used since its creation has nothing to wait for.
+	const bool& layoutChange = barrierCI.type == Barrier::Type::IMAGE && state.layout != desiredState.layout;
+	if (state.stages == PipelineStageBit::NONE_BIT && !layoutChange)
+	{
+		state = desiredState;
+		return false;
+	}
+
+	barrierCI.srcStageMask = state.stages;
+	barrierCI.dstStageMask = desiredState.stages;
+	barrierCI.dstAccess = desiredState.access;
+	barrierCI.oldLayout = state.layout;
+	barrierCI.newLayout = desiredState.layout;
+
+	//Layout transitions and hazards involving a write wait for all previous uses. Only writes need to be made available.
+	const Barrier::AccessBit& writeAccess = ResourceStateTracker::GetWriteAccess(state.access);
+	if (layoutChange || writeAccess != Barrier::AccessBit::NONE_BIT || ResourceStateTracker::GetWriteAccess(desiredState.access) != Barrier::AccessBit::NONE_BIT)
+	{
+		barrierCI.srcAccess = writeAccess;
+		state = desiredState;
+		return true;
+	}
+
+	//Read after read: Only the stages and accesses that have not yet waited on the previous write need a barrier.
+	const PipelineStageBit& stages = state.stages | desiredState.stages;
+	const Barrier::AccessBit& access = state.access | desiredState.access;
+	if (stages == state.stages && access == state.access)
+		return false;
+
+	barrierCI.srcAccess = Barrier::AccessBit::NONE_BIT;
+	barrierCI.newLayout = state.layout;
+	state.stages = stages;
+	state.access = access;
+	return true;
 }
\ No newline at end of file
@@ -4,6 +4,10 @@
 #include "Pipeline.h"
 #include "Buffer.h"
 #include "AccelerationStructure.h"
+#include "HandlePool.h"
+#include "QueryPool.h"
+#include "ResourceStateTracker.h"
+#include "ScratchAllocator.h"
 
 namespace miru
 {
@@ -31,6 +35,8 @@ namespace base
 			ContextRef	context;
 			FlagBit		flags;
 			QueueType	queueType;
+			uint32_t	queueIndex = 0;	//Index of the queue within the QueueType's family. Vulkan: Clamped to the family's queue count.
+										//D3D12: Any index is valid; each new index creates another command queue of the QueueType.
 		};
 		//Methods
 	public:
@@ -40,6 +46,12 @@ namespace base
 
 		virtual void Trim() = 0;
 		virtual void Reset(bool releaseResources) = 0;
+		//Samples the queue's timestamp counter, in ticks, and the CPU's std::chrono::steady_clock, in nanoseconds since its epoch,
+		//at the same instant. Returns false if the device can not calibrate timestamps.
+		virtual bool GetCalibratedTimestamps(uint64_t& gpuTimestamp, uint64_t& cpuTimestamp) = 0;
+		//The queue family for Barrier::CreateInfo::srcQueueFamilyIndex and dstQueueFamilyIndex. D3D12 has no queue families
+		//and returns Barrier::QueueFamilyIgnored.
+		virtual uint32_t GetQueueFamilyIndex() = 0;
 
 		inline const CreateInfo& GetCreateInfo() const { return m_CI; }
 
@@ -86,6 +98,36 @@ namespace base
 			std::vector<SemaphoreSubmitInfo>		signalSemaphoreInfos;
 		};
 
+		//Indirect: Layouts of the arguments read from the buffer by the indirect commands.
+
+		struct DrawIndirectCommand
+		{
+			uint32_t vertexCount;
+			uint32_t instanceCount;
+			uint32_t firstVertex;
+			uint32_t firstInstance;
+		};
+		struct DrawIndexedIndirectCommand
+		{
+			uint32_t indexCount;
+			uint32_t instanceCount;
+			uint32_t firstIndex;
+			int32_t  vertexOffset;
+			uint32_t firstInstance;
+		};
+		struct DrawMeshTasksIndirectCommand
+		{
+			uint32_t groupCountX;
+			uint32_t groupCountY;
+			uint32_t groupCountZ;
+		};
+		struct DispatchIndirectCommand
+		{
+			uint32_t x;
+			uint32_t y;
+			uint32_t z;
+		};
+
 		//PipelineBarrier2
 
 		struct DependencyInfo
@@ -105,12 +147,40 @@ namespace base
 			PRIMARY,
 			SECONDARY
 		};
+		enum class SubpassContents : uint32_t
+		{
+			INLINE,
+			SECONDARY_COMMAND_BUFFERS
+		};
+		//State inherited by a Level::SECONDARY CommandBuffer that is executed inside a RenderPass or dynamic rendering.
+		//For D3D12, secondary CommandBuffers are bundles, which inherit the render targets, viewports and scissors of the calling
+		//CommandBuffer. Bundles can not bind DescriptorSets or call SetViewport() and SetScissor().
+		struct InheritanceInfo
+		{
+			FramebufferRef				framebuffer;				//If set, its RenderPass is inherited. Otherwise, dynamic rendering is inherited.
+			uint32_t					subpass;
+			RenderingFlagBits			renderingFlags;				//Dynamic rendering only.
+			uint32_t					viewMask;					//Dynamic rendering only.
+			std::vector<Image::Format>	colourAttachmentFormats;	//Dynamic rendering only.
+			Image::Format				depthAttachmentFormat;		//Dynamic rendering only.
+			Image::Format				stencilAttachmentFormat;	//Dynamic rendering only.
+			Image::SampleCountBit		rasterisationSamples;		//Dynamic rendering only.
+		};
 		struct CreateInfo
 		{
 			std::string		debugName;
 			CommandPoolRef	commandPool;
 			Level			level;
 			uint32_t		commandBufferCount;
+			bool			filterRedundantState = false;	//Drops binds and dynamic state identical to the state already set in the CommandBuffer.
+			bool			deferBarriers = false;			//Queues the barriers from PipelineBarrier2() and records them merged into one barrier command.
+			bool			trackResourceStates = false;	//Enables Transition(). The ResourceStateTracker is updated with the recorded states at Submit() and Submit2().
+		};
+		//Counts since the last Begin(). Only counted if CreateInfo::filterRedundantState is set.
+		struct StateFilterStatistics
+		{
+			uint64_t	issuedCount;	//Binds and dynamic state recorded to the native CommandBuffer.
+			uint64_t	filteredCount;	//Binds and dynamic state dropped as redundant.
 		};
 
 		//Methods
@@ -118,8 +188,11 @@ namespace base
 		static CommandBufferRef Create(CreateInfo* pCreateInfo);
 		virtual ~CommandBuffer() = default;
 		const CreateInfo& GetCreateInfo() { return m_CI; }
+		const StateFilterStatistics& GetStateFilterStatistics(uint32_t index) { return m_BoundStates[index].statistics; }
 
 		virtual void Begin(uint32_t index, UsageBit usage) = 0;
+		//For Level::SECONDARY only. UsageBit::RENDEER_PASS_CONTINUE is implied.
+		virtual void Begin(uint32_t index, UsageBit usage, const InheritanceInfo& inheritanceInfo) = 0;
 		virtual void End(uint32_t index) = 0;
 		virtual void Reset(uint32_t index, bool releaseResources) = 0;
 		virtual void ExecuteSecondaryCommandBuffers(uint32_t index, const CommandBufferRef& commandBuffer, const std::vector<uint32_t>& secondaryCommandBufferIndices) = 0;
@@ -129,15 +202,39 @@ namespace base
 		virtual void SetEvent(uint32_t index, const EventRef& event, PipelineStageBit pipelineStage) = 0;
 		virtual void ResetEvent(uint32_t index, const EventRef& event, PipelineStageBit pipelineStage) = 0;
 		virtual void WaitEvents(uint32_t index, const std::vector<EventRef>& events, PipelineStageBit srcStage, PipelineStageBit dstStage, const std::vector<BarrierRef>& barriers) = 0;
+		virtual void WaitEvents(uint32_t index, const EventRef* pEvents, uint32_t eventCount, PipelineStageBit srcStage, PipelineStageBit dstStage, const BarrierHandle* pBarriers, uint32_t barrierCount) = 0;
 		virtual void PipelineBarrier(uint32_t index, PipelineStageBit srcStage, PipelineStageBit dstStage, DependencyBit dependencies, const std::vector<BarrierRef>& barriers) = 0;
 		virtual void PipelineBarrier2(uint32_t index, const DependencyInfo& dependencyInfo) = 0;
+		//Overloads taking Handles resolve each object from its HandlePool without any reference counting.
+		//Overloads taking a pointer and a count do not allocate.
+		virtual void PipelineBarrier(uint32_t index, PipelineStageBit srcStage, PipelineStageBit dstStage, DependencyBit dependencies, const BarrierHandle* pBarriers, uint32_t barrierCount) = 0;
+		virtual void PipelineBarrier2(uint32_t index, DependencyBit dependencies, const Barrier2Handle* pBarriers, uint32_t barrierCount) = 0;
+		inline void PipelineBarrier(uint32_t index, PipelineStageBit srcStage, PipelineStageBit dstStage, DependencyBit dependencies, const std::vector<BarrierHandle>& barriers) { PipelineBarrier(index, srcStage, dstStage, dependencies, barriers.data(), static_cast<uint32_t>(barriers.size())); }
+		inline void PipelineBarrier2(uint32_t index, DependencyBit dependencies, const std::vector<Barrier2Handle>& barriers) { PipelineBarrier2(index, dependencies, barriers.data(), static_cast<uint32_t>(barriers.size())); }
+		//Records the barriers queued by PipelineBarrier2(), if CreateInfo::deferBarriers is set. Barriers on the same resource and
+		//with the same layouts and queue families are merged, with their stages and accesses combined. This is called implicitly
+		//before any command that executes work, before RenderPass and rendering boundaries, before SetEvent() and WaitEvents() and at End().
+		virtual void FlushBarriers(uint32_t index) = 0;
+
+		//Records the minimal Barrier2, if any, from the tracked state of the resource to desiredState. Requires CreateInfo::trackResourceStates.
+		//The state before the first Transition() of a resource since Begin() is read from the ResourceStateTracker. Layout changes from
+		//other barriers or RenderPasses and Transition() in Level::SECONDARY CommandBuffers are not tracked. The recorded barriers
+		//are only correct if the resources are still in those states when the CommandBuffer is submitted, so submitting it after
+		//another submission changed them is a fatal error. This includes resubmitting a recording whose Transition() calls changed them.
+		void Transition(uint32_t index, const BufferRef& buffer, const ResourceState& desiredState);
+		void Transition(uint32_t index, const ImageRef& image, const Image::SubresourceRange& subresourceRange, const ResourceState& desiredState);
 
-		virtual void ClearColourImage(uint32_t index, const ImageRef& image, Image::Layout layout, const Image::ClearColourValue& clear, const std::vector<Image::SubresourceRange>& subresourceRanges) = 0;
-		virtual void ClearDepthStencilImage(uint32_t index, const ImageRef& image, Image::Layout layout, const Image::ClearDepthStencilValue& clear, const std::vector<Image::SubresourceRange>& subresourceRanges) = 0;
+		//For D3D12, ClearColourImage() and ClearDepthStencilImage() create a temporary descriptor heap and views, so they always allocate.
+		virtual void ClearColourImage(uint32_t index, const ImageRef& image, Image::Layout layout, const Image::ClearColourValue& clear, const Image::SubresourceRange* pSubresourceRanges, uint32_t subresourceRangeCount) = 0;
+		virtual void ClearDepthStencilImage(uint32_t index, const ImageRef& image, Image::Layout layout, const Image::ClearDepthStencilValue& clear, const Image::SubresourceRange* pSubresourceRanges, uint32_t subresourceRangeCount) = 0;
+		inline void ClearColourImage(uint32_t index, const ImageRef& image, Image::Layout layout, const Image::ClearColourValue& clear, const std::vector<Image::SubresourceRange>& subresourceRanges) { ClearColourImage(index, image, layout, clear, subresourceRanges.data(), static_cast<uint32_t>(subresourceRanges.size())); }
+		inline void ClearDepthStencilImage(uint32_t index, const ImageRef& image, Image::Layout layout, const Image::ClearDepthStencilValue& clear, const std::vector<Image::SubresourceRange>& subresourceRanges) { ClearDepthStencilImage(index, image, layout, clear, subresourceRanges.data(), static_cast<uint32_t>(subresourceRanges.size())); }
 
-		virtual void BeginRenderPass(uint32_t index, const FramebufferRef& framebuffer, const std::vector<Image::ClearValue>& clearValues) = 0;
+		//For D3D12, BeginRenderPass() creates the Barriers for the attachments' initial layouts, so it always allocates.
+		virtual void BeginRenderPass(uint32_t index, const FramebufferRef& framebuffer, const Image::ClearValue* pClearValues, uint32_t clearValueCount, SubpassContents contents = SubpassContents::INLINE) = 0;
+		inline void BeginRenderPass(uint32_t index, const FramebufferRef& framebuffer, const std::vector<Image::ClearValue>& clearValues, SubpassContents contents = SubpassContents::INLINE) { BeginRenderPass(index, framebuffer, clearValues.data(), static_cast<uint32_t>(clearValues.size()), contents); }
 		virtual void EndRenderPass(uint32_t index) = 0;
-		virtual void NextSubpass(uint32_t index) = 0;
+		virtual void NextSubpass(uint32_t index, SubpassContents contents = SubpassContents::INLINE) = 0;
 
 		virtual void BeginRendering(uint32_t index, const RenderingInfo& renderingInfo) = 0;
 		virtual void EndRendering(uint32_t index) = 0;
@@ -146,8 +243,18 @@ namespace base
 
 		virtual void BindVertexBuffers(uint32_t index, const std::vector<BufferViewRef>& vertexBufferViews) = 0;
 		virtual void BindIndexBuffer(uint32_t index, const BufferViewRef& indexBufferView) = 0;
+		virtual void BindVertexBuffers(uint32_t index, const BufferViewHandle* pVertexBufferViews, uint32_t vertexBufferViewCount) = 0;
+		inline void BindVertexBuffers(uint32_t index, const std::vector<BufferViewHandle>& vertexBufferViews) { BindVertexBuffers(index, vertexBufferViews.data(), static_cast<uint32_t>(vertexBufferViews.size())); }
+		virtual void BindIndexBuffer(uint32_t index, const BufferViewHandle& indexBufferView) = 0;
 
-		virtual void BindDescriptorSets(uint32_t index, const std::vector<DescriptorSetRef>& descriptorSets, uint32_t firstSet, const PipelineRef& pipeline) = 0;
+		//dynamicOffsets has one offset in bytes per DescriptorType::UNIFORM_BUFFER_DYNAMIC and STORAGE_BUFFER_DYNAMIC descriptor in the
+		//descriptorSets, ordered by set and then by binding. Each offset is added to the offset of the descriptor's BufferView.
+		virtual void BindDescriptorSets(uint32_t index, const std::vector<DescriptorSetRef>& descriptorSets, uint32_t firstSet, const PipelineRef& pipeline, const std::vector<uint32_t>& dynamicOffsets = {}) = 0;
+		virtual void BindDescriptorSets(uint32_t index, const DescriptorSetHandle* pDescriptorSets, uint32_t descriptorSetCount, uint32_t firstSet, const PipelineRef& pipeline, const uint32_t* pDynamicOffsets = nullptr, uint32_t dynamicOffsetCount = 0) = 0;
+		inline void BindDescriptorSets(uint32_t index, const std::vector<DescriptorSetHandle>& descriptorSets, uint32_t firstSet, const PipelineRef& pipeline, const std::vector<uint32_t>& dynamicOffsets = {}) { BindDescriptorSets(index, descriptorSets.data(), static_cast<uint32_t>(descriptorSets.size()), firstSet, pipeline, dynamicOffsets.data(), static_cast<uint32_t>(dynamicOffsets.size())); }
+
+		//Offset and size are in bytes and must be multiples of 4. For D3D12, the bytes are written to each PushConstantRange that they overlap.
+		virtual void PushConstants(uint32_t index, const PipelineRef& pipeline, Shader::StageBit stages, uint32_t offset, uint32_t size, const void* pValues) = 0;
 
 		virtual void DrawIndexed(uint32_t index, uint32_t indexCount, uint32_t instanceCount = 1, uint32_t firstIndex = 0, int32_t vertexOffset = 0, uint32_t firstInstance = 0) = 0;
 		virtual void Draw(uint32_t index, uint32_t vertexCount, uint32_t instanceCount = 1, uint32_t firstVertex = 0, uint32_t firstInstance = 0) = 0;
@@ -155,26 +262,208 @@ namespace base
 
 		virtual void Dispatch(uint32_t index, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) = 0;
 
-		virtual void BuildAccelerationStructure(uint32_t index, const std::vector<AccelerationStructureBuildInfoRef>& buildGeometryInfos, const std::vector<std::vector<AccelerationStructureBuildInfo::BuildRangeInfo>>& buildRangeInfos) = 0;
+		//The buffer must be created with Buffer::UsageBit::INDIRECT_BIT. Offsets are in bytes and must be multiples of 4.
+		//Count variants read the draw count as a uint32_t from the countBuffer and clamp it to maxDrawCount.
+		virtual void DrawIndirect(uint32_t index, const BufferRef& buffer, uint64_t offset, uint32_t drawCount, uint32_t stride = sizeof(DrawIndirectCommand)) = 0;
+		virtual void DrawIndexedIndirect(uint32_t index, const BufferRef& buffer, uint64_t offset, uint32_t drawCount, uint32_t stride = sizeof(DrawIndexedIndirectCommand)) = 0;
+		virtual void DrawIndirectCount(uint32_t index, const BufferRef& buffer, uint64_t offset, const BufferRef& countBuffer, uint64_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride = sizeof(DrawIndirectCommand)) = 0;
+		virtual void DrawIndexedIndirectCount(uint32_t index, const BufferRef& buffer, uint64_t offset, const BufferRef& countBuffer, uint64_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride = sizeof(DrawIndexedIndirectCommand)) = 0;
+		virtual void DrawMeshTasksIndirect(uint32_t index, const BufferRef& buffer, uint64_t offset, uint32_t drawCount, uint32_t stride = sizeof(DrawMeshTasksIndirectCommand)) = 0;
+		virtual void DrawMeshTasksIndirectCount(uint32_t index, const BufferRef& buffer, uint64_t offset, const BufferRef& countBuffer, uint64_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride = sizeof(DrawMeshTasksIndirectCommand)) = 0;
+		virtual void DispatchIndirect(uint32_t index, const BufferRef& buffer, uint64_t offset) = 0;
+
+		//ppBuildRangeInfos has one array per build geometry info, with one BuildRangeInfo per geometry.
+		virtual void BuildAccelerationStructure(uint32_t index, const AccelerationStructureBuildInfoRef* pBuildGeometryInfos, uint32_t buildGeometryInfoCount, const AccelerationStructureBuildInfo::BuildRangeInfo* const* ppBuildRangeInfos) = 0;
+		void BuildAccelerationStructure(uint32_t index, const std::vector<AccelerationStructureBuildInfoRef>& buildGeometryInfos, const std::vector<std::vector<AccelerationStructureBuildInfo::BuildRangeInfo>>& buildRangeInfos);
 		virtual void TraceRays(uint32_t index, const StridedDeviceAddressRegion* pRaygenShaderBindingTable, const StridedDeviceAddressRegion* pMissShaderBindingTable, const StridedDeviceAddressRegion* pHitShaderBindingTable, const StridedDeviceAddressRegion* pCallableShaderBindingTable, uint32_t width, uint32_t height, uint32_t depth) = 0;
 
-		virtual void CopyBuffer(uint32_t index, const BufferRef& srcBuffer, const BufferRef& dstBuffer, const std::vector<Buffer::Copy>& copyRegions) = 0;
-		virtual void CopyImage(uint32_t index, const ImageRef& srcImage, Image::Layout srcImageLayout, const ImageRef& dstImage, Image::Layout dstImageLayout, const std::vector<Image::Copy>& copyRegions) = 0;
-		virtual void CopyBufferToImage(uint32_t index, const BufferRef& srcBuffer, const ImageRef& dstImage, Image::Layout dstImageLayout, const std::vector<Image::BufferImageCopy>& regions) = 0;
-		virtual void CopyImageToBuffer(uint32_t index, const ImageRef& srcImage, const BufferRef& dstBuffer, Image::Layout srcImageLayout, const std::vector<Image::BufferImageCopy>& regions) = 0;
+		virtual void CopyBuffer(uint32_t index, const BufferRef& srcBuffer, const BufferRef& dstBuffer, const Buffer::Copy* pCopyRegions, uint32_t copyRegionCount) = 0;
+		inline void CopyBuffer(uint32_t index, const BufferRef& srcBuffer, const BufferRef& dstBuffer, const std::vector<Buffer::Copy>& copyRegions) { CopyBuffer(index, srcBuffer, dstBuffer, copyRegions.data(), static_cast<uint32_t>(copyRegions.size())); }
+		virtual void CopyImage(uint32_t index, const ImageRef& srcImage, Image::Layout srcImageLayout, const ImageRef& dstImage, Image::Layout dstImageLayout, const Image::Copy* pCopyRegions, uint32_t copyRegionCount) = 0;
+		virtual void CopyBufferToImage(uint32_t index, const BufferRef& srcBuffer, const ImageRef& dstImage, Image::Layout dstImageLayout, const Image::BufferImageCopy* pRegions, uint32_t regionCount) = 0;
+		virtual void CopyImageToBuffer(uint32_t index, const ImageRef& srcImage, const BufferRef& dstBuffer, Image::Layout srcImageLayout, const Image::BufferImageCopy* pRegions, uint32_t regionCount) = 0;
+		inline void CopyImage(uint32_t index, const ImageRef& srcImage, Image::Layout srcImageLayout, const ImageRef& dstImage, Image::Layout dstImageLayout, const std::vector<Image::Copy>& copyRegions) { CopyImage(index, srcImage, srcImageLayout, dstImage, dstImageLayout, copyRegions.data(), static_cast<uint32_t>(copyRegions.size())); }
+		inline void CopyBufferToImage(uint32_t index, const BufferRef& srcBuffer, const ImageRef& dstImage, Image::Layout dstImageLayout, const std::vector<Image::BufferImageCopy>& regions) { CopyBufferToImage(index, srcBuffer, dstImage, dstImageLayout, regions.data(), static_cast<uint32_t>(regions.size())); }
+		inline void CopyImageToBuffer(uint32_t index, const ImageRef& srcImage, const BufferRef& dstBuffer, Image::Layout srcImageLayout, const std::vector<Image::BufferImageCopy>& regions) { CopyImageToBuffer(index, srcImage, dstBuffer, srcImageLayout, regions.data(), static_cast<uint32_t>(regions.size())); }
 
-		virtual void ResolveImage(uint32_t index, const ImageRef& srcImage, Image::Layout srcImageLayout, const ImageRef& dstImage, Image::Layout dstImageLayout, const std::vector<Image::Resolve>& resolveRegions) = 0;
+		//For D3D12, ResolveImage() creates the Barriers to and from the resolve states, so it always allocates.
+		virtual void ResolveImage(uint32_t index, const ImageRef& srcImage, Image::Layout srcImageLayout, const ImageRef& dstImage, Image::Layout dstImageLayout, const Image::Resolve* pResolveRegions, uint32_t resolveRegionCount) = 0;
+		inline void ResolveImage(uint32_t index, const ImageRef& srcImage, Image::Layout srcImageLayout, const ImageRef& dstImage, Image::Layout dstImageLayout, const std::vector<Image::Resolve>& resolveRegions) { ResolveImage(index, srcImage, srcImageLayout, dstImage, dstImageLayout, resolveRegions.data(), static_cast<uint32_t>(resolveRegions.size())); }
+
+		//Queries must be reset before they are written. ResetQueryPool() must be recorded outside of a RenderPass or rendering.
+		//WriteTimestamp() writes the timestamp once the previous commands have completed stage. D3D12 ignores the stage.
+		//Without SYNCHRONISATION_2, Vulkan writes the timestamp at BOTTOM_OF_PIPE_BIT if stage has multiple or SYNCHRONISATION_2 only bits.
+		//Type::OCCLUSION queries that are not precise may only count whether any samples have passed.
+		//CopyQueryPoolResults() waits for the queries and writes their results tightly packed, with QueryPool::GetResultSize() bytes
+		//per query, to the dstBuffer at dstOffset, which must be a multiple of 8.
+		virtual void ResetQueryPool(uint32_t index, const QueryPoolRef& queryPool, uint32_t firstQuery, uint32_t queryCount) = 0;
+		virtual void BeginQuery(uint32_t index, const QueryPoolRef& queryPool, uint32_t query, bool precise = false) = 0;
+		virtual void EndQuery(uint32_t index, const QueryPoolRef& queryPool, uint32_t query) = 0;
+		virtual void WriteTimestamp(uint32_t index, PipelineStageBit stage, const QueryPoolRef& queryPool, uint32_t query) = 0;
+		virtual void CopyQueryPoolResults(uint32_t index, const QueryPoolRef& queryPool, uint32_t firstQuery, uint32_t queryCount, const BufferRef& dstBuffer, uint64_t dstOffset) = 0;
 
 		virtual void BeginDebugLabel(uint32_t index, const std::string& label, std::array<float, 4> rgba = {0.0f, 0.0f , 0.0f, 0.0f }) = 0;
 		virtual void EndDebugLabel(uint32_t index) = 0;
+		//If set, BeginDebugLabel() and EndDebugLabel() also begin and end a scope in the GpuProfiler. Do not set it on
+		//CommandBuffers that are executed in several frames without being re-recorded.
+		inline void SetGpuProfiler(const GpuProfilerRef& gpuProfiler) { m_GpuProfiler = gpuProfiler; }
 
-		virtual void SetViewport(uint32_t index, const std::vector<Viewport>& viewports) = 0;
-		virtual void SetScissor(uint32_t index, const std::vector<Rect2D>& scissors) = 0;
+		virtual void SetViewport(uint32_t index, const Viewport* pViewports, uint32_t viewportCount) = 0;
+		virtual void SetScissor(uint32_t index, const Rect2D* pScissors, uint32_t scissorCount) = 0;
+		inline void SetViewport(uint32_t index, const std::vector<Viewport>& viewports) { SetViewport(index, viewports.data(), static_cast<uint32_t>(viewports.size())); }
+		inline void SetScissor(uint32_t index, const std::vector<Rect2D>& scissors) { SetScissor(index, scissors.data(), static_cast<uint32_t>(scissors.size())); }
 
 	protected:
 		inline bool CheckValidIndex(uint32_t index) { return (index < m_CI.commandBufferCount); }
 		#define CHECK_VALID_INDEX_RETURN(index) if (!CheckValidIndex(index)) {return;}
 
+		//Redundant state filtering: Each Filter function returns true if the command matches the shadow state and
+		//should be dropped. Otherwise, the shadow state is updated and the command should be recorded.
+		//Objects are compared by address, which is unique for the lifetime of the recording.
+		void ResetBoundState(uint32_t index);		//At Begin(). Also resets the statistics.
+		void InvalidateBoundState(uint32_t index);	//At RenderPass boundaries and after executing secondary CommandBuffers.
+		bool FilterPipeline(uint32_t index, const Pipeline* pipeline);
+		bool FilterIndexBuffer(uint32_t index, const BufferView* indexBufferView);
+		bool FilterViewports(uint32_t index, const Viewport* pViewports, uint32_t viewportCount);
+		bool FilterScissors(uint32_t index, const Rect2D* pScissors, uint32_t scissorCount);
+		template<typename T>
+		bool FilterVertexBuffers(uint32_t index, const T* pVertexBufferViews, uint32_t vertexBufferViewCount)
+		{
+			if (!m_CI.filterRedundantState)
+				return false;
+
+			BoundState& state = m_BoundStates[index];
+			bool redundant = vertexBufferViewCount <= state.vertexBufferCount;
+			for (uint32_t i = 0; i < vertexBufferViewCount && redundant; i++)
+				redundant = state.vertexBuffers[i] == GetBoundObject(pVertexBufferViews[i]);
+			if (!redundant)
+			{
+				const bool& tracked = vertexBufferViewCount <= BoundState::MaxVertexBuffers;
+				for (uint32_t i = 0; i < vertexBufferViewCount && tracked; i++)
+					state.vertexBuffers[i] = GetBoundObject(pVertexBufferViews[i]);
+				state.vertexBufferCount = tracked ? vertexBufferViewCount : 0;
+			}
+			return CountFiltered(state, redundant);
+		}
+		template<typename T>
+		bool FilterDescriptorSets(uint32_t index, const T* pDescriptorSets, uint32_t descriptorSetCount, uint32_t firstSet, const Pipeline* pipeline, uint32_t dynamicOffsetCount)
+		{
+			if (!m_CI.filterRedundantState)
+				return false;
+
+			//Sets bound with another Pipeline may have been bound with an incompatible pipeline layout.
+			BoundState& state = m_BoundStates[index];
+			if (state.descriptorSetPipeline != pipeline)
+			{
+				state.descriptorSets.fill(nullptr);
+				state.descriptorSetPipeline = pipeline;
+			}
+
+			//Binds with dynamic offsets are always recorded, as the offsets usually change with every bind.
+			const bool& tracked = firstSet + descriptorSetCount <= BoundState::MaxDescriptorSets;
+			bool redundant = tracked && dynamicOffsetCount == 0;
+			for (uint32_t i = 0; i < descriptorSetCount && redundant; i++)
+				redundant = state.descriptorSets[firstSet + i] && state.descriptorSets[firstSet + i] == GetBoundObject(pDescriptorSets[i]);
+			if (!redundant)
+			{
+				if (tracked)
+				{
+					for (uint32_t i = 0; i < descriptorSetCount; i++)
+						state.descriptorSets[firstSet + i] = GetBoundObject(pDescriptorSets[i]);
+				}
+				else
+				{
+					state.descriptorSets.fill(nullptr);
+				}
+			}
+			return CountFiltered(state, redundant);
+		}
+
+		//Resource state tracking
+		void ResetResourceStates(uint32_t index);	//At Begin().
+		void CommitResourceStates(uint32_t index);	//At Submit() and Submit2(), for each submitted index.
+		friend class SubmissionQueue;				//Commits the resource states at SubmissionQueue::Add().
+
+	private:
+		static bool ResolveTransition(ResourceState& state, const ResourceState& desiredState, Barrier2::CreateInfo& barrierCI);
+
+		static inline const BufferView* GetBoundObject(const BufferViewRef& bufferView) { return bufferView.get(); }
+		static inline const BufferView* GetBoundObject(const BufferView* bufferView) { return bufferView; }
+		static inline const DescriptorSet* GetBoundObject(const DescriptorSetRef& descriptorSet) { return descriptorSet.get(); }
+		static inline const DescriptorSet* GetBoundObject(const DescriptorSet* descriptorSet) { return descriptorSet; }
+
+	protected:
+		struct BoundState
+		{
+			static constexpr uint32_t MaxDescriptorSets = 8;
+			static constexpr uint32_t MaxVertexBuffers = 32;
+			static constexpr uint32_t MaxViewports = 16;
+
+			const Pipeline*										pipeline;
+			const Pipeline*										descriptorSetPipeline;	//The Pipeline whose layout the descriptorSets were bound with.
+			std::array<const DescriptorSet*, MaxDescriptorSets>	descriptorSets;
+			std::array<const BufferView*, MaxVertexBuffers>		vertexBuffers;
+			uint32_t											vertexBufferCount;
+			const BufferView*									indexBuffer;
+			std::array<Viewport, MaxViewports>					viewports;
+			uint32_t											viewportCount;
+			std::array<Rect2D, MaxViewports>					scissors;
+			uint32_t											scissorCount;
+			StateFilterStatistics								statistics;
+		};
+		static inline bool CountFiltered(BoundState& state, bool redundant)
+		{
+			if (redundant)
+				state.statistics.filteredCount++;
+			else
+				state.statistics.issuedCount++;
+			return redundant;
+		}
+
+		struct TrackedResource
+		{
+			std::weak_ptr<void>			resource;
+			std::vector<ResourceState>	initialStates;	//The global states at the first Transition() of the resource.
+			std::vector<ResourceState>	states;
+		};
+
+		//Members
+	protected:
+		CreateInfo m_CI = {};
+		std::vector<ScratchAllocator> m_Scratch;	//Per command buffer. Used to translate arguments for the native commands.
+		std::vector<BoundState> m_BoundStates;	//Shadow state for redundant state filtering.
+		std::vector<std::unordered_map<const void*, TrackedResource>> m_TrackedResources;	//Resource states for Transition().
+		GpuProfilerRef m_GpuProfiler;	//Scopes for the debug labels.
+	};
+
+	//Collects the SubmitInfo2 batches of many CommandBuffers and submits them to a queue in a single call at Flush().
+	//CommandBuffers can be from any CommandPool that submits to the same queue as CreateInfo::commandPool.
+	//Batches are submitted in the order they were added. A batch without waits is merged into the previous batch, if that
+	//has no signals. Add() and Flush() can be called from any thread.
+	class MIRU_API SubmissionQueue
+	{
+		//enums/structs
+	public:
+		struct CreateInfo
+		{
+			std::string		debugName;
+			CommandPoolRef	commandPool;	//Selects the queue.
+		};
+
+		//Methods
+	public:
+		static SubmissionQueueRef Create(CreateInfo* pCreateInfo);
+		virtual ~SubmissionQueue() = default;
+		const CreateInfo& GetCreateInfo() { return m_CI; }
+
+		//Appends the batches for commandBuffer. The CommandBuffers must not be modified until they are flushed.
+		virtual void Add(const CommandBufferRef& commandBuffer, const std::vector<CommandBuffer::SubmitInfo2>& submitInfo2s) = 0;
+		//Submits all pending batches. fence is signalled once they have completed. Call at the frame's sync points.
+		virtual void Flush(const FenceRef& fence) = 0;
+
+	protected:
+		static inline void CommitResourceStates(const CommandBufferRef& commandBuffer, uint32_t index) { commandBuffer->CommitResourceStates(index); }
+
 		//Members
 	protected:
 		CreateInfo m_CI = {};
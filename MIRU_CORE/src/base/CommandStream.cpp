@@ -0,0 +1,285 @@
+#include "miru_core_common.h"
+#include "CommandStream.h"
+
+using namespace miru;
+using namespace base;
+
+CommandStreamRef CommandStream::Create(CreateInfo* pCreateInfo)
+{
+	return CreateRef<CommandStream>(pCreateInfo);
+}
+
+CommandStream::CommandStream(CreateInfo* pCreateInfo)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_CI = *pCreateInfo;
+	m_Data.reserve(arc::Align<size_t>(m_CI.initialSize, sizeof(uint64_t)) / sizeof(uint64_t));
+}
+
+void CommandStream::Reset()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_Data.clear();
+	m_CommandCount = 0;
+	m_Pipelines.clear();
+	m_Buffers.clear();
+}
+
+void CommandStream::Record(const CommandBufferRef& commandBuffer, uint32_t index) const
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	const uint8_t* data = reinterpret_cast<const uint8_t*>(m_Data.data());
+	const uint8_t* end = data + GetSize();
+	while (data < end)
+	{
+		const PacketHeader* header = reinterpret_cast<const PacketHeader*>(data);
+		switch (header->opcode)
+		{
+		case Opcode::PIPELINE_BARRIER2:
+		{
+			const PipelineBarrier2Packet* packet = reinterpret_cast<const PipelineBarrier2Packet*>(header + 1);
+			commandBuffer->PipelineBarrier2(index, packet->dependencies, GetTrailing<Barrier2Handle>(packet), packet->barrierCount);
+			break;
+		}
+		case Opcode::BIND_PIPELINE:
+		{
+			const BindPipelinePacket* packet = reinterpret_cast<const BindPipelinePacket*>(header + 1);
+			commandBuffer->BindPipeline(index, m_Pipelines[packet->pipeline]);
+			break;
+		}
+		case Opcode::BIND_VERTEX_BUFFERS:
+		{
+			const BindVertexBuffersPacket* packet = reinterpret_cast<const BindVertexBuffersPacket*>(header + 1);
+			commandBuffer->BindVertexBuffers(index, GetTrailing<BufferViewHandle>(packet), packet->vertexBufferViewCount);
+			break;
+		}
+		case Opcode::BIND_INDEX_BUFFER:
+		{
+			const BindIndexBufferPacket* packet = reinterpret_cast<const BindIndexBufferPacket*>(header + 1);
+			commandBuffer->BindIndexBuffer(index, packet->indexBufferView);
+			break;
+		}
+		case Opcode::BIND_DESCRIPTOR_SETS:
+		{
+			const BindDescriptorSetsPacket* packet = reinterpret_cast<const BindDescriptorSetsPacket*>(header + 1);
+			const DescriptorSetHandle* pDescriptorSets = GetTrailing<DescriptorSetHandle>(packet);
+			const uint32_t* pDynamicOffsets = GetTrailing<uint32_t>(packet, sizeof(DescriptorSetHandle) * packet->descriptorSetCount);
+			commandBuffer->BindDescriptorSets(index, pDescriptorSets, packet->descriptorSetCount, packet->firstSet, m_Pipelines[packet->pipeline], pDynamicOffsets, packet->dynamicOffsetCount);
+			break;
+		}
+		case Opcode::PUSH_CONSTANTS:
+		{
+			const PushConstantsPacket* packet = reinterpret_cast<const PushConstantsPacket*>(header + 1);
+			commandBuffer->PushConstants(index, m_Pipelines[packet->pipeline], packet->stages, packet->offset, packet->size, GetTrailing<uint8_t>(packet));
+			break;
+		}
+		case Opcode::SET_VIEWPORT:
+		{
+			const SetViewportPacket* packet = reinterpret_cast<const SetViewportPacket*>(header + 1);
+			commandBuffer->SetViewport(index, GetTrailing<Viewport>(packet), packet->viewportCount);
+			break;
+		}
+		case Opcode::SET_SCISSOR:
+		{
+			const SetScissorPacket* packet = reinterpret_cast<const SetScissorPacket*>(header + 1);
+			commandBuffer->SetScissor(index, GetTrailing<Rect2D>(packet), packet->scissorCount);
+			break;
+		}
+		case Opcode::DRAW:
+		{
+			const DrawPacket* packet = reinterpret_cast<const DrawPacket*>(header + 1);
+			commandBuffer->Draw(index, packet->vertexCount, packet->instanceCount, packet->firstVertex, packet->firstInstance);
+			break;
+		}
+		case Opcode::DRAW_INDEXED:
+		{
+			const DrawIndexedPacket* packet = reinterpret_cast<const DrawIndexedPacket*>(header + 1);
+			commandBuffer->DrawIndexed(index, packet->indexCount, packet->instanceCount, packet->firstIndex, packet->vertexOffset, packet->firstInstance);
+			break;
+		}
+		case Opcode::DRAW_MESH_TASKS:
+		{
+			const GroupCountPacket* packet = reinterpret_cast<const GroupCountPacket*>(header + 1);
+			commandBuffer->DrawMeshTasks(index, packet->groupCountX, packet->groupCountY, packet->groupCountZ);
+			break;
+		}
+		case Opcode::DISPATCH:
+		{
+			const GroupCountPacket* packet = reinterpret_cast<const GroupCountPacket*>(header + 1);
+			commandBuffer->Dispatch(index, packet->groupCountX, packet->groupCountY, packet->groupCountZ);
+			break;
+		}
+		case Opcode::DRAW_INDIRECT:
+		{
+			const IndirectPacket* packet = reinterpret_cast<const IndirectPacket*>(header + 1);
+			commandBuffer->DrawIndirect(index, m_Buffers[packet->buffer], packet->offset, packet->drawCount, packet->stride);
+			break;
+		}
+		case Opcode::DRAW_INDEXED_INDIRECT:
+		{
+			const IndirectPacket* packet = reinterpret_cast<const IndirectPacket*>(header + 1);
+			commandBuffer->DrawIndexedIndirect(index, m_Buffers[packet->buffer], packet->offset, packet->drawCount, packet->stride);
+			break;
+		}
+		case Opcode::DISPATCH_INDIRECT:
+		{
+			const IndirectPacket* packet = reinterpret_cast<const IndirectPacket*>(header + 1);
+			commandBuffer->DispatchIndirect(index, m_Buffers[packet->buffer], packet->offset);
+			break;
+		}
+		case Opcode::BEGIN_DEBUG_LABEL:
+		{
+			const BeginDebugLabelPacket* packet = reinterpret_cast<const BeginDebugLabelPacket*>(header + 1);
+			const std::array<float, 4> rgba = { packet->rgba[0], packet->rgba[1], packet->rgba[2], packet->rgba[3] };
+			commandBuffer->BeginDebugLabel(index, std::string(GetTrailing<char>(packet), packet->length), rgba);
+			break;
+		}
+		case Opcode::END_DEBUG_LABEL:
+		{
+			commandBuffer->EndDebugLabel(index);
+			break;
+		}
+		default:
+			MIRU_FATAL(true, "ERROR: BASE: Unknown CommandStream::Opcode.");
+		}
+		data += header->size;
+	}
+}
+
+void CommandStream::PipelineBarrier2(DependencyBit dependencies, const Barrier2Handle* pBarriers, uint32_t barrierCount)
+{
+	PipelineBarrier2Packet* packet = Append<PipelineBarrier2Packet>(Opcode::PIPELINE_BARRIER2, sizeof(Barrier2Handle) * barrierCount);
+	packet->dependencies = dependencies;
+	packet->barrierCount = barrierCount;
+	memcpy(GetTrailing<Barrier2Handle>(packet), pBarriers, sizeof(Barrier2Handle) * barrierCount);
+}
+
+void CommandStream::BindPipeline(const PipelineRef& pipeline)
+{
+	BindPipelinePacket* packet = Append<BindPipelinePacket>(Opcode::BIND_PIPELINE);
+	packet->pipeline = GetPipelineIndex(pipeline);
+}
+
+void CommandStream::BindVertexBuffers(const BufferViewHandle* pVertexBufferViews, uint32_t vertexBufferViewCount)
+{
+	BindVertexBuffersPacket* packet = Append<BindVertexBuffersPacket>(Opcode::BIND_VERTEX_BUFFERS, sizeof(BufferViewHandle) * vertexBufferViewCount);
+	packet->vertexBufferViewCount = vertexBufferViewCount;
+	memcpy(GetTrailing<BufferViewHandle>(packet), pVertexBufferViews, sizeof(BufferViewHandle) * vertexBufferViewCount);
+}
+
+void CommandStream::BindIndexBuffer(const BufferViewHandle& indexBufferView)
+{
+	BindIndexBufferPacket* packet = Append<BindIndexBufferPacket>(Opcode::BIND_INDEX_BUFFER);
+	packet->indexBufferView = indexBufferView;
+}
+
+void CommandStream::BindDescriptorSets(const DescriptorSetHandle* pDescriptorSets, uint32_t descriptorSetCount, uint32_t firstSet, const PipelineRef& pipeline, const uint32_t* pDynamicOffsets, uint32_t dynamicOffsetCount)
+{
+	const size_t& descriptorSetsSize = sizeof(DescriptorSetHandle) * descriptorSetCount;
+	const size_t& dynamicOffsetsSize = sizeof(uint32_t) * dynamicOffsetCount;
+	const uint32_t& pipelineIndex = GetPipelineIndex(pipeline);
+
+	BindDescriptorSetsPacket* packet = Append<BindDescriptorSetsPacket>(Opcode::BIND_DESCRIPTOR_SETS, descriptorSetsSize + dynamicOffsetsSize);
+	packet->pipeline = pipelineIndex;
+	packet->firstSet = firstSet;
+	packet->descriptorSetCount = descriptorSetCount;
+	packet->dynamicOffsetCount = dynamicOffsetCount;
+	memcpy(GetTrailing<DescriptorSetHandle>(packet), pDescriptorSets, descriptorSetsSize);
+	if (dynamicOffsetCount)
+		memcpy(GetTrailing<uint32_t>(packet, descriptorSetsSize), pDynamicOffsets, dynamicOffsetsSize);
+}
+
+void CommandStream::PushConstants(const PipelineRef& pipeline, Shader::StageBit stages, uint32_t offset, uint32_t size, const void* pValues)
+{
+	const uint32_t& pipelineIndex = GetPipelineIndex(pipeline);
+
+	PushConstantsPacket* packet = Append<PushConstantsPacket>(Opcode::PUSH_CONSTANTS, size);
+	packet->pipeline = pipelineIndex;
+	packet->stages = stages;
+	packet->offset = offset;
+	packet->size = size;
+	memcpy(GetTrailing<uint8_t>(packet), pValues, size);
+}
+
+void CommandStream::SetViewport(const Viewport* pViewports, uint32_t viewportCount)
+{
+	SetViewportPacket* packet = Append<SetViewportPacket>(Opcode::SET_VIEWPORT, sizeof(Viewport) * viewportCount);
+	packet->viewportCount = viewportCount;
+	memcpy(GetTrailing<Viewport>(packet), pViewports, sizeof(Viewport) * viewportCount);
+}
+
+void CommandStream::SetScissor(const Rect2D* pScissors, uint32_t scissorCount)
+{
+	SetScissorPacket* packet = Append<SetScissorPacket>(Opcode::SET_SCISSOR, sizeof(Rect2D) * scissorCount);
+	packet->scissorCount = scissorCount;
+	memcpy(GetTrailing<Rect2D>(packet), pScissors, sizeof(Rect2D) * scissorCount);
+}
+
+void CommandStream::Draw(uint32_t vertexCount, uint32_t instanceCount, uint32_t firstVertex, uint32_t firstInstance)
+{
+	*Append<DrawPacket>(Opcode::DRAW) = { vertexCount, instanceCount, firstVertex, firstInstance };
+}
+
+void CommandStream::DrawIndexed(uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance)
+{
+	*Append<DrawIndexedPacket>(Opcode::DRAW_INDEXED) = { indexCount, instanceCount, firstIndex, vertexOffset, firstInstance };
+}
+
+void CommandStream::DrawMeshTasks(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
+{
+	*Append<GroupCountPacket>(Opcode::DRAW_MESH_TASKS) = { groupCountX, groupCountY, groupCountZ };
+}
+
+void CommandStream::Dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
+{
+	*Append<GroupCountPacket>(Opcode::DISPATCH) = { groupCountX, groupCountY, groupCountZ };
+}
+
+void CommandStream::DrawIndirect(const BufferRef& buffer, uint64_t offset, uint32_t drawCount, uint32_t stride)
+{
+	const uint32_t& bufferIndex = GetBufferIndex(buffer);
+	*Append<IndirectPacket>(Opcode::DRAW_INDIRECT) = { offset, bufferIndex, drawCount, stride };
+}
+
+void CommandStream::DrawIndexedIndirect(const BufferRef& buffer, uint64_t offset, uint32_t drawCount, uint32_t stride)
+{
+	const uint32_t& bufferIndex = GetBufferIndex(buffer);
+	*Append<IndirectPacket>(Opcode::DRAW_INDEXED_INDIRECT) = { offset, bufferIndex, drawCount, stride };
+}
+
+void CommandStream::DispatchIndirect(const BufferRef& buffer, uint64_t offset)
+{
+	const uint32_t& bufferIndex = GetBufferIndex(buffer);
+	*Append<IndirectPacket>(Opcode::DISPATCH_INDIRECT) = { offset, bufferIndex, 1, 0 };
+}
+
+void CommandStream::BeginDebugLabel(const std::string& label, std::array<float, 4> rgba)
+{
+	BeginDebugLabelPacket* packet = Append<BeginDebugLabelPacket>(Opcode::BEGIN_DEBUG_LABEL, label.size());
+	memcpy(packet->rgba, rgba.data(), sizeof(packet->rgba));
+	packet->length = static_cast<uint32_t>(label.size());
+	memcpy(GetTrailing<char>(packet), label.data(), label.size());
+}
+
+void CommandStream::EndDebugLabel()
+{
+	Append<EmptyPacket>(Opcode::END_DEBUG_LABEL);
+}
+
+uint32_t CommandStream::GetPipelineIndex(const PipelineRef& pipeline)
+{
+	//Consecutive commands usually use the same Pipeline.
+	if (m_Pipelines.empty() || m_Pipelines.back() != pipeline)
+		m_Pipelines.push_back(pipeline);
+	return static_cast<uint32_t>(m_Pipelines.size() - 1);
+}
+
+uint32_t CommandStream::GetBufferIndex(const BufferRef& buffer)
+{
+	if (m_Buffers.empty() || m_Buffers.back() != buffer)
+		m_Buffers.push_back(buffer);
+	return static_cast<uint32_t>(m_Buffers.size() - 1);
+}
\ No newline at end of file
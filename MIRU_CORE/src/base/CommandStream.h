@@ -0,0 +1,201 @@
+#pragma once
+
+#include "miru_core_common.h"
+#include "CommandPoolBuffer.h"
+
+namespace miru
+{
+namespace base
+{
+	//Records commands as compact POD packets into a linear stream, without calling the graphics API.
+	//Record() translates the stream into a CommandBuffer. It does not modify the stream, so a stream can be recorded many times,
+	//e.g. for static passes, and concurrently from worker threads, e.g. from a ParallelRecorder::RecordFunction. Objects are
+	//referenced by Handle. Pipelines and Buffers are referenced by an index into a table holding one Ref per object, so that
+	//appending a packet does not reference count. Profiling Record() separately from the appends measures the translation cost.
+	//Appending to a CommandStream is not thread safe.
+	class MIRU_API CommandStream
+	{
+		//enums/structs
+	public:
+		struct CreateInfo
+		{
+			std::string	debugName;
+			size_t		initialSize;	//In bytes.
+		};
+		enum class Opcode : uint32_t
+		{
+			PIPELINE_BARRIER2,
+			BIND_PIPELINE,
+			BIND_VERTEX_BUFFERS,
+			BIND_INDEX_BUFFER,
+			BIND_DESCRIPTOR_SETS,
+			PUSH_CONSTANTS,
+			SET_VIEWPORT,
+			SET_SCISSOR,
+			DRAW,
+			DRAW_INDEXED,
+			DRAW_MESH_TASKS,
+			DISPATCH,
+			DRAW_INDIRECT,
+			DRAW_INDEXED_INDIRECT,
+			DISPATCH_INDIRECT,
+			BEGIN_DEBUG_LABEL,
+			END_DEBUG_LABEL,
+		};
+
+		//Methods
+	public:
+		static CommandStreamRef Create(CreateInfo* pCreateInfo);
+		CommandStream(CreateInfo* pCreateInfo);
+		~CommandStream() = default;
+		const CreateInfo& GetCreateInfo() { return m_CI; }
+		inline uint32_t GetCommandCount() const { return m_CommandCount; }
+		inline size_t GetSize() const { return m_Data.size() * sizeof(uint64_t); }
+
+		//Removes all packets and releases the retained Pipelines and Buffers. The memory of the stream is kept.
+		void Reset();
+		//Translates the stream into the CommandBuffer, which must have begun and, if needed, begun a RenderPass or rendering.
+		void Record(const CommandBufferRef& commandBuffer, uint32_t index) const;
+
+		void PipelineBarrier2(DependencyBit dependencies, const Barrier2Handle* pBarriers, uint32_t barrierCount);
+		void BindPipeline(const PipelineRef& pipeline);
+		void BindVertexBuffers(const BufferViewHandle* pVertexBufferViews, uint32_t vertexBufferViewCount);
+		void BindIndexBuffer(const BufferViewHandle& indexBufferView);
+		void BindDescriptorSets(const DescriptorSetHandle* pDescriptorSets, uint32_t descriptorSetCount, uint32_t firstSet, const PipelineRef& pipeline, const uint32_t* pDynamicOffsets = nullptr, uint32_t dynamicOffsetCount = 0);
+		void PushConstants(const PipelineRef& pipeline, Shader::StageBit stages, uint32_t offset, uint32_t size, const void* pValues);
+		void SetViewport(const Viewport* pViewports, uint32_t viewportCount);
+		void SetScissor(const Rect2D* pScissors, uint32_t scissorCount);
+
+		void Draw(uint32_t vertexCount, uint32_t instanceCount = 1, uint32_t firstVertex = 0, uint32_t firstInstance = 0);
+		void DrawIndexed(uint32_t indexCount, uint32_t instanceCount = 1, uint32_t firstIndex = 0, int32_t vertexOffset = 0, uint32_t firstInstance = 0);
+		void DrawMeshTasks(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
+		void Dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ);
+		void DrawIndirect(const BufferRef& buffer, uint64_t offset, uint32_t drawCount, uint32_t stride = sizeof(CommandBuffer::DrawIndirectCommand));
+		void DrawIndexedIndirect(const BufferRef& buffer, uint64_t offset, uint32_t drawCount, uint32_t stride = sizeof(CommandBuffer::DrawIndexedIndirectCommand));
+		void DispatchIndirect(const BufferRef& buffer, uint64_t offset);
+
+		void BeginDebugLabel(const std::string& label, std::array<float, 4> rgba = { 0.0f, 0.0f , 0.0f, 0.0f });
+		void EndDebugLabel();
+
+	private:
+		//Each packet is a PacketHeader, followed by the opcode's packet structure and then its trailing arrays.
+		//Packets are padded to a multiple of 8 bytes, so that every packet structure is aligned.
+		struct PacketHeader
+		{
+			Opcode		opcode;
+			uint32_t	size;		//In bytes, including the PacketHeader.
+		};
+		struct PipelineBarrier2Packet
+		{
+			DependencyBit	dependencies;
+			uint32_t		barrierCount;		//Followed by Barrier2Handle[barrierCount].
+		};
+		struct BindPipelinePacket
+		{
+			uint32_t	pipeline;
+		};
+		struct BindVertexBuffersPacket
+		{
+			uint32_t	vertexBufferViewCount;	//Followed by BufferViewHandle[vertexBufferViewCount].
+		};
+		struct BindIndexBufferPacket
+		{
+			BufferViewHandle	indexBufferView;
+		};
+		struct BindDescriptorSetsPacket
+		{
+			uint32_t	pipeline;
+			uint32_t	firstSet;
+			uint32_t	descriptorSetCount;		//Followed by DescriptorSetHandle[descriptorSetCount].
+			uint32_t	dynamicOffsetCount;		//Followed by uint32_t[dynamicOffsetCount].
+		};
+		struct PushConstantsPacket
+		{
+			uint32_t			pipeline;
+			Shader::StageBit	stages;
+			uint32_t			offset;
+			uint32_t			size;			//Followed by uint8_t[size].
+		};
+		struct SetViewportPacket
+		{
+			uint32_t	viewportCount;			//Followed by Viewport[viewportCount].
+		};
+		struct SetScissorPacket
+		{
+			uint32_t	scissorCount;			//Followed by Rect2D[scissorCount].
+		};
+		struct DrawPacket
+		{
+			uint32_t	vertexCount;
+			uint32_t	instanceCount;
+			uint32_t	firstVertex;
+			uint32_t	firstInstance;
+		};
+		struct DrawIndexedPacket
+		{
+			uint32_t	indexCount;
+			uint32_t	instanceCount;
+			uint32_t	firstIndex;
+			int32_t		vertexOffset;
+			uint32_t	firstInstance;
+		};
+		struct GroupCountPacket
+		{
+			uint32_t	groupCountX;
+			uint32_t	groupCountY;
+			uint32_t	groupCountZ;
+		};
+		struct IndirectPacket
+		{
+			uint64_t	offset;
+			uint32_t	buffer;
+			uint32_t	drawCount;
+			uint32_t	stride;
+		};
+		struct BeginDebugLabelPacket
+		{
+			float		rgba[4];
+			uint32_t	length;					//Followed by char[length].
+		};
+		struct EmptyPacket
+		{
+		};
+
+		template<typename T>
+		T* Append(Opcode opcode, size_t trailingSize = 0)
+		{
+			const size_t& size = arc::Align<size_t>(sizeof(PacketHeader) + sizeof(T) + trailingSize, sizeof(uint64_t));
+			const size_t& offset = m_Data.size();
+			m_Data.resize(offset + size / sizeof(uint64_t));
+
+			PacketHeader* header = reinterpret_cast<PacketHeader*>(m_Data.data() + offset);
+			header->opcode = opcode;
+			header->size = static_cast<uint32_t>(size);
+			m_CommandCount++;
+			return reinterpret_cast<T*>(header + 1);
+		}
+		template<typename T, typename P>
+		static inline T* GetTrailing(P* packet, size_t offset = 0)
+		{
+			return reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(packet + 1) + offset);
+		}
+		template<typename T, typename P>
+		static inline const T* GetTrailing(const P* packet, size_t offset = 0)
+		{
+			return reinterpret_cast<const T*>(reinterpret_cast<const uint8_t*>(packet + 1) + offset);
+		}
+
+		uint32_t GetPipelineIndex(const PipelineRef& pipeline);
+		uint32_t GetBufferIndex(const BufferRef& buffer);
+
+		//Members
+	private:
+		CreateInfo m_CI = {};
+
+		std::vector<uint64_t> m_Data;
+		uint32_t m_CommandCount = 0;
+		std::vector<PipelineRef> m_Pipelines;
+		std::vector<BufferRef> m_Buffers;
+	};
+}
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include "miru_core_common.h"
+#include "GpuProfiler.h"
+
+using namespace miru;
+using namespace base;
+
+GpuProfilerRef GpuProfiler::Create(CreateInfo* pCreateInfo)
+{
+	return CreateRef<GpuProfiler>(pCreateInfo);
+}
+
+GpuProfiler::GpuProfiler(CreateInfo* pCreateInfo)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_CI = *pCreateInfo;
+	m_CI.frameCount = std::max<uint32_t>(m_CI.frameCount, 1);
+	m_CI.maxScopesPerFrame = std::max<uint32_t>(m_CI.maxScopesPerFrame, 1);
+
+	QueryPool::CreateInfo queryPoolCI;
+	queryPoolCI.debugName = m_CI.debugName + ": QueryPool";
+	queryPoolCI.context = m_CI.context;
+	queryPoolCI.type = QueryPool::Type::TIMESTAMP;
+	queryPoolCI.queryCount = 2 * m_CI.maxScopesPerFrame * m_CI.frameCount;
+	m_QueryPool = QueryPool::Create(&queryPoolCI);
+	m_TimestampPeriod = m_QueryPool->GetTimestampPeriod();
+
+	m_Frames.resize(m_CI.frameCount, { 0, false, false, 0, 0, {} });
+	for (RecordedFrame& frame : m_Frames)
+		frame.scopes.reserve(m_CI.maxScopesPerFrame);
+	m_Results.resize(2 * static_cast<size_t>(m_CI.maxScopesPerFrame));
+}
+
+GpuProfiler::~GpuProfiler()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_QueryPool = nullptr;
+}
+
+void GpuProfiler::BeginFrame(CommandBuffer* commandBuffer, uint32_t index)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	//The end timestamps of the unended scopes will never be written, so the results of the frame would never be available.
+	if (!m_ScopeStack.empty())
+	{
+		MIRU_WARN(true, "WARN: BASE: GpuProfiler scopes were not ended before GpuProfiler::BeginFrame(). The frame is dropped.");
+		m_Frames[m_FrameIndex].pending = false;
+		m_ScopeStack.clear();
+	}
+
+	m_FrameIndex = static_cast<uint32_t>(m_FrameNumber % m_CI.frameCount);
+	ResolveFrame(m_FrameIndex);
+
+	RecordedFrame& frame = m_Frames[m_FrameIndex];
+	frame.frameNumber = m_FrameNumber++;
+	frame.pending = true;
+	frame.calibrated = m_CI.commandPool && m_CI.commandPool->GetCalibratedTimestamps(frame.gpuCalibration, frame.cpuCalibration);
+	frame.scopes.clear();
+
+	commandBuffer->ResetQueryPool(index, m_QueryPool, 2 * m_CI.maxScopesPerFrame * m_FrameIndex, 2 * m_CI.maxScopesPerFrame);
+}
+
+void GpuProfiler::BeginScope(CommandBuffer* commandBuffer, uint32_t index, const std::string& name)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	//Dropped scopes are still pushed, so that their EndScope() is matched.
+	RecordedFrame& frame = m_Frames[m_FrameIndex];
+	if (!frame.pending || frame.scopes.size() >= m_CI.maxScopesPerFrame)
+	{
+		MIRU_WARN(frame.pending, "WARN: BASE: GpuProfiler::CreateInfo::maxScopesPerFrame exceeded. The scope is dropped.");
+		m_ScopeStack.push_back(NoParent);
+		return;
+	}
+
+	const uint32_t scopeIndex = static_cast<uint32_t>(frame.scopes.size());
+	frame.scopes.push_back({ name, static_cast<uint32_t>(m_ScopeStack.size()), m_ScopeStack.empty() ? NoParent : m_ScopeStack.back() });
+	m_ScopeStack.push_back(scopeIndex);
+
+	commandBuffer->WriteTimestamp(index, PipelineStageBit::BOTTOM_OF_PIPE_BIT, m_QueryPool, 2 * (m_CI.maxScopesPerFrame * m_FrameIndex + scopeIndex));
+}
+
+void GpuProfiler::EndScope(CommandBuffer* commandBuffer, uint32_t index)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	if (m_ScopeStack.empty())
+	{
+		MIRU_WARN(true, "WARN: BASE: GpuProfiler::EndScope() has no matching GpuProfiler::BeginScope().");
+		return;
+	}
+
+	const uint32_t scopeIndex = m_ScopeStack.back();
+	m_ScopeStack.pop_back();
+	if (scopeIndex == NoParent)
+		return;
+
+	commandBuffer->WriteTimestamp(index, PipelineStageBit::BOTTOM_OF_PIPE_BIT, m_QueryPool, 2 * (m_CI.maxScopesPerFrame * m_FrameIndex + scopeIndex) + 1);
+}
+
+void GpuProfiler::ResolveFrame(uint32_t frameIndex)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	RecordedFrame& frame = m_Frames[frameIndex];
+	const bool pending = frame.pending;
+	frame.pending = false;
+	if (!pending || frame.scopes.empty())
+		return;
+
+	const uint32_t queryCount = 2 * static_cast<uint32_t>(frame.scopes.size());
+	if (!m_QueryPool->GetResults(2 * m_CI.maxScopesPerFrame * frameIndex, queryCount, m_Results.data()))
+	{
+		MIRU_WARN(true, "WARN: BASE: GpuProfiler results are not available. The frame is dropped. Increase GpuProfiler::CreateInfo::frameCount.");
+		return;
+	}
+
+	//Ticks are converted relative to the calibration, or to the frame's first timestamp.
+	const uint64_t& gpuOrigin = frame.calibrated ? frame.gpuCalibration : m_Results[0];
+	const int64_t& cpuOrigin = frame.calibrated ? static_cast<int64_t>(frame.cpuCalibration) : 0;
+
+	m_ResolvedFrame.frameNumber = frame.frameNumber;
+	m_ResolvedFrame.calibrated = frame.calibrated;
+	m_ResolvedFrame.scopes.clear();
+	for (size_t i = 0; i < frame.scopes.size(); i++)
+	{
+		const RecordedScope& recordedScope = frame.scopes[i];
+		const uint64_t& begin = m_Results[2 * i + 0];
+		const uint64_t& end = m_Results[2 * i + 1];
+
+		Scope scope;
+		scope.name = recordedScope.name;
+		scope.depth = recordedScope.depth;
+		scope.parent = recordedScope.parent;
+		scope.begin = cpuOrigin + static_cast<int64_t>(static_cast<double>(static_cast<int64_t>(begin - gpuOrigin)) * m_TimestampPeriod);
+		scope.duration = end > begin ? static_cast<uint64_t>(static_cast<double>(end - begin) * m_TimestampPeriod) : 0;
+		m_ResolvedFrame.scopes.push_back(scope);
+	}
+
+	WriteFrame(m_ResolvedFrame);
+}
+
+void GpuProfiler::WriteFrame(const Frame& frame)
+{
+#if defined(MIRU_CPU_PROFILER)
+	//Scope numbers start at 1, as for the CPU scopes.
+	const std::string& prefix = "GPU: " + m_CI.debugName + ": Frame " + std::to_string(frame.frameNumber) + ": ";
+	for (const Scope& scope : frame.scopes)
+		Timer::WriteScope(scope.depth + 1, prefix + scope.name, scope.duration, scope.begin);
+#endif
+}
\ No newline at end of file
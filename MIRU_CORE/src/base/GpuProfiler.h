@@ -0,0 +1,98 @@
+#pragma once
+
+#include "miru_core_common.h"
+#include "CommandPoolBuffer.h"
+#include "QueryPool.h"
+
+namespace miru
+{
+namespace base
+{
+	//Measures the GPU time of nested scopes with pairs of timestamp queries. Scopes are begun and ended explicitly, or by
+	//CommandBuffer::BeginDebugLabel() and EndDebugLabel() on CommandBuffers that the profiler is set on.
+	//Each frame in flight has its own range of queries. A frame's results are read back without blocking when its range is
+	//reused frameCount frames later, and frames whose results are not yet available are dropped. If the CommandPool can calibrate
+	//timestamps, the scopes are converted into the CPU's std::chrono::steady_clock domain, and each resolved frame is written into
+	//the MIRU_CPU_PROFILE session's file alongside the CPU scopes. Scopes must be recorded in submission order from one thread.
+	class MIRU_API GpuProfiler
+	{
+		//enums/structs
+	public:
+		struct CreateInfo
+		{
+			std::string		debugName;
+			ContextRef		context;
+			CommandPoolRef	commandPool;		//Optional. Used to calibrate the timestamps against the CPU clock.
+			uint32_t		frameCount;			//Number of frames in flight. Results are read back frameCount frames later.
+			uint32_t		maxScopesPerFrame;
+		};
+		struct Scope
+		{
+			std::string	name;
+			uint32_t	depth;		//0 for the outermost scopes.
+			uint32_t	parent;		//Index of the enclosing Scope in Frame::scopes, or NoParent.
+			int64_t		begin;		//Nanoseconds. If Frame::calibrated, since the steady_clock epoch. Otherwise, since the frame's first timestamp.
+			uint64_t	duration;	//Nanoseconds.
+		};
+		struct Frame
+		{
+			uint64_t			frameNumber;
+			bool				calibrated;
+			std::vector<Scope>	scopes;		//In the order that the scopes were begun.
+		};
+		static constexpr uint32_t NoParent = ~0u;
+
+		//Methods
+	public:
+		static GpuProfilerRef Create(CreateInfo* pCreateInfo);
+		GpuProfiler(CreateInfo* pCreateInfo);
+		~GpuProfiler();
+		const CreateInfo& GetCreateInfo() { return m_CI; }
+
+		//Reads back the results of the frame that last used the current frame's queries, and resets them. Call once per frame,
+		//before any scopes, outside of a RenderPass or rendering. The frame's previous submission must have been submitted.
+		void BeginFrame(CommandBuffer* commandBuffer, uint32_t index);
+		void BeginScope(CommandBuffer* commandBuffer, uint32_t index, const std::string& name);
+		void EndScope(CommandBuffer* commandBuffer, uint32_t index);
+		inline void BeginFrame(const CommandBufferRef& commandBuffer, uint32_t index) { BeginFrame(commandBuffer.get(), index); }
+		inline void BeginScope(const CommandBufferRef& commandBuffer, uint32_t index, const std::string& name) { BeginScope(commandBuffer.get(), index, name); }
+		inline void EndScope(const CommandBufferRef& commandBuffer, uint32_t index) { EndScope(commandBuffer.get(), index); }
+
+		//The most recently read back frame. frameNumber is ~0 until a frame has been read back.
+		inline const Frame& GetResolvedFrame() const { return m_ResolvedFrame; }
+
+	private:
+		void ResolveFrame(uint32_t frameIndex);
+		void WriteFrame(const Frame& frame);
+
+		//Members
+	private:
+		struct RecordedScope
+		{
+			std::string	name;
+			uint32_t	depth;
+			uint32_t	parent;
+		};
+		struct RecordedFrame
+		{
+			uint64_t					frameNumber;
+			bool						pending;
+			bool						calibrated;
+			uint64_t					gpuCalibration;		//Ticks.
+			uint64_t					cpuCalibration;		//Nanoseconds since the steady_clock epoch.
+			std::vector<RecordedScope>	scopes;				//Scope i wrote the queries 2 * i and 2 * i + 1 of the frame's range.
+		};
+
+		CreateInfo m_CI = {};
+
+		QueryPoolRef m_QueryPool;
+		double m_TimestampPeriod = 1.0;
+		std::vector<RecordedFrame> m_Frames;
+		uint64_t m_FrameNumber = 0;
+		uint32_t m_FrameIndex = 0;
+		std::vector<uint32_t> m_ScopeStack;		//Indices into the current frame's scopes, or NoParent for dropped scopes.
+		std::vector<uint64_t> m_Results;
+		Frame m_ResolvedFrame = { ~0ull, false, {} };
+	};
+}
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "miru_core_common.h"
+#include "HandlePool.h"
+#include "Buffer.h"
+#include "Image.h"
+#include "DescriptorPoolSet.h"
+#include "Sync.h"
+
+namespace miru
+{
+namespace base
+{
+	template<> HandlePool<Barrier>& GetHandlePool<Barrier>()
+	{
+		static HandlePool<Barrier> pool;
+		return pool;
+	}
+	template<> HandlePool<Barrier2>& GetHandlePool<Barrier2>()
+	{
+		static HandlePool<Barrier2> pool;
+		return pool;
+	}
+	template<> HandlePool<BufferView>& GetHandlePool<BufferView>()
+	{
+		static HandlePool<BufferView> pool;
+		return pool;
+	}
+	template<> HandlePool<ImageView>& GetHandlePool<ImageView>()
+	{
+		static HandlePool<ImageView> pool;
+		return pool;
+	}
+	template<> HandlePool<DescriptorSet>& GetHandlePool<DescriptorSet>()
+	{
+		static HandlePool<DescriptorSet> pool;
+		return pool;
+	}
+	template<> HandlePool<Sampler>& GetHandlePool<Sampler>()
+	{
+		static HandlePool<Sampler> pool;
+		return pool;
+	}
+
+	void ClearHandlePools()
+	{
+		MIRU_CPU_PROFILE_FUNCTION();
+
+		//Barriers and DescriptorSets hold Refs to the other objects, so they are released first.
+		size_t count = 0;
+		count += GetHandlePool<Barrier>().Clear();
+		count += GetHandlePool<Barrier2>().Clear();
+		count += GetHandlePool<DescriptorSet>().Clear();
+		count += GetHandlePool<BufferView>().Clear();
+		count += GetHandlePool<ImageView>().Clear();
+		count += GetHandlePool<Sampler>().Clear();
+		MIRU_WARN(count, "WARN: BASE: Handles were not destroyed before the Context was destroyed. Their objects have been released.");
+	}
+}
+}
\ No newline at end of file
@@ -0,0 +1,211 @@
+#pragma once
+
+#include "miru_core_common.h"
+#include <mutex>
+#include <atomic>
+
+namespace miru
+{
+namespace base
+{
+	//Compact generational handle to an object held in a HandlePool.
+	//A handle becomes stale when its object is removed from the pool; stale handles resolve to nullptr.
+	template<typename T>
+	struct Handle
+	{
+		uint32_t index = 0;
+		uint32_t generation = 0;	//Generations start at 1, so a default constructed Handle is null.
+
+		explicit operator bool() const { return generation != 0; }
+		bool operator==(const Handle& other) const { return index == other.index && generation == other.generation; }
+		bool operator!=(const Handle& other) const { return !(*this == other); }
+	};
+	typedef Handle<Barrier> BarrierHandle;
+	typedef Handle<Barrier2> Barrier2Handle;
+	typedef Handle<BufferView> BufferViewHandle;
+	typedef Handle<ImageView> ImageViewHandle;
+	typedef Handle<DescriptorSet> DescriptorSetHandle;
+	typedef Handle<Sampler> SamplerHandle;
+
+	//Per-type pool of objects addressed by generational Handles.
+	//The pool holds a Ref to each object until it is removed, so CommandBuffers can record from a Handle with a plain
+	//pointer lookup and no reference counting. Slots are stored as a structure-of-arrays in fixed size chunks that
+	//are never moved or freed before the pool, so Get() and IsValid() are lock free: chunk pointers, objects and
+	//generations are atomic, and Get() rechecks the generation after reading the object, so it never returns the object
+	//of a slot that was reused. All methods can be called from any thread. The object returned by Get() is only kept
+	//alive by the pool while its Handle has not been removed.
+	template<typename T>
+	class HandlePool
+	{
+		//enums/structs
+	public:
+		static constexpr uint32_t ChunkSize = 1024;
+		static constexpr uint32_t MaxChunkCount = 1024;
+
+		//Methods
+	public:
+		HandlePool() = default;
+		~HandlePool()
+		{
+			for (std::atomic<Chunk*>& chunk : m_Chunks)
+				delete chunk.exchange(nullptr);
+		}
+		HandlePool(const HandlePool&) = delete;
+		HandlePool& operator=(const HandlePool&) = delete;
+
+		Handle<T> Insert(const Ref<T>& object)
+		{
+			MIRU_CPU_PROFILE_FUNCTION();
+
+			if (!object)
+				return {};
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			uint32_t index = 0;
+			if (!m_FreeIndices.empty())
+			{
+				index = m_FreeIndices.back();
+				m_FreeIndices.pop_back();
+			}
+			else
+			{
+				MIRU_FATAL(m_SlotCount >= ChunkSize * MaxChunkCount, "ERROR: BASE: HandlePool is full.");
+				index = m_SlotCount++;
+				std::atomic<Chunk*>& chunk = m_Chunks[index / ChunkSize];
+				if (!chunk.load(std::memory_order_relaxed))
+					chunk.store(new Chunk(), std::memory_order_release);
+			}
+
+			Chunk& chunk = *m_Chunks[index / ChunkSize].load(std::memory_order_relaxed);
+			const uint32_t& slot = index % ChunkSize;
+			chunk.refs[slot] = object;
+			chunk.objects[slot].store(object.get(), std::memory_order_release);
+			uint32_t generation = chunk.generations[slot].load(std::memory_order_relaxed);
+			if (generation == 0)
+			{
+				generation = 1;
+				chunk.generations[slot].store(generation, std::memory_order_release);
+			}
+
+			return { index, generation };
+		}
+
+		//Releases the pool's Ref to the object and invalidates all Handles to it.
+		void Remove(const Handle<T>& handle)
+		{
+			MIRU_CPU_PROFILE_FUNCTION();
+
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			if (!IsValid(handle))
+				return;
+
+			//The generation is changed first, so that a concurrent Get() discards the object.
+			Chunk& chunk = *m_Chunks[handle.index / ChunkSize].load(std::memory_order_relaxed);
+			const uint32_t& slot = handle.index % ChunkSize;
+			const uint32_t generation = handle.generation + 1;
+			chunk.generations[slot].store(generation == 0 ? 1 : generation, std::memory_order_seq_cst);
+			chunk.objects[slot].store(nullptr, std::memory_order_release);
+			chunk.refs[slot] = nullptr;
+
+			m_FreeIndices.push_back(handle.index);
+		}
+
+		//Releases the pool's Refs to all objects and invalidates all Handles. Returns the number of objects that were released.
+		size_t Clear()
+		{
+			MIRU_CPU_PROFILE_FUNCTION();
+
+			//The objects are destroyed after the mutex is unlocked.
+			std::vector<Ref<T>> objects;
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				for (uint32_t index = 0; index < m_SlotCount; index++)
+				{
+					Chunk& chunk = *m_Chunks[index / ChunkSize].load(std::memory_order_relaxed);
+					const uint32_t& slot = index % ChunkSize;
+					if (!chunk.refs[slot])
+						continue;
+
+					const uint32_t generation = chunk.generations[slot].load(std::memory_order_relaxed) + 1;
+					chunk.generations[slot].store(generation == 0 ? 1 : generation, std::memory_order_seq_cst);
+					chunk.objects[slot].store(nullptr, std::memory_order_release);
+					objects.push_back(std::move(chunk.refs[slot]));
+					chunk.refs[slot] = nullptr;
+
+					m_FreeIndices.push_back(index);
+				}
+			}
+			return objects.size();
+		}
+
+		//Returns nullptr if the handle is null or stale.
+		inline T* Get(const Handle<T>& handle) const
+		{
+			if (!IsValid(handle))
+				return nullptr;
+
+			//The slot may have been removed and reused while the object was read.
+			const Chunk* chunk = m_Chunks[handle.index / ChunkSize].load(std::memory_order_acquire);
+			const uint32_t& slot = handle.index % ChunkSize;
+			T* object = chunk->objects[slot].load(std::memory_order_acquire);
+			if (chunk->generations[slot].load(std::memory_order_relaxed) != handle.generation)
+				return nullptr;
+
+			return object;
+		}
+		//Returns an empty Ref if the handle is null or stale.
+		Ref<T> GetRef(const Handle<T>& handle)
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+
+			if (!IsValid(handle))
+				return nullptr;
+
+			return m_Chunks[handle.index / ChunkSize].load(std::memory_order_relaxed)->refs[handle.index % ChunkSize];
+		}
+		inline bool IsValid(const Handle<T>& handle) const
+		{
+			if (handle.generation == 0 || handle.index >= ChunkSize * MaxChunkCount)
+				return false;
+
+			const Chunk* chunk = m_Chunks[handle.index / ChunkSize].load(std::memory_order_acquire);
+			return chunk && chunk->generations[handle.index % ChunkSize].load(std::memory_order_acquire) == handle.generation;
+		}
+
+		//Members
+	private:
+		struct Chunk
+		{
+			std::array<std::atomic<T*>, ChunkSize>			objects = {};
+			std::array<std::atomic<uint32_t>, ChunkSize>	generations = {};
+			std::array<Ref<T>, ChunkSize>					refs;		//Guarded by m_Mutex.
+		};
+
+		std::array<std::atomic<Chunk*>, MaxChunkCount> m_Chunks = {};
+		uint32_t m_SlotCount = 0;
+		std::vector<uint32_t> m_FreeIndices;
+		std::mutex m_Mutex;
+	};
+
+	//Process wide pools for the objects most frequently passed to CommandBuffers.
+	//Every Handle must be destroyed before the Context of its object. When a Context is destroyed, ClearHandlePools() warns about
+	//and releases the objects that are still held, so that they do not outlive the device. This invalidates the Handles of all
+	//Contexts, so the Handles of other Contexts that are still in use resolve to nullptr.
+	template<typename T> HandlePool<T>& GetHandlePool();
+	template<> MIRU_API HandlePool<Barrier>& GetHandlePool<Barrier>();
+	template<> MIRU_API HandlePool<Barrier2>& GetHandlePool<Barrier2>();
+	template<> MIRU_API HandlePool<BufferView>& GetHandlePool<BufferView>();
+	template<> MIRU_API HandlePool<ImageView>& GetHandlePool<ImageView>();
+	template<> MIRU_API HandlePool<DescriptorSet>& GetHandlePool<DescriptorSet>();
+	template<> MIRU_API HandlePool<Sampler>& GetHandlePool<Sampler>();
+
+	template<typename T> Handle<T> CreateHandle(const Ref<T>& object) { return GetHandlePool<T>().Insert(object); }
+	template<typename T> void DestroyHandle(const Handle<T>& handle) { GetHandlePool<T>().Remove(handle); }
+	template<typename T> T* GetHandleObject(const Handle<T>& handle) { return GetHandlePool<T>().Get(handle); }
+
+	//Releases the objects of all HandlePools. Called by the destructor of Context, before the device is destroyed.
+	MIRU_API void ClearHandlePools();
+}
+}
\ No newline at end of file
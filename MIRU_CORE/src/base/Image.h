@@ -291,8 +291,9 @@ namespace base
 			Layout				layout;
 			size_t				size;
 			void*				data;
-			AllocatorRef		allocator;
+			AllocatorRef		allocator;	//If nullptr, the resource is created without memory. See AliasingHeap.
 			ExternalImageHandle externalImage;
+			bool				transientAttachment = false; //The Image is only used as an attachment within a RenderPass/Rendering. Lazily allocated memory is used when available.
 		};
 
 		//Methods
@@ -302,6 +303,7 @@ namespace base
 		const CreateInfo& GetCreateInfo() { return m_CI; }
 		const Allocation& GetAllocation() { return m_Allocation; }
 		const bool& IsSwapchainImage() { return m_SwapchainImage; }
+		bool IsTransientAttachment() { return m_CI.transientAttachment || arc::BitwiseCheck(m_CI.usage, UsageBit::TRANSIENT_ATTACHMENT_BIT); }
 		friend Swapchain;
 
 		static FormatData GetFormatData(miru::base::Image::Format format);
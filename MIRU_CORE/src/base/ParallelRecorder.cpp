@@ -0,0 +1,163 @@
+#include "miru_core_common.h"
+#include "ParallelRecorder.h"
+
+using namespace miru;
+using namespace base;
+
+ParallelRecorderRef ParallelRecorder::Create(CreateInfo* pCreateInfo)
+{
+	return CreateRef<ParallelRecorder>(pCreateInfo);
+}
+
+ParallelRecorder::ParallelRecorder(CreateInfo* pCreateInfo)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	MIRU_FATAL(GraphicsAPI::IsD3D12(), "ERROR: BASE: ParallelRecorder is not supported with D3D12.");
+
+	m_CI = *pCreateInfo;
+	if (m_CI.workerCount == 0)
+		m_CI.workerCount = std::max<uint32_t>(std::thread::hardware_concurrency(), 1);
+	m_CI.frameCount = std::max<uint32_t>(m_CI.frameCount, 1);
+	m_CI.maxForksPerFrame = std::max<uint32_t>(m_CI.maxForksPerFrame, 1);
+
+	m_CmdPools.resize(m_CI.frameCount);
+	m_CmdBuffers.resize(m_CI.frameCount);
+	for (uint32_t frame = 0; frame < m_CI.frameCount; frame++)
+	{
+		for (uint32_t worker = 0; worker < m_CI.workerCount; worker++)
+		{
+			const std::string& name = m_CI.debugName + ": Frame " + std::to_string(frame) + ": Worker " + std::to_string(worker);
+
+			CommandPool::CreateInfo cmdPoolCI;
+			cmdPoolCI.debugName = name + ": CommandPool";
+			cmdPoolCI.context = m_CI.context;
+			cmdPoolCI.flags = CommandPool::FlagBit::TRANSIENT_BIT;
+			cmdPoolCI.queueType = m_CI.queueType;
+			m_CmdPools[frame].push_back(CommandPool::Create(&cmdPoolCI));
+
+			CommandBuffer::CreateInfo cmdBufferCI;
+			cmdBufferCI.debugName = name + ": CommandBuffer";
+			cmdBufferCI.commandPool = m_CmdPools[frame].back();
+			cmdBufferCI.level = CommandBuffer::Level::SECONDARY;
+			cmdBufferCI.commandBufferCount = m_CI.maxForksPerFrame;
+			m_CmdBuffers[frame].push_back(CommandBuffer::Create(&cmdBufferCI));
+		}
+	}
+
+	m_Jobs.resize(m_CI.workerCount, { false, 0, 0 });
+	for (uint32_t worker = 0; worker < m_CI.workerCount; worker++)
+		m_Workers.emplace_back(&ParallelRecorder::WorkerThread, this, worker);
+}
+
+ParallelRecorder::~ParallelRecorder()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Shutdown = true;
+	}
+	m_WorkCV.notify_all();
+	for (std::thread& worker : m_Workers)
+		worker.join();
+
+	m_CmdBuffers.clear();
+	m_CmdPools.clear();
+}
+
+void ParallelRecorder::BeginFrame(uint32_t frameIndex)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	MIRU_FATAL(m_Forked, "ERROR: BASE: ParallelRecorder::Join() must be called before ParallelRecorder::BeginFrame().");
+
+	m_FrameIndex = frameIndex % m_CI.frameCount;
+	m_ForkIndex = 0;
+	for (const CommandPoolRef& cmdPool : m_CmdPools[m_FrameIndex])
+		cmdPool->Reset(false);
+}
+
+void ParallelRecorder::Fork(const CommandBuffer::InheritanceInfo& inheritanceInfo, uint32_t first, uint32_t count, const RecordFunction& recordFunction)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	MIRU_FATAL(m_Forked, "ERROR: BASE: ParallelRecorder::Join() must be called before the next ParallelRecorder::Fork().");
+	MIRU_FATAL(m_ForkIndex >= m_CI.maxForksPerFrame, "ERROR: BASE: Exceeded ParallelRecorder's maxForksPerFrame.");
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_InheritanceInfo = inheritanceInfo;
+		m_RecordFunction = recordFunction;
+
+		//Split into contiguous ranges, so that executing the workers in order preserves the draw order.
+		const uint32_t& workerCount = std::max<uint32_t>(std::min<uint32_t>(m_CI.workerCount, count), 1);
+		const uint32_t& rangeSize = count / workerCount;
+		const uint32_t& remainder = count % workerCount;
+		uint32_t offset = first;
+		m_OutstandingJobs = 0;
+		for (uint32_t worker = 0; worker < m_CI.workerCount; worker++)
+		{
+			Job& job = m_Jobs[worker];
+			job.first = offset;
+			job.count = worker < workerCount ? rangeSize + (worker < remainder ? 1 : 0) : 0;
+			job.pending = job.count > 0;
+			offset += job.count;
+			if (job.pending)
+				m_OutstandingJobs++;
+		}
+		m_Forked = true;
+	}
+	m_WorkCV.notify_all();
+}
+
+void ParallelRecorder::Join(const CommandBufferRef& primaryCommandBuffer, uint32_t primaryIndex)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	if (!m_Forked)
+		return;
+
+	std::vector<bool> recorded(m_CI.workerCount, false);
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_DoneCV.wait(lock, [&] { return m_OutstandingJobs == 0; });
+		for (uint32_t worker = 0; worker < m_CI.workerCount; worker++)
+			recorded[worker] = m_Jobs[worker].count > 0;
+		m_RecordFunction = nullptr;
+		m_Forked = false;
+	}
+
+	for (uint32_t worker = 0; worker < m_CI.workerCount; worker++)
+	{
+		if (recorded[worker])
+			primaryCommandBuffer->ExecuteSecondaryCommandBuffers(primaryIndex, m_CmdBuffers[m_FrameIndex][worker], { m_ForkIndex });
+	}
+	m_ForkIndex++;
+}
+
+void ParallelRecorder::WorkerThread(uint32_t workerIndex)
+{
+	while (true)
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_WorkCV.wait(lock, [&] { return m_Shutdown || m_Jobs[workerIndex].pending; });
+		if (m_Shutdown)
+			return;
+
+		const Job job = m_Jobs[workerIndex];
+		const CommandBufferRef& cmdBuffer = m_CmdBuffers[m_FrameIndex][workerIndex];
+		const uint32_t index = m_ForkIndex;
+		lock.unlock();
+
+		cmdBuffer->Begin(index, CommandBuffer::UsageBit::ONE_TIME_SUBMIT, m_InheritanceInfo);
+		m_RecordFunction({ cmdBuffer, index, workerIndex, job.first, job.count });
+		cmdBuffer->End(index);
+
+		lock.lock();
+		m_Jobs[workerIndex].pending = false;
+		m_OutstandingJobs--;
+		if (m_OutstandingJobs == 0)
+			m_DoneCV.notify_all();
+	}
+}
\ No newline at end of file
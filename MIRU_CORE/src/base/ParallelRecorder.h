@@ -0,0 +1,90 @@
+#pragma once
+
+#include "miru_core_common.h"
+#include "CommandPoolBuffer.h"
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+namespace miru
+{
+namespace base
+{
+	//Records ranges of draws concurrently on worker threads into Level::SECONDARY CommandBuffers.
+	//Each worker has its own CommandPool per frame in flight, which is reset by BeginFrame(). Fork() splits a range of
+	//draws between the workers and returns immediately. Join() waits for the workers and executes their CommandBuffers
+	//in draw order in the primary CommandBuffer, which must have begun the RenderPass or dynamic rendering with
+	//SubpassContents::SECONDARY_COMMAND_BUFFERS or RenderingFlagBits::CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT.
+	//Vulkan only: D3D12 secondary CommandBuffers are bundles, which can not bind DescriptorSets or set viewports and scissors.
+	class MIRU_API ParallelRecorder
+	{
+		//enums/structs
+	public:
+		struct CreateInfo
+		{
+			std::string				debugName;
+			ContextRef				context;
+			CommandPool::QueueType	queueType;
+			uint32_t				workerCount;		//If 0, std::thread::hardware_concurrency() is used.
+			uint32_t				frameCount;			//Number of frames in flight.
+			uint32_t				maxForksPerFrame;	//Number of secondary CommandBuffers per worker per frame.
+		};
+		struct RecordRange
+		{
+			CommandBufferRef	commandBuffer;	//Has begun with the InheritanceInfo passed to Fork().
+			uint32_t			index;
+			uint32_t			workerIndex;
+			uint32_t			first;
+			uint32_t			count;
+		};
+		typedef std::function<void(const RecordRange& recordRange)> RecordFunction;
+
+		//Methods
+	public:
+		static ParallelRecorderRef Create(CreateInfo* pCreateInfo);
+		ParallelRecorder(CreateInfo* pCreateInfo);
+		~ParallelRecorder();
+		const CreateInfo& GetCreateInfo() { return m_CI; }
+		const uint32_t& GetWorkerCount() { return m_CI.workerCount; }
+
+		//Resets the frame's CommandPools. The frame's previous submission must have completed on the device.
+		void BeginFrame(uint32_t frameIndex);
+		//Splits the draws [first, first + count) into contiguous ranges and records one range per worker.
+		//The RecordFunction is called concurrently and must only record into the RecordRange's CommandBuffer.
+		void Fork(const CommandBuffer::InheritanceInfo& inheritanceInfo, uint32_t first, uint32_t count, const RecordFunction& recordFunction);
+		//Waits for the workers and executes the recorded CommandBuffers in the primary CommandBuffer.
+		void Join(const CommandBufferRef& primaryCommandBuffer, uint32_t primaryIndex);
+
+	private:
+		void WorkerThread(uint32_t workerIndex);
+
+		//Members
+	private:
+		struct Job
+		{
+			bool		pending;
+			uint32_t	first;
+			uint32_t	count;
+		};
+
+		CreateInfo m_CI = {};
+
+		std::vector<std::vector<CommandPoolRef>> m_CmdPools;		//[frame][worker]
+		std::vector<std::vector<CommandBufferRef>> m_CmdBuffers;	//[frame][worker]
+		uint32_t m_FrameIndex = 0;
+		uint32_t m_ForkIndex = 0;
+		bool m_Forked = false;
+
+		std::vector<std::thread> m_Workers;
+		std::vector<Job> m_Jobs;
+		CommandBuffer::InheritanceInfo m_InheritanceInfo;
+		RecordFunction m_RecordFunction;
+		uint32_t m_OutstandingJobs = 0;
+		bool m_Shutdown = false;
+		std::mutex m_Mutex;
+		std::condition_variable m_WorkCV;
+		std::condition_variable m_DoneCV;
+	};
+}
+}
\ No newline at end of file
@@ -37,6 +37,7 @@ namespace base
 			AttachmentStoreOp		stencilStoreOp;
 			Image::Layout			initialLayout;	//Layout of Image subresources at the start of all subpasses in this RenderPass.
 			Image::Layout			finalLayout;	//Layout of Image subresources at the end of all subpasses in this RenderPass.
+			bool					transient = false; //The attachment is a transient Image. storeOp and stencilStoreOp are inferred as DONT_CARE.
 		};
 		struct AttachmentReference
 		{
@@ -166,6 +167,8 @@ namespace base
 		};
 
 		static constexpr uint32_t ShaderUnused = ~0;
+		//For D3D12: Each PushConstantRange is root constants at register(b<range index>, space<PushConstantRegisterSpace>).
+		static constexpr uint32_t PushConstantRegisterSpace = 1000;
 		struct ShaderGroupInfo
 		{
 			ShaderGroupType type;								//If GENERAL, specify only a generalShader. If TRIANGLES_HIT_GROUP, specify a closestHitShader and/or an anyHitShader. If PROCEDURAL_HIT_GROUP, specify a closestHitShader and/or an anyHitShader and an intersectionShader must be specified.
@@ -236,7 +239,7 @@ namespace base
 		ImageViewRef					resolveImageView;
 		Image::Layout					resolveImageLayout;
 		RenderPass::AttachmentLoadOp	loadOp;
-		RenderPass::AttachmentStoreOp	storeOp;
+		RenderPass::AttachmentStoreOp	storeOp;		//Inferred as DONT_CARE if the Image is a transient attachment.
 		Image::ClearValue				clearValue;
 	};
 	struct RenderingInfo
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "miru_core_common.h"
+
+namespace miru
+{
+namespace base
+{
+	//Queries written by CommandBuffer::WriteTimestamp(), BeginQuery() and EndQuery().
+	//Results are 64-bit. They can be read back on the host with GetResults(), which does not block, or copied into a
+	//Buffer on the device with CommandBuffer::CopyQueryPoolResults(). Queries must be reset with CommandBuffer::ResetQueryPool()
+	//before they are written again.
+	class MIRU_API QueryPool
+	{
+		//enums/structs
+	public:
+		enum class Type : uint32_t
+		{
+			TIMESTAMP,
+			OCCLUSION,
+			PIPELINE_STATISTICS
+		};
+		//Result of a Type::PIPELINE_STATISTICS query. All counters are always queried.
+		struct PipelineStatistics
+		{
+			uint64_t inputAssemblyVertices;
+			uint64_t inputAssemblyPrimitives;
+			uint64_t vertexShaderInvocations;
+			uint64_t geometryShaderInvocations;
+			uint64_t geometryShaderPrimitives;
+			uint64_t clippingInvocations;
+			uint64_t clippingPrimitives;
+			uint64_t fragmentShaderInvocations;
+			uint64_t tessellationControlShaderPatches;
+			uint64_t tessellationEvaluationShaderInvocations;
+			uint64_t computeShaderInvocations;
+		};
+		struct CreateInfo
+		{
+			std::string	debugName;
+			ContextRef	context;
+			Type		type;
+			uint32_t	queryCount;
+		};
+
+		//Methods
+	public:
+		static QueryPoolRef Create(CreateInfo* pCreateInfo);
+		virtual ~QueryPool() = default;
+		const CreateInfo& GetCreateInfo() { return m_CI; }
+
+		//Size in bytes of the result of one query.
+		inline uint32_t GetResultSize() const { return m_CI.type == Type::PIPELINE_STATISTICS ? sizeof(PipelineStatistics) : sizeof(uint64_t); }
+		//Nanoseconds per timestamp tick.
+		virtual double GetTimestampPeriod() = 0;
+		//Does not block. Writes the results of the available queries into pResults, tightly packed with GetResultSize() bytes per query.
+		//The results of unavailable queries are left unchanged. If set, pAvailable receives the availability of each query.
+		//Returns true if all the queries are available.
+		virtual bool GetResults(uint32_t firstQuery, uint32_t queryCount, void* pResults, bool* pAvailable = nullptr) = 0;
+
+		//Members
+	protected:
+		CreateInfo m_CI = {};
+	};
+}
+}
\ No newline at end of file
@@ -0,0 +1,105 @@
+#include "miru_core_common.h"
+#include "ResourceStateTracker.h"
+
+using namespace miru;
+using namespace base;
+
+ResourceStateTracker& ResourceStateTracker::Get()
+{
+	static ResourceStateTracker tracker;
+	return tracker;
+}
+
+std::vector<ResourceState> ResourceStateTracker::GetStates(const BufferRef& buffer)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	return GetStates(buffer.get(), 1, { PipelineStageBit::NONE_BIT, Barrier::AccessBit::NONE_BIT, Image::Layout::UNKNOWN });
+}
+
+std::vector<ResourceState> ResourceStateTracker::GetStates(const ImageRef& image)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	const Image::CreateInfo& imageCI = image->GetCreateInfo();
+	return GetStates(image.get(), static_cast<size_t>(imageCI.mipLevels) * imageCI.arrayLayers, { PipelineStageBit::NONE_BIT, Barrier::AccessBit::NONE_BIT, imageCI.layout });
+}
+
+bool ResourceStateTracker::GetTrackedStates(Image* image, std::vector<ResourceState>& states)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	const Image::CreateInfo& imageCI = image->GetCreateInfo();
+	const size_t count = static_cast<size_t>(imageCI.mipLevels) * imageCI.arrayLayers;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto it = m_Entries.find(image);
+	if (it == m_Entries.end() || it->second.resource.expired() || it->second.states.size() != count)
+		return false;
+
+	states = it->second.states;
+	return true;
+}
+
+bool ResourceStateTracker::SetStates(const Ref<void>& resource, const std::vector<ResourceState>& expectedStates, const std::vector<ResourceState>& states)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	Entry& entry = m_Entries[resource.get()];
+	if (entry.resource.expired())
+	{
+		entry.resource = resource;
+		entry.states = expectedStates;
+	}
+
+	bool expected = true;
+	for (size_t i = 0; i < states.size() && i < entry.states.size(); i++)
+	{
+		if (states[i] == expectedStates[i])
+			continue;
+
+		expected &= entry.states[i] == expectedStates[i];
+		entry.states[i] = states[i];
+	}
+
+	if (m_Entries.size() > m_PurgeSize)
+	{
+		for (auto it = m_Entries.begin(); it != m_Entries.end();)
+		{
+			if (it->second.resource.expired())
+				it = m_Entries.erase(it);
+			else
+				it++;
+		}
+		m_PurgeSize = std::max<size_t>(64, 2 * m_Entries.size());
+	}
+
+	return expected;
+}
+
+Barrier::AccessBit ResourceStateTracker::GetWriteAccess(Barrier::AccessBit access)
+{
+	static const Barrier::AccessBit writeAccess = Barrier::AccessBit::SHADER_WRITE_BIT | Barrier::AccessBit::COLOUR_ATTACHMENT_WRITE_BIT
+		| Barrier::AccessBit::DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | Barrier::AccessBit::TRANSFER_WRITE_BIT | Barrier::AccessBit::HOST_WRITE_BIT
+		| Barrier::AccessBit::MEMORY_WRITE_BIT | Barrier::AccessBit::TRANSFORM_FEEDBACK_WRITE_BIT | Barrier::AccessBit::TRANSFORM_FEEDBACK_COUNTER_WRITE_BIT
+		| Barrier::AccessBit::ACCELERATION_STRUCTURE_WRITE_BIT | Barrier::AccessBit::VIDEO_DECODE_WRITE_BIT | Barrier::AccessBit::VIDEO_ENCODE_WRITE_BIT
+		| Barrier::AccessBit::SHADER_STORAGE_WRITE_BIT | Barrier::AccessBit::D3D12_RESOLVE_DEST;
+
+	return access & writeAccess;
+}
+
+std::vector<ResourceState> ResourceStateTracker::GetStates(const void* resource, size_t count, const ResourceState& initialState)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto it = m_Entries.find(resource);
+	if (it == m_Entries.end() || it->second.resource.expired() || it->second.states.size() != count)
+		return std::vector<ResourceState>(count, initialState);
+	else
+		return it->second.states;
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "miru_core_common.h"
+#include "Buffer.h"
+#include "Image.h"
+#include "Sync.h"
+#include <mutex>
+
+namespace miru
+{
+namespace base
+{
+	//The pipeline stages and accesses of the latest use of a resource and, for Images, its layout.
+	struct ResourceState
+	{
+		PipelineStageBit	stages;
+		Barrier::AccessBit	access;
+		Image::Layout		layout;		//For Images only.
+
+		bool operator==(const ResourceState& other) const { return stages == other.stages && access == other.access && layout == other.layout; }
+		bool operator!=(const ResourceState& other) const { return !(*this == other); }
+	};
+
+	//Global ResourceStates of Buffers and Image subresources as of the last submitted CommandBuffer that used them.
+	//Used by CommandBuffer::Transition(). Resources are keyed by address and held by a weak reference, so the states of
+	//destroyed resources are discarded. Image subresources are indexed by mipLevel + arrayLayer * mipLevels.
+	//All methods can be called from any thread.
+	class MIRU_API ResourceStateTracker
+	{
+		//Methods
+	public:
+		static ResourceStateTracker& Get();
+
+		//Returns the one state of the Buffer or the states of all subresources of the Image.
+		//Untracked Buffers have not been used. Untracked Images are in their Image::CreateInfo::layout.
+		std::vector<ResourceState> GetStates(const BufferRef& buffer);
+		std::vector<ResourceState> GetStates(const ImageRef& image);
+		//Returns false if the Image is not tracked, in which case its layouts are unknown if it has been used.
+		bool GetTrackedStates(Image* image, std::vector<ResourceState>& states);
+
+		//Stores the states that differ from expectedStates. Returns false if any of those was not in its expected state,
+		//i.e. a CommandBuffer that used the resource was submitted after the states were read with GetStates().
+		bool SetStates(const Ref<void>& resource, const std::vector<ResourceState>& expectedStates, const std::vector<ResourceState>& states);
+
+		static Barrier::AccessBit GetWriteAccess(Barrier::AccessBit access);
+
+	private:
+		std::vector<ResourceState> GetStates(const void* resource, size_t count, const ResourceState& initialState);
+
+		//Members
+	private:
+		struct Entry
+		{
+			std::weak_ptr<void>			resource;
+			std::vector<ResourceState>	states;
+		};
+		std::unordered_map<const void*, Entry> m_Entries;
+		size_t m_PurgeSize = 64;	//Expired entries are removed when m_Entries grows beyond this.
+		std::mutex m_Mutex;
+	};
+}
+}
\ No newline at end of file
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "miru_core_common.h"
+#include <memory>
+#include <type_traits>
+
+namespace miru
+{
+namespace base
+{
+	//Linear scratch memory for translating a command's arguments into API structures.
+	//Allocations are valid until the enclosing Scope is destroyed. Allocations that do not fit are served from overflow
+	//blocks, which are merged into the main block when the outermost Scope ends. Once warmed up, recording does not allocate.
+	class ScratchAllocator
+	{
+		//enums/structs
+	public:
+		class Scope
+		{
+		public:
+			Scope(ScratchAllocator& scratch) : m_Scratch(scratch), m_Head(scratch.m_Head) {}
+			~Scope() { m_Scratch.Release(m_Head); }
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+
+		private:
+			ScratchAllocator& m_Scratch;
+			size_t m_Head;
+		};
+
+		//Methods
+	public:
+		ScratchAllocator(size_t size = 4096)
+			:m_Block(std::make_unique<uint8_t[]>(size)), m_Size(size) {}
+		~ScratchAllocator() = default;
+		ScratchAllocator(ScratchAllocator&&) = default;
+		ScratchAllocator& operator=(ScratchAllocator&&) = default;
+
+		//Returns uninitialised memory for count objects of T.
+		template<typename T>
+		T* Allocate(size_t count)
+		{
+			static_assert(std::is_trivially_destructible<T>::value, "ScratchAllocator only supports trivially destructible types.");
+			static_assert(alignof(T) <= alignof(std::max_align_t), "ScratchAllocator does not support over-aligned types.");
+
+			const size_t size = std::max<size_t>(sizeof(T) * count, 1);
+			const size_t offset = arc::Align<size_t>(m_Head, alignof(T));
+			if (offset + size <= m_Size)
+			{
+				m_Head = offset + size;
+				return reinterpret_cast<T*>(m_Block.get() + offset);
+			}
+
+			m_Overflow.push_back(std::make_unique<uint8_t[]>(size));
+			m_OverflowSize += size;
+			return reinterpret_cast<T*>(m_Overflow.back().get());
+		}
+
+	private:
+		void Release(size_t head)
+		{
+			m_Head = head;
+			if (m_Head == 0 && !m_Overflow.empty())
+			{
+				m_Size = 2 * (m_Size + m_OverflowSize);
+				m_Block = std::make_unique<uint8_t[]>(m_Size);
+				m_Overflow.clear();
+				m_OverflowSize = 0;
+			}
+		}
+
+		//Members
+	private:
+		std::unique_ptr<uint8_t[]> m_Block;
+		size_t m_Size = 0;
+		size_t m_Head = 0;
+		std::vector<std::unique_ptr<uint8_t[]>> m_Overflow;
+		size_t m_OverflowSize = 0;
+	};
+}
+}
\ No newline at end of file
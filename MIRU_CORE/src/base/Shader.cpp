@@ -53,6 +53,7 @@ void Shader::Recompile()
 	#if !defined(MIRU_WIN64_UWP)
 	CompileShaderFromSource(m_CI.recompileArguments);
 	Reconstruct();
+	m_Revision++;
 	#endif
 }
 
@@ -101,6 +101,8 @@ namespace base
 		const CreateInfo& GetCreateInfo() { return m_CI; }
 
 		void Recompile();
+		//Incremented by each Recompile(). Pipelines created with the Shader before a Recompile() use the previous code.
+		const uint64_t& GetRevision() const { return m_Revision; }
 
 		virtual void GetShaderResources() = 0;
 		const std::vector<VertexShaderInputAttributeDescription>& GetVSIADs() const { return m_VSIADs; };
@@ -120,6 +122,7 @@ namespace base
 	protected:
 		CreateInfo m_CI = {};
 		std::vector<char> m_ShaderBinary;
+		uint64_t m_Revision = 0;
 
 		std::vector<VertexShaderInputAttributeDescription> m_VSIADs;
 		std::vector<PixelShaderOutputAttributeDescription> m_PSOADs;
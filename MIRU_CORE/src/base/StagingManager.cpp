@@ -0,0 +1,379 @@
+#include "miru_core_common.h"
+#include "StagingManager.h"
+#include "CommandPoolBuffer.h"
+
+using namespace miru;
+using namespace base;
+
+StagingManagerRef StagingManager::Create(CreateInfo* pCreateInfo)
+{
+	return CreateRef<StagingManager>(pCreateInfo);
+}
+
+StagingManager::StagingManager(CreateInfo* pCreateInfo)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_CI = *pCreateInfo;
+	m_CI.maxFlushesInFlight = std::max<uint32_t>(m_CI.maxFlushesInFlight, 1);
+
+	MIRU_FATAL(!arc::BitwiseCheck(m_CI.allocator->GetCreateInfo().properties, Allocator::PropertiesBit::HOST_VISIBLE_BIT), "ERROR: BASE: StagingManager's Allocator must be HOST_VISIBLE.");
+
+	CommandPool::CreateInfo cmdPoolCI;
+	cmdPoolCI.debugName = m_CI.debugName + ": CommandPool";
+	cmdPoolCI.context = m_CI.context;
+	cmdPoolCI.flags = CommandPool::FlagBit::RESET_COMMAND_BUFFER_BIT;
+	cmdPoolCI.queueType = CommandPool::QueueType::TRANSFER;
+	m_CmdPool = CommandPool::Create(&cmdPoolCI);
+	m_SrcQueueFamilyIndex = m_CmdPool->GetQueueFamilyIndex();
+	m_DstQueueFamilyIndex = m_CI.dstCommandPool ? m_CI.dstCommandPool->GetQueueFamilyIndex() : Barrier::QueueFamilyIgnored;
+
+	CommandBuffer::CreateInfo cmdBufferCI;
+	cmdBufferCI.debugName = m_CI.debugName + ": CommandBuffer";
+	cmdBufferCI.commandPool = m_CmdPool;
+	cmdBufferCI.level = CommandBuffer::Level::PRIMARY;
+	cmdBufferCI.commandBufferCount = m_CI.maxFlushesInFlight;
+	m_CmdBuffer = CommandBuffer::Create(&cmdBufferCI);
+	m_CmdBufferValues.resize(m_CI.maxFlushesInFlight, 0);
+
+	Semaphore::CreateInfo semaphoreCI;
+	semaphoreCI.debugName = m_CI.debugName + ": Semaphore";
+	semaphoreCI.device = m_CI.context->GetDevice();
+	semaphoreCI.type = Semaphore::Type::TIMELINE;
+	m_Semaphore = Semaphore::Create(&semaphoreCI);
+}
+
+StagingManager::~StagingManager()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	Wait(m_Value);
+
+	m_BufferUploads.clear();
+	m_ImageUploads.clear();
+	m_AcquireBarriers.clear();
+	m_Chunks.clear();
+	m_PendingChunks.clear();
+	m_FreeChunks.clear();
+}
+
+void StagingManager::UploadBuffer(const BufferRef& buffer, size_t offset, size_t size, const void* data)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	if (!buffer || size == 0 || !data)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	size_t srcOffset = 0;
+	Chunk& chunk = AcquireChunk(size, 16, srcOffset);
+	m_CI.allocator->SubmitData(chunk.buffer->GetAllocation(), srcOffset, size, const_cast<void*>(data));
+
+	m_BufferUploads.push_back({ chunk.buffer, buffer, { srcOffset, offset, size } });
+}
+
+void StagingManager::UploadImage(const ImageUploadInfo& imageUploadInfo, size_t size, const void* data)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	if (!imageUploadInfo.image || size == 0 || !data)
+		return;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	//512 bytes satisfies D3D12_TEXTURE_DATA_PLACEMENT_ALIGNMENT and any Vulkan texel size.
+	size_t srcOffset = 0;
+	Chunk& chunk = AcquireChunk(size, 512, srcOffset);
+	m_CI.allocator->SubmitData(chunk.buffer->GetAllocation(), srcOffset, size, const_cast<void*>(data));
+
+	ImageUpload imageUpload = { chunk.buffer, imageUploadInfo };
+	imageUpload.info.region.bufferOffset = static_cast<uint64_t>(srcOffset);
+	m_ImageUploads.push_back(imageUpload);
+}
+
+uint64_t StagingManager::Flush()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	if (m_BufferUploads.empty() && m_ImageUploads.empty())
+		return m_Value;
+
+	const uint32_t index = m_CmdBufferIndex;
+	m_Semaphore->Wait(m_CmdBufferValues[index], UINT64_MAX);
+
+	m_CmdBuffer->Begin(index, CommandBuffer::UsageBit::ONE_TIME_SUBMIT);
+
+	//Exclusive resources are released to the consuming queue family after the copies. Each release barrier has a matching
+	//acquire barrier, with the same layouts, for RecordAcquireBarriers().
+	const bool transferOwnership = m_DstQueueFamilyIndex != Barrier::QueueFamilyIgnored && m_DstQueueFamilyIndex != m_SrcQueueFamilyIndex;
+	std::vector<BarrierRef> acquireBarriers;
+
+	//Transition images for the copies
+	std::vector<BarrierRef> preBarriers;
+	std::vector<BarrierRef> postBarriers;
+	for (const ImageUpload& imageUpload : m_ImageUploads)
+	{
+		const ImageUploadInfo& info = imageUpload.info;
+		const Image::SubresourceLayers& layers = info.region.imageSubresource;
+
+		Barrier::CreateInfo barrierCI;
+		barrierCI.type = Barrier::Type::IMAGE;
+		barrierCI.srcAccess = Barrier::AccessBit::NONE_BIT;
+		barrierCI.dstAccess = Barrier::AccessBit::TRANSFER_WRITE_BIT;
+		barrierCI.srcQueueFamilyIndex = Barrier::QueueFamilyIgnored;
+		barrierCI.dstQueueFamilyIndex = Barrier::QueueFamilyIgnored;
+		barrierCI.image = info.image;
+		barrierCI.oldLayout = info.oldLayout;
+		barrierCI.newLayout = Image::Layout::TRANSFER_DST_OPTIMAL;
+		barrierCI.subresourceRange = { layers.aspectMask, layers.mipLevel, 1, layers.baseArrayLayer, layers.arrayLayerCount };
+		preBarriers.push_back(Barrier::Create(&barrierCI));
+
+		if (info.newLayout != Image::Layout::TRANSFER_DST_OPTIMAL || transferOwnership)
+		{
+			barrierCI.srcAccess = Barrier::AccessBit::TRANSFER_WRITE_BIT;
+			barrierCI.dstAccess = Barrier::AccessBit::NONE_BIT;
+			barrierCI.oldLayout = Image::Layout::TRANSFER_DST_OPTIMAL;
+			barrierCI.newLayout = info.newLayout;
+			if (transferOwnership)
+			{
+				barrierCI.srcQueueFamilyIndex = m_SrcQueueFamilyIndex;
+				barrierCI.dstQueueFamilyIndex = m_DstQueueFamilyIndex;
+			}
+			postBarriers.push_back(Barrier::Create(&barrierCI));
+
+			if (transferOwnership)
+			{
+				barrierCI.srcAccess = Barrier::AccessBit::NONE_BIT;
+				barrierCI.dstAccess = Barrier::AccessBit::MEMORY_READ_BIT | Barrier::AccessBit::MEMORY_WRITE_BIT;
+				acquireBarriers.push_back(Barrier::Create(&barrierCI));
+			}
+		}
+	}
+	if (!preBarriers.empty())
+		m_CmdBuffer->PipelineBarrier(index, PipelineStageBit::TOP_OF_PIPE_BIT, PipelineStageBit::TRANSFER_BIT, DependencyBit::NONE_BIT, preBarriers);
+
+	//Batch consecutive buffer copies with the same source and destination, in upload order. A copy that overlaps a range
+	//written since the last barrier must be ordered after the earlier write, so a barrier is recorded before it.
+	std::vector<Buffer::Copy> batch;
+	std::vector<std::pair<const Buffer*, std::pair<uint64_t, uint64_t>>> writtenRanges;
+	size_t batchUpload = 0;
+	auto RecordBatch = [&]()
+	{
+		if (!batch.empty())
+			m_CmdBuffer->CopyBuffer(index, m_BufferUploads[batchUpload].srcBuffer, m_BufferUploads[batchUpload].dstBuffer, batch);
+		batch.clear();
+	};
+	for (size_t i = 0; i < m_BufferUploads.size(); i++)
+	{
+		const BufferUpload& bufferUpload = m_BufferUploads[i];
+		const uint64_t& begin = bufferUpload.copy.dstOffset;
+		const uint64_t& end = bufferUpload.copy.dstOffset + bufferUpload.copy.size;
+
+		bool overlap = false;
+		for (const auto& writtenRange : writtenRanges)
+		{
+			if (writtenRange.first == bufferUpload.dstBuffer.get() && begin < writtenRange.second.second && writtenRange.second.first < end)
+			{
+				overlap = true;
+				break;
+			}
+		}
+
+		const BufferUpload& batchBufferUpload = m_BufferUploads[batchUpload];
+		if (overlap || batchBufferUpload.srcBuffer != bufferUpload.srcBuffer || batchBufferUpload.dstBuffer != bufferUpload.dstBuffer)
+		{
+			RecordBatch();
+			batchUpload = i;
+		}
+		if (overlap)
+		{
+			Barrier::CreateInfo barrierCI;
+			barrierCI.type = Barrier::Type::MEMORY;
+			barrierCI.srcAccess = Barrier::AccessBit::TRANSFER_WRITE_BIT;
+			barrierCI.dstAccess = Barrier::AccessBit::TRANSFER_WRITE_BIT;
+			barrierCI.srcQueueFamilyIndex = Barrier::QueueFamilyIgnored;
+			barrierCI.dstQueueFamilyIndex = Barrier::QueueFamilyIgnored;
+			barrierCI.buffer = bufferUpload.dstBuffer;	//For D3D12, a UAV barrier is recorded on the buffer.
+			barrierCI.offset = 0;
+			barrierCI.size = bufferUpload.dstBuffer->GetCreateInfo().size;
+			m_CmdBuffer->PipelineBarrier(index, PipelineStageBit::TRANSFER_BIT, PipelineStageBit::TRANSFER_BIT, DependencyBit::NONE_BIT, { Barrier::Create(&barrierCI) });
+			writtenRanges.clear();
+		}
+
+		batch.push_back(bufferUpload.copy);
+		writtenRanges.push_back({ bufferUpload.dstBuffer.get(), { begin, end } });
+	}
+	RecordBatch();
+
+	for (const ImageUpload& imageUpload : m_ImageUploads)
+	{
+		m_CmdBuffer->CopyBufferToImage(index, imageUpload.srcBuffer, imageUpload.info.image, Image::Layout::TRANSFER_DST_OPTIMAL, &imageUpload.info.region, 1);
+	}
+
+	//Release each destination buffer over the range that was written
+	if (transferOwnership)
+	{
+		std::map<Buffer*, std::pair<BufferRef, std::pair<uint64_t, uint64_t>>> bufferRanges;
+		for (const BufferUpload& bufferUpload : m_BufferUploads)
+		{
+			auto it = bufferRanges.find(bufferUpload.dstBuffer.get());
+			const uint64_t& begin = bufferUpload.copy.dstOffset;
+			const uint64_t& end = bufferUpload.copy.dstOffset + bufferUpload.copy.size;
+			if (it == bufferRanges.end())
+			{
+				bufferRanges[bufferUpload.dstBuffer.get()] = { bufferUpload.dstBuffer, { begin, end } };
+			}
+			else
+			{
+				it->second.second.first = std::min(it->second.second.first, begin);
+				it->second.second.second = std::max(it->second.second.second, end);
+			}
+		}
+		for (const auto& bufferRange : bufferRanges)
+		{
+			Barrier::CreateInfo barrierCI;
+			barrierCI.type = Barrier::Type::BUFFER;
+			barrierCI.srcAccess = Barrier::AccessBit::TRANSFER_WRITE_BIT;
+			barrierCI.dstAccess = Barrier::AccessBit::NONE_BIT;
+			barrierCI.srcQueueFamilyIndex = m_SrcQueueFamilyIndex;
+			barrierCI.dstQueueFamilyIndex = m_DstQueueFamilyIndex;
+			barrierCI.buffer = bufferRange.second.first;
+			barrierCI.offset = bufferRange.second.second.first;
+			barrierCI.size = bufferRange.second.second.second - bufferRange.second.second.first;
+			postBarriers.push_back(Barrier::Create(&barrierCI));
+
+			barrierCI.srcAccess = Barrier::AccessBit::NONE_BIT;
+			barrierCI.dstAccess = Barrier::AccessBit::MEMORY_READ_BIT | Barrier::AccessBit::MEMORY_WRITE_BIT;
+			acquireBarriers.push_back(Barrier::Create(&barrierCI));
+		}
+	}
+
+	if (!postBarriers.empty())
+		m_CmdBuffer->PipelineBarrier(index, PipelineStageBit::TRANSFER_BIT, PipelineStageBit::BOTTOM_OF_PIPE_BIT, DependencyBit::NONE_BIT, postBarriers);
+
+	m_CmdBuffer->End(index);
+
+	m_Value++;
+	CommandBuffer::SubmitInfo submitInfo = { { index }, {}, {}, {}, { m_Semaphore }, { m_Value } };
+	m_CmdBuffer->Submit({ submitInfo }, nullptr);
+
+	m_CmdBufferValues[index] = m_Value;
+	m_CmdBufferIndex = (m_CmdBufferIndex + 1) % m_CI.maxFlushesInFlight;
+
+	if (!acquireBarriers.empty())
+		m_AcquireBarriers.push_back({ m_Value, std::move(acquireBarriers) });
+
+	for (Chunk& chunk : m_Chunks)
+	{
+		chunk.value = m_Value;
+		m_PendingChunks.push_back(chunk);
+	}
+	m_Chunks.clear();
+	m_BufferUploads.clear();
+	m_ImageUploads.clear();
+
+	return m_Value;
+}
+
+bool StagingManager::IsComplete(uint64_t value)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	return m_Semaphore->GetCurrentValue() >= value;
+}
+
+bool StagingManager::Wait(uint64_t value, uint64_t timeout)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	if (value == 0)
+		return true;
+
+	return m_Semaphore->Wait(value, timeout);
+}
+
+void StagingManager::RecordAcquireBarriers(const CommandBufferRef& commandBuffer, uint32_t index, uint64_t value)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	std::vector<BarrierRef> barriers;
+	for (auto it = m_AcquireBarriers.begin(); it != m_AcquireBarriers.end();)
+	{
+		if (it->first <= value)
+		{
+			barriers.insert(barriers.end(), it->second.begin(), it->second.end());
+			it = m_AcquireBarriers.erase(it);
+		}
+		else
+		{
+			it++;
+		}
+	}
+	if (!barriers.empty())
+		commandBuffer->PipelineBarrier(index, PipelineStageBit::TOP_OF_PIPE_BIT, PipelineStageBit::ALL_COMMANDS_BIT, DependencyBit::NONE_BIT, barriers);
+}
+
+StagingManager::Chunk& StagingManager::AcquireChunk(size_t size, size_t alignment, size_t& offset)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	//Open chunks in the current batch
+	for (Chunk& chunk : m_Chunks)
+	{
+		size_t alignedHead = arc::Align<size_t>(chunk.head, alignment);
+		if (alignedHead + size <= chunk.buffer->GetCreateInfo().size)
+		{
+			offset = alignedHead;
+			chunk.head = alignedHead + size;
+			return chunk;
+		}
+	}
+
+	//Recycle chunks from completed flushes
+	const uint64_t completedValue = m_Semaphore->GetCurrentValue();
+	for (auto it = m_PendingChunks.begin(); it != m_PendingChunks.end();)
+	{
+		if (it->value <= completedValue)
+		{
+			it->head = 0;
+			m_FreeChunks.push_back(*it);
+			it = m_PendingChunks.erase(it);
+		}
+		else
+		{
+			it++;
+		}
+	}
+	for (auto it = m_FreeChunks.begin(); it != m_FreeChunks.end(); it++)
+	{
+		if (size <= it->buffer->GetCreateInfo().size)
+		{
+			m_Chunks.push_back(*it);
+			m_FreeChunks.erase(it);
+
+			Chunk& chunk = m_Chunks.back();
+			offset = 0;
+			chunk.head = size;
+			return chunk;
+		}
+	}
+
+	//Allocate a new chunk
+	Buffer::CreateInfo bufferCI;
+	bufferCI.debugName = m_CI.debugName + ": Staging Chunk " + std::to_string(m_Chunks.size() + m_PendingChunks.size() + m_FreeChunks.size());
+	bufferCI.device = m_CI.context->GetDevice();
+	bufferCI.usage = Buffer::UsageBit::TRANSFER_SRC_BIT;
+	bufferCI.imageDimension = { 0, 0, 0, 0 };
+	bufferCI.size = std::max<size_t>(m_CI.chunkSize, size);
+	bufferCI.data = nullptr;
+	bufferCI.allocator = m_CI.allocator;
+	m_Chunks.push_back({ Buffer::Create(&bufferCI), size, 0 });
+
+	offset = 0;
+	return m_Chunks.back();
+}
\ No newline at end of file
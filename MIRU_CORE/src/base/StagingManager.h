@@ -0,0 +1,111 @@
+#pragma once
+
+#include "miru_core_common.h"
+#include "Allocator.h"
+#include "Buffer.h"
+#include "Image.h"
+#include "Sync.h"
+#include <mutex>
+
+namespace miru
+{
+namespace base
+{
+	//Batches uploads to device local resources on a CommandPool::QueueType::TRANSFER queue.
+	//Upload requests can be made from any thread. The data is copied into pooled host visible staging chunks
+	//and all pending copies are recorded into one CommandBuffer per Flush(). Flush() returns the timeline
+	//Semaphore value that is signalled when the copies have completed. Buffer uploads to overlapping ranges are applied in the
+	//order that they were requested.
+	//Resources are used with exclusive sharing, so consumers should wait on the semaphore at PipelineStageBit::TRANSFER_BIT.
+	//If the consuming queue is in another queue family, Flush() releases the ownership of the uploaded resources to it, and
+	//the consumer must record the matching acquire barriers with RecordAcquireBarriers() before using the resources.
+	class MIRU_API StagingManager
+	{
+		//enums/structs
+	public:
+		struct CreateInfo
+		{
+			std::string		debugName;
+			ContextRef		context;
+			AllocatorRef	allocator;			//Must be HOST_VISIBLE. Staging chunks are allocated from this.
+			size_t			chunkSize;			//Requests larger than this get a dedicated chunk.
+			uint32_t		maxFlushesInFlight;	//Number of CommandBuffers to cycle through.
+			CommandPoolRef	dstCommandPool;		//Optional. The CommandPool of the queue that consumes the uploads.
+		};
+		struct ImageUploadInfo
+		{
+			ImageRef					image;
+			Image::Layout				oldLayout;	//Layout of the image before the upload.
+			Image::Layout				newLayout;	//Layout of the image after the upload.
+			Image::BufferImageCopy		region;		//bufferOffset is ignored. For D3D12, rows must be padded to D3D12_TEXTURE_DATA_PITCH_ALIGNMENT.
+		};
+
+		//Methods
+	public:
+		static StagingManagerRef Create(CreateInfo* pCreateInfo);
+		StagingManager(CreateInfo* pCreateInfo);
+		~StagingManager();
+		const CreateInfo& GetCreateInfo() { return m_CI; }
+		const SemaphoreRef& GetSemaphore() { return m_Semaphore; }
+
+		void UploadBuffer(const BufferRef& buffer, size_t offset, size_t size, const void* data);
+		void UploadImage(const ImageUploadInfo& imageUploadInfo, size_t size, const void* data);
+
+		//Records and submits all pending uploads. Returns the Semaphore value signalled on completion.
+		uint64_t Flush();
+		//Returns true if the uploads associated with the value have completed.
+		bool IsComplete(uint64_t value);
+		//Parameter: timeout is in nanoseconds
+		bool Wait(uint64_t value, uint64_t timeout = UINT64_MAX);
+		//Records the queue family ownership acquire barriers for the flushes up to and including value into a CommandBuffer
+		//from CreateInfo::dstCommandPool. Its submission must wait on the Semaphore for value. Does nothing if no ownership
+		//transfer is needed.
+		void RecordAcquireBarriers(const CommandBufferRef& commandBuffer, uint32_t index, uint64_t value);
+
+	private:
+		struct Chunk;
+		Chunk& AcquireChunk(size_t size, size_t alignment, size_t& offset);
+
+		//Members
+	private:
+		struct Chunk
+		{
+			BufferRef	buffer;
+			size_t		head;
+			uint64_t	value;	//Semaphore value of the last Flush() that used this chunk.
+		};
+		struct BufferUpload
+		{
+			BufferRef	srcBuffer;
+			BufferRef	dstBuffer;
+			Buffer::Copy copy;
+		};
+		struct ImageUpload
+		{
+			BufferRef		srcBuffer;
+			ImageUploadInfo	info;
+		};
+
+		CreateInfo m_CI = {};
+		std::mutex m_Mutex;
+
+		CommandPoolRef m_CmdPool;
+		CommandBufferRef m_CmdBuffer;
+		std::vector<uint64_t> m_CmdBufferValues;
+		uint32_t m_CmdBufferIndex = 0;
+
+		SemaphoreRef m_Semaphore;
+		uint64_t m_Value = 0;
+
+		std::vector<Chunk> m_Chunks;
+		std::vector<Chunk> m_FreeChunks;
+		std::vector<Chunk> m_PendingChunks;
+		std::vector<BufferUpload> m_BufferUploads;
+		std::vector<ImageUpload> m_ImageUploads;
+
+		uint32_t m_SrcQueueFamilyIndex;
+		uint32_t m_DstQueueFamilyIndex;
+		std::vector<std::pair<uint64_t, std::vector<BarrierRef>>> m_AcquireBarriers;	//Per Flush() value.
+	};
+}
+}
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include "miru_core_common.h"
+#include "UploadRing.h"
+#if defined (MIRU_D3D12)
+#include "d3d12/D3D12_Include.h"
+#endif
+#if defined (MIRU_VULKAN)
+#include "vulkan/VKContext.h"
+#endif
+
+using namespace miru;
+using namespace base;
+
+UploadRingRef UploadRing::Create(CreateInfo* pCreateInfo)
+{
+	return CreateRef<UploadRing>(pCreateInfo);
+}
+
+UploadRing::UploadRing(CreateInfo* pCreateInfo)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_CI = *pCreateInfo;
+	m_Alignment = m_CI.alignment ? m_CI.alignment : GetDeviceAlignment();
+	m_CI.size = arc::Align<size_t>(m_CI.size, m_Alignment);
+
+	MIRU_WARN(!m_CI.allocator->GetCreateInfo().persistentlyMapped, "WARN: BASE: UploadRing's Allocator is not persistently mapped. Uploads will map and unmap the buffer.");
+
+	Buffer::CreateInfo bufferCI;
+	bufferCI.debugName = m_CI.debugName + ": Buffer";
+	bufferCI.device = m_CI.context->GetDevice();
+	bufferCI.usage = m_CI.usage;
+	bufferCI.imageDimension = { 0, 0, 0, 0 };
+	bufferCI.size = m_CI.size;
+	bufferCI.data = nullptr;
+	bufferCI.allocator = m_CI.allocator;
+	m_Buffer = Buffer::Create(&bufferCI);
+}
+
+UploadRing::~UploadRing()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_Frames.clear();
+	m_Buffer = nullptr;
+}
+
+bool UploadRing::Allocate(size_t size, Suballocation& suballocation)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	size_t offset = 0;
+	if (!TryAllocate(size, offset))
+	{
+		Reclaim();
+		if (!TryAllocate(size, offset))
+		{
+			MIRU_WARN(true, "WARN: BASE: UploadRing is full.");
+			return false;
+		}
+	}
+
+	void* mappedData = m_Buffer->GetMappedPointer();
+	suballocation.buffer = m_Buffer;
+	suballocation.offset = offset;
+	suballocation.size = size;
+	suballocation.mappedData = mappedData ? reinterpret_cast<char*>(mappedData) + offset : nullptr;
+	return true;
+}
+
+bool UploadRing::Upload(const void* data, size_t size, Suballocation& suballocation)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	if (!Allocate(size, suballocation))
+		return false;
+
+	m_CI.allocator->SubmitData(m_Buffer->GetAllocation(), suballocation.offset, size, const_cast<void*>(data));
+	return true;
+}
+
+BufferViewRef UploadRing::CreateBufferView(const Suballocation& suballocation, BufferView::Type type, size_t stride)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	BufferView::CreateInfo bufferViewCI;
+	bufferViewCI.debugName = m_CI.debugName + ": BufferView";
+	bufferViewCI.device = m_CI.context->GetDevice();
+	bufferViewCI.type = type;
+	bufferViewCI.buffer = suballocation.buffer;
+	bufferViewCI.offset = suballocation.offset;
+	bufferViewCI.size = suballocation.size;
+	bufferViewCI.stride = stride;
+	return BufferView::Create(&bufferViewCI);
+}
+
+void UploadRing::EndFrame(const FenceRef& fence)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_Frames.push_back({ m_Head, m_FrameUsedSize, fence, nullptr, 0 });
+	m_FrameUsedSize = 0;
+}
+
+void UploadRing::EndFrame(const SemaphoreRef& timelineSemaphore, uint64_t value)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	MIRU_FATAL(timelineSemaphore->GetCreateInfo().type != Semaphore::Type::TIMELINE, "ERROR: BASE: UploadRing requires a timeline Semaphore.");
+
+	m_Frames.push_back({ m_Head, m_FrameUsedSize, nullptr, timelineSemaphore, value });
+	m_FrameUsedSize = 0;
+}
+
+void UploadRing::Reclaim()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	while (!m_Frames.empty())
+	{
+		const Frame& frame = m_Frames.front();
+		bool completed = frame.fence ? frame.fence->GetStatus() : (frame.timelineSemaphore->GetCurrentValue() >= frame.value);
+		if (!completed)
+			break;
+
+		m_Tail = frame.head;
+		m_UsedSize -= frame.usedSize;
+		m_Frames.pop_front();
+	}
+
+	//Nothing in flight, so restart from the beginning of the buffer.
+	if (m_UsedSize == 0)
+	{
+		m_Head = 0;
+		m_Tail = 0;
+	}
+}
+
+bool UploadRing::TryAllocate(size_t size, size_t& offset)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	//Reserve whole alignment units, so that views which round up their size (e.g. D3D12 CBVs) stay in their region.
+	size = arc::Align<size_t>(size, m_Alignment);
+	if (size == 0 || size > m_CI.size)
+		return false;
+
+	const size_t alignedHead = arc::Align<size_t>(m_Head, m_Alignment);
+	size_t newHead = 0;
+	size_t usedSize = 0;
+
+	const bool wrapped = m_Head < m_Tail || (m_Head == m_Tail && m_UsedSize > 0);
+	if (!wrapped)
+	{
+		if (alignedHead + size <= m_CI.size)
+		{
+			offset = alignedHead;
+			newHead = alignedHead + size;
+			usedSize = newHead - m_Head;
+		}
+		else if (size <= m_Tail)
+		{
+			//The unused end of the buffer is accounted to this frame.
+			offset = 0;
+			newHead = size;
+			usedSize = (m_CI.size - m_Head) + size;
+		}
+		else
+		{
+			return false;
+		}
+	}
+	else
+	{
+		if (alignedHead + size <= m_Tail)
+		{
+			offset = alignedHead;
+			newHead = alignedHead + size;
+			usedSize = newHead - m_Head;
+		}
+		else
+		{
+			return false;
+		}
+	}
+
+	m_Head = newHead;
+	m_UsedSize += usedSize;
+	m_FrameUsedSize += usedSize;
+	return true;
+}
+
+size_t UploadRing::GetDeviceAlignment()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	const bool& uniform = arc::BitwiseCheck(m_CI.usage, Buffer::UsageBit::UNIFORM_BIT) || arc::BitwiseCheck(m_CI.usage, Buffer::UsageBit::UNIFORM_TEXEL_BIT);
+	const bool& storage = arc::BitwiseCheck(m_CI.usage, Buffer::UsageBit::STORAGE_BIT) || arc::BitwiseCheck(m_CI.usage, Buffer::UsageBit::STORAGE_TEXEL_BIT);
+
+	switch (GraphicsAPI::GetAPI())
+	{
+	case GraphicsAPI::API::D3D12:
+		#if defined (MIRU_D3D12)
+		return uniform ? D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT : D3D12_RAW_UAV_SRV_BYTE_ALIGNMENT;
+		#else
+		return 256;
+		#endif
+	case GraphicsAPI::API::VULKAN:
+		#if defined (MIRU_VULKAN)
+		{
+			const vulkan::ContextRef& context = ref_cast<vulkan::Context>(m_CI.context);
+			const VkPhysicalDeviceLimits& limits = context->m_PhysicalDevices.m_PDIs[context->m_PhysicalDeviceIndex].m_Properties.limits;
+			size_t alignment = 16;
+			if (uniform)
+				alignment = std::max<size_t>(alignment, static_cast<size_t>(limits.minUniformBufferOffsetAlignment));
+			if (storage)
+				alignment = std::max<size_t>(alignment, static_cast<size_t>(limits.minStorageBufferOffsetAlignment));
+			return alignment;
+		}
+		#else
+		return 256;
+		#endif
+	case GraphicsAPI::API::UNKNOWN:
+	default:
+		MIRU_FATAL(true, "ERROR: BASE: Unknown GraphicsAPI."); return 256;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "miru_core_common.h"
+#include "Allocator.h"
+#include "Buffer.h"
+#include "Sync.h"
+#include <deque>
+
+namespace miru
+{
+namespace base
+{
+	//Linear per-frame suballocator for transient data, e.g. constant buffers.
+	//All suballocations come from one host visible Buffer. Regions are reclaimed once the Fence or
+	//timeline Semaphore value passed to EndFrame() has been signalled.
+	class MIRU_API UploadRing
+	{
+		//enums/structs
+	public:
+		struct CreateInfo
+		{
+			std::string			debugName;
+			ContextRef			context;
+			AllocatorRef		allocator;	//Should be HOST_VISIBLE and persistentlyMapped.
+			Buffer::UsageBit	usage;
+			size_t				size;
+			size_t				alignment;	//If 0, the device's minimum offset alignment for the usage is used.
+		};
+		struct Suballocation
+		{
+			BufferRef	buffer;
+			size_t		offset;
+			size_t		size;
+			void*		mappedData;		//nullptr if the Allocator is not persistently mapped.
+		};
+
+		//Methods
+	public:
+		static UploadRingRef Create(CreateInfo* pCreateInfo);
+		UploadRing(CreateInfo* pCreateInfo);
+		~UploadRing();
+		const CreateInfo& GetCreateInfo() { return m_CI; }
+		const BufferRef& GetBuffer() { return m_Buffer; }
+		const size_t& GetAlignment() { return m_Alignment; }
+
+		//Returns false if there is no space left in the ring.
+		bool Allocate(size_t size, Suballocation& suballocation);
+		//Allocates and copies the data in to the suballocation.
+		bool Upload(const void* data, size_t size, Suballocation& suballocation);
+		BufferViewRef CreateBufferView(const Suballocation& suballocation, BufferView::Type type, size_t stride);
+
+		//Closes the current frame's region. It is reclaimed when the fence is signalled.
+		void EndFrame(const FenceRef& fence);
+		//Closes the current frame's region. It is reclaimed when the semaphore reaches the value.
+		void EndFrame(const SemaphoreRef& timelineSemaphore, uint64_t value);
+		//Releases all regions whose frames have completed on the device.
+		void Reclaim();
+
+	private:
+		bool TryAllocate(size_t size, size_t& offset);
+		size_t GetDeviceAlignment();
+
+		//Members
+	private:
+		struct Frame
+		{
+			size_t			head;
+			size_t			usedSize;
+			FenceRef		fence;
+			SemaphoreRef	timelineSemaphore;
+			uint64_t		value;
+		};
+
+		CreateInfo m_CI = {};
+		BufferRef m_Buffer;
+		size_t m_Alignment = 0;
+
+		size_t m_Head = 0;
+		size_t m_Tail = 0;
+		size_t m_UsedSize = 0;
+		size_t m_FrameUsedSize = 0;
+		std::deque<Frame> m_Frames;
+	};
+}
+}
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "D3D12AliasingHeap.h"
+#include "D3D12Allocator.h"
+#include "D3D12Context.h"
+#include "D3D12Buffer.h"
+#include "D3D12Image.h"
+
+using namespace miru;
+using namespace d3d12;
+
+AliasingHeap::AliasingHeap(AliasingHeap::CreateInfo* pCreateInfo)
+	:m_Device(reinterpret_cast<ID3D12Device*>(pCreateInfo->context->GetDevice()))
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_CI = *pCreateInfo;
+}
+
+AliasingHeap::~AliasingHeap()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	Reset();
+}
+
+void AliasingHeap::GetMemoryRequirements(Resource& resource)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	D3D12_RESOURCE_DESC resourceDesc;
+	if (resource.isImage)
+	{
+		resourceDesc = ref_cast<Image>(resource.image)->m_ResourceDesc;
+		const bool& renderTargetOrDepthStencil = arc::BitwiseCheck(resourceDesc.Flags, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET) || arc::BitwiseCheck(resourceDesc.Flags, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
+		m_HasRenderTargetOrDepthStencilTextures |= renderTargetOrDepthStencil;
+		m_HasNonRenderTargetOrDepthStencilTextures |= !renderTargetOrDepthStencil;
+	}
+	else
+	{
+		resourceDesc = ref_cast<Buffer>(resource.buffer)->m_ResourceDesc;
+		m_HasBuffers = true;
+	}
+
+	const D3D12_RESOURCE_ALLOCATION_INFO& allocationInfo = m_Device->GetResourceAllocationInfo(0, 1, &resourceDesc);
+	resource.size = static_cast<size_t>(allocationInfo.SizeInBytes);
+	resource.alignment = static_cast<size_t>(allocationInfo.Alignment);
+	resource.memoryTypeBits = ~0u; //The heap's category is selected by AllocateMemory().
+}
+
+void AliasingHeap::AllocateMemory(size_t size, size_t alignment, uint32_t memoryTypeBits)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	//Resource heap tier 1 only allows one category of resource per heap.
+	const uint32_t& categoryCount = uint32_t(m_HasBuffers) + uint32_t(m_HasRenderTargetOrDepthStencilTextures) + uint32_t(m_HasNonRenderTargetOrDepthStencilTextures);
+	D3D12_HEAP_FLAGS heapFlags = D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES;
+	if (categoryCount == 1)
+	{
+		heapFlags = m_HasBuffers ? D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS : m_HasRenderTargetOrDepthStencilTextures ? D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES : D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+	}
+	else
+	{
+		const D3D12_RESOURCE_HEAP_TIER& resourceHeapTier = ref_cast<Context>(m_CI.context)->m_Features.d3d12Options.ResourceHeapTier;
+		MIRU_FATAL(resourceHeapTier < D3D12_RESOURCE_HEAP_TIER_2, "ERROR: D3D12: AliasingHeap can not mix Buffers, render target/depth stencil Images and other Images on a device with D3D12_RESOURCE_HEAP_TIER_1.");
+	}
+
+	D3D12_RESOURCE_ALLOCATION_INFO allocationInfo;
+	allocationInfo.SizeInBytes = static_cast<UINT64>(size);
+	allocationInfo.Alignment = static_cast<UINT64>(alignment);
+
+	m_D3D12MAllocationDesc.Flags = D3D12MA::ALLOCATION_FLAG_COMMITTED;
+	m_D3D12MAllocationDesc.HeapType = ref_cast<Allocator>(m_CI.allocator)->GetHeapProperties().Type;
+	m_D3D12MAllocationDesc.ExtraHeapFlags = heapFlags;
+	m_D3D12MAllocationDesc.CustomPool = nullptr;
+
+	D3D12MA::Allocator* allocator = reinterpret_cast<D3D12MA::Allocator*>(m_CI.allocator->GetNativeAllocator());
+	MIRU_FATAL(allocator->AllocateMemory(&m_D3D12MAllocationDesc, &allocationInfo, &m_D3D12MAllocation), "ERROR: D3D12: Failed to allocate memory for AliasingHeap.");
+	m_D3D12MAllocation->SetName(arc::ToWString(m_CI.debugName).c_str());
+}
+
+void AliasingHeap::BindMemory(Resource& resource)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	D3D12MA::Allocator* allocator = reinterpret_cast<D3D12MA::Allocator*>(m_CI.allocator->GetNativeAllocator());
+	if (resource.isImage)
+	{
+		const ImageRef& image = ref_cast<Image>(resource.image);
+		MIRU_FATAL(allocator->CreateAliasingResource(m_D3D12MAllocation, static_cast<UINT64>(resource.offset), &image->m_ResourceDesc, image->m_InitialResourceState, image->m_UseClearValue ? &image->m_ClearValue : nullptr, IID_PPV_ARGS(&image->m_Image)), "ERROR: D3D12: Failed to place Image in AliasingHeap.");
+		D3D12SetName(image->m_Image, image->GetCreateInfo().debugName);
+	}
+	else
+	{
+		const BufferRef& buffer = ref_cast<Buffer>(resource.buffer);
+		MIRU_FATAL(allocator->CreateAliasingResource(m_D3D12MAllocation, static_cast<UINT64>(resource.offset), &buffer->m_ResourceDesc, buffer->m_InitialResourceState, nullptr, IID_PPV_ARGS(&buffer->m_Buffer)), "ERROR: D3D12: Failed to place Buffer in AliasingHeap.");
+		D3D12SetName(buffer->m_Buffer, buffer->GetCreateInfo().debugName);
+	}
+}
+
+void AliasingHeap::FreeMemory()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	MIRU_D3D12_SAFE_RELEASE(m_D3D12MAllocation);
+	m_HasBuffers = false;
+	m_HasRenderTargetOrDepthStencilTextures = false;
+	m_HasNonRenderTargetOrDepthStencilTextures = false;
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+#include "base/AliasingHeap.h"
+#include "d3d12/D3D12_Include.h"
+
+namespace miru
+{
+namespace d3d12
+{
+	class AliasingHeap final : public base::AliasingHeap
+	{
+		//Methods
+	public:
+		AliasingHeap(AliasingHeap::CreateInfo* pCreateInfo);
+		~AliasingHeap();
+
+	protected:
+		void GetMemoryRequirements(Resource& resource) override;
+		void AllocateMemory(size_t size, size_t alignment, uint32_t memoryTypeBits) override;
+		void BindMemory(Resource& resource) override;
+		void FreeMemory() override;
+
+		//Members
+	public:
+		ID3D12Device* m_Device;
+
+		bool m_HasBuffers = false;
+		bool m_HasRenderTargetOrDepthStencilTextures = false;
+		bool m_HasNonRenderTargetOrDepthStencilTextures = false;
+
+		D3D12MA::Allocation* m_D3D12MAllocation = nullptr;
+		D3D12MA::ALLOCATION_DESC m_D3D12MAllocationDesc;
+	};
+}
+}
\ No newline at end of file
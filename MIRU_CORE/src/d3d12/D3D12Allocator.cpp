@@ -1,5 +1,6 @@
 #include "D3D12Allocator.h"
 #include "D3D12Context.h"
+#include <atomic>
 
 using namespace miru;
 using namespace d3d12;
@@ -26,6 +27,10 @@ Allocator::~Allocator()
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
+	for (auto& pool : m_Pools)
+		MIRU_D3D12_SAFE_RELEASE(pool.second);
+	m_Pools.clear();
+
 	MIRU_D3D12_SAFE_RELEASE(m_Allocator);
 }
 
@@ -46,9 +51,13 @@ void Allocator::SubmitData(const base::Allocation& allocation, size_t offset, si
 		bool uploadHeap = GetHeapProperties().Type == D3D12_HEAP_TYPE_UPLOAD;
 		if (uploadHeap)
 		{
-			void* mappedData;
-			D3D12_RANGE readRange = { 0, 0 }; //We never intend to read from the resource
-			MIRU_FATAL(d3d12Resource->Map(0, &readRange, &mappedData), "ERROR: D3D12: Can not map resource.");
+			void* mappedData = allocation.mappedData;
+			if (!mappedData)
+			{
+				D3D12_RANGE readRange = { 0, 0 }; //We never intend to read from the resource
+				MIRU_FATAL(d3d12Resource->Map(0, &readRange, &mappedData), "ERROR: D3D12: Can not map resource.");
+				mappedData = reinterpret_cast<char*>(mappedData) + allocation.offset;
+			}
 
 			bool copyByRow = allocation.rowPadding > 0;
 			if (copyByRow)
@@ -76,8 +85,11 @@ void Allocator::SubmitData(const base::Allocation& allocation, size_t offset, si
 				memcpy(reinterpret_cast<char*>(mappedData) + offset, data, size);
 			}
 
-			D3D12_RANGE writtenRange = { offset, offset + size };
-			d3d12Resource->Unmap(0, &writtenRange);
+			if (!allocation.mappedData)
+			{
+				D3D12_RANGE writtenRange = { allocation.offset + offset, allocation.offset + offset + size };
+				d3d12Resource->Unmap(0, &writtenRange);
+			}
 		}
 	}
 }
@@ -93,9 +105,13 @@ void Allocator::AccessData(const base::Allocation& allocation, size_t offset, si
 		bool uploadHeap = GetHeapProperties().Type == D3D12_HEAP_TYPE_UPLOAD;
 		if (uploadHeap)
 		{
-			void* mappedData;
-			D3D12_RANGE readRange = { offset, offset + size };
-			MIRU_FATAL(d3d12Resource->Map(0, &readRange, &mappedData), "ERROR: D3D12: Can not map resource.");
+			void* mappedData = allocation.mappedData;
+			if (!mappedData)
+			{
+				D3D12_RANGE readRange = { allocation.offset + offset, allocation.offset + offset + size };
+				MIRU_FATAL(d3d12Resource->Map(0, &readRange, &mappedData), "ERROR: D3D12: Can not map resource.");
+				mappedData = reinterpret_cast<char*>(mappedData) + allocation.offset;
+			}
 
 			bool copyByRow = allocation.rowPadding > 0;
 			if (copyByRow)
@@ -123,12 +139,74 @@ void Allocator::AccessData(const base::Allocation& allocation, size_t offset, si
 				memcpy(data, reinterpret_cast<char*>(mappedData) + offset, size);
 			}
 
-			D3D12_RANGE writtenRange = { 0, 0 };
-			d3d12Resource->Unmap(0, &writtenRange);
+			if (!allocation.mappedData)
+			{
+				D3D12_RANGE writtenRange = { 0, 0 };
+				d3d12Resource->Unmap(0, &writtenRange);
+			}
 		}
 	}
 }
 
+Allocator::Statistics Allocator::GetStatistics()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	D3D12MA::TotalStatistics totalStatistics;
+	m_Allocator->CalculateStatistics(&totalStatistics);
+	return ToStatistics(totalStatistics.Total);
+}
+
+std::vector<Allocator::HeapBudget> Allocator::GetHeapBudgets()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	//D3D12 exposes memory segment groups rather than heaps: 0 is local and 1 is non-local.
+	D3D12MA::Budget budgets[2];
+	m_Allocator->GetBudget(&budgets[0], &budgets[1]);
+
+	D3D12MA::TotalStatistics totalStatistics;
+	m_Allocator->CalculateStatistics(&totalStatistics);
+
+	const uint32_t heapCount = m_Allocator->IsUMA() ? 1 : 2;
+	std::vector<HeapBudget> heapBudgets;
+	heapBudgets.reserve(heapCount);
+	for (uint32_t i = 0; i < heapCount; i++)
+	{
+		HeapBudget heapBudget;
+		heapBudget.heapIndex = i;
+		heapBudget.deviceLocal = (i == 0);
+		heapBudget.usageBytes = budgets[i].UsageBytes;
+		heapBudget.budgetBytes = budgets[i].BudgetBytes;
+		heapBudget.statistics = ToStatistics(totalStatistics.MemorySegmentGroup[i]);
+		heapBudgets.push_back(heapBudget);
+	}
+	return heapBudgets;
+}
+
+std::string Allocator::GetStatisticsJSON(bool detailedMap)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	WCHAR* statsString = nullptr;
+	m_Allocator->BuildStatsString(&statsString, detailedMap ? TRUE : FALSE);
+	std::string result = statsString ? arc::ToString(std::wstring(statsString)) : "";
+	m_Allocator->FreeStatsString(statsString);
+	return result;
+}
+
+bool Allocator::Defragment(size_t budgetBytes, uint32_t budgetMoves)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	//D3D12MA defragmentation passes are not implemented: a move requires a new ID3D12Resource to be created in the destination
+	//allocation and copied into, but d3d12::Buffer and d3d12::Image can not replace their resource after creation.
+	//Returns true, as there are no moves that can be performed, and warns only on the first call, as this is called per frame.
+	static std::atomic<bool> warned(false);
+	MIRU_WARN(!warned.exchange(true), "WARN: D3D12: Allocator::Defragment() is not supported.");
+	return true;
+}
+
 D3D12_HEAP_PROPERTIES Allocator::GetHeapProperties()
 {
 	MIRU_CPU_PROFILE_FUNCTION();
@@ -145,4 +223,47 @@ D3D12_HEAP_PROPERTIES Allocator::GetHeapProperties()
 	result.VisibleNodeMask = 0;
 
 	return result;
+}
+
+D3D12MA::Pool* Allocator::GetPool(D3D12_HEAP_FLAGS heapFlags)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	std::lock_guard<std::mutex> lock(m_PoolsMutex);
+
+	auto it = m_Pools.find(heapFlags);
+	if (it != m_Pools.end())
+		return it->second;
+
+	D3D12MA::POOL_DESC poolDesc = {};
+	poolDesc.Flags = m_CI.linearAlgorithm ? D3D12MA::POOL_FLAG_ALGORITHM_LINEAR : D3D12MA::POOL_FLAG_NONE;
+	poolDesc.HeapProperties = GetHeapProperties();
+	poolDesc.HeapFlags = heapFlags;
+	poolDesc.BlockSize = static_cast<UINT64>(m_CI.blockSize);
+	poolDesc.MinBlockCount = static_cast<UINT>(m_CI.minBlockCount);
+	poolDesc.MaxBlockCount = m_CI.maxBlockCount ? static_cast<UINT>(m_CI.maxBlockCount) : UINT_MAX;
+	poolDesc.MinAllocationAlignment = 0;
+	poolDesc.pProtectedSession = nullptr;
+
+	D3D12MA::Pool* pool = nullptr;
+	MIRU_FATAL(m_Allocator->CreatePool(&poolDesc, &pool), "ERROR: D3D12: Failed to create D3D12MA::Pool.");
+	pool->SetName(arc::ToWString(m_CI.debugName + ": Pool " + std::to_string(static_cast<uint32_t>(heapFlags))).c_str());
+
+	m_Pools[heapFlags] = pool;
+	return pool;
+}
+
+Allocator::Statistics Allocator::ToStatistics(const D3D12MA::DetailedStatistics& detailedStatistics)
+{
+	Statistics statistics;
+	statistics.blockCount = detailedStatistics.Stats.BlockCount;
+	statistics.allocationCount = detailedStatistics.Stats.AllocationCount;
+	statistics.unusedRangeCount = detailedStatistics.UnusedRangeCount;
+	statistics.blockBytes = detailedStatistics.Stats.BlockBytes;
+	statistics.allocationBytes = detailedStatistics.Stats.AllocationBytes;
+	statistics.largestUnusedRangeBytes = detailedStatistics.UnusedRangeCount ? detailedStatistics.UnusedRangeSizeMax : 0;
+
+	const uint64_t unusedBytes = statistics.blockBytes - statistics.allocationBytes;
+	statistics.fragmentation = unusedBytes ? 1.0f - float(double(statistics.largestUnusedRangeBytes) / double(unusedBytes)) : 0.0f;
+	return statistics;
 }
\ No newline at end of file
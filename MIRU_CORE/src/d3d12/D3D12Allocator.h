@@ -1,6 +1,7 @@
 #pragma once
 #include "base/Allocator.h"
 #include "d3d12/D3D12_Include.h"
+#include <mutex>
 
 namespace miru
 {
@@ -18,8 +19,22 @@ namespace d3d12
 		void SubmitData(const base::Allocation& allocation, size_t offset, size_t size, void* data) override;
 		void AccessData(const base::Allocation& allocation, size_t offset, size_t size, void* data) override;
 
+		Statistics GetStatistics() override;
+		std::vector<HeapBudget> GetHeapBudgets() override;
+		std::string GetStatisticsJSON(bool detailedMap = false) override;
+
+		bool Defragment(size_t budgetBytes, uint32_t budgetMoves) override;
+
 		D3D12_HEAP_PROPERTIES GetHeapProperties();
 
+		//Returns the Allocator's D3D12MA::Pool for the heap flags that the resource requires.
+		D3D12MA::Pool* GetPool(D3D12_HEAP_FLAGS heapFlags);
+		//Returns true if an allocation that failed in a pool may be retried in the default pools.
+		bool CanFallbackFromPool() { return m_CI.maxBlockCount == 0; }
+
+	private:
+		static Statistics ToStatistics(const D3D12MA::DetailedStatistics& detailedStatistics);
+
 		//Members
 	private:
 		ID3D12Device* m_Device;
@@ -27,6 +42,10 @@ namespace d3d12
 	public:
 		D3D12MA::Allocator* m_Allocator;
 		D3D12MA::ALLOCATOR_DESC m_AllocatorDesc;
+
+	private:
+		std::map<D3D12_HEAP_FLAGS, D3D12MA::Pool*> m_Pools;
+		std::mutex m_PoolsMutex;
 	};
 }
 }
\ No newline at end of file
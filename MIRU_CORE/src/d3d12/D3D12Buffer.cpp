@@ -1,5 +1,6 @@
 #include "D3D12Buffer.h"
 #include "D3D12Allocator.h"
+#include "base/BufferArena.h"
 
 using namespace miru;
 using namespace d3d12;
@@ -48,6 +49,42 @@ Buffer::Buffer(Buffer::CreateInfo* pCreateInfo)
 	m_ResourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;				//How the resource is to be used
 	D3D12_CLEAR_VALUE* clear = nullptr;
 
+	if (m_CI.arena)
+	{
+		//Suballocated from the arena's ID3D12Resource.
+		size_t offset = 0;
+		MIRU_FATAL(!m_CI.arena->Allocate(m_CI.size, offset), "ERROR: D3D12: BufferArena is full.");
+		m_CI.allocator = m_CI.arena->GetCreateInfo().allocator;
+
+		const BufferRef& arenaBuffer = ref_cast<Buffer>(m_CI.arena->GetBuffer());
+		m_Buffer = arenaBuffer->m_Buffer;
+		m_InitialResourceState = arenaBuffer->m_InitialResourceState;
+		m_D3D12MAllocation = arenaBuffer->m_D3D12MAllocation;
+
+		const base::Allocation& arenaAllocation = arenaBuffer->GetAllocation();
+		m_Allocation.nativeAllocation = arenaAllocation.nativeAllocation;
+		m_Allocation.mappedData = arenaAllocation.mappedData ? reinterpret_cast<char*>(arenaAllocation.mappedData) + offset : nullptr;
+		m_Allocation.offset = offset;
+
+		if (m_CI.data)
+		{
+			m_CI.allocator->SubmitData(m_Allocation, 0, m_CI.size, m_CI.data);
+		}
+		return;
+	}
+
+	if (!m_CI.allocator)
+	{
+		//Created without memory. The resource is placed by an AliasingHeap.
+		m_InitialResourceState = ToD3D12BufferType(m_CI.usage);
+		m_ResourceDesc.Flags = D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+		m_Buffer = nullptr;
+		m_D3D12MAllocation = nullptr;
+		m_Allocation.nativeAllocation = nullptr;
+		m_Allocation.mappedData = nullptr;
+		return;
+	}
+
 	D3D12_HEAP_TYPE heapType = ref_cast<Allocator>(m_CI.allocator)->GetHeapProperties().Type;
 	if (heapType == D3D12_HEAP_TYPE_DEFAULT)
 	{
@@ -60,13 +97,27 @@ Buffer::Buffer(Buffer::CreateInfo* pCreateInfo)
 	m_D3D12MAllocationDesc.Flags = D3D12MA::ALLOCATION_FLAG_NONE;
 	m_D3D12MAllocationDesc.HeapType = heapType;
 	m_D3D12MAllocationDesc.ExtraHeapFlags = D3D12_HEAP_FLAG_NONE;
-	m_D3D12MAllocationDesc.CustomPool = nullptr;
+	m_D3D12MAllocationDesc.CustomPool = ref_cast<Allocator>(m_CI.allocator)->GetPool(D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS);
 
 	D3D12MA::Allocator* allocator = reinterpret_cast<D3D12MA::Allocator*>(m_CI.allocator->GetNativeAllocator());
-	MIRU_FATAL(allocator->CreateResource(&m_D3D12MAllocationDesc, &m_ResourceDesc, m_InitialResourceState, clear, &m_D3D12MAllocation, IID_PPV_ARGS(&m_Buffer)), "ERROR: D3D12: Failed to create Buffer.");
+	HRESULT result = allocator->CreateResource(&m_D3D12MAllocationDesc, &m_ResourceDesc, m_InitialResourceState, clear, &m_D3D12MAllocation, IID_PPV_ARGS(&m_Buffer));
+	if (result == E_OUTOFMEMORY && m_D3D12MAllocationDesc.CustomPool && ref_cast<Allocator>(m_CI.allocator)->CanFallbackFromPool())
+	{
+		//The Buffer is larger than the pool's block size.
+		m_D3D12MAllocationDesc.CustomPool = nullptr;
+		result = allocator->CreateResource(&m_D3D12MAllocationDesc, &m_ResourceDesc, m_InitialResourceState, clear, &m_D3D12MAllocation, IID_PPV_ARGS(&m_Buffer));
+	}
+	MIRU_FATAL(result, "ERROR: D3D12: Failed to create Buffer.");
 	D3D12SetName(m_Buffer, m_CI.debugName);
 	
 	m_Allocation.nativeAllocation = (base::NativeAllocation)m_D3D12MAllocation;
+	m_Allocation.mappedData = nullptr;
+
+	if (m_CI.allocator->GetCreateInfo().persistentlyMapped && heapType == D3D12_HEAP_TYPE_UPLOAD)
+	{
+		D3D12_RANGE readRange = { 0, 0 }; //We never intend to read from the resource
+		MIRU_FATAL(m_Buffer->Map(0, &readRange, &m_Allocation.mappedData), "ERROR: D3D12: Can not map resource.");
+	}
 
 	if (m_CI.data)
 	{
@@ -78,6 +129,18 @@ Buffer::~Buffer()
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
+	if (m_CI.arena)
+	{
+		m_CI.arena->Free(m_Allocation.offset);
+		return;
+	}
+
+	if (m_Allocation.mappedData)
+	{
+		m_Buffer->Unmap(0, nullptr);
+		m_Allocation.mappedData = nullptr;
+	}
+
 	MIRU_D3D12_SAFE_RELEASE(m_D3D12MAllocation);
 	MIRU_D3D12_SAFE_RELEASE(m_Buffer);
 }
@@ -149,13 +212,14 @@ BufferView::BufferView(BufferView::CreateInfo* pCreateInfo)
 
 	auto resourceDesc = ref_cast<Buffer>(m_CI.buffer)->m_ResourceDesc;
 	auto buffer = ref_cast<Buffer>(m_CI.buffer)->m_Buffer;
+	const size_t offset = m_CI.buffer->GetOffset() + m_CI.offset;
 
 	switch (m_CI.type)
 	{
 		case Type::UNIFORM_TEXEL:
 		case Type::UNIFORM:
 		{
-			m_CBVDesc.BufferLocation = buffer->GetGPUVirtualAddress() + m_CI.offset;
+			m_CBVDesc.BufferLocation = buffer->GetGPUVirtualAddress() + offset;
 			m_CBVDesc.SizeInBytes = arc::Align<UINT>(static_cast<UINT>(m_CI.size), D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT);
 			break;
 		}
@@ -164,7 +228,7 @@ BufferView::BufferView(BufferView::CreateInfo* pCreateInfo)
 		{
 			m_UAVDesc.Format = DXGI_FORMAT_UNKNOWN;
 			m_UAVDesc.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
-			m_UAVDesc.Buffer.FirstElement = m_CI.offset / m_CI.stride;
+			m_UAVDesc.Buffer.FirstElement = offset / m_CI.stride;
 			m_UAVDesc.Buffer.NumElements = static_cast<UINT>(m_CI.size / m_CI.stride);
 			m_UAVDesc.Buffer.StructureByteStride = static_cast<UINT>(m_CI.stride);
 			m_UAVDesc.Buffer.CounterOffsetInBytes = 0;
@@ -173,7 +237,7 @@ BufferView::BufferView(BufferView::CreateInfo* pCreateInfo)
 			m_SRVDesc.Format = DXGI_FORMAT_UNKNOWN;
 			m_SRVDesc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
 			m_SRVDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-			m_SRVDesc.Buffer.FirstElement = m_CI.offset / m_CI.stride;
+			m_SRVDesc.Buffer.FirstElement = offset / m_CI.stride;
 			m_SRVDesc.Buffer.NumElements = static_cast<UINT>(m_CI.size / m_CI.stride);
 			m_SRVDesc.Buffer.StructureByteStride = static_cast<UINT>(m_CI.stride);
 			m_SRVDesc.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
@@ -183,14 +247,14 @@ BufferView::BufferView(BufferView::CreateInfo* pCreateInfo)
 		case Type::INDEX:
 		{
 			
-			m_IBVDesc.BufferLocation = buffer->GetGPUVirtualAddress() + m_CI.offset;
+			m_IBVDesc.BufferLocation = buffer->GetGPUVirtualAddress() + offset;
 			m_IBVDesc.SizeInBytes = static_cast<UINT>(m_CI.size);
 			m_IBVDesc.Format = m_CI.stride == 4 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
 			break;
 		}
 		case Type::VERTEX:
 		{
-			m_VBVDesc.BufferLocation = buffer->GetGPUVirtualAddress() + m_CI.offset;
+			m_VBVDesc.BufferLocation = buffer->GetGPUVirtualAddress() + offset;
 			m_VBVDesc.SizeInBytes = static_cast<UINT>(m_CI.size);
 			m_VBVDesc.StrideInBytes = static_cast<UINT>(m_CI.stride);
 			break;
@@ -0,0 +1,79 @@
+#include "D3D12BufferArena.h"
+
+using namespace miru;
+using namespace d3d12;
+
+BufferArena::BufferArena(BufferArena::CreateInfo* pCreateInfo)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_CI = *pCreateInfo;
+	const bool& uniform = arc::BitwiseCheck(m_CI.usage, base::Buffer::UsageBit::UNIFORM_BIT) || arc::BitwiseCheck(m_CI.usage, base::Buffer::UsageBit::UNIFORM_TEXEL_BIT);
+	m_Alignment = m_CI.alignment ? m_CI.alignment : uniform ? D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT : D3D12_RAW_UAV_SRV_BYTE_ALIGNMENT;
+	CreateBuffer();
+
+	m_VirtualBlockDesc.Flags = D3D12MA::VIRTUAL_BLOCK_FLAG_NONE;
+	m_VirtualBlockDesc.Size = static_cast<UINT64>(m_CI.size);
+	m_VirtualBlockDesc.pAllocationCallbacks = nullptr;
+	MIRU_FATAL(D3D12MA::CreateVirtualBlock(&m_VirtualBlockDesc, &m_VirtualBlock), "ERROR: D3D12: Failed to create VirtualBlock for BufferArena.");
+}
+
+BufferArena::~BufferArena()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	MIRU_WARN(!m_VirtualAllocations.empty(), "WARN: D3D12: BufferArena destroyed with live suballocations.");
+	m_VirtualBlock->Clear();
+	MIRU_D3D12_SAFE_RELEASE(m_VirtualBlock);
+	m_Buffer = nullptr;
+}
+
+bool BufferArena::Allocate(size_t size, size_t& offset)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	D3D12MA::VIRTUAL_ALLOCATION_DESC virtualAllocationDesc = {};
+	virtualAllocationDesc.Flags = D3D12MA::VIRTUAL_ALLOCATION_FLAG_NONE;
+	virtualAllocationDesc.Size = static_cast<UINT64>(arc::Align<size_t>(size, m_Alignment));
+	virtualAllocationDesc.Alignment = static_cast<UINT64>(m_Alignment);
+	virtualAllocationDesc.pPrivateData = nullptr;
+
+	D3D12MA::VirtualAllocation virtualAllocation;
+	UINT64 virtualOffset = 0;
+	if (FAILED(m_VirtualBlock->Allocate(&virtualAllocationDesc, &virtualAllocation, &virtualOffset)))
+		return false;
+
+	offset = static_cast<size_t>(virtualOffset);
+	m_VirtualAllocations[offset] = virtualAllocation;
+	return true;
+}
+
+void BufferArena::Free(size_t offset)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto it = m_VirtualAllocations.find(offset);
+	if (it == m_VirtualAllocations.end())
+	{
+		MIRU_WARN(true, "WARN: D3D12: BufferArena has no suballocation at the offset.");
+		return;
+	}
+
+	m_VirtualBlock->FreeAllocation(it->second);
+	m_VirtualAllocations.erase(it);
+}
+
+size_t BufferArena::GetUsedSize()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	D3D12MA::Statistics statistics;
+	m_VirtualBlock->GetStatistics(&statistics);
+	return static_cast<size_t>(statistics.AllocationBytes);
+}
\ No newline at end of file
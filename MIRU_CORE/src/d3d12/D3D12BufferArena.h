@@ -0,0 +1,27 @@
+#pragma once
+#include "base/BufferArena.h"
+#include "d3d12/D3D12_Include.h"
+
+namespace miru
+{
+namespace d3d12
+{
+	class BufferArena final : public base::BufferArena
+	{
+		//Methods
+	public:
+		BufferArena(BufferArena::CreateInfo* pCreateInfo);
+		~BufferArena();
+
+		bool Allocate(size_t size, size_t& offset) override;
+		void Free(size_t offset) override;
+		size_t GetUsedSize() override;
+
+		//Members
+	public:
+		D3D12MA::VirtualBlock* m_VirtualBlock;
+		D3D12MA::VIRTUAL_BLOCK_DESC m_VirtualBlockDesc;
+		std::map<size_t, D3D12MA::VirtualAllocation> m_VirtualAllocations;
+	};
+}
+}
\ No newline at end of file
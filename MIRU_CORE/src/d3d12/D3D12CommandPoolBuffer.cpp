@@ -8,6 +8,8 @@
 #include "D3D12DescriptorPoolSet.h"
 #include "D3D12Framebuffer.h"
 #include "D3D12AccelerationStructure.h"
+#include "D3D12QueryPool.h"
+#include "base/GpuProfiler.h"
 
 #include "Include/WinPixEventRuntime/pix3.h"
 
@@ -21,7 +23,7 @@ CommandPool::CommandPool(CommandPool::CreateInfo* pCreateInfo)
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	m_CI = *pCreateInfo;
-	m_Queue = ref_cast<Context>(pCreateInfo->context)->m_Queues[GetCommandQueueIndex(pCreateInfo->queueType)];
+	m_Queue = ref_cast<Context>(pCreateInfo->context)->GetQueue(GetCommandQueueIndex(pCreateInfo->queueType), pCreateInfo->queueIndex);
 }
 
 CommandPool::~CommandPool()
@@ -52,6 +54,24 @@ void CommandPool::Reset(bool releaseResources)
 	}
 }
 
+bool CommandPool::GetCalibratedTimestamps(uint64_t& gpuTimestamp, uint64_t& cpuTimestamp)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	UINT64 queueTimestamp = 0;
+	UINT64 performanceCounter = 0;
+	if (FAILED(m_Queue->GetClockCalibration(&queueTimestamp, &performanceCounter)))
+		return false;
+
+	//std::chrono::steady_clock is the performance counter in nanoseconds.
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	const uint64_t& ticksPerSecond = static_cast<uint64_t>(frequency.QuadPart);
+	gpuTimestamp = queueTimestamp;
+	cpuTimestamp = (performanceCounter / ticksPerSecond) * 1000000000 + (performanceCounter % ticksPerSecond) * 1000000000 / ticksPerSecond;
+	return true;
+}
+
 uint32_t CommandPool::GetCommandQueueIndex(const CommandPool::QueueType& type)
 {
 	uint32_t index = 0;
@@ -80,17 +100,22 @@ CommandBuffer::CommandBuffer(CommandBuffer::CreateInfo* pCreateInfo)
 	CommandPoolRef cmdPool = ref_cast<CommandPool>(m_CI.commandPool);
 	m_Device = cmdPool->m_Device;
 	D3D12_COMMAND_QUEUE_DESC queueDesc = cmdPool->m_Queue->GetDesc();
+	D3D12_COMMAND_LIST_TYPE type = m_CI.level == Level::SECONDARY ? D3D12_COMMAND_LIST_TYPE_BUNDLE : queueDesc.Type;
 	std::vector<ID3D12CommandAllocator*>& d3d12CmdAllocators = cmdPool->m_CmdPools;
 
 	d3d12CmdAllocators.resize(m_CI.commandBufferCount);
 	m_CmdBuffers.resize(m_CI.commandBufferCount);
 	m_RenderingResources.resize(m_CI.commandBufferCount);
+	m_BoundStates.resize(m_CI.commandBufferCount);
+	m_Scratch.resize(m_CI.commandBufferCount);
+	m_PendingBarriers.resize(m_CI.commandBufferCount);
+	m_TrackedResources.resize(m_CI.commandBufferCount);
 	for (size_t i = 0; i < m_CmdBuffers.size(); i++)
 	{
-		MIRU_FATAL(m_Device->CreateCommandAllocator(queueDesc.Type, IID_PPV_ARGS(&d3d12CmdAllocators[i])), "ERROR: D3D12: Failed to create CommandPool.");
+		MIRU_FATAL(m_Device->CreateCommandAllocator(type, IID_PPV_ARGS(&d3d12CmdAllocators[i])), "ERROR: D3D12: Failed to create CommandPool.");
 		D3D12SetName(d3d12CmdAllocators[i], cmdPool->GetCreateInfo().debugName + ": " + std::to_string(i));
 	
-		MIRU_FATAL(m_Device->CreateCommandList(0, m_CI.level == Level::SECONDARY ? D3D12_COMMAND_LIST_TYPE_BUNDLE : queueDesc.Type, d3d12CmdAllocators[i], nullptr, IID_PPV_ARGS(&m_CmdBuffers[i])), "ERROR: D3D12: Failed to create CommandBuffer.");
+		MIRU_FATAL(m_Device->CreateCommandList(0, type, d3d12CmdAllocators[i], nullptr, IID_PPV_ARGS(&m_CmdBuffers[i])), "ERROR: D3D12: Failed to create CommandBuffer.");
 		D3D12SetName(m_CmdBuffers[i], m_CI.debugName + ": " + std::to_string(i));
 		End(static_cast<uint32_t>(i));
 	}
@@ -175,12 +200,26 @@ void CommandBuffer::Begin(uint32_t index, UsageBit usage)
 	renderingResource.SAMPLER_DescriptorOffset = 0;
 	renderingResource.RTV_DescriptorOffset = 0;
 	renderingResource.DSV_DescriptorOffset = 0;
+	ResetBoundState(index);
+	ResetResourceStates(index);
+	ClearPendingBarriers(index);
+}
+void CommandBuffer::Begin(uint32_t index, UsageBit usage, const InheritanceInfo& inheritanceInfo)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	MIRU_FATAL(m_CI.level != Level::SECONDARY, "ERROR: D3D12: Only secondary CommandBuffers can begin with InheritanceInfo.");
+
+	//Bundles inherit the render targets from the calling CommandBuffer.
+	Begin(index, usage);
 }
 
 void CommandBuffer::End(uint32_t index)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
+	FlushBarriers(index);
 	MIRU_FATAL(reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->Close(), "ERROR: D3D12: Failed to end CommandBuffer.");
 	m_RenderingResources[index].Resettable = true;
 }
@@ -208,6 +247,7 @@ void CommandBuffer::ExecuteSecondaryCommandBuffers(uint32_t index, const base::C
 		return;
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 	if (m_CmdBuffers[index]->GetType() != D3D12_COMMAND_LIST_TYPE_DIRECT)
 		return;
 
@@ -216,6 +256,8 @@ void CommandBuffer::ExecuteSecondaryCommandBuffers(uint32_t index, const base::C
 		if (secondaryIndex < commandBuffer->GetCreateInfo().commandBufferCount)
 			reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->ExecuteBundle(reinterpret_cast<ID3D12GraphicsCommandList*>(ref_cast<CommandBuffer>(commandBuffer)->m_CmdBuffers[secondaryIndex]));
 	}
+	//State set by the bundles persists in the calling CommandBuffer.
+	InvalidateBoundState(index);
 }
 
 void CommandBuffer::Submit(const std::vector<base::CommandBuffer::SubmitInfo>& submitInfos, const base::FenceRef& fence)
@@ -247,6 +289,7 @@ void CommandBuffer::Submit(const std::vector<base::CommandBuffer::SubmitInfo>& s
 		{
 			if (index < m_CI.commandBufferCount)
 				submitCmdBuffers.push_back(m_CmdBuffers[index]);
+			CommitResourceStates(index);
 		}
 		queue->ExecuteCommandLists(static_cast<uint32_t>(submitCmdBuffers.size()), submitCmdBuffers.data());
 
@@ -303,6 +346,7 @@ void CommandBuffer::Submit2(const std::vector<base::CommandBuffer::SubmitInfo2>&
 		{
 			if (commandBufferInfo.index < m_CI.commandBufferCount)
 				submitCmdBuffers.push_back(m_CmdBuffers[commandBufferInfo.index]);
+			CommitResourceStates(commandBufferInfo.index);
 		}
 		queue->ExecuteCommandLists(static_cast<uint32_t>(submitCmdBuffers.size()), submitCmdBuffers.data());
 
@@ -345,23 +389,65 @@ void CommandBuffer::WaitEvents(uint32_t index, const std::vector<base::EventRef>
 	MIRU_CPU_PROFILE_FUNCTION();
 }
 
+void CommandBuffer::WaitEvents(uint32_t index, const base::EventRef* pEvents, uint32_t eventCount, base::PipelineStageBit srcStage, base::PipelineStageBit dstStage, const base::BarrierHandle* pBarriers, uint32_t barrierCount)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+}
+
 void CommandBuffer::PipelineBarrier(uint32_t index, base::PipelineStageBit srcStage, base::PipelineStageBit dstStage, base::DependencyBit dependencies, const std::vector<base::BarrierRef>& barriers)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
 
-	std::vector<D3D12_RESOURCE_BARRIER> _barriers;
+	size_t barrierCount = 0;
+	for (auto& barrier : barriers)
+		barrierCount += static_cast<const Barrier*>(barrier.get())->m_Barriers.size();
+	if (barrierCount == 0)
+		return;
+
+	D3D12_RESOURCE_BARRIER* _barriers = m_Scratch[index].Allocate<D3D12_RESOURCE_BARRIER>(barrierCount);
+	size_t i = 0;
 	for (auto& barrier : barriers)
 	{
-		for (auto& _barrier : ref_cast<Barrier>(barrier)->m_Barriers)
-			_barriers.push_back(_barrier);
+		for (auto& _barrier : static_cast<const Barrier*>(barrier.get())->m_Barriers)
+			_barriers[i++] = _barrier;
+	}
+
+	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->ResourceBarrier(static_cast<UINT>(barrierCount), _barriers);
+}
+
+void CommandBuffer::PipelineBarrier(uint32_t index, base::PipelineStageBit srcStage, base::PipelineStageBit dstStage, base::DependencyBit dependencies, const base::BarrierHandle* pBarriers, uint32_t barrierCount)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
 
+	const Barrier** barriers = m_Scratch[index].Allocate<const Barrier*>(barrierCount);
+	size_t d3d12BarrierCount = 0;
+	for (uint32_t i = 0; i < barrierCount; i++)
+	{
+		base::Barrier* barrier = base::GetHandleObject(pBarriers[i]);
+		MIRU_FATAL(!barrier, "ERROR: D3D12: Invalid BarrierHandle.");
+		barriers[i] = static_cast<const Barrier*>(barrier);
+		d3d12BarrierCount += barriers[i]->m_Barriers.size();
 	}
-	if (_barriers.empty())
+	if (d3d12BarrierCount == 0)
 		return;
 
-	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->ResourceBarrier(static_cast<UINT>(_barriers.size()), _barriers.data());
+	D3D12_RESOURCE_BARRIER* _barriers = m_Scratch[index].Allocate<D3D12_RESOURCE_BARRIER>(d3d12BarrierCount);
+	size_t j = 0;
+	for (uint32_t i = 0; i < barrierCount; i++)
+	{
+		for (auto& _barrier : barriers[i]->m_Barriers)
+			_barriers[j++] = _barrier;
+	}
+
+	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->ResourceBarrier(static_cast<UINT>(d3d12BarrierCount), _barriers);
 }
 
 void CommandBuffer::PipelineBarrier2(uint32_t index, const base::CommandBuffer::DependencyInfo& dependencyInfo)
@@ -369,47 +455,250 @@ void CommandBuffer::PipelineBarrier2(uint32_t index, const base::CommandBuffer::
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+
+	const uint32_t& barrierCount = static_cast<uint32_t>(dependencyInfo.barriers.size());
+	Barrier2** barriers = m_Scratch[index].Allocate<Barrier2*>(barrierCount);
+	for (uint32_t i = 0; i < barrierCount; i++)
+		barriers[i] = static_cast<Barrier2*>(dependencyInfo.barriers[i].get());
+
+	if (m_CI.deferBarriers)
+	{
+		for (uint32_t i = 0; i < barrierCount; i++)
+			QueueBarrier(index, barriers[i]);
+		return;
+	}
+
+	RecordBarrierGroups(index, barriers, barrierCount);
+}
+
+void CommandBuffer::PipelineBarrier2(uint32_t index, base::DependencyBit dependencies, const base::Barrier2Handle* pBarriers, uint32_t barrierCount)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+
+	Barrier2** barriers = m_Scratch[index].Allocate<Barrier2*>(barrierCount);
+	for (uint32_t i = 0; i < barrierCount; i++)
+	{
+		base::Barrier2* barrier = base::GetHandleObject(pBarriers[i]);
+		MIRU_FATAL(!barrier, "ERROR: D3D12: Invalid Barrier2Handle.");
+		barriers[i] = static_cast<Barrier2*>(barrier);
+	}
 
-	std::vector<D3D12_BARRIER_GROUP> barrierGroups;
-	for (auto& barrier : dependencyInfo.barriers)
+	if (m_CI.deferBarriers)
 	{
+		for (uint32_t i = 0; i < barrierCount; i++)
+			QueueBarrier(index, barriers[i]);
+		return;
+	}
+
+	RecordBarrierGroups(index, barriers, barrierCount);
+}
+
+void CommandBuffer::RecordBarrierGroups(uint32_t index, Barrier2* const* ppBarriers, uint32_t barrierCount)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	if (barrierCount == 0)
+		return;
+
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+	D3D12_BARRIER_GROUP* barrierGroups = m_Scratch[index].Allocate<D3D12_BARRIER_GROUP>(barrierCount);
+	for (uint32_t i = 0; i < barrierCount; i++)
+	{
+		Barrier2* barrier = ppBarriers[i];
 		D3D12_BARRIER_GROUP barrierGroup;
 		if (barrier->GetCreateInfo().type == Barrier::Type::MEMORY)
 		{
-			const std::vector<D3D12_GLOBAL_BARRIER>& globalBarrier = ref_cast<Barrier2>(barrier)->m_GlobalBarriers;
+			const std::vector<D3D12_GLOBAL_BARRIER>& globalBarrier = barrier->m_GlobalBarriers;
 			barrierGroup.Type = D3D12_BARRIER_TYPE_GLOBAL;
 			barrierGroup.NumBarriers = static_cast<UINT>(globalBarrier.size());
 			barrierGroup.pGlobalBarriers = globalBarrier.data();
 		}
 		else if (barrier->GetCreateInfo().type == Barrier::Type::BUFFER)
 		{
-			const std::vector<D3D12_BUFFER_BARRIER>& bufferBarrier = ref_cast<Barrier2>(barrier)->m_BufferBarriers;
+			const std::vector<D3D12_BUFFER_BARRIER>& bufferBarrier = barrier->m_BufferBarriers;
 			barrierGroup.Type = D3D12_BARRIER_TYPE_BUFFER;
 			barrierGroup.NumBarriers = static_cast<UINT>(bufferBarrier.size());
 			barrierGroup.pBufferBarriers = bufferBarrier.data();
 		}
 		else if (barrier->GetCreateInfo().type == Barrier::Type::IMAGE)
 		{
-			const std::vector<D3D12_TEXTURE_BARRIER>& textureBarrier = ref_cast<Barrier2>(barrier)->m_TextureBarriers;
+			const std::vector<D3D12_TEXTURE_BARRIER>& textureBarrier = barrier->m_TextureBarriers;
 			barrierGroup.Type = D3D12_BARRIER_TYPE_TEXTURE;
 			barrierGroup.NumBarriers = static_cast<UINT>(textureBarrier.size());
 			barrierGroup.pTextureBarriers = textureBarrier.data();
 		}
-		barrierGroups.push_back(barrierGroup);
+		barrierGroups[i] = barrierGroup;
 	}
-	if (barrierGroups.empty())
+
+	reinterpret_cast<ID3D12GraphicsCommandList7*>(m_CmdBuffers[index])->Barrier(barrierCount, barrierGroups);
+}
+
+void CommandBuffer::FlushBarriers(uint32_t index)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	const PendingBarriers& pending = m_PendingBarriers[index];
+	if (pending.globalBarriers.empty() && pending.bufferBarriers.empty() && pending.textureBarriers.empty())
 		return;
 
-	reinterpret_cast<ID3D12GraphicsCommandList7*>(m_CmdBuffers[index])->Barrier(static_cast<UINT>(barrierGroups.size()), barrierGroups.data());
+	D3D12_BARRIER_GROUP barrierGroups[3];
+	UINT barrierGroupCount = 0;
+	if (!pending.globalBarriers.empty())
+	{
+		barrierGroups[barrierGroupCount].Type = D3D12_BARRIER_TYPE_GLOBAL;
+		barrierGroups[barrierGroupCount].NumBarriers = static_cast<UINT>(pending.globalBarriers.size());
+		barrierGroups[barrierGroupCount].pGlobalBarriers = pending.globalBarriers.data();
+		barrierGroupCount++;
+	}
+	if (!pending.bufferBarriers.empty())
+	{
+		barrierGroups[barrierGroupCount].Type = D3D12_BARRIER_TYPE_BUFFER;
+		barrierGroups[barrierGroupCount].NumBarriers = static_cast<UINT>(pending.bufferBarriers.size());
+		barrierGroups[barrierGroupCount].pBufferBarriers = pending.bufferBarriers.data();
+		barrierGroupCount++;
+	}
+	if (!pending.textureBarriers.empty())
+	{
+		barrierGroups[barrierGroupCount].Type = D3D12_BARRIER_TYPE_TEXTURE;
+		barrierGroups[barrierGroupCount].NumBarriers = static_cast<UINT>(pending.textureBarriers.size());
+		barrierGroups[barrierGroupCount].pTextureBarriers = pending.textureBarriers.data();
+		barrierGroupCount++;
+	}
+
+	reinterpret_cast<ID3D12GraphicsCommandList7*>(m_CmdBuffers[index])->Barrier(barrierGroupCount, barrierGroups);
+	ClearPendingBarriers(index);
 }
 
-void CommandBuffer::ClearColourImage(uint32_t index, const base::ImageRef& image, base::Image::Layout layout, const base::Image::ClearColourValue& clear, const std::vector<base::Image::SubresourceRange>& subresourceRanges)
+void CommandBuffer::QueueBarrier(uint32_t index, const Barrier2* barrier)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
+	//Barriers in one command are not ordered with respect to each other. A barrier that overlaps a queued barrier,
+	//but can not be merged with it, flushes the queued barriers first; e.g. consecutive layout transitions.
+	PendingBarriers& pending = m_PendingBarriers[index];
+
+	//D3D12_BARRIER_SYNC_ALL and D3D12_BARRIER_ACCESS_COMMON already cover any other value. D3D12_BARRIER_ACCESS_NO_ACCESS can not be combined.
+	auto MergeSync = [](D3D12_BARRIER_SYNC a, D3D12_BARRIER_SYNC b) -> D3D12_BARRIER_SYNC
+	{
+		return (a == D3D12_BARRIER_SYNC_ALL || b == D3D12_BARRIER_SYNC_ALL) ? D3D12_BARRIER_SYNC_ALL : a | b;
+	};
+	auto MergeAccess = [](D3D12_BARRIER_ACCESS a, D3D12_BARRIER_ACCESS b) -> D3D12_BARRIER_ACCESS
+	{
+		if (a == D3D12_BARRIER_ACCESS_NO_ACCESS)
+			return b;
+		if (b == D3D12_BARRIER_ACCESS_NO_ACCESS)
+			return a;
+		return (a == D3D12_BARRIER_ACCESS_COMMON || b == D3D12_BARRIER_ACCESS_COMMON) ? D3D12_BARRIER_ACCESS_COMMON : a | b;
+	};
+	auto MergeMasks = [&](auto& pendingBarrier, const auto& barrier)
+	{
+		pendingBarrier.SyncBefore = MergeSync(pendingBarrier.SyncBefore, barrier.SyncBefore);
+		pendingBarrier.SyncAfter = MergeSync(pendingBarrier.SyncAfter, barrier.SyncAfter);
+		pendingBarrier.AccessBefore = MergeAccess(pendingBarrier.AccessBefore, barrier.AccessBefore);
+		pendingBarrier.AccessAfter = MergeAccess(pendingBarrier.AccessAfter, barrier.AccessAfter);
+	};
+
+	for (const D3D12_GLOBAL_BARRIER& globalBarrier : barrier->m_GlobalBarriers)
+	{
+		if (pending.globalBarriers.empty())
+			pending.globalBarriers.push_back(globalBarrier);
+		else
+			MergeMasks(pending.globalBarriers[0], globalBarrier);
+	}
+
+	//Buffer barriers have no layouts, so all barriers on the same buffer are merged.
+	for (const D3D12_BUFFER_BARRIER& bufferBarrier : barrier->m_BufferBarriers)
+	{
+		bool merged = false;
+		for (D3D12_BUFFER_BARRIER& pendingBufferBarrier : pending.bufferBarriers)
+		{
+			if (pendingBufferBarrier.pResource != bufferBarrier.pResource)
+				continue;
+
+			MergeMasks(pendingBufferBarrier, bufferBarrier);
+			const UINT64& offset = std::min(pendingBufferBarrier.Offset, bufferBarrier.Offset);
+			if (pendingBufferBarrier.Size != UINT64_MAX && bufferBarrier.Size != UINT64_MAX)
+				pendingBufferBarrier.Size = std::max(pendingBufferBarrier.Offset + pendingBufferBarrier.Size, bufferBarrier.Offset + bufferBarrier.Size) - offset;
+			else
+				pendingBufferBarrier.Size = UINT64_MAX;
+			pendingBufferBarrier.Offset = offset;
+			merged = true;
+			break;
+		}
+		if (!merged)
+			pending.bufferBarriers.push_back(bufferBarrier);
+	}
+
+	for (const D3D12_TEXTURE_BARRIER& textureBarrier : barrier->m_TextureBarriers)
+	{
+		const D3D12_BARRIER_SUBRESOURCE_RANGE& range = textureBarrier.Subresources;
+		const UINT& mipEnd = range.IndexOrFirstMipLevel + range.NumMipLevels;
+		const UINT& arrayEnd = range.FirstArraySlice + range.NumArraySlices;
+		const UINT& planeEnd = range.FirstPlane + range.NumPlanes;
+		bool merged = false;
+		for (D3D12_TEXTURE_BARRIER& pendingTextureBarrier : pending.textureBarriers)
+		{
+			if (pendingTextureBarrier.pResource != textureBarrier.pResource)
+				continue;
+
+			D3D12_BARRIER_SUBRESOURCE_RANGE& pendingRange = pendingTextureBarrier.Subresources;
+			const UINT& pendingMipEnd = pendingRange.IndexOrFirstMipLevel + pendingRange.NumMipLevels;
+			const UINT& pendingArrayEnd = pendingRange.FirstArraySlice + pendingRange.NumArraySlices;
+			const UINT& pendingPlaneEnd = pendingRange.FirstPlane + pendingRange.NumPlanes;
+			const bool& sameTransition = pendingTextureBarrier.LayoutBefore == textureBarrier.LayoutBefore && pendingTextureBarrier.LayoutAfter == textureBarrier.LayoutAfter
+				&& pendingTextureBarrier.Flags == textureBarrier.Flags
+				&& pendingRange.FirstPlane == range.FirstPlane && pendingRange.NumPlanes == range.NumPlanes;
+			const bool& sameMips = pendingRange.IndexOrFirstMipLevel == range.IndexOrFirstMipLevel && pendingRange.NumMipLevels == range.NumMipLevels;
+			const bool& sameArraySlices = pendingRange.FirstArraySlice == range.FirstArraySlice && pendingRange.NumArraySlices == range.NumArraySlices;
+			const bool& adjacentMips = pendingRange.IndexOrFirstMipLevel <= mipEnd && range.IndexOrFirstMipLevel <= pendingMipEnd;
+			const bool& adjacentArraySlices = pendingRange.FirstArraySlice <= arrayEnd && range.FirstArraySlice <= pendingArrayEnd;
+			if (sameTransition && ((sameArraySlices && adjacentMips) || (sameMips && adjacentArraySlices)))
+			{
+				//The union of the two ranges is a single range.
+				MergeMasks(pendingTextureBarrier, textureBarrier);
+				pendingRange.IndexOrFirstMipLevel = std::min(pendingRange.IndexOrFirstMipLevel, range.IndexOrFirstMipLevel);
+				pendingRange.NumMipLevels = std::max(pendingMipEnd, mipEnd) - pendingRange.IndexOrFirstMipLevel;
+				pendingRange.FirstArraySlice = std::min(pendingRange.FirstArraySlice, range.FirstArraySlice);
+				pendingRange.NumArraySlices = std::max(pendingArrayEnd, arrayEnd) - pendingRange.FirstArraySlice;
+				merged = true;
+				break;
+			}
+			if (pendingRange.IndexOrFirstMipLevel < mipEnd && range.IndexOrFirstMipLevel < pendingMipEnd
+				&& pendingRange.FirstArraySlice < arrayEnd && range.FirstArraySlice < pendingArrayEnd
+				&& pendingRange.FirstPlane < planeEnd && range.FirstPlane < pendingPlaneEnd)
+			{
+				FlushBarriers(index);
+				break;
+			}
+		}
+		if (!merged)
+			pending.textureBarriers.push_back(textureBarrier);
+	}
+}
+
+void CommandBuffer::ClearPendingBarriers(uint32_t index)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	PendingBarriers& pending = m_PendingBarriers[index];
+	pending.globalBarriers.clear();
+	pending.bufferBarriers.clear();
+	pending.textureBarriers.clear();
+}
+
+void CommandBuffer::ClearColourImage(uint32_t index, const base::ImageRef& image, base::Image::Layout layout, const base::Image::ClearColourValue& clear, const base::Image::SubresourceRange* pSubresourceRanges, uint32_t subresourceRangeCount)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	FlushBarriers(index);
 	UINT descriptorCount = 0;
-	for (size_t h = 0; h < subresourceRanges.size(); h++)
-		for (uint32_t i = subresourceRanges[h].baseMipLevel; i < subresourceRanges[h].baseMipLevel + subresourceRanges[h].mipLevelCount; i++)
+	for (size_t h = 0; h < subresourceRangeCount; h++)
+		for (uint32_t i = pSubresourceRanges[h].baseMipLevel; i < pSubresourceRanges[h].baseMipLevel + pSubresourceRanges[h].mipLevelCount; i++)
 			descriptorCount++;
 
 	D3D12_DESCRIPTOR_HEAP_DESC heapDesc;
@@ -423,16 +712,16 @@ void CommandBuffer::ClearColourImage(uint32_t index, const base::ImageRef& image
 
 	UINT RTV_DescriptorSize = m_Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_RTV);
 
-	for (size_t h = 0; h < subresourceRanges.size(); h++)
+	for (size_t h = 0; h < subresourceRangeCount; h++)
 	{
-		for (uint32_t i = subresourceRanges[h].baseMipLevel; i < subresourceRanges[h].baseMipLevel + subresourceRanges[h].mipLevelCount; i++)
+		for (uint32_t i = pSubresourceRanges[h].baseMipLevel; i < pSubresourceRanges[h].baseMipLevel + pSubresourceRanges[h].mipLevelCount; i++)
 		{
 			ImageView::CreateInfo imageViewCI;
 			imageViewCI.debugName = "CommandBuffer::ClearColourImage RTV: " + std::to_string(h) + " MIP: " + std::to_string(i);
 			imageViewCI.device = m_Device;
 			imageViewCI.image = image;
 			imageViewCI.viewType = image->GetCreateInfo().type;
-			imageViewCI.subresourceRange = subresourceRanges[h];
+			imageViewCI.subresourceRange = pSubresourceRanges[h];
 			imageViewCI.subresourceRange.baseMipLevel = i;
 			imageViewCI.subresourceRange.mipLevelCount = 1;
 			d3d12::ImageViewRef rtv = ref_cast<d3d12::ImageView>(ImageView::Create(&imageViewCI));
@@ -446,13 +735,14 @@ void CommandBuffer::ClearColourImage(uint32_t index, const base::ImageRef& image
 	MIRU_D3D12_SAFE_RELEASE(heap);
 }
 
-void CommandBuffer::ClearDepthStencilImage(uint32_t index, const base::ImageRef& image, base::Image::Layout layout, const base::Image::ClearDepthStencilValue& clear, const std::vector<base::Image::SubresourceRange>& subresourceRanges)
+void CommandBuffer::ClearDepthStencilImage(uint32_t index, const base::ImageRef& image, base::Image::Layout layout, const base::Image::ClearDepthStencilValue& clear, const base::Image::SubresourceRange* pSubresourceRanges, uint32_t subresourceRangeCount)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
+	FlushBarriers(index);
 	UINT descriptorCount = 0;
-	for (size_t h = 0; h < subresourceRanges.size(); h++)
-		for (uint32_t i = subresourceRanges[h].baseMipLevel; i < subresourceRanges[h].baseMipLevel + subresourceRanges[h].mipLevelCount; i++)
+	for (size_t h = 0; h < subresourceRangeCount; h++)
+		for (uint32_t i = pSubresourceRanges[h].baseMipLevel; i < pSubresourceRanges[h].baseMipLevel + pSubresourceRanges[h].mipLevelCount; i++)
 			descriptorCount++;
 
 	D3D12_DESCRIPTOR_HEAP_DESC heapDesc;
@@ -466,16 +756,16 @@ void CommandBuffer::ClearDepthStencilImage(uint32_t index, const base::ImageRef&
 
 	UINT DSV_DescriptorSize = m_Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_DSV);
 
-	for (size_t h = 0; h < subresourceRanges.size(); h++)
+	for (size_t h = 0; h < subresourceRangeCount; h++)
 	{
-		for (uint32_t i = subresourceRanges[h].baseMipLevel; i < subresourceRanges[h].baseMipLevel + subresourceRanges[h].mipLevelCount; i++)
+		for (uint32_t i = pSubresourceRanges[h].baseMipLevel; i < pSubresourceRanges[h].baseMipLevel + pSubresourceRanges[h].mipLevelCount; i++)
 		{
 			ImageView::CreateInfo imageViewCI;
 			imageViewCI.debugName = "CommandBuffer::ClearColourImage DSV: " + std::to_string(h) + " MIP: " + std::to_string(i);
 			imageViewCI.device = m_Device;
 			imageViewCI.image = image;
 			imageViewCI.viewType = image->GetCreateInfo().type;
-			imageViewCI.subresourceRange = subresourceRanges[h];
+			imageViewCI.subresourceRange = pSubresourceRanges[h];
 			imageViewCI.subresourceRange.baseMipLevel = i;
 			imageViewCI.subresourceRange.mipLevelCount = 1;
 			d3d12::ImageViewRef dsv = ref_cast<d3d12::ImageView>(ImageView::Create(&imageViewCI));
@@ -489,15 +779,16 @@ void CommandBuffer::ClearDepthStencilImage(uint32_t index, const base::ImageRef&
 	MIRU_D3D12_SAFE_RELEASE(heap);
 }
 
-void CommandBuffer::BeginRenderPass(uint32_t index, const base::FramebufferRef& framebuffer, const std::vector<base::Image::ClearValue>& clearValues)
+void CommandBuffer::BeginRenderPass(uint32_t index, const base::FramebufferRef& framebuffer, const base::Image::ClearValue* pClearValues, uint32_t clearValueCount, SubpassContents contents)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 	RenderingResource& renderingResource = m_RenderingResources[index];
 
 	renderingResource.Framebuffer = framebuffer;
-	renderingResource.ClearValues = clearValues;
+	renderingResource.ClearValues.assign(pClearValues, pClearValues + clearValueCount);
 	
 	//Transition resources to be begin render pass.
 	renderingResource.SubpassIndex = (uint32_t)-1;
@@ -537,7 +828,7 @@ void CommandBuffer::BeginRenderPass(uint32_t index, const base::FramebufferRef&
 	PipelineBarrier(index, base::PipelineStageBit::BOTTOM_OF_PIPE_BIT, base::PipelineStageBit::TOP_OF_PIPE_BIT, base::DependencyBit::NONE_BIT, barriers);
 
 	//Begin first subpass
-	NextSubpass(index);
+	NextSubpass(index, contents);
 };
 
 void CommandBuffer::EndRenderPass(uint32_t index) 
@@ -545,6 +836,7 @@ void CommandBuffer::EndRenderPass(uint32_t index)
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 	RenderingResource& renderingResource = m_RenderingResources[index];
 
 	//Resolve any attachments from the previous subpass
@@ -575,11 +867,13 @@ void CommandBuffer::EndRenderPass(uint32_t index)
 	PipelineBarrier(index, base::PipelineStageBit::BOTTOM_OF_PIPE_BIT, base::PipelineStageBit::TOP_OF_PIPE_BIT, base::DependencyBit::NONE_BIT, barriers);
 };
 
-void CommandBuffer::NextSubpass(uint32_t index)
+void CommandBuffer::NextSubpass(uint32_t index, SubpassContents contents)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	InvalidateBoundState(index);
 	RenderingResource& renderingResource = m_RenderingResources[index];
 
 	//Resolve any attachments from the previous subpass
@@ -702,6 +996,8 @@ void CommandBuffer::BeginRendering(uint32_t index, const base::RenderingInfo& re
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	InvalidateBoundState(index);
 	RenderingResource& renderingResource = m_RenderingResources[index];
 	renderingResource.RenderingInfo = renderingInfo;
 
@@ -772,6 +1068,7 @@ void CommandBuffer::EndRendering(uint32_t index)
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 	RenderingResource& renderingResource = m_RenderingResources[index];
 
 	for (auto& colourAttachment : renderingResource.RenderingInfo.colourAttachments)
@@ -790,10 +1087,15 @@ void CommandBuffer::EndRendering(uint32_t index)
 			resolveRegion.dstOffset = { 0, 0, 0 };
 			resolveRegion.extent = { colourImageCI.width, colourImageCI.height, colourImageCI.depth };
 
-			ResolveImage(index, colourImage, colourAttachment.imageLayout, resolveImage, colourAttachment.resolveImageLayout, { resolveRegion });
+			ResolveImage(index, colourImage, colourAttachment.imageLayout, resolveImage, colourAttachment.resolveImageLayout, &resolveRegion, 1);
 		}
 
 		ImageViewRef imageView = ref_cast<ImageView>(colourAttachment.imageView);
+		if (imageView->GetCreateInfo().image->IsTransientAttachment())
+		{
+			//Equivalent to AttachmentStoreOp::DONT_CARE.
+			reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->DiscardResource(ref_cast<Image>(imageView->GetCreateInfo().image)->m_Image, nullptr);
+		}
 		if (!imageView->IsSwapchainImageView())
 		{
 			ImageRef image = ref_cast<Image>(imageView->GetCreateInfo().image);
@@ -804,6 +1106,11 @@ void CommandBuffer::EndRendering(uint32_t index)
 	if (renderingResource.RenderingInfo.pDepthAttachment)
 	{
 		ImageViewRef imageView = ref_cast<ImageView>(renderingResource.RenderingInfo.pDepthAttachment->imageView);
+		if (imageView->GetCreateInfo().image->IsTransientAttachment())
+		{
+			//Equivalent to AttachmentStoreOp::DONT_CARE.
+			reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->DiscardResource(ref_cast<Image>(imageView->GetCreateInfo().image)->m_Image, nullptr);
+		}
 		if (!imageView->IsSwapchainImageView())
 		{
 			ImageRef image = ref_cast<Image>(imageView->GetCreateInfo().image);
@@ -818,16 +1125,31 @@ void CommandBuffer::BindPipeline(uint32_t index, const base::PipelineRef& pipeli
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	if (FilterPipeline(index, pipeline.get()))
+		return;
+
+	//Setting the root signature clears all root arguments, so the bound descriptor tables must be set again.
+	m_BoundStates[index].descriptorSets.fill(nullptr);
+	m_BoundStates[index].descriptorSetPipeline = nullptr;
+
 	if (pipeline->GetCreateInfo().type == base::PipelineType::GRAPHICS)
 	{
 		reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->SetPipelineState(ref_cast<Pipeline>(pipeline)->m_Pipeline);
 		reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->SetGraphicsRootSignature(ref_cast<Pipeline>(pipeline)->m_GlobalRootSignature.rootSignature);
 		reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->IASetPrimitiveTopology(Pipeline::ToD3D12_PRIMITIVE_TOPOLOGY(ref_cast<Pipeline>(pipeline)->GetCreateInfo().inputAssemblyState.topology));
 
-		if (!arc::FindInVector(pipeline->GetCreateInfo().dynamicStates.dynamicStates, base::DynamicState::VIEWPORT))
+		//Bundles can not set the viewports and scissors, which are inherited from the primary CommandBuffer.
+		const bool bundle = m_CI.level == Level::SECONDARY;
+		if (!bundle && !arc::FindInVector(pipeline->GetCreateInfo().dynamicStates.dynamicStates, base::DynamicState::VIEWPORT))
+		{
 			reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->RSSetViewports(static_cast<UINT>(ref_cast<Pipeline>(pipeline)->m_Viewports.size()), ref_cast<Pipeline>(pipeline)->m_Viewports.data());
-		if (!arc::FindInVector(pipeline->GetCreateInfo().dynamicStates.dynamicStates, base::DynamicState::SCISSOR))
+			m_BoundStates[index].viewportCount = 0;
+		}
+		if (!bundle && !arc::FindInVector(pipeline->GetCreateInfo().dynamicStates.dynamicStates, base::DynamicState::SCISSOR))
+		{
 			reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->RSSetScissorRects(static_cast<UINT>(ref_cast<Pipeline>(pipeline)->m_Scissors.size()), ref_cast<Pipeline>(pipeline)->m_Scissors.data());
+			m_BoundStates[index].scissorCount = 0;
+		}
 		
 		/*if (pipeline->GetCreateInfo().renderPass && !pipeline->GetCreateInfo().renderPass->GetCreateInfo().multiview.viewMasks.empty())
 			reinterpret_cast<ID3D12GraphicsCommandList1*>(m_CmdBuffers[index])->SetViewInstanceMask(pipeline->GetCreateInfo().renderPass->GetCreateInfo().multiview.viewMasks[m_RenderingResources[index].SubpassIndex]);
@@ -858,28 +1180,112 @@ void CommandBuffer::BindVertexBuffers(uint32_t index, const std::vector<base::Bu
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	if (FilterVertexBuffers(index, vertexBufferViews.data(), static_cast<uint32_t>(vertexBufferViews.size())))
+		return;
 
-	std::vector<D3D12_VERTEX_BUFFER_VIEW>vbvs;
-	vbvs.reserve(vertexBufferViews.size());
-	for (auto& vbv : vertexBufferViews)
-		vbvs.push_back(ref_cast<BufferView>(vbv)->m_VBVDesc);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
 
-	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->IASetVertexBuffers(0, static_cast<UINT>(vbvs.size()), vbvs.data());
+	D3D12_VERTEX_BUFFER_VIEW* vbvs = m_Scratch[index].Allocate<D3D12_VERTEX_BUFFER_VIEW>(vertexBufferViews.size());
+	for (size_t i = 0; i < vertexBufferViews.size(); i++)
+		vbvs[i] = static_cast<const BufferView*>(vertexBufferViews[i].get())->m_VBVDesc;
 
-};
+	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->IASetVertexBuffers(0, static_cast<UINT>(vertexBufferViews.size()), vbvs);
+}
 void CommandBuffer::BindIndexBuffer(uint32_t index, const base::BufferViewRef& indexBufferView) 
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
-	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->IASetIndexBuffer(&ref_cast<BufferView>(indexBufferView)->m_IBVDesc);
+	if (FilterIndexBuffer(index, indexBufferView.get()))
+		return;
+
+	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->IASetIndexBuffer(&static_cast<const BufferView*>(indexBufferView.get())->m_IBVDesc);
 };
 
-void CommandBuffer::BindDescriptorSets(uint32_t index, const std::vector<base::DescriptorSetRef>& descriptorSets, uint32_t firstSet, const base::PipelineRef& pipeline)
+void CommandBuffer::BindVertexBuffers(uint32_t index, const base::BufferViewHandle* pVertexBufferViews, uint32_t vertexBufferViewCount)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+
+	const BufferView** bufferViews = m_Scratch[index].Allocate<const BufferView*>(vertexBufferViewCount);
+	for (uint32_t i = 0; i < vertexBufferViewCount; i++)
+	{
+		base::BufferView* bufferView = base::GetHandleObject(pVertexBufferViews[i]);
+		MIRU_FATAL(!bufferView, "ERROR: D3D12: Invalid BufferViewHandle.");
+		bufferViews[i] = static_cast<const BufferView*>(bufferView);
+	}
+	if (FilterVertexBuffers(index, bufferViews, vertexBufferViewCount))
+		return;
+
+	D3D12_VERTEX_BUFFER_VIEW* vbvs = m_Scratch[index].Allocate<D3D12_VERTEX_BUFFER_VIEW>(vertexBufferViewCount);
+	for (uint32_t i = 0; i < vertexBufferViewCount; i++)
+		vbvs[i] = bufferViews[i]->m_VBVDesc;
+
+	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->IASetVertexBuffers(0, vertexBufferViewCount, vbvs);
+}
+
+void CommandBuffer::BindIndexBuffer(uint32_t index, const base::BufferViewHandle& indexBufferView)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+
+	base::BufferView* bufferView = base::GetHandleObject(indexBufferView);
+	MIRU_FATAL(!bufferView, "ERROR: D3D12: Invalid BufferViewHandle.");
+	if (FilterIndexBuffer(index, bufferView))
+		return;
+
+	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->IASetIndexBuffer(&static_cast<BufferView*>(bufferView)->m_IBVDesc);
+}
+
+void CommandBuffer::BindDescriptorSets(uint32_t index, const std::vector<base::DescriptorSetRef>& descriptorSets, uint32_t firstSet, const base::PipelineRef& pipeline, const std::vector<uint32_t>& dynamicOffsets)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	const uint32_t& descriptorSetCount = static_cast<uint32_t>(descriptorSets.size());
+	if (FilterDescriptorSets(index, descriptorSets.data(), descriptorSetCount, firstSet, pipeline.get(), static_cast<uint32_t>(dynamicOffsets.size())))
+		return;
+
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+
+	DescriptorSet** d3d12DescriptorSets = m_Scratch[index].Allocate<DescriptorSet*>(descriptorSetCount);
+	for (uint32_t i = 0; i < descriptorSetCount; i++)
+		d3d12DescriptorSets[i] = static_cast<DescriptorSet*>(descriptorSets[i].get());
+
+	SetDescriptorTables(index, d3d12DescriptorSets, descriptorSetCount, firstSet, pipeline, dynamicOffsets.data(), static_cast<uint32_t>(dynamicOffsets.size()));
+}
+
+void CommandBuffer::BindDescriptorSets(uint32_t index, const base::DescriptorSetHandle* pDescriptorSets, uint32_t descriptorSetCount, uint32_t firstSet, const base::PipelineRef& pipeline, const uint32_t* pDynamicOffsets, uint32_t dynamicOffsetCount)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+
+	DescriptorSet** d3d12DescriptorSets = m_Scratch[index].Allocate<DescriptorSet*>(descriptorSetCount);
+	for (uint32_t i = 0; i < descriptorSetCount; i++)
+	{
+		base::DescriptorSet* descriptorSet = base::GetHandleObject(pDescriptorSets[i]);
+		MIRU_FATAL(!descriptorSet, "ERROR: D3D12: Invalid DescriptorSetHandle.");
+		d3d12DescriptorSets[i] = static_cast<DescriptorSet*>(descriptorSet);
+	}
+	if (FilterDescriptorSets(index, d3d12DescriptorSets, descriptorSetCount, firstSet, pipeline.get(), dynamicOffsetCount))
+		return;
+
+	SetDescriptorTables(index, d3d12DescriptorSets, descriptorSetCount, firstSet, pipeline, pDynamicOffsets, dynamicOffsetCount);
+}
+
+void CommandBuffer::SetDescriptorTables(uint32_t index, DescriptorSet* const* ppDescriptorSets, uint32_t descriptorSetCount, uint32_t firstSet, const base::PipelineRef& pipeline, const uint32_t* pDynamicOffsets, uint32_t dynamicOffsetCount)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	//Bundles must use the descriptor heaps of the primary CommandBuffer, but each CommandBuffer copies its descriptors into its own heaps.
+	MIRU_FATAL(m_CI.level == Level::SECONDARY, "ERROR: D3D12: DescriptorSets can not be bound in secondary CommandBuffers.");
+
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
 	RenderingResource& renderingResource = m_RenderingResources[index];
 
 	if (renderingResource.SetDescriptorHeap)
@@ -898,17 +1304,24 @@ void CommandBuffer::BindDescriptorSets(uint32_t index, const std::vector<base::D
 	UINT Current_CBV_SRV_UAV_DescriptorOffset = 0;
 	UINT Current_SAMPLER_DescriptorOffset = 0;
 	
-	std::vector<D3D12_GPU_DESCRIPTOR_HANDLE> CBV_SRV_UAV_GPUDescriptorHandles;
-	std::vector<D3D12_GPU_DESCRIPTOR_HANDLE> SAMPLER_GPUDescriptorHandles;
+	size_t heapCount = 0;
+	for (uint32_t i = 0; i < descriptorSetCount; i++)
+		heapCount += ppDescriptorSets[i]->m_DescriptorHeaps.size();
+
+	D3D12_GPU_DESCRIPTOR_HANDLE* CBV_SRV_UAV_GPUDescriptorHandles = m_Scratch[index].Allocate<D3D12_GPU_DESCRIPTOR_HANDLE>(heapCount);
+	D3D12_GPU_DESCRIPTOR_HANDLE* SAMPLER_GPUDescriptorHandles = m_Scratch[index].Allocate<D3D12_GPU_DESCRIPTOR_HANDLE>(heapCount);
+	size_t CBV_SRV_UAV_GPUDescriptorHandleCount = 0;
+	size_t SAMPLER_GPUDescriptorHandleCount = 0;
 
 	UINT totalDescriptorSets = 0;
+	uint32_t dynamicOffsetIndex = 0;
 
-	for(auto& descriptorSet : descriptorSets)
+	for (uint32_t j = 0; j < descriptorSetCount; j++)
 	{
-		DescriptorSetRef d3d12DescriptorSet = ref_cast<DescriptorSet>(descriptorSet);
+		DescriptorSet* d3d12DescriptorSet = ppDescriptorSets[j];
 		const auto& heap = d3d12DescriptorSet->m_DescriptorHeaps;
 		const auto& heapDesc = d3d12DescriptorSet->m_DescriptorHeapDescs;
-		totalDescriptorSets += static_cast<UINT>(descriptorSet->GetCreateInfo().descriptorSetLayouts.size());
+		totalDescriptorSets += static_cast<UINT>(d3d12DescriptorSet->GetCreateInfo().descriptorSetLayouts.size());
 		
 		for (size_t i = 0; i < heap.size(); i++)
 		{
@@ -916,8 +1329,37 @@ void CommandBuffer::BindDescriptorSets(uint32_t index, const std::vector<base::D
 			{
 				D3D12_CPU_DESCRIPTOR_HANDLE Current_CmdBuffer_CBV_SRV_UAV_CPUDescriptorHandle;
 				Current_CmdBuffer_CBV_SRV_UAV_CPUDescriptorHandle.ptr = renderingResource.CBV_SRV_UAV_DescriptorHeap->GetCPUDescriptorHandleForHeapStart().ptr + Current_CBV_SRV_UAV_DescriptorOffset + renderingResource.CBV_SRV_UAV_DescriptorOffset;
-				CBV_SRV_UAV_GPUDescriptorHandles.push_back({ renderingResource.CBV_SRV_UAV_DescriptorHeap->GetGPUDescriptorHandleForHeapStart().ptr + Current_CBV_SRV_UAV_DescriptorOffset + renderingResource.CBV_SRV_UAV_DescriptorOffset });
+				CBV_SRV_UAV_GPUDescriptorHandles[CBV_SRV_UAV_GPUDescriptorHandleCount++] = { renderingResource.CBV_SRV_UAV_DescriptorHeap->GetGPUDescriptorHandleForHeapStart().ptr + Current_CBV_SRV_UAV_DescriptorOffset + renderingResource.CBV_SRV_UAV_DescriptorOffset };
 				m_Device->CopyDescriptorsSimple(heapDesc[i][0].NumDescriptors, Current_CmdBuffer_CBV_SRV_UAV_CPUDescriptorHandle, heap[i][0]->GetCPUDescriptorHandleForHeapStart(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+				//Rewrite the copied dynamic descriptors with their dynamic offsets.
+				const auto& dynamicDescriptors = d3d12DescriptorSet->m_DynamicDescriptors.find(static_cast<uint32_t>(i));
+				if (dynamicDescriptors != d3d12DescriptorSet->m_DynamicDescriptors.end())
+				{
+					for (const auto& dynamicDescriptor : dynamicDescriptors->second)
+					{
+						MIRU_FATAL(dynamicOffsetIndex >= dynamicOffsetCount, "ERROR: D3D12: Not enough dynamic offsets for the DescriptorSets.");
+						const uint32_t& dynamicOffset = pDynamicOffsets[dynamicOffsetIndex++];
+						const DescriptorSet::DynamicDescriptor& descriptor = dynamicDescriptor.second;
+
+						D3D12_CPU_DESCRIPTOR_HANDLE dynamicDescriptorHandle = { Current_CmdBuffer_CBV_SRV_UAV_CPUDescriptorHandle.ptr + descriptor.heapOffset };
+						if (descriptor.type == base::DescriptorType::UNIFORM_BUFFER_DYNAMIC)
+						{
+							D3D12_CONSTANT_BUFFER_VIEW_DESC CBVDesc = descriptor.CBVDesc;
+							CBVDesc.BufferLocation += dynamicOffset;
+							m_Device->CreateConstantBufferView(&CBVDesc, dynamicDescriptorHandle);
+						}
+						else
+						{
+							//Structured buffer views can only start at a whole element.
+							D3D12_UNORDERED_ACCESS_VIEW_DESC UAVDesc = descriptor.UAVDesc;
+							MIRU_FATAL(dynamicOffset % UAVDesc.Buffer.StructureByteStride != 0, "ERROR: D3D12: Dynamic offset for a STORAGE_BUFFER_DYNAMIC descriptor is not a multiple of the BufferView's stride.");
+							UAVDesc.Buffer.FirstElement += dynamicOffset / UAVDesc.Buffer.StructureByteStride;
+							m_Device->CreateUnorderedAccessView(descriptor.resource, nullptr, &UAVDesc, dynamicDescriptorHandle);
+						}
+					}
+				}
+
 				Current_CBV_SRV_UAV_DescriptorOffset += heapDesc[i][0].NumDescriptors * CBV_SRV_UAV_DescriptorSize;
 			}
 
@@ -925,7 +1367,7 @@ void CommandBuffer::BindDescriptorSets(uint32_t index, const std::vector<base::D
 			{
 				D3D12_CPU_DESCRIPTOR_HANDLE Current_CmdBuffer_Sampler_CPUDescriptorHandle;
 				Current_CmdBuffer_Sampler_CPUDescriptorHandle.ptr = renderingResource.SAMPLER_DescriptorHeap->GetCPUDescriptorHandleForHeapStart().ptr + Current_SAMPLER_DescriptorOffset + renderingResource.SAMPLER_DescriptorOffset;
-				SAMPLER_GPUDescriptorHandles.push_back({ renderingResource.SAMPLER_DescriptorHeap->GetGPUDescriptorHandleForHeapStart().ptr + Current_SAMPLER_DescriptorOffset + renderingResource.SAMPLER_DescriptorOffset });
+				SAMPLER_GPUDescriptorHandles[SAMPLER_GPUDescriptorHandleCount++] = { renderingResource.SAMPLER_DescriptorHeap->GetGPUDescriptorHandleForHeapStart().ptr + Current_SAMPLER_DescriptorOffset + renderingResource.SAMPLER_DescriptorOffset };
 				m_Device->CopyDescriptorsSimple(heapDesc[i][1].NumDescriptors, Current_CmdBuffer_Sampler_CPUDescriptorHandle, heap[i][1]->GetCPUDescriptorHandleForHeapStart(),D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
 				Current_SAMPLER_DescriptorOffset += heapDesc[i][1].NumDescriptors * SAMPLER_DescriptorSize;
 			}
@@ -939,8 +1381,14 @@ void CommandBuffer::BindDescriptorSets(uint32_t index, const std::vector<base::D
 	size_t SAMPLER_GPUDescriptorHandleIndex = 0;
 
 	size_t rootParameterIndex = 0;
-	for (const auto& rootParameter : ref_cast<Pipeline>(pipeline)->m_GlobalRootSignature.rootParameters)
+	for (const auto& rootParameter : static_cast<const Pipeline*>(pipeline.get())->m_GlobalRootSignature.rootParameters)
 	{
+		if (rootParameter.ParameterType != D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
+		{
+			rootParameterIndex++;
+			continue;
+		}
+
 		const D3D12_ROOT_DESCRIPTOR_TABLE& descriptorTable = rootParameter.DescriptorTable;
 		D3D12_GPU_DESCRIPTOR_HANDLE GPUDescriptorHandle;
 
@@ -954,13 +1402,13 @@ void CommandBuffer::BindDescriptorSets(uint32_t index, const std::vector<base::D
 	
 		if (descriptorTable.pDescriptorRanges[0].RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_SAMPLER)
 		{
-			MIRU_FATAL(!(SAMPLER_GPUDescriptorHandleIndex < SAMPLER_GPUDescriptorHandles.size()), "ERROR: D3D12: No D3D12_GPU_DESCRIPTOR_HANDLE is available.");
+			MIRU_FATAL(!(SAMPLER_GPUDescriptorHandleIndex < SAMPLER_GPUDescriptorHandleCount), "ERROR: D3D12: No D3D12_GPU_DESCRIPTOR_HANDLE is available.");
 			GPUDescriptorHandle = SAMPLER_GPUDescriptorHandles[SAMPLER_GPUDescriptorHandleIndex];
 			SAMPLER_GPUDescriptorHandleIndex++;
 		}
 		else
 		{
-			MIRU_FATAL(!(CBV_SRV_UAV_GPUDescriptorHandleIndex < CBV_SRV_UAV_GPUDescriptorHandles.size()), "ERROR: D3D12: No D3D12_GPU_DESCRIPTOR_HANDLE is available.");
+			MIRU_FATAL(!(CBV_SRV_UAV_GPUDescriptorHandleIndex < CBV_SRV_UAV_GPUDescriptorHandleCount), "ERROR: D3D12: No D3D12_GPU_DESCRIPTOR_HANDLE is available.");
 			GPUDescriptorHandle = CBV_SRV_UAV_GPUDescriptorHandles[CBV_SRV_UAV_GPUDescriptorHandleIndex];
 			CBV_SRV_UAV_GPUDescriptorHandleIndex++;
 		}
@@ -986,11 +1434,45 @@ void CommandBuffer::BindDescriptorSets(uint32_t index, const std::vector<base::D
 	}
 };
 
+void CommandBuffer::PushConstants(uint32_t index, const base::PipelineRef& pipeline, base::Shader::StageBit stages, uint32_t offset, uint32_t size, const void* pValues)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+
+	const std::vector<base::PushConstantRange>& pushConstantRanges = pipeline->GetCreateInfo().layout.pushConstantRanges;
+	const std::vector<UINT>& rootParameterIndices = static_cast<const Pipeline*>(pipeline.get())->m_GlobalRootSignature.pushConstantRootParameterIndices;
+	const base::PipelineType& type = pipeline->GetCreateInfo().type;
+
+	for (size_t i = 0; i < pushConstantRanges.size(); i++)
+	{
+		const base::PushConstantRange& pushConstantRange = pushConstantRanges[i];
+		if ((static_cast<uint32_t>(pushConstantRange.stages) & static_cast<uint32_t>(stages)) == 0)
+			continue;
+
+		//Write the bytes that overlap this range into its root constants.
+		const uint32_t& begin = std::max(offset, pushConstantRange.offset);
+		const uint32_t& end = std::min(offset + size, pushConstantRange.offset + pushConstantRange.size);
+		if (begin >= end)
+			continue;
+
+		const UINT& num32BitValues = (end - begin + 3) / 4;
+		const void* pSrcData = reinterpret_cast<const uint8_t*>(pValues) + (begin - offset);
+		const UINT& destOffsetIn32BitValues = (begin - pushConstantRange.offset) / 4;
+
+		if (type == base::PipelineType::GRAPHICS)
+			reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->SetGraphicsRoot32BitConstants(rootParameterIndices[i], num32BitValues, pSrcData, destOffsetIn32BitValues);
+		else
+			reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->SetComputeRoot32BitConstants(rootParameterIndices[i], num32BitValues, pSrcData, destOffsetIn32BitValues);
+	}
+}
+
 void CommandBuffer::DrawIndexed(uint32_t index, uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->DrawIndexedInstanced(indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
 };
 
@@ -999,6 +1481,7 @@ void CommandBuffer::Draw(uint32_t index, uint32_t vertexCount, uint32_t instance
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->DrawInstanced(vertexCount, instanceCount, firstVertex, firstInstance);
 };
 
@@ -1007,6 +1490,7 @@ void CommandBuffer::DrawMeshTasks(uint32_t index, uint32_t groupCountX, uint32_t
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 	reinterpret_cast<ID3D12GraphicsCommandList6*>(m_CmdBuffers[index])->DispatchMesh(groupCountX, groupCountY, groupCountZ);
 }
 
@@ -1015,16 +1499,94 @@ void CommandBuffer::Dispatch(uint32_t index, uint32_t groupCountX, uint32_t grou
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->Dispatch(groupCountX, groupCountY, groupCountZ);
 }
 
-void CommandBuffer::BuildAccelerationStructure(uint32_t index, const std::vector<base::AccelerationStructureBuildInfoRef>& buildGeometryInfos, const std::vector<std::vector<base::AccelerationStructureBuildInfo::BuildRangeInfo>>& buildRangeInfos)
+void CommandBuffer::DrawIndirect(uint32_t index, const base::BufferRef& buffer, uint64_t offset, uint32_t drawCount, uint32_t stride)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	ExecuteIndirect(index, D3D12_INDIRECT_ARGUMENT_TYPE_DRAW, stride, drawCount, buffer, offset, nullptr, 0);
+}
+
+void CommandBuffer::DrawIndexedIndirect(uint32_t index, const base::BufferRef& buffer, uint64_t offset, uint32_t drawCount, uint32_t stride)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	ExecuteIndirect(index, D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED, stride, drawCount, buffer, offset, nullptr, 0);
+}
+
+void CommandBuffer::DrawIndirectCount(uint32_t index, const base::BufferRef& buffer, uint64_t offset, const base::BufferRef& countBuffer, uint64_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	ExecuteIndirect(index, D3D12_INDIRECT_ARGUMENT_TYPE_DRAW, stride, maxDrawCount, buffer, offset, countBuffer, countBufferOffset);
+}
+
+void CommandBuffer::DrawIndexedIndirectCount(uint32_t index, const base::BufferRef& buffer, uint64_t offset, const base::BufferRef& countBuffer, uint64_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	ExecuteIndirect(index, D3D12_INDIRECT_ARGUMENT_TYPE_DRAW_INDEXED, stride, maxDrawCount, buffer, offset, countBuffer, countBufferOffset);
+}
+
+void CommandBuffer::DrawMeshTasksIndirect(uint32_t index, const base::BufferRef& buffer, uint64_t offset, uint32_t drawCount, uint32_t stride)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	ExecuteIndirect(index, D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH_MESH, stride, drawCount, buffer, offset, nullptr, 0);
+}
+
+void CommandBuffer::DrawMeshTasksIndirectCount(uint32_t index, const base::BufferRef& buffer, uint64_t offset, const base::BufferRef& countBuffer, uint64_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	ExecuteIndirect(index, D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH_MESH, stride, maxDrawCount, buffer, offset, countBuffer, countBufferOffset);
+}
+
+void CommandBuffer::DispatchIndirect(uint32_t index, const base::BufferRef& buffer, uint64_t offset)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	ExecuteIndirect(index, D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH, sizeof(DispatchIndirectCommand), 1, buffer, offset, nullptr, 0);
+}
+
+void CommandBuffer::ExecuteIndirect(uint32_t index, D3D12_INDIRECT_ARGUMENT_TYPE type, uint32_t stride, uint32_t maxCommandCount, const base::BufferRef& argumentBuffer, uint64_t argumentBufferOffset, const base::BufferRef& countBuffer, uint64_t countBufferOffset)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	Context* context = static_cast<Context*>(m_CI.commandPool->GetCreateInfo().context.get());
+	ID3D12CommandSignature* commandSignature = context->GetCommandSignature(type, stride);
+
+	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->ExecuteIndirect(commandSignature, maxCommandCount,
+		static_cast<const Buffer*>(argumentBuffer.get())->m_Buffer, argumentBuffer->GetOffset() + argumentBufferOffset,
+		countBuffer ? static_cast<const Buffer*>(countBuffer.get())->m_Buffer : nullptr, countBuffer ? countBuffer->GetOffset() + countBufferOffset : 0);
+}
+
+void CommandBuffer::BuildAccelerationStructure(uint32_t index, const base::AccelerationStructureBuildInfoRef* pBuildGeometryInfos, uint32_t buildGeometryInfoCount, const base::AccelerationStructureBuildInfo::BuildRangeInfo* const* ppBuildRangeInfos)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
-	for (auto& buildGeometryInfo : buildGeometryInfos)
+	FlushBarriers(index);
+	for (uint32_t j = 0; j < buildGeometryInfoCount; j++)
 	{
+		const base::AccelerationStructureBuildInfoRef& buildGeometryInfo = pBuildGeometryInfos[j];
 		const AccelerationStructureBuildInfo::BuildGeometryInfo& bgi = buildGeometryInfo->GetBuildGeometryInfo();
 
 		D3D12_BUILD_RAYTRACING_ACCELERATION_STRUCTURE_DESC desc = {};
@@ -1048,6 +1610,7 @@ void CommandBuffer::TraceRays(uint32_t index, const base::StridedDeviceAddressRe
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 	D3D12_DISPATCH_RAYS_DESC desc;
 
 	if (pRaygenShaderBindingTable)
@@ -1076,24 +1639,28 @@ void CommandBuffer::TraceRays(uint32_t index, const base::StridedDeviceAddressRe
 	reinterpret_cast<ID3D12GraphicsCommandList4*>(m_CmdBuffers[index])->DispatchRays(&desc);
 }
 
-void CommandBuffer::CopyBuffer(uint32_t index, const base::BufferRef& srcBuffer, const base::BufferRef& dstBuffer, const std::vector<base::Buffer::Copy>& copyRegions) 
+void CommandBuffer::CopyBuffer(uint32_t index, const base::BufferRef& srcBuffer, const base::BufferRef& dstBuffer, const base::Buffer::Copy* pCopyRegions, uint32_t copyRegionCount)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
-	for (auto& copyRegion : copyRegions)
+	FlushBarriers(index);
+	for (uint32_t i = 0; i < copyRegionCount; i++)
 		reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->CopyBufferRegion(
-			ref_cast<Buffer>(dstBuffer)->m_Buffer, static_cast<UINT>(copyRegion.dstOffset), 
-			ref_cast<Buffer>(srcBuffer)->m_Buffer, static_cast<UINT>(copyRegion.srcOffset), static_cast<UINT>(copyRegion.size));
-};
+			ref_cast<Buffer>(dstBuffer)->m_Buffer, static_cast<UINT64>(dstBuffer->GetOffset() + pCopyRegions[i].dstOffset), 
+			ref_cast<Buffer>(srcBuffer)->m_Buffer, static_cast<UINT64>(srcBuffer->GetOffset() + pCopyRegions[i].srcOffset), static_cast<UINT64>(pCopyRegions[i].size));
+}
 
-void CommandBuffer::CopyImage(uint32_t index, const base::ImageRef& srcImage, base::Image::Layout srcImageLayout, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const std::vector<base::Image::Copy>& copyRegions)
+void CommandBuffer::CopyImage(uint32_t index, const base::ImageRef& srcImage, base::Image::Layout srcImageLayout, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const base::Image::Copy* pCopyRegions, uint32_t copyRegionCount)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
-	for (auto& copyRegion : copyRegions)
+	FlushBarriers(index);
+	for (uint32_t j = 0; j < copyRegionCount; j++)
 	{
+		const base::Image::Copy& copyRegion = pCopyRegions[j];
+
 		D3D12_TEXTURE_COPY_LOCATION dst;
 		dst.pResource = ref_cast<Image>(dstImage)->m_Image;
 		dst.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
@@ -1121,13 +1688,16 @@ void CommandBuffer::CopyImage(uint32_t index, const base::ImageRef& srcImage, ba
 	}
 };
 
-void CommandBuffer::CopyBufferToImage(uint32_t index, const base::BufferRef& srcBuffer, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const std::vector<base::Image::BufferImageCopy>& regions)
+void CommandBuffer::CopyBufferToImage(uint32_t index, const base::BufferRef& srcBuffer, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const base::Image::BufferImageCopy* pRegions, uint32_t regionCount)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
-	for (auto& region : regions)
+	FlushBarriers(index);
+	for (uint32_t j = 0; j < regionCount; j++)
 	{
+		const base::Image::BufferImageCopy& region = pRegions[j];
+
 		D3D12_TEXTURE_COPY_LOCATION src;
 		src.pResource = ref_cast<Buffer>(srcBuffer)->m_Buffer;
 		src.Type = D3D12_TEXTURE_COPY_TYPE_PLACED_FOOTPRINT;
@@ -1146,7 +1716,7 @@ void CommandBuffer::CopyBufferToImage(uint32_t index, const base::BufferRef& src
 		for (uint32_t i = 0; i < region.imageSubresource.arrayLayerCount; i++)
 		{
 			UINT SubresourceIndex = Image::D3D12CalculateSubresource(region.imageSubresource.mipLevel, i + region.imageSubresource.baseArrayLayer, 0, dstResDesc.MipLevels, dstResDesc.DepthOrArraySize);
-			m_Device->GetCopyableFootprints(&dstResDesc, SubresourceIndex, 1, region.bufferOffset, &Layout, &NumRows, &RowSizesInBytes, &RequiredSize);
+			m_Device->GetCopyableFootprints(&dstResDesc, SubresourceIndex, 1, srcBuffer->GetOffset() + region.bufferOffset, &Layout, &NumRows, &RowSizesInBytes, &RequiredSize);
 			src.PlacedFootprint = Layout;
 			dst.SubresourceIndex = SubresourceIndex;
 
@@ -1155,13 +1725,16 @@ void CommandBuffer::CopyBufferToImage(uint32_t index, const base::BufferRef& src
 	}	
 }
 
-void CommandBuffer::CopyImageToBuffer(uint32_t index, const base::ImageRef& srcImage, const base::BufferRef& dstBuffer, base::Image::Layout srcImageLayout, const std::vector<base::Image::BufferImageCopy>& regions)
+void CommandBuffer::CopyImageToBuffer(uint32_t index, const base::ImageRef& srcImage, const base::BufferRef& dstBuffer, base::Image::Layout srcImageLayout, const base::Image::BufferImageCopy* pRegions, uint32_t regionCount)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
-	for (auto& region : regions)
+	FlushBarriers(index);
+	for (uint32_t j = 0; j < regionCount; j++)
 	{
+		const base::Image::BufferImageCopy& region = pRegions[j];
+
 		D3D12_TEXTURE_COPY_LOCATION src;
 		src.pResource = ref_cast<Image>(srcImage)->m_Image;
 		src.Type = D3D12_TEXTURE_COPY_TYPE_SUBRESOURCE_INDEX;
@@ -1180,7 +1753,7 @@ void CommandBuffer::CopyImageToBuffer(uint32_t index, const base::ImageRef& srcI
 		for (uint32_t i = 0; i < region.imageSubresource.arrayLayerCount; i++)
 		{
 			UINT SubresourceIndex = Image::D3D12CalculateSubresource(region.imageSubresource.mipLevel, i + region.imageSubresource.baseArrayLayer, 0, srcResDesc.MipLevels, srcResDesc.DepthOrArraySize);
-			m_Device->GetCopyableFootprints(&srcResDesc, SubresourceIndex, 1, region.bufferOffset, &Layout, &NumRows, &RowSizesInBytes, &RequiredSize);
+			m_Device->GetCopyableFootprints(&srcResDesc, SubresourceIndex, 1, dstBuffer->GetOffset() + region.bufferOffset, &Layout, &NumRows, &RowSizesInBytes, &RequiredSize);
 			src.SubresourceIndex = SubresourceIndex;
 			dst.PlacedFootprint = Layout;
 
@@ -1189,18 +1762,21 @@ void CommandBuffer::CopyImageToBuffer(uint32_t index, const base::ImageRef& srcI
 	}
 }
 
-void CommandBuffer::ResolveImage(uint32_t index, const base::ImageRef& srcImage, Image::Layout srcImageLayout, const base::ImageRef& dstImage, Image::Layout dstImageLayout, const std::vector<base::Image::Resolve>& resolveRegions)
+void CommandBuffer::ResolveImage(uint32_t index, const base::ImageRef& srcImage, Image::Layout srcImageLayout, const base::ImageRef& dstImage, Image::Layout dstImageLayout, const base::Image::Resolve* pResolveRegions, uint32_t resolveRegionCount)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 
 	const bool& useBarrier2 = arc::BitwiseCheck(m_CI.commandPool->GetCreateInfo().context->GetResultInfo().activeExtensions, base::Context::ExtensionsBit::SYNCHRONISATION_2);
 
 	Barrier::CreateInfo bCI;
 	Barrier2::CreateInfo b2CI;
-	for (auto& resolveRegion : resolveRegions)
+	for (uint32_t j = 0; j < resolveRegionCount; j++)
 	{
+		const base::Image::Resolve& resolveRegion = pResolveRegions[j];
+
 		if (useBarrier2)
 		{
 			b2CI.type = Barrier::Type::IMAGE;
@@ -1227,6 +1803,7 @@ void CommandBuffer::ResolveImage(uint32_t index, const base::ImageRef& srcImage,
 			base::Barrier2Ref preResolveBarrierDst = Barrier2::Create(&b2CI);
 
 			PipelineBarrier2(index, { base::DependencyBit::NONE_BIT, { preResolveBarrierSrc, preResolveBarrierDst } });
+			FlushBarriers(index); //Recorded before the resolve, even if barriers are deferred.
 		}
 		else
 		{
@@ -1308,6 +1885,7 @@ void CommandBuffer::ResolveImage(uint32_t index, const base::ImageRef& srcImage,
 			base::Barrier2Ref postResolveBarrierDst = Barrier2::Create(&b2CI);
 			
 			PipelineBarrier2(index, { base::DependencyBit::NONE_BIT, { postResolveBarrierSrc, postResolveBarrierDst } });
+			FlushBarriers(index); //Recorded before any following DiscardResource(), even if barriers are deferred.
 		}
 		else
 		{
@@ -1328,30 +1906,46 @@ void CommandBuffer::ResolveImage(uint32_t index, const base::ImageRef& srcImage,
 	}
 }
 
-void CommandBuffer::SetViewport(uint32_t index, const std::vector<base::Viewport>& viewports)
+void CommandBuffer::SetViewport(uint32_t index, const base::Viewport* pViewports, uint32_t viewportCount)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
-	std::vector<D3D12_VIEWPORT> d3d12Viewports;
-	d3d12Viewports.reserve(viewports.size());
-	for (auto& viewport : viewports)
-		d3d12Viewports.push_back({ viewport.x, viewport.y, viewport.width, viewport.height, viewport.minDepth, viewport.maxDepth });
+	MIRU_FATAL(m_CI.level == Level::SECONDARY, "ERROR: D3D12: Viewports can not be set in secondary CommandBuffers.");
+	if (FilterViewports(index, pViewports, viewportCount))
+		return;
+
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
 
-	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->RSSetViewports(static_cast<UINT>(d3d12Viewports.size()), d3d12Viewports.data());
+	D3D12_VIEWPORT* d3d12Viewports = m_Scratch[index].Allocate<D3D12_VIEWPORT>(viewportCount);
+	for (uint32_t i = 0; i < viewportCount; i++)
+	{
+		const base::Viewport& viewport = pViewports[i];
+		d3d12Viewports[i] = { viewport.x, viewport.y, viewport.width, viewport.height, viewport.minDepth, viewport.maxDepth };
+	}
+
+	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->RSSetViewports(viewportCount, d3d12Viewports);
 }
 
-void CommandBuffer::SetScissor(uint32_t index, const std::vector<base::Rect2D>& scissors)
+void CommandBuffer::SetScissor(uint32_t index, const base::Rect2D* pScissors, uint32_t scissorCount)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
-	std::vector<D3D12_RECT> d3d12Scissors;
-	d3d12Scissors.reserve(scissors.size());
-	for (auto& scissor : scissors)
-		d3d12Scissors.push_back({ static_cast<LONG>(scissor.offset.x), static_cast<LONG>(scissor.offset.y), static_cast<LONG>(scissor.extent.width), static_cast<LONG>(scissor.extent.height) });
+	MIRU_FATAL(m_CI.level == Level::SECONDARY, "ERROR: D3D12: Scissors can not be set in secondary CommandBuffers.");
+	if (FilterScissors(index, pScissors, scissorCount))
+		return;
 
-	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->RSSetScissorRects(static_cast<UINT>(d3d12Scissors.size()), d3d12Scissors.data());
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+
+	D3D12_RECT* d3d12Scissors = m_Scratch[index].Allocate<D3D12_RECT>(scissorCount);
+	for (uint32_t i = 0; i < scissorCount; i++)
+	{
+		const base::Rect2D& scissor = pScissors[i];
+		d3d12Scissors[i] = { static_cast<LONG>(scissor.offset.x), static_cast<LONG>(scissor.offset.y), static_cast<LONG>(scissor.extent.width), static_cast<LONG>(scissor.extent.height) };
+	}
+
+	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->RSSetScissorRects(scissorCount, d3d12Scissors);
 }
 
 void CommandBuffer::ResolvePreviousSubpassAttachments(uint32_t index)
@@ -1394,10 +1988,103 @@ void CommandBuffer::ResolvePreviousSubpassAttachments(uint32_t index)
 		resolveRegion.dstOffset = { 0, 0, 0 };
 		resolveRegion.extent = { colourImageCI.width, colourImageCI.height, colourImageCI.depth};
 
-		ResolveImage(index, colourImage, m_RenderPassAttachementImageLayouts[colourImage], resolveImage, m_RenderPassAttachementImageLayouts[resolveImage], { resolveRegion });
+		ResolveImage(index, colourImage, m_RenderPassAttachementImageLayouts[colourImage], resolveImage, m_RenderPassAttachementImageLayouts[resolveImage], &resolveRegion, 1);
+	}
+}
+
+void CommandBuffer::ResetQueryPool(uint32_t index, const base::QueryPoolRef& queryPool, uint32_t firstQuery, uint32_t queryCount)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+
+	//Query heaps need no reset. Clear the availability values, so that GetResults() does not return the previous results.
+	QueryPool* pool = static_cast<QueryPool*>(queryPool.get());
+	const D3D12_GPU_VIRTUAL_ADDRESS& availabilityAddress = pool->m_ReadbackBuffer->GetGPUVirtualAddress() + pool->m_AvailabilityOffset;
+
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+	D3D12_WRITEBUFFERIMMEDIATE_PARAMETER* params = m_Scratch[index].Allocate<D3D12_WRITEBUFFERIMMEDIATE_PARAMETER>(queryCount);
+	for (uint32_t i = 0; i < queryCount; i++)
+		params[i] = { availabilityAddress + sizeof(uint32_t) * (firstQuery + i), 0 };
+
+	reinterpret_cast<ID3D12GraphicsCommandList2*>(m_CmdBuffers[index])->WriteBufferImmediate(queryCount, params, nullptr);
+}
+
+void CommandBuffer::BeginQuery(uint32_t index, const base::QueryPoolRef& queryPool, uint32_t query, bool precise)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+
+	QueryPool* pool = static_cast<QueryPool*>(queryPool.get());
+	if (pool->GetCreateInfo().type == QueryPool::Type::OCCLUSION)
+		pool->m_QueryTypes[query] = precise ? D3D12_QUERY_TYPE_OCCLUSION : D3D12_QUERY_TYPE_BINARY_OCCLUSION;
+
+	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->BeginQuery(pool->m_QueryHeap, pool->m_QueryTypes[query], query);
+}
+
+void CommandBuffer::EndQuery(uint32_t index, const base::QueryPoolRef& queryPool, uint32_t query)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+
+	QueryPool* pool = static_cast<QueryPool*>(queryPool.get());
+	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->EndQuery(pool->m_QueryHeap, pool->m_QueryTypes[query], query);
+	ResolveQuery(index, pool, query);
+}
+
+void CommandBuffer::WriteTimestamp(uint32_t index, base::PipelineStageBit stage, const base::QueryPoolRef& queryPool, uint32_t query)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+
+	QueryPool* pool = static_cast<QueryPool*>(queryPool.get());
+	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->EndQuery(pool->m_QueryHeap, D3D12_QUERY_TYPE_TIMESTAMP, query);
+	ResolveQuery(index, pool, query);
+}
+
+void CommandBuffer::CopyQueryPoolResults(uint32_t index, const base::QueryPoolRef& queryPool, uint32_t firstQuery, uint32_t queryCount, const base::BufferRef& dstBuffer, uint64_t dstOffset)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+
+	//Resolve each run of queries of the same D3D12_QUERY_TYPE.
+	QueryPool* pool = static_cast<QueryPool*>(queryPool.get());
+	ID3D12Resource* buffer = static_cast<const Buffer*>(dstBuffer.get())->m_Buffer;
+	const uint64_t& bufferOffset = dstBuffer->GetOffset() + dstOffset;
+	uint32_t first = firstQuery;
+	for (uint32_t query = firstQuery + 1; query <= firstQuery + queryCount; query++)
+	{
+		if (query < firstQuery + queryCount && pool->m_QueryTypes[query] == pool->m_QueryTypes[first])
+			continue;
+
+		reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->ResolveQueryData(pool->m_QueryHeap, pool->m_QueryTypes[first], first, query - first,
+			buffer, bufferOffset + static_cast<uint64_t>(pool->GetResultSize()) * (first - firstQuery));
+		first = query;
 	}
 }
 
+void CommandBuffer::ResolveQuery(uint32_t index, QueryPool* queryPool, uint32_t query)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	//Resolve into the readback buffer, then mark the query available once the resolve has completed.
+	reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index])->ResolveQueryData(queryPool->m_QueryHeap, queryPool->m_QueryTypes[query], query, 1,
+		queryPool->m_ReadbackBuffer, static_cast<uint64_t>(queryPool->GetResultSize()) * query);
+
+	D3D12_WRITEBUFFERIMMEDIATE_PARAMETER param = { queryPool->m_ReadbackBuffer->GetGPUVirtualAddress() + queryPool->m_AvailabilityOffset + sizeof(uint32_t) * query, 1 };
+	D3D12_WRITEBUFFERIMMEDIATE_MODE mode = D3D12_WRITEBUFFERIMMEDIATE_MODE_MARKER_OUT;
+	reinterpret_cast<ID3D12GraphicsCommandList2*>(m_CmdBuffers[index])->WriteBufferImmediate(1, &param, &mode);
+}
+
 void CommandBuffer::BeginDebugLabel(uint32_t index, const std::string& label, std::array<float, 4> rgba)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
@@ -1408,6 +2095,8 @@ void CommandBuffer::BeginDebugLabel(uint32_t index, const std::string& label, st
 	BYTE b = static_cast<BYTE>(std::clamp(static_cast<float>(0xFF) * rgba[2], 0.0f, 255.0f));
 	if (PIXBeginEventOnCommandList)
 		PIXBeginEventOnCommandList(reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index]), PIX_COLOR(r, g, b), label.c_str());
+	if (m_GpuProfiler)
+		m_GpuProfiler->BeginScope(this, index, label);
 }
 
 void CommandBuffer::EndDebugLabel(uint32_t index)
@@ -1415,6 +2104,118 @@ void CommandBuffer::EndDebugLabel(uint32_t index)
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	if (m_GpuProfiler)
+		m_GpuProfiler->EndScope(this, index);
 	if (PIXEndEventOnCommandList)
 		PIXEndEventOnCommandList(reinterpret_cast<ID3D12GraphicsCommandList*>(m_CmdBuffers[index]));
+}
+
+//SubmissionQueue
+SubmissionQueue::SubmissionQueue(SubmissionQueue::CreateInfo* pCreateInfo)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_CI = *pCreateInfo;
+	m_Queue = ref_cast<CommandPool>(m_CI.commandPool)->m_Queue;
+}
+
+SubmissionQueue::~SubmissionQueue()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	MIRU_WARN(m_BatchCount > 0, "WARN: D3D12: SubmissionQueue destroyed with pending batches that were not flushed.");
+}
+
+void SubmissionQueue::Add(const base::CommandBufferRef& commandBuffer, const std::vector<base::CommandBuffer::SubmitInfo2>& submitInfo2s)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	const CommandBufferRef& cmdBuffer = ref_cast<CommandBuffer>(commandBuffer);
+	const CommandPoolRef& pool = ref_cast<CommandPool>(cmdBuffer->GetCreateInfo().commandPool);
+	MIRU_FATAL(pool->m_Queue != m_Queue, "ERROR: D3D12: The CommandBuffer's CommandPool does not submit to the queue of the SubmissionQueue.");
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_CommandBuffers.push_back(commandBuffer);
+
+	for (const auto& submitInfo2 : submitInfo2s)
+	{
+		const bool& merge = m_BatchCount > 0 && submitInfo2.waitSemaphoreInfos.empty() && m_Batches[m_BatchCount - 1].signals.empty();
+		if (!merge)
+		{
+			if (m_BatchCount == m_Batches.size())
+				m_Batches.push_back({});
+			m_BatchCount++;
+		}
+		Batch& batch = m_Batches[m_BatchCount - 1];
+
+		for (const auto& waitSemaphoreInfo : submitInfo2.waitSemaphoreInfos)
+		{
+			const SemaphoreRef& wait = ref_cast<Semaphore>(waitSemaphoreInfo.semaphore);
+			uint64_t value = 0;
+			if (wait->GetCreateInfo().type == Semaphore::Type::TIMELINE)
+			{
+				value = waitSemaphoreInfo.value;
+			}
+			else
+			{
+				value = wait->GetValue();
+			}
+			batch.waits.push_back({ wait->m_Semaphore, value });
+		}
+
+		for (const auto& commandBufferInfo : submitInfo2.commandBufferInfos)
+		{
+			if (commandBufferInfo.index < cmdBuffer->GetCreateInfo().commandBufferCount)
+				batch.commandLists.push_back(cmdBuffer->m_CmdBuffers[commandBufferInfo.index]);
+			CommitResourceStates(commandBuffer, commandBufferInfo.index);
+		}
+
+		for (const auto& signalSemaphoreInfo : submitInfo2.signalSemaphoreInfos)
+		{
+			const SemaphoreRef& signal = ref_cast<Semaphore>(signalSemaphoreInfo.semaphore);
+			uint64_t value = 0;
+			if (signal->GetCreateInfo().type == Semaphore::Type::TIMELINE)
+			{
+				value = signalSemaphoreInfo.value;
+			}
+			else
+			{
+				signal->GetValue()++;
+				value = signal->GetValue();
+			}
+			batch.signals.push_back({ signal->m_Semaphore, value });
+		}
+	}
+}
+
+void SubmissionQueue::Flush(const base::FenceRef& fence)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	for (size_t i = 0; i < m_BatchCount; i++)
+	{
+		Batch& batch = m_Batches[i];
+
+		for (const auto& wait : batch.waits)
+			MIRU_FATAL(m_Queue->Wait(wait.first, wait.second), "ERROR: D3D12: Failed to Wait on the wait Semaphore.");
+
+		if (!batch.commandLists.empty())
+			m_Queue->ExecuteCommandLists(static_cast<uint32_t>(batch.commandLists.size()), batch.commandLists.data());
+
+		for (const auto& signal : batch.signals)
+			MIRU_FATAL(m_Queue->Signal(signal.first, signal.second), "ERROR: D3D12: Failed to Signal the signal Semaphore.");
+
+		batch.waits.clear();
+		batch.commandLists.clear();
+		batch.signals.clear();
+	}
+	m_BatchCount = 0;
+	m_CommandBuffers.clear();
+
+	if (fence)
+	{
+		ref_cast<Fence>(fence)->GetValue()++;
+		MIRU_FATAL(m_Queue->Signal(ref_cast<Fence>(fence)->m_Fence, ref_cast<Fence>(fence)->GetValue()), "ERROR: D3D12: Failed to Signal the draw Fence.");
+	}
 }
\ No newline at end of file
@@ -15,6 +15,8 @@ namespace d3d12
 
 		void Trim() override;
 		void Reset(bool releaseResources) override;
+		bool GetCalibratedTimestamps(uint64_t& gpuTimestamp, uint64_t& cpuTimestamp) override;
+		uint32_t GetQueueFamilyIndex() override { return base::Barrier::QueueFamilyIgnored; }
 
 		uint32_t GetCommandQueueIndex(const CommandPool::QueueType& type);
 
@@ -33,6 +35,7 @@ namespace d3d12
 		~CommandBuffer();
 
 		void Begin(uint32_t index, UsageBit usage) override;
+		void Begin(uint32_t index, UsageBit usage, const InheritanceInfo& inheritanceInfo) override;
 		void End(uint32_t index) override;
 		void Reset(uint32_t index, bool releaseResources) override;
 		void ExecuteSecondaryCommandBuffers(uint32_t index, const base::CommandBufferRef& commandBuffer, const std::vector<uint32_t>& secondaryCommandBufferIndices) override;
@@ -42,15 +45,19 @@ namespace d3d12
 		void SetEvent(uint32_t index, const base::EventRef& event, base::PipelineStageBit pipelineStage) override;
 		void ResetEvent(uint32_t index, const base::EventRef& event, base::PipelineStageBit pipelineStage) override;
 		void WaitEvents(uint32_t, const std::vector<base::EventRef>& events, base::PipelineStageBit srcStage, base::PipelineStageBit dstStage, const std::vector<base::BarrierRef>& barriers) override;
+		void WaitEvents(uint32_t index, const base::EventRef* pEvents, uint32_t eventCount, base::PipelineStageBit srcStage, base::PipelineStageBit dstStage, const base::BarrierHandle* pBarriers, uint32_t barrierCount) override;
 		void PipelineBarrier(uint32_t index, base::PipelineStageBit srcStage, base::PipelineStageBit dstStage, base::DependencyBit dependencies, const std::vector<base::BarrierRef>& barriers) override;
 		void PipelineBarrier2(uint32_t index, const base::CommandBuffer::DependencyInfo& dependencyInfo) override;
+		void PipelineBarrier(uint32_t index, base::PipelineStageBit srcStage, base::PipelineStageBit dstStage, base::DependencyBit dependencies, const base::BarrierHandle* pBarriers, uint32_t barrierCount) override;
+		void PipelineBarrier2(uint32_t index, base::DependencyBit dependencies, const base::Barrier2Handle* pBarriers, uint32_t barrierCount) override;
+		void FlushBarriers(uint32_t index) override;
 
-		void ClearColourImage(uint32_t index, const base::ImageRef& image, base::Image::Layout layout, const base::Image::ClearColourValue& clear, const std::vector<base::Image::SubresourceRange>& subresourceRanges) override;
-		void ClearDepthStencilImage(uint32_t index, const base::ImageRef& image, base::Image::Layout layout, const base::Image::ClearDepthStencilValue& clear, const std::vector<base::Image::SubresourceRange>& subresourceRanges) override;
+		void ClearColourImage(uint32_t index, const base::ImageRef& image, base::Image::Layout layout, const base::Image::ClearColourValue& clear, const base::Image::SubresourceRange* pSubresourceRanges, uint32_t subresourceRangeCount) override;
+		void ClearDepthStencilImage(uint32_t index, const base::ImageRef& image, base::Image::Layout layout, const base::Image::ClearDepthStencilValue& clear, const base::Image::SubresourceRange* pSubresourceRanges, uint32_t subresourceRangeCount) override;
 
-		void BeginRenderPass(uint32_t index, const base::FramebufferRef& framebuffer, const std::vector<base::Image::ClearValue>& clearValues) override;
+		void BeginRenderPass(uint32_t index, const base::FramebufferRef& framebuffer, const base::Image::ClearValue* pClearValues, uint32_t clearValueCount, SubpassContents contents = SubpassContents::INLINE) override;
 		void EndRenderPass(uint32_t index) override;
-		void NextSubpass(uint32_t index) override;
+		void NextSubpass(uint32_t index, SubpassContents contents = SubpassContents::INLINE) override;
 
 		void BeginRendering(uint32_t index, const base::RenderingInfo& renderingInfo) override;
 		void EndRendering(uint32_t index) override;
@@ -59,8 +66,13 @@ namespace d3d12
 
 		void BindVertexBuffers(uint32_t index, const std::vector<base::BufferViewRef>& vertexBufferViews) override;
 		void BindIndexBuffer(uint32_t index, const base::BufferViewRef& indexBufferView) override;
+		void BindVertexBuffers(uint32_t index, const base::BufferViewHandle* pVertexBufferViews, uint32_t vertexBufferViewCount) override;
+		void BindIndexBuffer(uint32_t index, const base::BufferViewHandle& indexBufferView) override;
 
-		void BindDescriptorSets(uint32_t index, const std::vector<base::DescriptorSetRef>& descriptorSets, uint32_t firstSet, const base::PipelineRef& pipeline) override;
+		void BindDescriptorSets(uint32_t index, const std::vector<base::DescriptorSetRef>& descriptorSets, uint32_t firstSet, const base::PipelineRef& pipeline, const std::vector<uint32_t>& dynamicOffsets = {}) override;
+		void BindDescriptorSets(uint32_t index, const base::DescriptorSetHandle* pDescriptorSets, uint32_t descriptorSetCount, uint32_t firstSet, const base::PipelineRef& pipeline, const uint32_t* pDynamicOffsets = nullptr, uint32_t dynamicOffsetCount = 0) override;
+
+		void PushConstants(uint32_t index, const base::PipelineRef& pipeline, base::Shader::StageBit stages, uint32_t offset, uint32_t size, const void* pValues) override;
 
 		void DrawIndexed(uint32_t index, uint32_t indexCount, uint32_t instanceCount = 1, uint32_t firstIndex = 0, int32_t vertexOffset = 0, uint32_t firstInstance = 0) override;
 		void Draw(uint32_t index, uint32_t vertexCount, uint32_t instanceCount = 1, uint32_t firstVertex = 0, uint32_t firstInstance = 0) override;
@@ -68,24 +80,44 @@ namespace d3d12
 
 		void Dispatch(uint32_t index, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) override;
 
-		void BuildAccelerationStructure(uint32_t index, const std::vector<base::AccelerationStructureBuildInfoRef>& buildGeometryInfos, const std::vector<std::vector<base::AccelerationStructureBuildInfo::BuildRangeInfo>>& buildRangeInfos) override;
+		void DrawIndirect(uint32_t index, const base::BufferRef& buffer, uint64_t offset, uint32_t drawCount, uint32_t stride = sizeof(DrawIndirectCommand)) override;
+		void DrawIndexedIndirect(uint32_t index, const base::BufferRef& buffer, uint64_t offset, uint32_t drawCount, uint32_t stride = sizeof(DrawIndexedIndirectCommand)) override;
+		void DrawIndirectCount(uint32_t index, const base::BufferRef& buffer, uint64_t offset, const base::BufferRef& countBuffer, uint64_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride = sizeof(DrawIndirectCommand)) override;
+		void DrawIndexedIndirectCount(uint32_t index, const base::BufferRef& buffer, uint64_t offset, const base::BufferRef& countBuffer, uint64_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride = sizeof(DrawIndexedIndirectCommand)) override;
+		void DrawMeshTasksIndirect(uint32_t index, const base::BufferRef& buffer, uint64_t offset, uint32_t drawCount, uint32_t stride = sizeof(DrawMeshTasksIndirectCommand)) override;
+		void DrawMeshTasksIndirectCount(uint32_t index, const base::BufferRef& buffer, uint64_t offset, const base::BufferRef& countBuffer, uint64_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride = sizeof(DrawMeshTasksIndirectCommand)) override;
+		void DispatchIndirect(uint32_t index, const base::BufferRef& buffer, uint64_t offset) override;
+
+		void BuildAccelerationStructure(uint32_t index, const base::AccelerationStructureBuildInfoRef* pBuildGeometryInfos, uint32_t buildGeometryInfoCount, const base::AccelerationStructureBuildInfo::BuildRangeInfo* const* ppBuildRangeInfos) override;
 		void TraceRays(uint32_t index, const base::StridedDeviceAddressRegion* pRaygenShaderBindingTable, const base::StridedDeviceAddressRegion* pMissShaderBindingTable, const base::StridedDeviceAddressRegion* pHitShaderBindingTable, const base::StridedDeviceAddressRegion* pCallableShaderBindingTable, uint32_t width, uint32_t height, uint32_t depth) override;
 
-		void CopyBuffer(uint32_t index, const base::BufferRef& srcBuffer, const base::BufferRef& dstBuffer, const std::vector<base::Buffer::Copy>& copyRegions) override;
-		void CopyImage(uint32_t index, const base::ImageRef& srcImage, base::Image::Layout srcImageLayout, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const std::vector<base::Image::Copy>& copyRegions) override;
-		void CopyBufferToImage(uint32_t index, const base::BufferRef& srcBuffer, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const std::vector<base::Image::BufferImageCopy>& regions) override;
-		void CopyImageToBuffer(uint32_t index, const base::ImageRef& srcImage, const base::BufferRef& dstBuffer, base::Image::Layout srcImageLayout, const std::vector<base::Image::BufferImageCopy>& regions) override;
+		void CopyBuffer(uint32_t index, const base::BufferRef& srcBuffer, const base::BufferRef& dstBuffer, const base::Buffer::Copy* pCopyRegions, uint32_t copyRegionCount) override;
+		void CopyImage(uint32_t index, const base::ImageRef& srcImage, base::Image::Layout srcImageLayout, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const base::Image::Copy* pCopyRegions, uint32_t copyRegionCount) override;
+		void CopyBufferToImage(uint32_t index, const base::BufferRef& srcBuffer, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const base::Image::BufferImageCopy* pRegions, uint32_t regionCount) override;
+		void CopyImageToBuffer(uint32_t index, const base::ImageRef& srcImage, const base::BufferRef& dstBuffer, base::Image::Layout srcImageLayout, const base::Image::BufferImageCopy* pRegions, uint32_t regionCount) override;
+
+		void ResolveImage(uint32_t index, const base::ImageRef& srcImage, base::Image::Layout srcImageLayout, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const base::Image::Resolve* pResolveRegions, uint32_t resolveRegionCount) override;
 
-		void ResolveImage(uint32_t index, const base::ImageRef& srcImage, base::Image::Layout srcImageLayout, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const std::vector<base::Image::Resolve>& resolveRegions) override;
+		void ResetQueryPool(uint32_t index, const base::QueryPoolRef& queryPool, uint32_t firstQuery, uint32_t queryCount) override;
+		void BeginQuery(uint32_t index, const base::QueryPoolRef& queryPool, uint32_t query, bool precise = false) override;
+		void EndQuery(uint32_t index, const base::QueryPoolRef& queryPool, uint32_t query) override;
+		void WriteTimestamp(uint32_t index, base::PipelineStageBit stage, const base::QueryPoolRef& queryPool, uint32_t query) override;
+		void CopyQueryPoolResults(uint32_t index, const base::QueryPoolRef& queryPool, uint32_t firstQuery, uint32_t queryCount, const base::BufferRef& dstBuffer, uint64_t dstOffset) override;
 
 		void BeginDebugLabel(uint32_t index, const std::string& label, std::array<float, 4> rgba = { 0.0f, 0.0f , 0.0f, 0.0f }) override;
 		void EndDebugLabel(uint32_t index) override;
 
-		void SetViewport(uint32_t index, const std::vector<base::Viewport>& viewports) override;
-		void SetScissor(uint32_t index, const std::vector<base::Rect2D>& scissors) override;
+		void SetViewport(uint32_t index, const base::Viewport* pViewports, uint32_t viewportCount) override;
+		void SetScissor(uint32_t index, const base::Rect2D* pScissors, uint32_t scissorCount) override;
 
 	private:
 		void ResolvePreviousSubpassAttachments(uint32_t index);
+		void RecordBarrierGroups(uint32_t index, Barrier2* const* ppBarriers, uint32_t barrierCount);
+		void SetDescriptorTables(uint32_t index, DescriptorSet* const* ppDescriptorSets, uint32_t descriptorSetCount, uint32_t firstSet, const base::PipelineRef& pipeline, const uint32_t* pDynamicOffsets, uint32_t dynamicOffsetCount);
+		void ExecuteIndirect(uint32_t index, D3D12_INDIRECT_ARGUMENT_TYPE type, uint32_t stride, uint32_t maxCommandCount, const base::BufferRef& argumentBuffer, uint64_t argumentBufferOffset, const base::BufferRef& countBuffer, uint64_t countBufferOffset);
+		void QueueBarrier(uint32_t index, const Barrier2* barrier);
+		void ResolveQuery(uint32_t index, QueryPool* queryPool, uint32_t query);
+		void ClearPendingBarriers(uint32_t index);
 
 		//Members
 	public:
@@ -133,6 +165,44 @@ namespace d3d12
 
 	private:
 		std::map<base::ImageRef, base::Image::Layout> m_RenderPassAttachementImageLayouts;
+
+		//Barriers queued by PipelineBarrier2() for CreateInfo::deferBarriers.
+		struct PendingBarriers
+		{
+			std::vector<D3D12_GLOBAL_BARRIER>	globalBarriers;
+			std::vector<D3D12_BUFFER_BARRIER>	bufferBarriers;
+			std::vector<D3D12_TEXTURE_BARRIER>	textureBarriers;
+		};
+		std::vector<PendingBarriers> m_PendingBarriers;
+	};
+
+	class SubmissionQueue final : public base::SubmissionQueue
+	{
+		//Methods
+	public:
+		SubmissionQueue(SubmissionQueue::CreateInfo* pCreateInfo);
+		~SubmissionQueue();
+
+		void Add(const base::CommandBufferRef& commandBuffer, const std::vector<base::CommandBuffer::SubmitInfo2>& submitInfo2s) override;
+		void Flush(const base::FenceRef& fence) override;
+
+		//Members
+	public:
+		ID3D12CommandQueue* m_Queue;
+
+	private:
+		//Semaphore values are resolved at Add(), so binary Semaphores keep their signal/wait pairing.
+		//Vectors are cleared rather than destroyed at Flush(), so that steady state batching does not allocate.
+		struct Batch
+		{
+			std::vector<std::pair<ID3D12Fence*, UINT64>>	waits;
+			std::vector<ID3D12CommandList*>					commandLists;
+			std::vector<std::pair<ID3D12Fence*, UINT64>>	signals;
+		};
+		std::vector<Batch> m_Batches;
+		size_t m_BatchCount = 0;
+		std::vector<base::CommandBufferRef> m_CommandBuffers;	//Kept alive until Flush().
+		std::mutex m_Mutex;
 	};
 }
 }
\ No newline at end of file
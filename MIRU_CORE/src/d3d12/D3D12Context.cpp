@@ -1,4 +1,5 @@
 #include "D3D12Context.h"
+#include "base/HandlePool.h"
 #include "D3D12Sync.h"
 #include "D3D12Shader.h"
 #include <sstream>
@@ -140,6 +141,8 @@ Context::~Context()
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
+	base::ClearHandlePools();
+
 	if (m_InfoQueue)
 		reinterpret_cast<ID3D12InfoQueue1*>(m_InfoQueue)->UnregisterMessageCallback(m_CallbackCookie);
 
@@ -151,6 +154,12 @@ Context::~Context()
 	for (auto& queue : m_Queues)
 		MIRU_D3D12_SAFE_RELEASE(queue);
 
+	for (auto& additionalQueue : m_AdditionalQueues)
+		MIRU_D3D12_SAFE_RELEASE(additionalQueue.second);
+
+	for (auto& commandSignature : m_CommandSignatures)
+		MIRU_D3D12_SAFE_RELEASE(commandSignature.second);
+
 	MIRU_D3D12_SAFE_RELEASE(m_Device);
 
 	for (auto& physicalDeviceInfo : m_PhysicalDevices.m_PDIs)
@@ -191,7 +200,14 @@ void Context::DeviceWaitIdle()
 	ci.signaled = false;
 	ci.timeout = UINT64_MAX; //In nanoseconds
 	
-	for (auto& queue : m_Queues)
+	std::vector<ID3D12CommandQueue*> queues = m_Queues;
+	{
+		std::lock_guard<std::mutex> lock(m_AdditionalQueuesMutex);
+		for (auto& additionalQueue : m_AdditionalQueues)
+			queues.push_back(additionalQueue.second);
+	}
+
+	for (auto& queue : queues)
 	{
 		fence = Fence::Create(&ci);
 
@@ -204,6 +220,52 @@ void Context::DeviceWaitIdle()
 	}
 }
 
+ID3D12CommandQueue* Context::GetQueue(uint32_t typeIndex, uint32_t queueIndex)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	if (queueIndex == 0)
+		return m_Queues[typeIndex];
+
+	std::lock_guard<std::mutex> lock(m_AdditionalQueuesMutex);
+
+	ID3D12CommandQueue*& queue = m_AdditionalQueues[{ typeIndex, queueIndex }];
+	if (queue)
+		return queue;
+
+	MIRU_FATAL(m_Device->CreateCommandQueue(&m_QueueDescs[typeIndex], IID_PPV_ARGS(&queue)), "ERROR: D3D12: Failed to create CommandQueue.");
+
+	std::string typeStr = typeIndex == 0 ? "Direct" : typeIndex == 1 ? "Compute" : typeIndex == 2 ? "Copy" : "";
+	D3D12SetName(queue, m_CI.deviceDebugName + ": Queue - " + typeStr + " " + std::to_string(queueIndex));
+
+	return queue;
+}
+
+ID3D12CommandSignature* Context::GetCommandSignature(D3D12_INDIRECT_ARGUMENT_TYPE type, UINT byteStride)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	std::lock_guard<std::mutex> lock(m_CommandSignaturesMutex);
+
+	ID3D12CommandSignature*& commandSignature = m_CommandSignatures[{ type, byteStride }];
+	if (commandSignature)
+		return commandSignature;
+
+	D3D12_INDIRECT_ARGUMENT_DESC argumentDesc = {};
+	argumentDesc.Type = type;
+
+	D3D12_COMMAND_SIGNATURE_DESC commandSignatureDesc;
+	commandSignatureDesc.ByteStride = byteStride;
+	commandSignatureDesc.NumArgumentDescs = 1;
+	commandSignatureDesc.pArgumentDescs = &argumentDesc;
+	commandSignatureDesc.NodeMask = 0;
+
+	MIRU_FATAL(m_Device->CreateCommandSignature(&commandSignatureDesc, nullptr, IID_PPV_ARGS(&commandSignature)), "ERROR: D3D12: Failed to create CommandSignature.");
+	D3D12SetName(commandSignature, "CommandSignature: " + std::to_string(type) + ": " + std::to_string(byteStride));
+
+	return commandSignature;
+}
+
 void Context::MessageCallbackFunction(D3D12_MESSAGE_CATEGORY Category, D3D12_MESSAGE_SEVERITY Severity, D3D12_MESSAGE_ID ID, LPCSTR pDescription, void* pContext)
 {
 	std::string category = std::string(magic_enum::enum_name<D3D12_MESSAGE_CATEGORY>(Category));
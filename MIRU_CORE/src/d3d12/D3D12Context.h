@@ -2,6 +2,7 @@
 #include "base/Context.h"
 #include "d3d12/D3D12_Include.h"
 #include <filesystem>
+#include <mutex>
 
 namespace miru
 {
@@ -94,6 +95,12 @@ namespace d3d12
 		void* GetDevice() override { return m_Device; }
 		void DeviceWaitIdle() override;
 
+		//Returns the queueIndex-th ID3D12CommandQueue of m_QueueDescs[typeIndex].Type. Queues beyond the first are created on first use.
+		ID3D12CommandQueue* GetQueue(uint32_t typeIndex, uint32_t queueIndex);
+
+		//Returns a cached ID3D12CommandSignature for ExecuteIndirect() with a single argument of the type.
+		ID3D12CommandSignature* GetCommandSignature(D3D12_INDIRECT_ARGUMENT_TYPE type, UINT byteStride);
+
 		static void MessageCallbackFunction(D3D12_MESSAGE_CATEGORY Category, D3D12_MESSAGE_SEVERITY Severity, D3D12_MESSAGE_ID ID, LPCSTR pDescription, void* pContext);
 
 		static std::string D3D12_MESSAGE_CATEGORY_ToString(D3D12_MESSAGE_CATEGORY Category);
@@ -118,9 +125,15 @@ namespace d3d12
 		//Queue
 		std::vector<ID3D12CommandQueue*> m_Queues;
 		std::vector<D3D12_COMMAND_QUEUE_DESC> m_QueueDescs;
+		std::map<std::pair<uint32_t, uint32_t>, ID3D12CommandQueue*> m_AdditionalQueues;
+		std::mutex m_AdditionalQueuesMutex;
 
 		//Features
 		Features m_Features;
+
+		//CommandSignatures
+		std::map<std::pair<D3D12_INDIRECT_ARGUMENT_TYPE, UINT>, ID3D12CommandSignature*> m_CommandSignatures;
+		std::mutex m_CommandSignaturesMutex;
 	};
 }
 }
\ No newline at end of file
@@ -274,10 +274,11 @@ DescriptorSet::DescriptorSet(DescriptorSet::CreateInfo* pCreateInfo)
 			}
 			else
 			{
+				//Array elements are consecutive in the heap.
 				m_DescCPUHandles[index][descBinding][D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV].ptr =
 					m_DescriptorHeaps[index][D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV]->GetCPUDescriptorHandleForHeapStart().ptr
 					+ binding_CBV_SRV_UAV * cbv_srv_uav_DescriptorSize;
-				binding_CBV_SRV_UAV++;
+				binding_CBV_SRV_UAV += std::max(descriptorSetLayoutBinding.descriptorCount, 1u);
 			}
 		}
 		index++;
@@ -306,9 +307,14 @@ void DescriptorSet::AddBuffer(uint32_t index, uint32_t bindingIndex, const std::
 	CHECK_VALID_INDEX_RETURN(index);
 
 	D3D12_CPU_DESCRIPTOR_HANDLE descriptorWriteLocation;
+	const UINT cbv_srv_uav_DescriptorSize = m_Device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	uint32_t arrayElement = desriptorArrayIndex;
 
 	for (auto& descriptorBufferInfo : descriptorBufferInfos)
 	{
+		D3D12_CPU_DESCRIPTOR_HANDLE elementLocation = m_DescCPUHandles[index][bindingIndex][D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV];
+		elementLocation.ptr += arrayElement * cbv_srv_uav_DescriptorSize;
+
 		base::DescriptorType descriptorType = base::DescriptorType(0);
 		for (auto& descriptorSetLayoutBinding : m_CI.descriptorSetLayouts[index]->GetCreateInfo().descriptorSetLayoutBinding)
 		{
@@ -322,7 +328,7 @@ void DescriptorSet::AddBuffer(uint32_t index, uint32_t bindingIndex, const std::
 		//CBV
 		if (descriptorType == base::DescriptorType::UNIFORM_BUFFER || descriptorType == base::DescriptorType::UNIFORM_TEXEL_BUFFER || descriptorType == base::DescriptorType::UNIFORM_BUFFER_DYNAMIC)
 		{
-			descriptorWriteLocation = m_DescCPUHandles[index][bindingIndex][D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV];
+			descriptorWriteLocation = elementLocation;
 
 			m_Device->CreateConstantBufferView(&ref_cast<BufferView>(descriptorBufferInfo.bufferView)->m_CBVDesc, descriptorWriteLocation);
 			ref_cast<BufferView>(descriptorBufferInfo.bufferView)->m_CBVDescHandle = descriptorWriteLocation;
@@ -330,7 +336,7 @@ void DescriptorSet::AddBuffer(uint32_t index, uint32_t bindingIndex, const std::
 		//SRV
 		if (descriptorType == base::DescriptorType::D3D12_STRUCTURED_BUFFER)
 		{
-			descriptorWriteLocation = m_DescCPUHandles[index][bindingIndex][D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV];
+			descriptorWriteLocation = elementLocation;
 			
 			m_Device->CreateShaderResourceView(ref_cast<Buffer>(ref_cast<BufferView>(descriptorBufferInfo.bufferView)->GetCreateInfo().buffer)->m_Buffer,
 				&ref_cast<BufferView>(descriptorBufferInfo.bufferView)->m_SRVDesc, descriptorWriteLocation);
@@ -339,12 +345,24 @@ void DescriptorSet::AddBuffer(uint32_t index, uint32_t bindingIndex, const std::
 		//UAV
 		if (descriptorType == base::DescriptorType::STORAGE_BUFFER || descriptorType == base::DescriptorType::STORAGE_TEXEL_BUFFER || descriptorType == base::DescriptorType::STORAGE_BUFFER_DYNAMIC)
 		{
-			descriptorWriteLocation = m_DescCPUHandles[index][bindingIndex][D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV];
+			descriptorWriteLocation = elementLocation;
 
 			m_Device->CreateUnorderedAccessView(ref_cast<Buffer>(ref_cast<BufferView>(descriptorBufferInfo.bufferView)->GetCreateInfo().buffer)->m_Buffer, nullptr,
 				&ref_cast<BufferView>(descriptorBufferInfo.bufferView)->m_UAVDesc, descriptorWriteLocation);
 			ref_cast<BufferView>(descriptorBufferInfo.bufferView)->m_UAVDescHandle = descriptorWriteLocation;
 		}
+		//Dynamic
+		if (descriptorType == base::DescriptorType::UNIFORM_BUFFER_DYNAMIC || descriptorType == base::DescriptorType::STORAGE_BUFFER_DYNAMIC)
+		{
+			DynamicDescriptor& dynamicDescriptor = m_DynamicDescriptors[index][{ bindingIndex, arrayElement }];
+			dynamicDescriptor.type = descriptorType;
+			dynamicDescriptor.heapOffset = static_cast<UINT>(descriptorWriteLocation.ptr - m_DescriptorHeaps[index][0]->GetCPUDescriptorHandleForHeapStart().ptr);
+			dynamicDescriptor.resource = ref_cast<Buffer>(ref_cast<BufferView>(descriptorBufferInfo.bufferView)->GetCreateInfo().buffer)->m_Buffer;
+			dynamicDescriptor.CBVDesc = ref_cast<BufferView>(descriptorBufferInfo.bufferView)->m_CBVDesc;
+			dynamicDescriptor.UAVDesc = ref_cast<BufferView>(descriptorBufferInfo.bufferView)->m_UAVDesc;
+		}
+
+		arrayElement++;
 	}
 }
 
@@ -62,6 +62,19 @@ namespace d3d12
 		//[index][binding][0] == HEAP_TYPE_CBV_SRV_UAV and [index][binding][1] == HEAP_TYPE_SAMPLER
 		//[index][binding][2] == HEAP_TYPE_RTV         and [index][binding][3] == HEAP_TYPE_DSV
 		std::map<uint32_t, std::map<uint32_t, std::array<D3D12_CPU_DESCRIPTOR_HANDLE, 4>>> m_DescCPUHandles;
+
+		//Descriptors of type UNIFORM_BUFFER_DYNAMIC and STORAGE_BUFFER_DYNAMIC, which are rewritten with the dynamic offsets
+		//when the DescriptorSet is bound. Per index per binding and array element, so iteration follows the order of the
+		//dynamic offsets.
+		struct DynamicDescriptor
+		{
+			base::DescriptorType				type;
+			UINT								heapOffset;	//Offset in bytes into the index's CBV_SRV_UAV descriptor heap.
+			ID3D12Resource*						resource;
+			D3D12_CONSTANT_BUFFER_VIEW_DESC		CBVDesc;
+			D3D12_UNORDERED_ACCESS_VIEW_DESC	UAVDesc;
+		};
+		std::map<uint32_t, std::map<std::pair<uint32_t, uint32_t>, DynamicDescriptor>> m_DynamicDescriptors;
 	};
 
 }
@@ -50,6 +50,18 @@ Image::Image(Image::CreateInfo* pCreateInfo)
 		return;
 	}
 
+	if (!m_CI.allocator)
+	{
+		//Created without memory. The resource is placed by an AliasingHeap.
+		m_InitialResourceState = ToD3D12ImageLayout(m_CI.layout);
+		m_ClearValue = clear;
+		m_UseClearValue = useClear;
+		m_Image = nullptr;
+		m_D3D12MAllocation = nullptr;
+		m_Allocation = {};
+		return;
+	}
+
 	D3D12_HEAP_TYPE heapType = ref_cast<Allocator>(m_CI.allocator)->GetHeapProperties().Type;
 	if (heapType == D3D12_HEAP_TYPE_DEFAULT)
 		m_InitialResourceState = ToD3D12ImageLayout(m_CI.layout);
@@ -59,10 +71,18 @@ Image::Image(Image::CreateInfo* pCreateInfo)
 	m_D3D12MAllocationDesc.Flags = D3D12MA::ALLOCATION_FLAG_NONE;
 	m_D3D12MAllocationDesc.HeapType = heapType;
 	m_D3D12MAllocationDesc.ExtraHeapFlags = D3D12_HEAP_FLAG_NONE;
-	m_D3D12MAllocationDesc.CustomPool = nullptr;
+	const bool& renderTargetOrDepthStencil = arc::BitwiseCheck(m_ResourceDesc.Flags, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET) || arc::BitwiseCheck(m_ResourceDesc.Flags, D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL);
+	m_D3D12MAllocationDesc.CustomPool = ref_cast<Allocator>(m_CI.allocator)->GetPool(renderTargetOrDepthStencil ? D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES : D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES);
 
 	D3D12MA::Allocator* allocator = reinterpret_cast<D3D12MA::Allocator*>(m_CI.allocator->GetNativeAllocator());
-	MIRU_FATAL(allocator->CreateResource(&m_D3D12MAllocationDesc, &m_ResourceDesc, m_InitialResourceState, useClear ? &clear : nullptr, &m_D3D12MAllocation, IID_PPV_ARGS(&m_Image)), "ERROR: D3D12: Failed to place Image.");
+	HRESULT result = allocator->CreateResource(&m_D3D12MAllocationDesc, &m_ResourceDesc, m_InitialResourceState, useClear ? &clear : nullptr, &m_D3D12MAllocation, IID_PPV_ARGS(&m_Image));
+	if (result == E_OUTOFMEMORY && m_D3D12MAllocationDesc.CustomPool && ref_cast<Allocator>(m_CI.allocator)->CanFallbackFromPool())
+	{
+		//The Image is larger than the pool's block size.
+		m_D3D12MAllocationDesc.CustomPool = nullptr;
+		result = allocator->CreateResource(&m_D3D12MAllocationDesc, &m_ResourceDesc, m_InitialResourceState, useClear ? &clear : nullptr, &m_D3D12MAllocation, IID_PPV_ARGS(&m_Image));
+	}
+	MIRU_FATAL(result, "ERROR: D3D12: Failed to place Image.");
 	D3D12SetName(m_Image, m_CI.debugName);
 
 	m_Allocation.nativeAllocation = (base::NativeAllocation)m_D3D12MAllocation;
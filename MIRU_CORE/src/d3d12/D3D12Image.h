@@ -31,6 +31,8 @@ namespace d3d12
 		ID3D12Resource* m_Image;
 		D3D12_RESOURCE_DESC m_ResourceDesc;
 		D3D12_RESOURCE_STATES m_InitialResourceState; 
+		D3D12_CLEAR_VALUE m_ClearValue = {};
+		bool m_UseClearValue = false;
 
 		D3D12MA::Allocation* m_D3D12MAllocation;
 		D3D12MA::ALLOCATION_DESC m_D3D12MAllocationDesc;
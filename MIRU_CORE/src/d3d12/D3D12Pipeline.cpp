@@ -762,15 +762,16 @@ Pipeline::RootSignature Pipeline::CreateRootSignature(const base::Pipeline::Pipe
 		set++;
 	}
 
-	for (auto& pushConstantRange : m_CI.layout.pushConstantRanges)
+	UINT pushConstantRegister = 0;
+	for (auto& pushConstantRange : layout.pushConstantRanges)
 	{
-		//TODO: Review this.
 		D3D12_ROOT_PARAMETER rootParameter;
 		rootParameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
-		rootParameter.Constants.ShaderRegister = 0;
-		rootParameter.Constants.RegisterSpace = 0;
-		rootParameter.Constants.Num32BitValues = pushConstantRange.size;
+		rootParameter.Constants.ShaderRegister = pushConstantRegister++;
+		rootParameter.Constants.RegisterSpace = base::Pipeline::PushConstantRegisterSpace;
+		rootParameter.Constants.Num32BitValues = (pushConstantRange.size + 3) / 4;
 		rootParameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+		result.pushConstantRootParameterIndices.push_back(static_cast<UINT>(result.rootParameters.size()));
 		result.rootParameters.push_back(rootParameter);
 	}
 
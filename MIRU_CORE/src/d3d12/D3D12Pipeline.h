@@ -31,6 +31,7 @@ namespace d3d12
 			std::vector<D3D12_ROOT_PARAMETER>					rootParameters;
 			std::vector<std::vector<D3D12_DESCRIPTOR_RANGE>>	descriptorRangesSRV_UAV_CBV;
 			std::vector<std::vector<D3D12_DESCRIPTOR_RANGE>>	descriptorRangesSampler;
+			std::vector<UINT>									pushConstantRootParameterIndices;	//One per PipelineLayout::pushConstantRanges.
 		};
 
 		struct PipelineStateStream
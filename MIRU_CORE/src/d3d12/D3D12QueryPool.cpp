@@ -0,0 +1,91 @@
+#include "D3D12QueryPool.h"
+#include "D3D12Context.h"
+
+using namespace miru;
+using namespace d3d12;
+
+static_assert(sizeof(base::QueryPool::PipelineStatistics) == sizeof(D3D12_QUERY_DATA_PIPELINE_STATISTICS), "base::QueryPool::PipelineStatistics must match D3D12_QUERY_DATA_PIPELINE_STATISTICS.");
+
+QueryPool::QueryPool(QueryPool::CreateInfo* pCreateInfo)
+	:m_Device(reinterpret_cast<ID3D12Device*>(pCreateInfo->context->GetDevice()))
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_CI = *pCreateInfo;
+
+	m_QueryHeapDesc.Type = m_CI.type == Type::TIMESTAMP ? D3D12_QUERY_HEAP_TYPE_TIMESTAMP : m_CI.type == Type::OCCLUSION ? D3D12_QUERY_HEAP_TYPE_OCCLUSION : D3D12_QUERY_HEAP_TYPE_PIPELINE_STATISTICS;
+	m_QueryHeapDesc.Count = m_CI.queryCount;
+	m_QueryHeapDesc.NodeMask = 0;
+	MIRU_FATAL(m_Device->CreateQueryHeap(&m_QueryHeapDesc, IID_PPV_ARGS(&m_QueryHeap)), "ERROR: D3D12: Failed to create QueryHeap.");
+	D3D12SetName(m_QueryHeap, m_CI.debugName + " : QueryHeap");
+
+	const D3D12_QUERY_TYPE& queryType = m_CI.type == Type::TIMESTAMP ? D3D12_QUERY_TYPE_TIMESTAMP : m_CI.type == Type::OCCLUSION ? D3D12_QUERY_TYPE_BINARY_OCCLUSION : D3D12_QUERY_TYPE_PIPELINE_STATISTICS;
+	m_QueryTypes.resize(m_CI.queryCount, queryType);
+
+	m_AvailabilityOffset = static_cast<uint64_t>(GetResultSize()) * m_CI.queryCount;
+
+	D3D12_HEAP_PROPERTIES heapProperties = {};
+	heapProperties.Type = D3D12_HEAP_TYPE_READBACK;
+	heapProperties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_UNKNOWN;
+	heapProperties.MemoryPoolPreference = D3D12_MEMORY_POOL_UNKNOWN;
+	heapProperties.CreationNodeMask = 0;
+	heapProperties.VisibleNodeMask = 0;
+
+	D3D12_RESOURCE_DESC resourceDesc = {};
+	resourceDesc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+	resourceDesc.Alignment = 0;
+	resourceDesc.Width = m_AvailabilityOffset + sizeof(uint32_t) * m_CI.queryCount;
+	resourceDesc.Height = 1;
+	resourceDesc.DepthOrArraySize = 1;
+	resourceDesc.MipLevels = 1;
+	resourceDesc.Format = DXGI_FORMAT_UNKNOWN;
+	resourceDesc.SampleDesc = { 1, 0 };
+	resourceDesc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+	resourceDesc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+	MIRU_FATAL(m_Device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc, D3D12_RESOURCE_STATE_COPY_DEST, nullptr, IID_PPV_ARGS(&m_ReadbackBuffer)), "ERROR: D3D12: Failed to create QueryPool readback buffer.");
+	D3D12SetName(m_ReadbackBuffer, m_CI.debugName + " : Readback Buffer");
+
+	//Readback buffers can stay mapped. The availability values are zero until the queries are written.
+	MIRU_FATAL(m_ReadbackBuffer->Map(0, nullptr, reinterpret_cast<void**>(&m_ReadbackData)), "ERROR: D3D12: Failed to map QueryPool readback buffer.");
+}
+
+QueryPool::~QueryPool()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	D3D12_RANGE writtenRange = { 0, 0 };
+	m_ReadbackBuffer->Unmap(0, &writtenRange);
+	MIRU_D3D12_SAFE_RELEASE(m_ReadbackBuffer);
+	MIRU_D3D12_SAFE_RELEASE(m_QueryHeap);
+}
+
+double QueryPool::GetTimestampPeriod()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	//All queues of the device tick at the same frequency as the direct queue.
+	UINT64 frequency = 0;
+	MIRU_FATAL(ref_cast<Context>(m_CI.context)->m_Queues[0]->GetTimestampFrequency(&frequency), "ERROR: D3D12: Failed to get timestamp frequency.");
+	return frequency ? 1e9 / static_cast<double>(frequency) : 0.0;
+}
+
+bool QueryPool::GetResults(uint32_t firstQuery, uint32_t queryCount, void* pResults, bool* pAvailable)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	const uint32_t* availabilities = reinterpret_cast<const uint32_t*>(m_ReadbackData + m_AvailabilityOffset);
+
+	bool allAvailable = true;
+	for (uint32_t i = 0; i < queryCount; i++)
+	{
+		const uint32_t& query = firstQuery + i;
+		const bool& available = availabilities[query] != 0;
+		if (available)
+			memcpy(reinterpret_cast<uint8_t*>(pResults) + GetResultSize() * i, m_ReadbackData + static_cast<size_t>(GetResultSize()) * query, GetResultSize());
+		if (pAvailable)
+			pAvailable[i] = available;
+		allAvailable &= available;
+	}
+	return allAvailable;
+}
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+#include "base/QueryPool.h"
+#include "d3d12/D3D12_Include.h"
+
+namespace miru
+{
+namespace d3d12
+{
+	//D3D12 has no query availability. Each EndQuery() resolves the query into a readback buffer and then writes its
+	//availability value there with a marker write, which GetResults() reads without blocking.
+	class QueryPool final : public base::QueryPool
+	{
+		//Methods
+	public:
+		QueryPool(QueryPool::CreateInfo* pCreateInfo);
+		~QueryPool();
+
+		double GetTimestampPeriod() override;
+		bool GetResults(uint32_t firstQuery, uint32_t queryCount, void* pResults, bool* pAvailable = nullptr) override;
+
+		//Members
+	public:
+		ID3D12Device* m_Device;
+
+		ID3D12QueryHeap* m_QueryHeap;
+		D3D12_QUERY_HEAP_DESC m_QueryHeapDesc;
+		std::vector<D3D12_QUERY_TYPE> m_QueryTypes;		//Per query, as Type::OCCLUSION queries are binary unless they are precise.
+
+		ID3D12Resource* m_ReadbackBuffer;
+		uint64_t m_AvailabilityOffset;					//Offset in bytes of the uint32_t availability values in the readback buffer.
+		uint8_t* m_ReadbackData;
+	};
+}
+}
\ No newline at end of file
@@ -1,15 +1,27 @@
 #pragma once
 #include "base/AccelerationStructure.h"
+#include "base/AliasingHeap.h"
 #include "base/Allocator.h"
 #include "base/Buffer.h"
+#include "base/BufferArena.h"
+#include "base/CommandBufferAllocator.h"
+#include "base/CommandBundle.h"
 #include "base/CommandPoolBuffer.h"
+#include "base/CommandStream.h"
 #include "base/Context.h"
 #include "base/DescriptorPoolSet.h"
 #include "base/Framebuffer.h"
+#include "base/GpuProfiler.h"
 #include "base/GraphicsAPI.h"
+#include "base/HandlePool.h"
 #include "base/Image.h"
+#include "base/ParallelRecorder.h"
 #include "base/Pipeline.h"
+#include "base/QueryPool.h"
+#include "base/ResourceStateTracker.h"
 #include "base/Shader.h"
 #include "base/ShaderBindingTable.h"
+#include "base/StagingManager.h"
 #include "base/Swapchain.h"
-#include "base/Sync.h"
\ No newline at end of file
+#include "base/Sync.h"
+#include "base/UploadRing.h"
\ No newline at end of file
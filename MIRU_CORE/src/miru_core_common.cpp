@@ -32,13 +32,7 @@ void Timer::Stop()
 		- std::chrono::time_point_cast<std::chrono::nanoseconds>(m_StartTP).time_since_epoch();
 	m_Stopped = true;
 
-	if (m_File.is_open())
-	{
-		for (uint32_t i = 0; i < m_ScopeCount; i++)
-			m_File << "\t";
-
-		m_File << "Scope " << m_ScopeCount << " : " << m_Name << " : " << duration.count() << "ns. (" << (double)duration.count() / 1e9 << "s" << ")\n";
-	}
+	WriteScope(m_ScopeCount, m_Name, duration.count(), std::chrono::time_point_cast<std::chrono::nanoseconds>(m_StartTP).time_since_epoch().count());
 }
 
 void Timer::BeginSession(const std::string& filepath)
@@ -54,4 +48,14 @@ void Timer::EndSession()
 	if (m_File.is_open())
 		m_File.close();
 }
+void Timer::WriteScope(uint64_t scopeNumber, const std::string& name, uint64_t duration, int64_t start)
+{
+	if (m_File.is_open())
+	{
+		for (uint64_t i = 0; i < scopeNumber; i++)
+			m_File << "\t";
+
+		m_File << "Scope " << scopeNumber << " : " << name << " : " << duration << "ns. (" << (double)duration / 1e9 << "s" << ") : Start " << start << "ns.\n";
+	}
+}
 #endif
\ No newline at end of file
@@ -79,6 +79,7 @@ namespace miru::base
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(BufferView);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(CommandPool);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(CommandBuffer);
+	MIRU_FORWARD_DECLARE_CLASS_AND_REF(SubmissionQueue);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Context);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(DescriptorPool);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(DescriptorSetLayout);
@@ -89,6 +90,7 @@ namespace miru::base
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Sampler);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(RenderPass);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Pipeline);
+	MIRU_FORWARD_DECLARE_CLASS_AND_REF(QueryPool);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Shader);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(ShaderBindingTable);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Swapchain);
@@ -97,6 +99,15 @@ namespace miru::base
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Event);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Barrier);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Barrier2);
+	MIRU_FORWARD_DECLARE_CLASS_AND_REF(UploadRing);
+	MIRU_FORWARD_DECLARE_CLASS_AND_REF(StagingManager);
+	MIRU_FORWARD_DECLARE_CLASS_AND_REF(AliasingHeap);
+	MIRU_FORWARD_DECLARE_CLASS_AND_REF(BufferArena);
+	MIRU_FORWARD_DECLARE_CLASS_AND_REF(ParallelRecorder);
+	MIRU_FORWARD_DECLARE_CLASS_AND_REF(CommandBufferAllocator);
+	MIRU_FORWARD_DECLARE_CLASS_AND_REF(CommandStream);
+	MIRU_FORWARD_DECLARE_CLASS_AND_REF(CommandBundle);
+	MIRU_FORWARD_DECLARE_CLASS_AND_REF(GpuProfiler);
 }
 namespace miru::d3d12
 {
@@ -107,6 +118,7 @@ namespace miru::d3d12
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(BufferView);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(CommandPool);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(CommandBuffer);
+	MIRU_FORWARD_DECLARE_CLASS_AND_REF(SubmissionQueue);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Context);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(DescriptorPool);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(DescriptorSetLayout);
@@ -117,6 +129,7 @@ namespace miru::d3d12
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Sampler);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(RenderPass);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Pipeline);
+	MIRU_FORWARD_DECLARE_CLASS_AND_REF(QueryPool);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Shader);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(ShaderBindingTable);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Swapchain);
@@ -125,6 +138,8 @@ namespace miru::d3d12
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Event);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Barrier);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Barrier2);
+	MIRU_FORWARD_DECLARE_CLASS_AND_REF(AliasingHeap);
+	MIRU_FORWARD_DECLARE_CLASS_AND_REF(BufferArena);
 }
 namespace miru::vulkan
 {
@@ -135,6 +150,7 @@ namespace miru::vulkan
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(BufferView);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(CommandPool);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(CommandBuffer);
+	MIRU_FORWARD_DECLARE_CLASS_AND_REF(SubmissionQueue);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Context);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(DescriptorPool);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(DescriptorSetLayout);
@@ -145,6 +161,7 @@ namespace miru::vulkan
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Sampler);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(RenderPass);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Pipeline);
+	MIRU_FORWARD_DECLARE_CLASS_AND_REF(QueryPool);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Shader);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(ShaderBindingTable);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Swapchain);
@@ -153,6 +170,8 @@ namespace miru::vulkan
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Event);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Barrier);
 	MIRU_FORWARD_DECLARE_CLASS_AND_REF(Barrier2);
+	MIRU_FORWARD_DECLARE_CLASS_AND_REF(AliasingHeap);
+	MIRU_FORWARD_DECLARE_CLASS_AND_REF(BufferArena);
 }
 
 //MIRU Enum Class Bitwise Operators Templates
@@ -182,6 +201,8 @@ namespace miru
 
 		static void BeginSession(const std::string& filepath);
 		static void EndSession();
+		//Writes a scope to the session's file. start is in nanoseconds since the std::chrono::steady_clock epoch.
+		static void WriteScope(uint64_t scopeNumber, const std::string& name, uint64_t duration, int64_t start);
 
 		//Members
 	private:
@@ -109,7 +109,7 @@ AccelerationStructure::AccelerationStructure(AccelerationStructure::CreateInfo*
 	m_ASCI.pNext = nullptr;
 	m_ASCI.createFlags = static_cast<VkAccelerationStructureCreateFlagsKHR>(m_CI.flags);
 	m_ASCI.buffer = ref_cast<Buffer>(m_CI.buffer)->m_Buffer;
-	m_ASCI.offset = m_CI.offset;
+	m_ASCI.offset = m_CI.buffer->GetOffset() + m_CI.offset;
 	m_ASCI.size = m_CI.size;
 	m_ASCI.type = static_cast<VkAccelerationStructureTypeKHR>(m_CI.type);
 	m_ASCI.deviceAddress = m_CI.deviceAddress;
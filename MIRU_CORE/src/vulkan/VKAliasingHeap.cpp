@@ -0,0 +1,87 @@
+#include "VKAliasingHeap.h"
+#include "VKContext.h"
+#include "VKBuffer.h"
+#include "VKImage.h"
+
+using namespace miru;
+using namespace vulkan;
+
+AliasingHeap::AliasingHeap(AliasingHeap::CreateInfo* pCreateInfo)
+	:m_Device(*reinterpret_cast<VkDevice*>(pCreateInfo->context->GetDevice()))
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_CI = *pCreateInfo;
+
+	const ContextRef& context = ref_cast<Context>(m_CI.context);
+	m_BufferImageGranularity = context->m_PhysicalDevices.m_PDIs[context->m_PhysicalDeviceIndex].m_Properties.limits.bufferImageGranularity;
+}
+
+AliasingHeap::~AliasingHeap()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	Reset();
+}
+
+void AliasingHeap::GetMemoryRequirements(Resource& resource)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	VkMemoryRequirements memoryRequirements;
+	if (resource.isImage)
+		vkGetImageMemoryRequirements(m_Device, ref_cast<Image>(resource.image)->m_Image, &memoryRequirements);
+	else
+		vkGetBufferMemoryRequirements(m_Device, ref_cast<Buffer>(resource.buffer)->m_Buffer, &memoryRequirements);
+
+	//Linear Buffers and optimal Images may share the heap, so keep every resource on its own bufferImageGranularity page.
+	resource.size = arc::Align<size_t>(static_cast<size_t>(memoryRequirements.size), static_cast<size_t>(m_BufferImageGranularity));
+	resource.alignment = std::max<size_t>(static_cast<size_t>(memoryRequirements.alignment), static_cast<size_t>(m_BufferImageGranularity));
+	resource.memoryTypeBits = memoryRequirements.memoryTypeBits;
+}
+
+void AliasingHeap::AllocateMemory(size_t size, size_t alignment, uint32_t memoryTypeBits)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	VkMemoryRequirements memoryRequirements;
+	memoryRequirements.size = static_cast<VkDeviceSize>(size);
+	memoryRequirements.alignment = static_cast<VkDeviceSize>(alignment);
+	memoryRequirements.memoryTypeBits = memoryTypeBits;
+
+	m_VmaACI.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+	m_VmaACI.usage = VMA_MEMORY_USAGE_UNKNOWN;
+	m_VmaACI.requiredFlags = static_cast<VkMemoryPropertyFlags>(m_CI.allocator->GetCreateInfo().properties);
+	m_VmaACI.preferredFlags = 0;
+	m_VmaACI.memoryTypeBits = 0;
+	m_VmaACI.pool = VK_NULL_HANDLE;
+	m_VmaACI.pUserData = nullptr;
+	m_VmaACI.priority = 0.0f;
+
+	VmaAllocator& allocator = *reinterpret_cast<VmaAllocator*>(m_CI.allocator->GetNativeAllocator());
+	MIRU_FATAL(vmaAllocateMemory(allocator, &memoryRequirements, &m_VmaACI, &m_VmaAllocation, &m_VmaAI), "ERROR: VULKAN: Failed to allocate memory for AliasingHeap.");
+	vmaSetAllocationName(allocator, m_VmaAllocation, m_CI.debugName.c_str());
+}
+
+void AliasingHeap::BindMemory(Resource& resource)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	VmaAllocator& allocator = *reinterpret_cast<VmaAllocator*>(m_CI.allocator->GetNativeAllocator());
+	if (resource.isImage)
+		MIRU_FATAL(vmaBindImageMemory2(allocator, m_VmaAllocation, static_cast<VkDeviceSize>(resource.offset), ref_cast<Image>(resource.image)->m_Image, nullptr), "ERROR: VULKAN: Failed to bind Image to AliasingHeap.");
+	else
+		MIRU_FATAL(vmaBindBufferMemory2(allocator, m_VmaAllocation, static_cast<VkDeviceSize>(resource.offset), ref_cast<Buffer>(resource.buffer)->m_Buffer, nullptr), "ERROR: VULKAN: Failed to bind Buffer to AliasingHeap.");
+}
+
+void AliasingHeap::FreeMemory()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	if (m_VmaAllocation)
+	{
+		VmaAllocator& allocator = *reinterpret_cast<VmaAllocator*>(m_CI.allocator->GetNativeAllocator());
+		vmaFreeMemory(allocator, m_VmaAllocation);
+		m_VmaAllocation = VK_NULL_HANDLE;
+	}
+}
\ No newline at end of file
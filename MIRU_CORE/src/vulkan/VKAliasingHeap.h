@@ -0,0 +1,32 @@
+#pragma once
+#include "base/AliasingHeap.h"
+#include "vulkan/VK_Include.h"
+
+namespace miru
+{
+namespace vulkan
+{
+	class AliasingHeap final : public base::AliasingHeap
+	{
+		//Methods
+	public:
+		AliasingHeap(AliasingHeap::CreateInfo* pCreateInfo);
+		~AliasingHeap();
+
+	protected:
+		void GetMemoryRequirements(Resource& resource) override;
+		void AllocateMemory(size_t size, size_t alignment, uint32_t memoryTypeBits) override;
+		void BindMemory(Resource& resource) override;
+		void FreeMemory() override;
+
+		//Members
+	public:
+		VkDevice m_Device;
+		VkDeviceSize m_BufferImageGranularity;
+
+		VmaAllocation m_VmaAllocation = VK_NULL_HANDLE;
+		VmaAllocationCreateInfo m_VmaACI;
+		VmaAllocationInfo m_VmaAI;
+	};
+}
+}
\ No newline at end of file
@@ -1,6 +1,11 @@
 #define VMA_IMPLEMENTATION
 #include "VKAllocator.h"
 #include "VKContext.h"
+#include "VKBuffer.h"
+#include "VKImage.h"
+#include "VKCommandPoolBuffer.h"
+#include "VKSync.h"
+#include "base/ResourceStateTracker.h"
 
 using namespace miru;
 using namespace vulkan;
@@ -17,7 +22,23 @@ Allocator::Allocator(Allocator::CreateInfo* pCreateInfo)
 	buffer_device_address |= context->IsActive(context->m_ActiveDeviceExtensions, VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME);
 	buffer_device_address |= (context->m_AI.apiVersion >= VK_API_VERSION_1_2);
 
+	//VMA uses the core 1.1 entry points at the effective API version. Below 1.1, it needs the KHR entry points for VK_EXT_memory_budget.
+#if VMA_VULKAN_VERSION >= 1003000
+	const uint32_t maxApiVersion = VK_API_VERSION_1_3;
+#elif VMA_VULKAN_VERSION >= 1002000
+	const uint32_t maxApiVersion = VK_API_VERSION_1_2;
+#elif VMA_VULKAN_VERSION >= 1001000
+	const uint32_t maxApiVersion = VK_API_VERSION_1_1;
+#else
+	const uint32_t maxApiVersion = VK_API_VERSION_1_0;
+#endif
+	const uint32_t apiVersion = std::min({ context->m_AI.apiVersion, context->m_PhysicalDevices.m_PDIs[0].m_Properties.apiVersion, maxApiVersion });
+
+	bool memory_budget = context->IsActive(context->m_ActiveDeviceExtensions, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	memory_budget &= (apiVersion >= VK_API_VERSION_1_1) || context->IsActive(context->m_ActiveInstanceExtensions, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+
 	m_AI.flags = buffer_device_address ? VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT : 0;
+	m_AI.flags |= memory_budget ? VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT : 0;
 	m_AI.physicalDevice = context->m_PhysicalDevices.m_PDIs[0].m_PhysicalDevice;
 	m_AI.device = m_Device;
 	m_AI.preferredLargeHeapBlockSize = static_cast<VkDeviceSize>(m_CI.blockSize);
@@ -26,16 +47,44 @@ Allocator::Allocator(Allocator::CreateInfo* pCreateInfo)
 	m_AI.pHeapSizeLimit = nullptr;
 	m_AI.pVulkanFunctions = nullptr;
 	m_AI.instance = context->m_Instance;
-	m_AI.vulkanApiVersion = 0; // context->m_AI.apiVersion;
+	m_AI.vulkanApiVersion = apiVersion;
 	m_AI.pTypeExternalMemoryHandleTypes = nullptr;
 	
 	MIRU_FATAL(vmaCreateAllocator(&m_AI, &m_Allocator), "ERROR: VULKAN: Failed to create Allocator.");
+
+	//Preallocate the pool for the preferred memory type.
+	if (m_CI.minBlockCount > 0)
+	{
+		VmaAllocationCreateInfo allocationCI = {};
+		allocationCI.usage = VMA_MEMORY_USAGE_UNKNOWN;
+		allocationCI.requiredFlags = static_cast<VkMemoryPropertyFlags>(m_CI.properties);
+
+		uint32_t memoryTypeIndex = 0;
+		if (vmaFindMemoryTypeIndex(m_Allocator, UINT32_MAX, &allocationCI, &memoryTypeIndex) == VK_SUCCESS)
+			GetPool(memoryTypeIndex);
+	}
 }
 
 Allocator::~Allocator()
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
+	if (m_DefragmentationPassInFlight)
+	{
+		m_DefragmentationFence->Wait();
+		EndDefragmentationPass();
+	}
+	if (m_DefragmentationContext)
+		vmaEndDefragmentation(m_Allocator, m_DefragmentationContext, nullptr);
+
+	m_DefragmentationCmdBuffer = nullptr;
+	m_DefragmentationCmdPool = nullptr;
+	m_DefragmentationFence = nullptr;
+
+	for (auto& pool : m_Pools)
+		vmaDestroyPool(m_Allocator, pool.second);
+	m_Pools.clear();
+
 	vmaDestroyAllocator(m_Allocator);
 }
 
@@ -54,13 +103,19 @@ void Allocator::SubmitData(const base::Allocation& allocation, size_t offset, si
 
 		const bool& hostVisible = arc::BitwiseCheck(static_cast<VkMemoryPropertyFlagBits>(m_CI.properties), VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
 		const bool& hostCoherent = arc::BitwiseCheck(static_cast<VkMemoryPropertyFlagBits>(m_CI.properties), VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		if (hostVisible)
+		if (hostVisible && allocation.mappedData)
+		{
+			memcpy(reinterpret_cast<char*>(allocation.mappedData) + offset, data, size);
+			if (!hostCoherent)
+				vmaFlushAllocation(m_Allocator, vmaAllocation, allocation.offset + offset, size);
+		}
+		else if (hostVisible)
 		{
 			void* mappedData;
 			MIRU_FATAL(vmaMapMemory(m_Allocator, vmaAllocation, &mappedData), "ERROR: VULKAN: Can not map resource.");
-			memcpy(reinterpret_cast<char*>(mappedData) + offset, data, size);
+			memcpy(reinterpret_cast<char*>(mappedData) + allocation.offset + offset, data, size);
 			if (!hostCoherent)
-				vmaFlushAllocation(m_Allocator, vmaAllocation, offset, size);
+				vmaFlushAllocation(m_Allocator, vmaAllocation, allocation.offset + offset, size);
 
 			vmaUnmapMemory(m_Allocator, vmaAllocation);
 		}
@@ -77,15 +132,473 @@ void Allocator::AccessData(const base::Allocation& allocation, size_t offset, si
 		
 		const bool& hostVisible = arc::BitwiseCheck(static_cast<VkMemoryPropertyFlagBits>(m_CI.properties), VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
 		const bool& hostCoherent = arc::BitwiseCheck(static_cast<VkMemoryPropertyFlagBits>(m_CI.properties), VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		if (hostVisible)
+		if (hostVisible && allocation.mappedData)
+		{
+			if (!hostCoherent)
+				vmaInvalidateAllocation(m_Allocator, vmaAllocation, allocation.offset + offset, size);
+
+			memcpy(data, reinterpret_cast<char*>(allocation.mappedData) + offset, size);
+		}
+		else if (hostVisible)
 		{
 			void* mappedData;
 			MIRU_FATAL(vmaMapMemory(m_Allocator, vmaAllocation, &mappedData), "ERROR: VULKAN: Can not map resource.");
 			if (!hostCoherent)
-				vmaInvalidateAllocation(m_Allocator, vmaAllocation, offset, size);
+				vmaInvalidateAllocation(m_Allocator, vmaAllocation, allocation.offset + offset, size);
 			
-			memcpy(data, reinterpret_cast<char*>(mappedData) + offset, size);
+			memcpy(data, reinterpret_cast<char*>(mappedData) + allocation.offset + offset, size);
 			vmaUnmapMemory(m_Allocator, vmaAllocation);
 		}
 	}
+}
+
+Allocator::Statistics Allocator::GetStatistics()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	VmaTotalStatistics totalStatistics;
+	vmaCalculateStatistics(m_Allocator, &totalStatistics);
+	return ToStatistics(totalStatistics.total);
+}
+
+std::vector<Allocator::HeapBudget> Allocator::GetHeapBudgets()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	const VkPhysicalDeviceMemoryProperties* memoryProperties = nullptr;
+	vmaGetMemoryProperties(m_Allocator, &memoryProperties);
+	const uint32_t& heapCount = memoryProperties->memoryHeapCount;
+
+	std::vector<VmaBudget> budgets(heapCount);
+	vmaGetHeapBudgets(m_Allocator, budgets.data());
+
+	VmaTotalStatistics totalStatistics;
+	vmaCalculateStatistics(m_Allocator, &totalStatistics);
+
+	std::vector<HeapBudget> heapBudgets;
+	heapBudgets.reserve(heapCount);
+	for (uint32_t i = 0; i < heapCount; i++)
+	{
+		HeapBudget heapBudget;
+		heapBudget.heapIndex = i;
+		heapBudget.deviceLocal = (memoryProperties->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+		heapBudget.usageBytes = budgets[i].usage;
+		heapBudget.budgetBytes = budgets[i].budget;
+		heapBudget.statistics = ToStatistics(totalStatistics.memoryHeap[i]);
+		heapBudgets.push_back(heapBudget);
+	}
+	return heapBudgets;
+}
+
+std::string Allocator::GetStatisticsJSON(bool detailedMap)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	char* statsString = nullptr;
+	vmaBuildStatsString(m_Allocator, &statsString, detailedMap ? VK_TRUE : VK_FALSE);
+	std::string result = statsString ? statsString : "";
+	vmaFreeStatsString(m_Allocator, statsString);
+	return result;
+}
+
+bool Allocator::Defragment(size_t budgetBytes, uint32_t budgetMoves)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	//Host visible allocations may be written by the host at any time, so their contents can not be copied on the device.
+	if (arc::BitwiseCheck(m_CI.properties, base::Allocator::PropertiesBit::HOST_VISIBLE_BIT))
+		return true;
+
+	std::vector<DefragmentationMove> moves;
+	bool complete = false;
+	{
+		std::lock_guard<std::mutex> lock(m_DefragmentationMutex);
+		m_DefragmentationFrame++;
+
+		if (!m_DefragmentationCmdBuffer)
+		{
+			//The copies are submitted to the same queue as the frames, so that they are ordered after the previous writes.
+			base::CommandPool::CreateInfo cmdPoolCI;
+			cmdPoolCI.debugName = m_CI.debugName + ": Defragmentation CommandPool";
+			cmdPoolCI.context = m_CI.context;
+			cmdPoolCI.flags = base::CommandPool::FlagBit::RESET_COMMAND_BUFFER_BIT;
+			cmdPoolCI.queueType = base::CommandPool::QueueType::GRAPHICS;
+			m_DefragmentationCmdPool = base::CommandPool::Create(&cmdPoolCI);
+
+			base::CommandBuffer::CreateInfo cmdBufferCI;
+			cmdBufferCI.debugName = m_CI.debugName + ": Defragmentation CommandBuffer";
+			cmdBufferCI.commandPool = m_DefragmentationCmdPool;
+			cmdBufferCI.level = base::CommandBuffer::Level::PRIMARY;
+			cmdBufferCI.commandBufferCount = 1;
+			m_DefragmentationCmdBuffer = base::CommandBuffer::Create(&cmdBufferCI);
+
+			base::Fence::CreateInfo fenceCI;
+			fenceCI.debugName = m_CI.debugName + ": Defragmentation Fence";
+			fenceCI.device = m_CI.context->GetDevice();
+			fenceCI.signaled = false;
+			fenceCI.timeout = UINT64_MAX;
+			m_DefragmentationFence = base::Fence::Create(&fenceCI);
+		}
+
+		//The pass in flight completes once its copies have finished and the frames that may still use the previous
+		//native resources have retired.
+		if (m_DefragmentationPassInFlight)
+		{
+			if (!m_DefragmentationFence->GetStatus() || m_DefragmentationFrame - m_DefragmentationPassFrame < m_CI.framesInFlight)
+				return false;
+
+			complete = EndDefragmentationPass();
+		}
+
+		if (!complete)
+			complete = BeginDefragmentationPass(budgetBytes, budgetMoves, moves);
+	}
+
+	//Invoked outside of the lock, so that moved resources can be destroyed and recreated in the callback.
+	if (m_DefragmentationCallback)
+	{
+		for (const DefragmentationMove& move : moves)
+			m_DefragmentationCallback(move);
+	}
+
+	return complete;
+}
+
+bool Allocator::BeginDefragmentationPass(size_t budgetBytes, uint32_t budgetMoves, std::vector<DefragmentationMove>& moves)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	//Defragment one pool at a time, until all have completed. The budgets are applied when a pool is started.
+	if (m_DefragmentationPools.empty())
+	{
+		std::lock_guard<std::mutex> lock(m_PoolsMutex);
+		if (!m_CI.linearAlgorithm)
+		{
+			for (auto& pool : m_Pools)
+				m_DefragmentationPools.push_back(pool.second);
+		}
+		m_DefragmentationPools.push_back(VK_NULL_HANDLE);
+	}
+
+	while (true)
+	{
+		if (!m_DefragmentationContext)
+		{
+			VmaDefragmentationInfo defragmentationInfo = {};
+			defragmentationInfo.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT;
+			defragmentationInfo.pool = m_DefragmentationPools.front();
+			defragmentationInfo.maxBytesPerPass = static_cast<VkDeviceSize>(budgetBytes);
+			defragmentationInfo.maxAllocationsPerPass = budgetMoves;
+			MIRU_FATAL(vmaBeginDefragmentation(m_Allocator, &defragmentationInfo, &m_DefragmentationContext), "ERROR: VULKAN: Failed to begin defragmentation.");
+		}
+
+		m_DefragmentationPassInfo = {};
+		VkResult result = vmaBeginDefragmentationPass(m_Allocator, m_DefragmentationContext, &m_DefragmentationPassInfo);
+		if (result != VK_SUCCESS)
+		{
+			MIRU_FATAL(result != VK_INCOMPLETE, "ERROR: VULKAN: Failed to begin defragmentation pass.");
+			break;
+		}
+
+		vmaEndDefragmentation(m_Allocator, m_DefragmentationContext, nullptr);
+		m_DefragmentationContext = VK_NULL_HANDLE;
+		m_DefragmentationPools.erase(m_DefragmentationPools.begin());
+		if (m_DefragmentationPools.empty())
+			return true;
+	}
+
+	struct Relocation
+	{
+		uint32_t					moveIndex;
+		VkBuffer					buffer;
+		VkImage						image;
+		std::vector<base::ResourceState> states;
+	};
+	std::vector<Relocation> relocations;
+	m_DefragmentationOwners.assign(m_DefragmentationPassInfo.moveCount, nullptr);
+
+	//Only Buffers and Images that can be copied are moved. Images also need their current layouts.
+	for (uint32_t i = 0; i < m_DefragmentationPassInfo.moveCount; i++)
+	{
+		VmaDefragmentationMove& move = m_DefragmentationPassInfo.pMoves[i];
+
+		VmaAllocationInfo allocationInfo;
+		vmaGetAllocationInfo(m_Allocator, move.srcAllocation, &allocationInfo);
+		AllocationOwner* owner = reinterpret_cast<AllocationOwner*>(allocationInfo.pUserData);
+
+		Relocation relocation = { i, VK_NULL_HANDLE, VK_NULL_HANDLE, {} };
+		if (owner && owner->buffer)
+		{
+			const VkBufferUsageFlags transferUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			if ((owner->buffer->m_BufferCI.usage & transferUsage) != transferUsage)
+			{
+				move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+				continue;
+			}
+
+			MIRU_FATAL(vkCreateBuffer(m_Device, &owner->buffer->m_BufferCI, nullptr, &relocation.buffer), "ERROR: VULKAN: Failed to create Buffer for defragmentation.");
+			MIRU_FATAL(vmaBindBufferMemory(m_Allocator, move.dstTmpAllocation, relocation.buffer), "ERROR: VULKAN: Failed to bind Buffer for defragmentation.");
+		}
+		else if (owner && owner->image)
+		{
+			const VkImageUsageFlags transferUsage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+			if ((owner->image->m_ImageCI.usage & transferUsage) != transferUsage
+				|| !base::ResourceStateTracker::Get().GetTrackedStates(owner->image, relocation.states))
+			{
+				move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+				continue;
+			}
+
+			MIRU_FATAL(vkCreateImage(m_Device, &owner->image->m_ImageCI, nullptr, &relocation.image), "ERROR: VULKAN: Failed to create Image for defragmentation.");
+			MIRU_FATAL(vmaBindImageMemory(m_Allocator, move.dstTmpAllocation, relocation.image), "ERROR: VULKAN: Failed to bind Image for defragmentation.");
+		}
+		else
+		{
+			move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+			continue;
+		}
+
+		m_DefragmentationOwners[i] = owner;
+		relocations.push_back(std::move(relocation));
+	}
+
+	if (relocations.empty())
+	{
+		//Nothing to copy. The pass ends immediately and the next one begins on the next call.
+		return EndDefragmentationPass();
+	}
+
+	std::vector<VkImageMemoryBarrier> preBarriers;
+	std::vector<VkImageMemoryBarrier> postBarriers;
+	auto AddImageBarrier = [](std::vector<VkImageMemoryBarrier>& barriers, VkImage image, VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkImageLayout oldLayout, VkImageLayout newLayout, const VkImageSubresourceRange& range)
+	{
+		VkImageMemoryBarrier barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = image;
+		barrier.subresourceRange = range;
+		barriers.push_back(barrier);
+	};
+
+	//Subresources in an undefined layout have no contents to preserve, and are left in the transfer layout.
+	for (const Relocation& relocation : relocations)
+	{
+		if (!relocation.image)
+			continue;
+
+		Image* image = m_DefragmentationOwners[relocation.moveIndex]->image;
+		const VkImageAspectFlags aspect = image->GetVkImageAspect(image->GetCreateInfo().format);
+		const uint32_t& mipLevels = image->m_ImageCI.mipLevels;
+		AddImageBarrier(preBarriers, relocation.image, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, { aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS });
+		for (uint32_t j = 0; j < static_cast<uint32_t>(relocation.states.size()); j++)
+		{
+			const VkImageSubresourceRange range = { aspect, j % mipLevels, 1, j / mipLevels, 1 };
+			const VkImageLayout layout = static_cast<VkImageLayout>(relocation.states[j].layout);
+			AddImageBarrier(preBarriers, image->m_Image, VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, range);
+			if (layout != VK_IMAGE_LAYOUT_UNDEFINED && layout != VK_IMAGE_LAYOUT_PREINITIALIZED)
+				AddImageBarrier(postBarriers, relocation.image, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layout, range);
+		}
+	}
+
+	const VkCommandBuffer& cmdBuffer = ref_cast<CommandBuffer>(m_DefragmentationCmdBuffer)->m_CmdBuffers[0];
+	m_DefragmentationCmdBuffer->Begin(0, base::CommandBuffer::UsageBit::ONE_TIME_SUBMIT);
+
+	VkMemoryBarrier preBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT };
+	vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &preBarrier, 0, nullptr, static_cast<uint32_t>(preBarriers.size()), preBarriers.data());
+
+	for (const Relocation& relocation : relocations)
+	{
+		const AllocationOwner* owner = m_DefragmentationOwners[relocation.moveIndex];
+		if (relocation.buffer)
+		{
+			VkBufferCopy region = { 0, 0, owner->buffer->m_BufferCI.size };
+			vkCmdCopyBuffer(cmdBuffer, owner->buffer->m_Buffer, relocation.buffer, 1, &region);
+		}
+		else
+		{
+			Image* image = owner->image;
+			const VkImageAspectFlags aspect = image->GetVkImageAspect(image->GetCreateInfo().format);
+			const VkExtent3D& extent = image->m_ImageCI.extent;
+			std::vector<VkImageCopy> regions;
+			for (uint32_t mipLevel = 0; mipLevel < image->m_ImageCI.mipLevels; mipLevel++)
+			{
+				VkImageCopy region;
+				region.srcSubresource = { aspect, mipLevel, 0, image->m_ImageCI.arrayLayers };
+				region.srcOffset = { 0, 0, 0 };
+				region.dstSubresource = region.srcSubresource;
+				region.dstOffset = { 0, 0, 0 };
+				region.extent = { std::max(extent.width >> mipLevel, 1u), std::max(extent.height >> mipLevel, 1u), std::max(extent.depth >> mipLevel, 1u) };
+				regions.push_back(region);
+			}
+			vkCmdCopyImage(cmdBuffer, image->m_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, relocation.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+		}
+	}
+
+	VkMemoryBarrier postBarrier = { VK_STRUCTURE_TYPE_MEMORY_BARRIER, nullptr, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT };
+	vkCmdPipelineBarrier(cmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &postBarrier, 0, nullptr, static_cast<uint32_t>(postBarriers.size()), postBarriers.data());
+
+	m_DefragmentationCmdBuffer->End(0);
+
+	base::CommandBuffer::SubmitInfo submitInfo = { { 0 }, {}, {}, {}, {}, {} };
+	m_DefragmentationCmdBuffer->Submit({ submitInfo }, m_DefragmentationFence);
+	m_DefragmentationPassInFlight = true;
+	m_DefragmentationPassFrame = m_DefragmentationFrame;
+
+	//The resources use the new native resources from now on. The previous ones are retired until the pass completes.
+	for (const Relocation& relocation : relocations)
+	{
+		AllocationOwner* owner = m_DefragmentationOwners[relocation.moveIndex];
+		if (relocation.buffer)
+		{
+			m_RetiredBuffers.push_back(owner->buffer->m_Buffer);
+			owner->buffer->Rebind(relocation.buffer);
+			moves.push_back({ owner->buffer, nullptr });
+		}
+		else
+		{
+			m_RetiredImages.push_back(owner->image->m_Image);
+			owner->image->Rebind(relocation.image);
+			moves.push_back({ nullptr, owner->image });
+		}
+	}
+
+	return false;
+}
+
+bool Allocator::EndDefragmentationPass()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	if (m_DefragmentationPassInFlight)
+		m_DefragmentationFence->Reset();
+	m_DefragmentationPassInFlight = false;
+
+	//Destroy the previous native resources before VMA frees their memory.
+	for (const VkBuffer& buffer : m_RetiredBuffers)
+		vkDestroyBuffer(m_Device, buffer, nullptr);
+	for (const VkImage& image : m_RetiredImages)
+		vkDestroyImage(m_Device, image, nullptr);
+	m_RetiredBuffers.clear();
+	m_RetiredImages.clear();
+
+	VkResult result = vmaEndDefragmentationPass(m_Allocator, m_DefragmentationContext, &m_DefragmentationPassInfo);
+
+	for (AllocationOwner* owner : m_DefragmentationOwners)
+	{
+		if (owner && owner->buffer)
+			vmaGetAllocationInfo(m_Allocator, owner->buffer->m_VmaAllocation, &owner->buffer->m_VmaAI);
+		else if (owner && owner->image)
+			vmaGetAllocationInfo(m_Allocator, owner->image->m_VmaAllocation, &owner->image->m_VmaAI);
+	}
+	m_DefragmentationOwners.clear();
+	m_DefragmentationPassInfo = {};
+
+	if (result == VK_SUCCESS)
+	{
+		vmaEndDefragmentation(m_Allocator, m_DefragmentationContext, nullptr);
+		m_DefragmentationContext = VK_NULL_HANDLE;
+		m_DefragmentationPools.erase(m_DefragmentationPools.begin());
+	}
+	return m_DefragmentationPools.empty();
+}
+
+bool Allocator::ReleaseMovingAllocation(VmaAllocation allocation, VkBuffer buffer, VkImage image)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	std::lock_guard<std::mutex> lock(m_DefragmentationMutex);
+	if (!m_DefragmentationPassInFlight)
+		return false;
+
+	for (uint32_t i = 0; i < m_DefragmentationPassInfo.moveCount; i++)
+	{
+		VmaDefragmentationMove& move = m_DefragmentationPassInfo.pMoves[i];
+		if (move.srcAllocation != allocation)
+			continue;
+
+		//VMA frees both the source and the destination memory of the move, including ignored moves.
+		move.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_DESTROY;
+		m_DefragmentationOwners[i] = nullptr;
+		if (buffer)
+			m_RetiredBuffers.push_back(buffer);
+		if (image)
+			m_RetiredImages.push_back(image);
+		return true;
+	}
+	return false;
+}
+
+VmaPool Allocator::GetPool(const VkBufferCreateInfo& bufferCI, const VmaAllocationCreateInfo& allocationCI)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	VmaAllocationCreateInfo _allocationCI = allocationCI;
+	_allocationCI.pool = VK_NULL_HANDLE;
+
+	uint32_t memoryTypeIndex = 0;
+	if (vmaFindMemoryTypeIndexForBufferInfo(m_Allocator, &bufferCI, &_allocationCI, &memoryTypeIndex) != VK_SUCCESS)
+		return VK_NULL_HANDLE;
+
+	return GetPool(memoryTypeIndex);
+}
+
+VmaPool Allocator::GetPool(const VkImageCreateInfo& imageCI, const VmaAllocationCreateInfo& allocationCI)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	VmaAllocationCreateInfo _allocationCI = allocationCI;
+	_allocationCI.pool = VK_NULL_HANDLE;
+
+	uint32_t memoryTypeIndex = 0;
+	if (vmaFindMemoryTypeIndexForImageInfo(m_Allocator, &imageCI, &_allocationCI, &memoryTypeIndex) != VK_SUCCESS)
+		return VK_NULL_HANDLE;
+
+	return GetPool(memoryTypeIndex);
+}
+
+VmaPool Allocator::GetPool(uint32_t memoryTypeIndex)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	std::lock_guard<std::mutex> lock(m_PoolsMutex);
+
+	auto it = m_Pools.find(memoryTypeIndex);
+	if (it != m_Pools.end())
+		return it->second;
+
+	VmaPoolCreateInfo poolCI = {};
+	poolCI.memoryTypeIndex = memoryTypeIndex;
+	poolCI.flags = m_CI.linearAlgorithm ? VMA_POOL_CREATE_LINEAR_ALGORITHM_BIT : 0;
+	poolCI.blockSize = static_cast<VkDeviceSize>(m_CI.blockSize);
+	poolCI.minBlockCount = static_cast<size_t>(m_CI.minBlockCount);
+	poolCI.maxBlockCount = static_cast<size_t>(m_CI.maxBlockCount);
+	poolCI.priority = 0.5f;
+	poolCI.minAllocationAlignment = 0;
+	poolCI.pMemoryAllocateNext = nullptr;
+
+	VmaPool pool = VK_NULL_HANDLE;
+	MIRU_FATAL(vmaCreatePool(m_Allocator, &poolCI, &pool), "ERROR: VULKAN: Failed to create VmaPool.");
+	vmaSetPoolName(m_Allocator, pool, (m_CI.debugName + ": Pool " + std::to_string(memoryTypeIndex)).c_str());
+
+	m_Pools[memoryTypeIndex] = pool;
+	return pool;
+}
+
+Allocator::Statistics Allocator::ToStatistics(const VmaDetailedStatistics& detailedStatistics)
+{
+	Statistics statistics;
+	statistics.blockCount = detailedStatistics.statistics.blockCount;
+	statistics.allocationCount = detailedStatistics.statistics.allocationCount;
+	statistics.unusedRangeCount = detailedStatistics.unusedRangeCount;
+	statistics.blockBytes = detailedStatistics.statistics.blockBytes;
+	statistics.allocationBytes = detailedStatistics.statistics.allocationBytes;
+	statistics.largestUnusedRangeBytes = detailedStatistics.unusedRangeCount ? detailedStatistics.unusedRangeSizeMax : 0;
+
+	const uint64_t unusedBytes = statistics.blockBytes - statistics.allocationBytes;
+	statistics.fragmentation = unusedBytes ? 1.0f - float(double(statistics.largestUnusedRangeBytes) / double(unusedBytes)) : 0.0f;
+	return statistics;
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 #include "base/Allocator.h"
 #include "vulkan/VK_Include.h"
+#include <mutex>
 
 namespace miru
 {
@@ -8,6 +9,15 @@ namespace vulkan
 {
 	class Allocator final : public base::Allocator
 	{
+		//enums/structs
+	public:
+		//Set as the pUserData of a VmaAllocation to find the owner of the allocation during defragmentation.
+		struct AllocationOwner
+		{
+			Buffer*		buffer;
+			Image*		image;
+		};
+
 		//Methods
 	public:
 		Allocator(Allocator::CreateInfo* pCreateInfo);
@@ -18,7 +28,29 @@ namespace vulkan
 		void SubmitData(const base::Allocation& allocation, size_t offset, size_t size, void* data) override;
 		void AccessData(const base::Allocation& allocation, size_t offset, size_t size, void* data) override;
 
+		Statistics GetStatistics() override;
+		std::vector<HeapBudget> GetHeapBudgets() override;
+		std::string GetStatisticsJSON(bool detailedMap = false) override;
+
+		bool Defragment(size_t budgetBytes, uint32_t budgetMoves) override;
+
+		//Returns the Allocator's VmaPool for the memory type that the resource will use.
+		VmaPool GetPool(const VkBufferCreateInfo& bufferCI, const VmaAllocationCreateInfo& allocationCI);
+		VmaPool GetPool(const VkImageCreateInfo& imageCI, const VmaAllocationCreateInfo& allocationCI);
+		//Returns true if an allocation that failed in a pool may be retried in the default pools.
+		bool CanFallbackFromPool() { return m_CI.maxBlockCount == 0; }
+		//Called by a Buffer or Image that is being destroyed. Returns true if its allocation is being moved by the pass in
+		//flight, in which case the Allocator destroys the native resource and frees the allocation when the pass completes.
+		bool ReleaseMovingAllocation(VmaAllocation allocation, VkBuffer buffer, VkImage image);
+
 	private:
+		VmaPool GetPool(uint32_t memoryTypeIndex);
+		//Returns true when all pools have been defragmented. Otherwise, a pass may have been submitted.
+		bool BeginDefragmentationPass(size_t budgetBytes, uint32_t budgetMoves, std::vector<DefragmentationMove>& moves);
+		//Returns true when all pools have been defragmented.
+		bool EndDefragmentationPass();
+		static Statistics ToStatistics(const VmaDetailedStatistics& detailedStatistics);
+
 		/*VkMemoryPropertyFlags GetMemoryPropertyFlag(base::Resource::Type type, uint32_t usage);
 		uint32_t GetMemoryTypeIndex(VkMemoryPropertyFlags properties);
 		uint32_t GetQueueFamilyIndex(VkQueueFlagBits queueType);*/
@@ -29,6 +61,24 @@ namespace vulkan
 
 		VmaAllocator m_Allocator;
 		VmaAllocatorCreateInfo m_AI;
+
+		std::map<uint32_t, VmaPool> m_Pools;
+		std::mutex m_PoolsMutex;
+
+		base::CommandPoolRef m_DefragmentationCmdPool;
+		base::CommandBufferRef m_DefragmentationCmdBuffer;
+		base::FenceRef m_DefragmentationFence;
+
+		std::mutex m_DefragmentationMutex;
+		std::vector<VmaPool> m_DefragmentationPools;		//Pools remaining to be defragmented. The front is being defragmented.
+		VmaDefragmentationContext m_DefragmentationContext = VK_NULL_HANDLE;
+		VmaDefragmentationPassMoveInfo m_DefragmentationPassInfo = {};
+		std::vector<AllocationOwner*> m_DefragmentationOwners;	//Per move of the pass in flight. nullptr if the move is not performed.
+		bool m_DefragmentationPassInFlight = false;
+		uint64_t m_DefragmentationFrame = 0;				//Number of calls to Defragment().
+		uint64_t m_DefragmentationPassFrame = 0;			//Value of m_DefragmentationFrame when the pass in flight was submitted.
+		std::vector<VkBuffer> m_RetiredBuffers;				//Destroyed when the pass in flight completes.
+		std::vector<VkImage> m_RetiredImages;
 	};
 }
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "VKBuffer.h"
-#include "base/Allocator.h"
+#include "VKAllocator.h"
+#include "base/BufferArena.h"
 
 using namespace miru;
 using namespace vulkan;
@@ -20,16 +21,68 @@ Buffer::Buffer(Buffer::CreateInfo* pCreateInfo)
 	m_BufferCI.queueFamilyIndexCount = 0;
 	m_BufferCI.pQueueFamilyIndices = nullptr;
 
-	m_VmaACI.flags = 0;
+	if (m_CI.arena)
+	{
+		//Suballocated from the arena's VkBuffer.
+		size_t offset = 0;
+		MIRU_FATAL(!m_CI.arena->Allocate(m_CI.size, offset), "ERROR: VULKAN: BufferArena is full.");
+		m_CI.allocator = m_CI.arena->GetCreateInfo().allocator;
+
+		const BufferRef& arenaBuffer = ref_cast<Buffer>(m_CI.arena->GetBuffer());
+		m_Buffer = arenaBuffer->m_Buffer;
+		m_VmaAllocation = arenaBuffer->m_VmaAllocation;
+		m_VmaAI = arenaBuffer->m_VmaAI;
+
+		const base::Allocation& arenaAllocation = arenaBuffer->GetAllocation();
+		m_Allocation.nativeAllocation = arenaAllocation.nativeAllocation;
+		m_Allocation.rowPitch = m_CI.imageDimension.width * m_CI.imageDimension.pixelSize;
+		m_Allocation.rowCount = m_CI.imageDimension.height;
+		m_Allocation.rowPadding = 0;
+		m_Allocation.slicePitch = m_Allocation.rowPitch * m_CI.imageDimension.height;
+		m_Allocation.sliceCount = m_CI.imageDimension.depthOrArraySize;
+		m_Allocation.mappedData = arenaAllocation.mappedData ? reinterpret_cast<char*>(arenaAllocation.mappedData) + offset : nullptr;
+		m_Allocation.offset = offset;
+
+		if (m_CI.data)
+		{
+			m_CI.allocator->SubmitData(m_Allocation, 0, m_CI.size, m_CI.data);
+		}
+		return;
+	}
+
+	if (!m_CI.allocator)
+	{
+		//Created without memory. The memory is bound by an AliasingHeap.
+		MIRU_FATAL(vkCreateBuffer(m_Device, &m_BufferCI, nullptr, &m_Buffer), "ERROR: VULKAN: Failed to create Buffer.");
+		VKSetName<VkBuffer>(m_Device, m_Buffer, m_CI.debugName);
+		m_VmaAllocation = VK_NULL_HANDLE;
+		m_Allocation = {};
+		return;
+	}
+
+	const base::Allocator::CreateInfo& allocatorCI = m_CI.allocator->GetCreateInfo();
+	const bool& persistentlyMapped = allocatorCI.persistentlyMapped && arc::BitwiseCheck(allocatorCI.properties, base::Allocator::PropertiesBit::HOST_VISIBLE_BIT);
+
+	m_VmaACI.flags = persistentlyMapped ? VMA_ALLOCATION_CREATE_MAPPED_BIT : 0;
 	m_VmaACI.usage = VMA_MEMORY_USAGE_UNKNOWN;
-	m_VmaACI.requiredFlags = static_cast<VkMemoryPropertyFlags>(m_CI.allocator->GetCreateInfo().properties);
+	m_VmaACI.requiredFlags = static_cast<VkMemoryPropertyFlags>(allocatorCI.properties);
 	m_VmaACI.preferredFlags = 0;
 	m_VmaACI.memoryTypeBits = 0;
 	m_VmaACI.pool = VK_NULL_HANDLE;
-	m_VmaACI.pUserData = nullptr;
+	m_VmaACI.pUserData = &m_AllocationOwner; //Used to find the owner of the VmaAllocation during defragmentation.
+
+	const AllocatorRef& allocatorRef = ref_cast<Allocator>(m_CI.allocator);
+	m_VmaACI.pool = allocatorRef->GetPool(m_BufferCI, m_VmaACI);
 
 	VmaAllocator& allocator = *reinterpret_cast<VmaAllocator*>(m_CI.allocator->GetNativeAllocator());
-	MIRU_FATAL(vmaCreateBuffer(allocator, &m_BufferCI, &m_VmaACI, &m_Buffer, &m_VmaAllocation, &m_VmaAI), "ERROR: VULKAN: Failed to create Buffer.");
+	VkResult result = vmaCreateBuffer(allocator, &m_BufferCI, &m_VmaACI, &m_Buffer, &m_VmaAllocation, &m_VmaAI);
+	if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY && m_VmaACI.pool && allocatorRef->CanFallbackFromPool())
+	{
+		//The Buffer is larger than the pool's block size.
+		m_VmaACI.pool = VK_NULL_HANDLE;
+		result = vmaCreateBuffer(allocator, &m_BufferCI, &m_VmaACI, &m_Buffer, &m_VmaAllocation, &m_VmaAI);
+	}
+	MIRU_FATAL(result, "ERROR: VULKAN: Failed to create Buffer.");
 	VKSetName<VkBuffer>(m_Device, m_Buffer, m_CI.debugName);
 
 	m_Allocation.nativeAllocation = (base::NativeAllocation)&m_VmaAllocation;
@@ -38,6 +91,7 @@ Buffer::Buffer(Buffer::CreateInfo* pCreateInfo)
 	m_Allocation.rowPadding = 0;
 	m_Allocation.slicePitch = m_Allocation.rowPitch * m_CI.imageDimension.height;
 	m_Allocation.sliceCount = m_CI.imageDimension.depthOrArraySize;
+	m_Allocation.mappedData = persistentlyMapped ? m_VmaAI.pMappedData : nullptr;
 
 	if (m_CI.data)
 	{
@@ -49,10 +103,33 @@ Buffer::~Buffer()
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
+	if (m_CI.arena)
+	{
+		m_CI.arena->Free(m_Allocation.offset);
+		return;
+	}
+
+	if (!m_CI.allocator)
+	{
+		vkDestroyBuffer(m_Device, m_Buffer, nullptr);
+		return;
+	}
+
+	if (ref_cast<Allocator>(m_CI.allocator)->ReleaseMovingAllocation(m_VmaAllocation, m_Buffer, VK_NULL_HANDLE))
+		return;
+
 	VmaAllocator& allocator = *reinterpret_cast<VmaAllocator*>(m_CI.allocator->GetNativeAllocator());
 	vmaDestroyBuffer(allocator, m_Buffer, m_VmaAllocation);
 }
 
+void Buffer::Rebind(VkBuffer buffer)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_Buffer = buffer;
+	VKSetName<VkBuffer>(m_Device, m_Buffer, m_CI.debugName);
+}
+
 BufferView::BufferView(CreateInfo* pCreateInfo)
 	:m_Device(*reinterpret_cast<VkDevice*>(pCreateInfo->device))
 {
@@ -65,7 +142,7 @@ BufferView::BufferView(CreateInfo* pCreateInfo)
 	m_BufferViewCI.flags = 0;
 	m_BufferViewCI.buffer = ref_cast<Buffer>(m_CI.buffer)->m_Buffer;
 	m_BufferViewCI.format = VK_FORMAT_R8_UINT;
-	m_BufferViewCI.offset = m_CI.offset;
+	m_BufferViewCI.offset = m_CI.buffer->GetOffset() + m_CI.offset;
 	m_BufferViewCI.range = m_CI.size;
 
 	if (m_CI.buffer->GetCreateInfo().usage == Buffer::UsageBit::UNIFORM_TEXEL_BIT
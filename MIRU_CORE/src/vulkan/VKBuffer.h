@@ -1,6 +1,7 @@
 #pragma once
 #include "base/Buffer.h"
 #include "vulkan/VK_Include.h"
+#include "vulkan/VKAllocator.h"
 
 namespace miru
 {
@@ -13,6 +14,10 @@ namespace vulkan
 		Buffer(Buffer::CreateInfo* pCreateInfo);
 		~Buffer();
 
+		//Replaces the VkBuffer with one bound to the VmaAllocation's new memory during defragmentation.
+		//The Allocator destroys the previous VkBuffer once the device has finished using it.
+		void Rebind(VkBuffer buffer);
+
 	private:
 		VkBufferUsageFlags ToVKBufferType(Buffer::UsageBit type);
 
@@ -26,6 +31,7 @@ namespace vulkan
 		VmaAllocation m_VmaAllocation;
 		VmaAllocationCreateInfo m_VmaACI;
 		VmaAllocationInfo m_VmaAI;
+		Allocator::AllocationOwner m_AllocationOwner = { this, nullptr };
 	};
 
 	class BufferView final : public base::BufferView
@@ -0,0 +1,105 @@
+#include "VKBufferArena.h"
+#include "VKContext.h"
+#include "VKAllocator.h"
+#include "VKBuffer.h"
+
+using namespace miru;
+using namespace vulkan;
+
+BufferArena::BufferArena(BufferArena::CreateInfo* pCreateInfo)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_CI = *pCreateInfo;
+	m_Alignment = m_CI.alignment ? m_CI.alignment : GetDeviceAlignment();
+	CreateBuffer();
+
+	//The suballocated Buffers hold the VkBuffer, so the arena's memory must not be moved by defragmentation.
+	VmaAllocator& allocator = *reinterpret_cast<VmaAllocator*>(m_CI.allocator->GetNativeAllocator());
+	vmaSetAllocationUserData(allocator, ref_cast<Buffer>(m_Buffer)->m_VmaAllocation, nullptr);
+
+	m_VirtualBlockCI.size = static_cast<VkDeviceSize>(m_CI.size);
+	m_VirtualBlockCI.flags = 0;
+	m_VirtualBlockCI.pAllocationCallbacks = nullptr;
+	MIRU_FATAL(vmaCreateVirtualBlock(&m_VirtualBlockCI, &m_VirtualBlock), "ERROR: VULKAN: Failed to create VirtualBlock for BufferArena.");
+}
+
+BufferArena::~BufferArena()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	MIRU_WARN(!m_VirtualAllocations.empty(), "WARN: VULKAN: BufferArena destroyed with live suballocations.");
+	vmaClearVirtualBlock(m_VirtualBlock);
+	vmaDestroyVirtualBlock(m_VirtualBlock);
+	m_Buffer = nullptr;
+}
+
+bool BufferArena::Allocate(size_t size, size_t& offset)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	VmaVirtualAllocationCreateInfo virtualAllocationCI = {};
+	virtualAllocationCI.size = static_cast<VkDeviceSize>(arc::Align<size_t>(size, m_Alignment));
+	virtualAllocationCI.alignment = static_cast<VkDeviceSize>(m_Alignment);
+	virtualAllocationCI.flags = 0;
+	virtualAllocationCI.pUserData = nullptr;
+
+	VmaVirtualAllocation virtualAllocation;
+	VkDeviceSize virtualOffset = 0;
+	if (vmaVirtualAllocate(m_VirtualBlock, &virtualAllocationCI, &virtualAllocation, &virtualOffset) != VK_SUCCESS)
+		return false;
+
+	offset = static_cast<size_t>(virtualOffset);
+	m_VirtualAllocations[offset] = virtualAllocation;
+	return true;
+}
+
+void BufferArena::Free(size_t offset)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto it = m_VirtualAllocations.find(offset);
+	if (it == m_VirtualAllocations.end())
+	{
+		MIRU_WARN(true, "WARN: VULKAN: BufferArena has no suballocation at the offset.");
+		return;
+	}
+
+	vmaVirtualFree(m_VirtualBlock, it->second);
+	m_VirtualAllocations.erase(it);
+}
+
+size_t BufferArena::GetUsedSize()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	VmaStatistics statistics;
+	vmaGetVirtualBlockStatistics(m_VirtualBlock, &statistics);
+	return static_cast<size_t>(statistics.allocationBytes);
+}
+
+size_t BufferArena::GetDeviceAlignment()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	const bool& uniform = arc::BitwiseCheck(m_CI.usage, Buffer::UsageBit::UNIFORM_BIT) || arc::BitwiseCheck(m_CI.usage, Buffer::UsageBit::UNIFORM_TEXEL_BIT);
+	const bool& storage = arc::BitwiseCheck(m_CI.usage, Buffer::UsageBit::STORAGE_BIT) || arc::BitwiseCheck(m_CI.usage, Buffer::UsageBit::STORAGE_TEXEL_BIT);
+	const bool& texel = arc::BitwiseCheck(m_CI.usage, Buffer::UsageBit::UNIFORM_TEXEL_BIT) || arc::BitwiseCheck(m_CI.usage, Buffer::UsageBit::STORAGE_TEXEL_BIT);
+
+	const ContextRef& context = ref_cast<Context>(m_CI.context);
+	const VkPhysicalDeviceLimits& limits = context->m_PhysicalDevices.m_PDIs[context->m_PhysicalDeviceIndex].m_Properties.limits;
+	size_t alignment = 16;
+	if (uniform)
+		alignment = std::max<size_t>(alignment, static_cast<size_t>(limits.minUniformBufferOffsetAlignment));
+	if (storage)
+		alignment = std::max<size_t>(alignment, static_cast<size_t>(limits.minStorageBufferOffsetAlignment));
+	if (texel)
+		alignment = std::max<size_t>(alignment, static_cast<size_t>(limits.minTexelBufferOffsetAlignment));
+	return alignment;
+}
\ No newline at end of file
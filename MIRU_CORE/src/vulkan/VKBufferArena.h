@@ -0,0 +1,30 @@
+#pragma once
+#include "base/BufferArena.h"
+#include "vulkan/VK_Include.h"
+
+namespace miru
+{
+namespace vulkan
+{
+	class BufferArena final : public base::BufferArena
+	{
+		//Methods
+	public:
+		BufferArena(BufferArena::CreateInfo* pCreateInfo);
+		~BufferArena();
+
+		bool Allocate(size_t size, size_t& offset) override;
+		void Free(size_t offset) override;
+		size_t GetUsedSize() override;
+
+	private:
+		size_t GetDeviceAlignment();
+
+		//Members
+	public:
+		VmaVirtualBlock m_VirtualBlock;
+		VmaVirtualBlockCreateInfo m_VirtualBlockCI;
+		std::map<size_t, VmaVirtualAllocation> m_VirtualAllocations;
+	};
+}
+}
\ No newline at end of file
@@ -8,6 +8,8 @@
 #include "VKFramebuffer.h"
 #include "VKDescriptorPoolSet.h"
 #include "VKAccelerationStructure.h"
+#include "VKQueryPool.h"
+#include "base/GpuProfiler.h"
 
 using namespace miru;
 using namespace vulkan;
@@ -27,6 +29,14 @@ CommandPool::CommandPool(CommandPool::CreateInfo* pCreateInfo)
 
 	MIRU_FATAL(vkCreateCommandPool(m_Device, &m_CmdPoolCI, nullptr, &m_CmdPool), "ERROR: VULKAN: Failed to create CommandPool.");
 	VKSetName<VkCommandPool>(m_Device, m_CmdPool, m_CI.debugName);
+
+	const ContextRef& context = ref_cast<Context>(m_CI.context);
+	m_QueueFamilyIndex = m_CmdPoolCI.queueFamilyIndex;
+	const uint32_t& queueCount = static_cast<uint32_t>(context->m_Queues[m_QueueFamilyIndex].size());
+	MIRU_WARN(m_CI.queueIndex >= queueCount, "WARN: VULKAN: CommandPool::CreateInfo::queueIndex exceeds the queue count of the queue family. Using the last queue.");
+	m_QueueIndex = std::min(m_CI.queueIndex, queueCount - 1);
+	m_Queue = context->m_Queues[m_QueueFamilyIndex][m_QueueIndex];
+	m_QueueMutex = context->m_QueueMutexes[m_QueueFamilyIndex][m_QueueIndex].get();
 }
 
 CommandPool::~CommandPool()
@@ -50,6 +60,59 @@ void CommandPool::Reset(bool releaseResources)
 	MIRU_FATAL(vkResetCommandPool(m_Device, m_CmdPool, releaseResources ? VK_COMMAND_POOL_RESET_RELEASE_RESOURCES_BIT : 0), "ERROR: VULKAN: Failed to reset CommandPool.");
 }
 
+bool CommandPool::GetCalibratedTimestamps(uint64_t& gpuTimestamp, uint64_t& cpuTimestamp)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	if (!vkGetPhysicalDeviceCalibrateableTimeDomainsEXT || !vkGetCalibratedTimestampsEXT)
+		return false;
+
+	//The host time domain of std::chrono::steady_clock.
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+	const VkTimeDomainEXT hostTimeDomain = VK_TIME_DOMAIN_QUERY_PERFORMANCE_COUNTER_EXT;
+#else
+	const VkTimeDomainEXT hostTimeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+#endif
+
+	const ContextRef& context = ref_cast<Context>(m_CI.context);
+	VkTimeDomainEXT timeDomains[8];
+	uint32_t timeDomainCount = static_cast<uint32_t>(std::size(timeDomains));
+	vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(context->m_PhysicalDevices.m_PDIs[context->m_PhysicalDeviceIndex].m_PhysicalDevice, &timeDomainCount, timeDomains);
+	bool deviceTimeDomainSupported = false;
+	bool hostTimeDomainSupported = false;
+	for (uint32_t i = 0; i < timeDomainCount; i++)
+	{
+		deviceTimeDomainSupported |= timeDomains[i] == VK_TIME_DOMAIN_DEVICE_EXT;
+		hostTimeDomainSupported |= timeDomains[i] == hostTimeDomain;
+	}
+	if (!deviceTimeDomainSupported || !hostTimeDomainSupported)
+		return false;
+
+	VkCalibratedTimestampInfoEXT timestampInfos[2];
+	timestampInfos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+	timestampInfos[0].pNext = nullptr;
+	timestampInfos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+	timestampInfos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+	timestampInfos[1].pNext = nullptr;
+	timestampInfos[1].timeDomain = hostTimeDomain;
+
+	uint64_t timestamps[2];
+	uint64_t maxDeviation = 0;
+	if (vkGetCalibratedTimestampsEXT(m_Device, 2, timestampInfos, timestamps, &maxDeviation) != VK_SUCCESS)
+		return false;
+
+	gpuTimestamp = timestamps[0];
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	const uint64_t& ticksPerSecond = static_cast<uint64_t>(frequency.QuadPart);
+	cpuTimestamp = (timestamps[1] / ticksPerSecond) * 1000000000 + (timestamps[1] % ticksPerSecond) * 1000000000 / ticksPerSecond;
+#else
+	cpuTimestamp = timestamps[1];
+#endif
+	return true;
+}
+
 uint32_t CommandPool::GetQueueFamilyIndex(const CommandPool::QueueType& type)
 {
 	uint32_t index = 0;
@@ -105,6 +168,10 @@ CommandBuffer::CommandBuffer(CommandBuffer::CreateInfo* pCreateInfo)
 	}
 	
 	m_CmdBufferBIs.resize(m_CI.commandBufferCount);
+	m_BoundStates.resize(m_CI.commandBufferCount);
+	m_Scratch.resize(m_CI.commandBufferCount);
+	m_PendingBarriers.resize(m_CI.commandBufferCount);
+	m_TrackedResources.resize(m_CI.commandBufferCount);
 }
 
 CommandBuffer::~CommandBuffer()
@@ -126,6 +193,55 @@ void CommandBuffer::Begin(uint32_t index, UsageBit usage)
 	m_CmdBufferBIs[index].pInheritanceInfo = nullptr;
 
 	MIRU_FATAL(vkBeginCommandBuffer(m_CmdBuffers[index], &m_CmdBufferBIs[index]), "ERROR: VULKAN: Failed to begin CommandBuffer.");
+	ResetBoundState(index);
+	ResetResourceStates(index);
+	ClearPendingBarriers(index);
+}
+
+void CommandBuffer::Begin(uint32_t index, UsageBit usage, const InheritanceInfo& inheritanceInfo)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	MIRU_FATAL(m_CI.level != Level::SECONDARY, "ERROR: VULKAN: Only secondary CommandBuffers can begin with InheritanceInfo.");
+
+	std::vector<VkFormat> colourAttachmentFormats;
+	colourAttachmentFormats.reserve(inheritanceInfo.colourAttachmentFormats.size());
+	for (const auto& format : inheritanceInfo.colourAttachmentFormats)
+		colourAttachmentFormats.push_back(static_cast<VkFormat>(format));
+
+	VkCommandBufferInheritanceRenderingInfo vkInheritanceRenderingInfo;
+	vkInheritanceRenderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+	vkInheritanceRenderingInfo.pNext = nullptr;
+	vkInheritanceRenderingInfo.flags = static_cast<VkRenderingFlags>(inheritanceInfo.renderingFlags) & ~VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+	vkInheritanceRenderingInfo.viewMask = inheritanceInfo.viewMask;
+	vkInheritanceRenderingInfo.colorAttachmentCount = static_cast<uint32_t>(colourAttachmentFormats.size());
+	vkInheritanceRenderingInfo.pColorAttachmentFormats = colourAttachmentFormats.data();
+	vkInheritanceRenderingInfo.depthAttachmentFormat = static_cast<VkFormat>(inheritanceInfo.depthAttachmentFormat);
+	vkInheritanceRenderingInfo.stencilAttachmentFormat = static_cast<VkFormat>(inheritanceInfo.stencilAttachmentFormat);
+	vkInheritanceRenderingInfo.rasterizationSamples = static_cast<VkSampleCountFlagBits>(inheritanceInfo.rasterisationSamples);
+
+	const base::FramebufferRef& framebuffer = inheritanceInfo.framebuffer;
+	VkCommandBufferInheritanceInfo vkInheritanceInfo;
+	vkInheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	vkInheritanceInfo.pNext = framebuffer ? nullptr : &vkInheritanceRenderingInfo;
+	vkInheritanceInfo.renderPass = framebuffer ? ref_cast<RenderPass>(framebuffer->GetCreateInfo().renderPass)->m_RenderPass : VK_NULL_HANDLE;
+	vkInheritanceInfo.subpass = framebuffer ? inheritanceInfo.subpass : 0;
+	vkInheritanceInfo.framebuffer = framebuffer ? ref_cast<Framebuffer>(framebuffer)->m_Framebuffer : VK_NULL_HANDLE;
+	vkInheritanceInfo.occlusionQueryEnable = VK_FALSE;
+	vkInheritanceInfo.queryFlags = 0;
+	vkInheritanceInfo.pipelineStatistics = 0;
+
+	m_CmdBufferBIs[index].sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	m_CmdBufferBIs[index].pNext = nullptr;
+	m_CmdBufferBIs[index].flags = static_cast<VkCommandBufferUsageFlags>(usage | UsageBit::RENDEER_PASS_CONTINUE);
+	m_CmdBufferBIs[index].pInheritanceInfo = &vkInheritanceInfo;
+
+	MIRU_FATAL(vkBeginCommandBuffer(m_CmdBuffers[index], &m_CmdBufferBIs[index]), "ERROR: VULKAN: Failed to begin CommandBuffer.");
+	m_CmdBufferBIs[index].pInheritanceInfo = nullptr;
+	ResetBoundState(index);
+	ResetResourceStates(index);
+	ClearPendingBarriers(index);
 }
 
 void CommandBuffer::End(uint32_t index)
@@ -133,6 +249,7 @@ void CommandBuffer::End(uint32_t index)
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 	MIRU_FATAL(vkEndCommandBuffer(m_CmdBuffers[index]), "ERROR: VULKAN: Failed to end CommandBuffer.");
 }
 
@@ -152,6 +269,7 @@ void CommandBuffer::ExecuteSecondaryCommandBuffers(uint32_t index, const base::C
 		return;
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 	
 	std::vector<VkCommandBuffer>secondaryCmdBuffers;
 	for (auto& secondaryIndex : secondaryCommandBufferIndices)
@@ -161,6 +279,7 @@ void CommandBuffer::ExecuteSecondaryCommandBuffers(uint32_t index, const base::C
 	}
 	
 	vkCmdExecuteCommands(m_CmdBuffers[index], static_cast<uint32_t>(secondaryCmdBuffers.size()), secondaryCmdBuffers.data());
+	InvalidateBoundState(index);
 }
 
 void CommandBuffer::Submit(const std::vector<base::CommandBuffer::SubmitInfo>& submitInfos, const base::FenceRef& fence)
@@ -195,6 +314,7 @@ void CommandBuffer::Submit(const std::vector<base::CommandBuffer::SubmitInfo>& s
 		{
 			if (index < m_CI.commandBufferCount)
 				vkCmdBuffers.back().push_back(m_CmdBuffers[index]);
+			CommitResourceStates(index);
 		}
 
 		vkSignals.push_back({});
@@ -230,10 +350,10 @@ void CommandBuffer::Submit(const std::vector<base::CommandBuffer::SubmitInfo>& s
 
 	VkFence vkFence = fence ? ref_cast<Fence>(fence)->m_Fence : VK_NULL_HANDLE;
 
-	const ContextRef& context = ref_cast<Context>(m_CI.commandPool->GetCreateInfo().context);
 	const CommandPoolRef& pool = ref_cast<CommandPool>(m_CI.commandPool);
-	VkQueue queue = context->m_Queues[pool->GetQueueFamilyIndex(pool->GetCreateInfo().queueType)][0];
+	VkQueue queue = pool->m_Queue;
 
+	std::lock_guard<std::mutex> lock(*pool->m_QueueMutex);
 	MIRU_FATAL(vkQueueSubmit(queue, static_cast<uint32_t>(vkSubmitInfos.size()), vkSubmitInfos.data(), vkFence), "ERROR: VULKAN: Failed to submit Queue.");
 }
 
@@ -274,6 +394,7 @@ void CommandBuffer::Submit2(const std::vector<base::CommandBuffer::SubmitInfo2>&
 			commandBufferSubmitInfo.commandBuffer = m_CmdBuffers[commandBufferInfo.index];
 			commandBufferSubmitInfo.deviceMask = commandBufferInfo.deviceMask;
 			vkCommandBufferInfos.back().push_back(commandBufferSubmitInfo);
+			CommitResourceStates(commandBufferInfo.index);
 		}
 		vkSignalSemaphoreInfos.push_back({});
 		for (const auto& signalInfo : submitInfo2.signalSemaphoreInfos)
@@ -303,10 +424,10 @@ void CommandBuffer::Submit2(const std::vector<base::CommandBuffer::SubmitInfo2>&
 
 	VkFence vkFence = fence ? ref_cast<Fence>(fence)->m_Fence : VK_NULL_HANDLE;
 
-	const ContextRef& context = ref_cast<Context>(m_CI.commandPool->GetCreateInfo().context);
 	const CommandPoolRef& pool = ref_cast<CommandPool>(m_CI.commandPool);
-	VkQueue queue = context->m_Queues[pool->GetQueueFamilyIndex(pool->GetCreateInfo().queueType)][0];
+	VkQueue queue = pool->m_Queue;
 
+	std::lock_guard<std::mutex> lock(*pool->m_QueueMutex);
 	vkQueueSubmit2(queue, static_cast<uint32_t>(vkSubmitInfo2s.size()), vkSubmitInfo2s.data(), vkFence);
 }
 
@@ -315,6 +436,7 @@ void CommandBuffer::SetEvent(uint32_t index, const base::EventRef& event, base::
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 	vkCmdSetEvent(m_CmdBuffers[index], ref_cast<Event>(event)->m_Event, static_cast<VkPipelineStageFlags>(pipelineStage));
 }
 
@@ -323,6 +445,7 @@ void CommandBuffer::ResetEvent(uint32_t index, const base::EventRef& event, base
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 	vkCmdResetEvent(m_CmdBuffers[index], ref_cast<Event>(event)->m_Event, static_cast<VkPipelineStageFlags>(pipelineStage));
 }
 
@@ -331,38 +454,81 @@ void CommandBuffer::WaitEvents(uint32_t index, const std::vector<base::EventRef>
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
 
-	std::vector<VkEvent>vkEvents;
-	vkEvents.reserve(events.size());
-	for (auto& event : events)
-		vkEvents.push_back(ref_cast<Event>(event)->m_Event);
+	VkEvent* vkEvents = m_Scratch[index].Allocate<VkEvent>(events.size());
+	for (size_t i = 0; i < events.size(); i++)
+		vkEvents[i] = static_cast<const Event*>(events[i].get())->m_Event;
 
-	std::vector<VkMemoryBarrier>vkMemoryBarriers;
-	std::vector<VkBufferMemoryBarrier>vkBufferBarriers;
-	std::vector<VkImageMemoryBarrier>vkImageBarriers;
+	uint32_t vkMemoryBarrierCount = 0, vkBufferBarrierCount = 0, vkImageBarrierCount = 0;
+	VkMemoryBarrier* vkMemoryBarriers = m_Scratch[index].Allocate<VkMemoryBarrier>(barriers.size());
+	VkBufferMemoryBarrier* vkBufferBarriers = m_Scratch[index].Allocate<VkBufferMemoryBarrier>(barriers.size());
+	VkImageMemoryBarrier* vkImageBarriers = m_Scratch[index].Allocate<VkImageMemoryBarrier>(barriers.size());
 	for (auto& barrier : barriers)
 	{
-		const BarrierRef& _barrier = ref_cast<Barrier>(barrier);
-		switch (_barrier->GetCreateInfo().type)
+		const Barrier* _barrier = static_cast<const Barrier*>(barrier.get());
+		switch (barrier->GetCreateInfo().type)
 		{
 		case Barrier::Type::MEMORY:
-			vkMemoryBarriers.push_back(_barrier->m_MB); continue;
+			vkMemoryBarriers[vkMemoryBarrierCount++] = _barrier->m_MB; continue;
 		case Barrier::Type::BUFFER:
-			vkBufferBarriers.push_back(_barrier->m_BMB); continue;
+			vkBufferBarriers[vkBufferBarrierCount++] = _barrier->m_BMB; continue;
 		case Barrier::Type::IMAGE:
-			vkImageBarriers.push_back(_barrier->m_IMB); continue;
+			vkImageBarriers[vkImageBarrierCount++] = _barrier->m_IMB; continue;
 		default:
 			continue;
 		}
 	}
 
 	vkCmdWaitEvents(m_CmdBuffers[index],
-		static_cast<uint32_t>(vkEvents.size()), vkEvents.data(),
-		static_cast<VkPipelineStageFlags>(srcStage), static_cast<VkPipelineStageFlags>(srcStage),
-		static_cast<uint32_t>(vkMemoryBarriers.size()), vkMemoryBarriers.data(),
-		static_cast<uint32_t>(vkBufferBarriers.size()), vkBufferBarriers.data(),
-		static_cast<uint32_t>(vkImageBarriers.size()), vkImageBarriers.data());
+		static_cast<uint32_t>(events.size()), vkEvents,
+		static_cast<VkPipelineStageFlags>(srcStage), static_cast<VkPipelineStageFlags>(dstStage),
+		vkMemoryBarrierCount, vkMemoryBarriers,
+		vkBufferBarrierCount, vkBufferBarriers,
+		vkImageBarrierCount, vkImageBarriers);
+}
 
+void CommandBuffer::WaitEvents(uint32_t index, const base::EventRef* pEvents, uint32_t eventCount, base::PipelineStageBit srcStage, base::PipelineStageBit dstStage, const base::BarrierHandle* pBarriers, uint32_t barrierCount)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+
+	VkEvent* vkEvents = m_Scratch[index].Allocate<VkEvent>(eventCount);
+	for (uint32_t i = 0; i < eventCount; i++)
+		vkEvents[i] = static_cast<const Event*>(pEvents[i].get())->m_Event;
+
+	uint32_t vkMemoryBarrierCount = 0, vkBufferBarrierCount = 0, vkImageBarrierCount = 0;
+	VkMemoryBarrier* vkMemoryBarriers = m_Scratch[index].Allocate<VkMemoryBarrier>(barrierCount);
+	VkBufferMemoryBarrier* vkBufferBarriers = m_Scratch[index].Allocate<VkBufferMemoryBarrier>(barrierCount);
+	VkImageMemoryBarrier* vkImageBarriers = m_Scratch[index].Allocate<VkImageMemoryBarrier>(barrierCount);
+	for (uint32_t i = 0; i < barrierCount; i++)
+	{
+		base::Barrier* barrier = base::GetHandleObject(pBarriers[i]);
+		MIRU_FATAL(!barrier, "ERROR: VULKAN: Invalid BarrierHandle.");
+		const Barrier* _barrier = static_cast<const Barrier*>(barrier);
+		switch (barrier->GetCreateInfo().type)
+		{
+		case Barrier::Type::MEMORY:
+			vkMemoryBarriers[vkMemoryBarrierCount++] = _barrier->m_MB; continue;
+		case Barrier::Type::BUFFER:
+			vkBufferBarriers[vkBufferBarrierCount++] = _barrier->m_BMB; continue;
+		case Barrier::Type::IMAGE:
+			vkImageBarriers[vkImageBarrierCount++] = _barrier->m_IMB; continue;
+		default:
+			continue;
+		}
+	}
+
+	vkCmdWaitEvents(m_CmdBuffers[index],
+		eventCount, vkEvents,
+		static_cast<VkPipelineStageFlags>(srcStage), static_cast<VkPipelineStageFlags>(dstStage),
+		vkMemoryBarrierCount, vkMemoryBarriers,
+		vkBufferBarrierCount, vkBufferBarriers,
+		vkImageBarrierCount, vkImageBarriers);
 }
 
 void CommandBuffer::PipelineBarrier(uint32_t index, base::PipelineStageBit srcStage, base::PipelineStageBit dstStage, base::DependencyBit dependencies, const std::vector<base::BarrierRef>& barriers)
@@ -370,21 +536,24 @@ void CommandBuffer::PipelineBarrier(uint32_t index, base::PipelineStageBit srcSt
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
 
-	std::vector<VkMemoryBarrier> vkMemoryBarriers;
-	std::vector<VkBufferMemoryBarrier> vkBufferBarriers;
-	std::vector<VkImageMemoryBarrier> vkImageBarriers;
+	uint32_t vkMemoryBarrierCount = 0, vkBufferBarrierCount = 0, vkImageBarrierCount = 0;
+	VkMemoryBarrier* vkMemoryBarriers = m_Scratch[index].Allocate<VkMemoryBarrier>(barriers.size());
+	VkBufferMemoryBarrier* vkBufferBarriers = m_Scratch[index].Allocate<VkBufferMemoryBarrier>(barriers.size());
+	VkImageMemoryBarrier* vkImageBarriers = m_Scratch[index].Allocate<VkImageMemoryBarrier>(barriers.size());
 	for (auto& barrier : barriers)
 	{
-		const BarrierRef& _barrier = ref_cast<Barrier>(barrier);
-		switch (_barrier->GetCreateInfo().type)
+		const Barrier* _barrier = static_cast<const Barrier*>(barrier.get());
+		switch (barrier->GetCreateInfo().type)
 		{
 		case Barrier::Type::MEMORY:
-			vkMemoryBarriers.push_back(_barrier->m_MB); continue;
+			vkMemoryBarriers[vkMemoryBarrierCount++] = _barrier->m_MB; continue;
 		case Barrier::Type::BUFFER:
-			vkBufferBarriers.push_back(_barrier->m_BMB); continue;
+			vkBufferBarriers[vkBufferBarrierCount++] = _barrier->m_BMB; continue;
 		case Barrier::Type::IMAGE:
-			vkImageBarriers.push_back(_barrier->m_IMB); continue;
+			vkImageBarriers[vkImageBarrierCount++] = _barrier->m_IMB; continue;
 		default:
 			continue;
 		}
@@ -392,9 +561,9 @@ void CommandBuffer::PipelineBarrier(uint32_t index, base::PipelineStageBit srcSt
 
 	vkCmdPipelineBarrier(m_CmdBuffers[index],
 		static_cast<VkPipelineStageFlags>(srcStage), static_cast<VkPipelineStageFlags>(dstStage), static_cast<VkDependencyFlags>(dependencies),
-		static_cast<uint32_t>(vkMemoryBarriers.size()), vkMemoryBarriers.data(),
-		static_cast<uint32_t>(vkBufferBarriers.size()), vkBufferBarriers.data(),
-		static_cast<uint32_t>(vkImageBarriers.size()), vkImageBarriers.data());
+		vkMemoryBarrierCount, vkMemoryBarriers,
+		vkBufferBarrierCount, vkBufferBarriers,
+		vkImageBarrierCount, vkImageBarriers);
 }
 
 void CommandBuffer::PipelineBarrier2(uint32_t index, const base::CommandBuffer::DependencyInfo& dependencyInfo)
@@ -402,21 +571,31 @@ void CommandBuffer::PipelineBarrier2(uint32_t index, const base::CommandBuffer::
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	if (m_CI.deferBarriers)
+	{
+		for (auto& barrier : dependencyInfo.barriers)
+			QueueBarrier(index, static_cast<VkDependencyFlags>(dependencyInfo.dependencies), static_cast<const Barrier2*>(barrier.get()));
+		return;
+	}
+
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
 
-	std::vector<VkMemoryBarrier2> vkMemoryBarriers;
-	std::vector<VkBufferMemoryBarrier2> vkBufferBarriers;
-	std::vector<VkImageMemoryBarrier2> vkImageBarriers;
-	for (auto& barrier : dependencyInfo.barriers)
+	const std::vector<base::Barrier2Ref>& barriers = dependencyInfo.barriers;
+	uint32_t vkMemoryBarrierCount = 0, vkBufferBarrierCount = 0, vkImageBarrierCount = 0;
+	VkMemoryBarrier2* vkMemoryBarriers = m_Scratch[index].Allocate<VkMemoryBarrier2>(barriers.size());
+	VkBufferMemoryBarrier2* vkBufferBarriers = m_Scratch[index].Allocate<VkBufferMemoryBarrier2>(barriers.size());
+	VkImageMemoryBarrier2* vkImageBarriers = m_Scratch[index].Allocate<VkImageMemoryBarrier2>(barriers.size());
+	for (auto& barrier : barriers)
 	{
-		const Barrier2Ref& _barrier = ref_cast<Barrier2>(barrier);
-		switch (_barrier->GetCreateInfo().type)
+		const Barrier2* _barrier = static_cast<const Barrier2*>(barrier.get());
+		switch (barrier->GetCreateInfo().type)
 		{
 		case Barrier::Type::MEMORY:
-			vkMemoryBarriers.push_back(_barrier->m_MB); continue;
+			vkMemoryBarriers[vkMemoryBarrierCount++] = _barrier->m_MB; continue;
 		case Barrier::Type::BUFFER:
-			vkBufferBarriers.push_back(_barrier->m_BMB); continue;
+			vkBufferBarriers[vkBufferBarrierCount++] = _barrier->m_BMB; continue;
 		case Barrier::Type::IMAGE:
-			vkImageBarriers.push_back(_barrier->m_IMB); continue;
+			vkImageBarriers[vkImageBarrierCount++] = _barrier->m_IMB; continue;
 		default:
 			continue;
 		}
@@ -426,81 +605,318 @@ void CommandBuffer::PipelineBarrier2(uint32_t index, const base::CommandBuffer::
 	vkDependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
 	vkDependencyInfo.pNext = nullptr;
 	vkDependencyInfo.dependencyFlags = static_cast<VkDependencyFlags>(dependencyInfo.dependencies);
-	vkDependencyInfo.memoryBarrierCount = static_cast<uint32_t>(vkMemoryBarriers.size());
-	vkDependencyInfo.pMemoryBarriers = vkMemoryBarriers.data();
-	vkDependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(vkBufferBarriers.size());
-	vkDependencyInfo.pBufferMemoryBarriers = vkBufferBarriers.data();
-	vkDependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(vkImageBarriers.size());
-	vkDependencyInfo.pImageMemoryBarriers = vkImageBarriers.data();
+	vkDependencyInfo.memoryBarrierCount = vkMemoryBarrierCount;
+	vkDependencyInfo.pMemoryBarriers = vkMemoryBarriers;
+	vkDependencyInfo.bufferMemoryBarrierCount = vkBufferBarrierCount;
+	vkDependencyInfo.pBufferMemoryBarriers = vkBufferBarriers;
+	vkDependencyInfo.imageMemoryBarrierCount = vkImageBarrierCount;
+	vkDependencyInfo.pImageMemoryBarriers = vkImageBarriers;
 	
 	vkCmdPipelineBarrier2(m_CmdBuffers[index], &vkDependencyInfo);
 }
 
-void CommandBuffer::ClearColourImage(uint32_t index, const base::ImageRef& image, base::Image::Layout layout, const base::Image::ClearColourValue& clear, const std::vector<base::Image::SubresourceRange>& subresourceRanges)
+void CommandBuffer::PipelineBarrier(uint32_t index, base::PipelineStageBit srcStage, base::PipelineStageBit dstStage, base::DependencyBit dependencies, const base::BarrierHandle* pBarriers, uint32_t barrierCount)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+
+	uint32_t vkMemoryBarrierCount = 0, vkBufferBarrierCount = 0, vkImageBarrierCount = 0;
+	VkMemoryBarrier* vkMemoryBarriers = m_Scratch[index].Allocate<VkMemoryBarrier>(barrierCount);
+	VkBufferMemoryBarrier* vkBufferBarriers = m_Scratch[index].Allocate<VkBufferMemoryBarrier>(barrierCount);
+	VkImageMemoryBarrier* vkImageBarriers = m_Scratch[index].Allocate<VkImageMemoryBarrier>(barrierCount);
+	for (uint32_t i = 0; i < barrierCount; i++)
+	{
+		base::Barrier* barrier = base::GetHandleObject(pBarriers[i]);
+		MIRU_FATAL(!barrier, "ERROR: VULKAN: Invalid BarrierHandle.");
+		const Barrier* _barrier = static_cast<const Barrier*>(barrier);
+		switch (barrier->GetCreateInfo().type)
+		{
+		case Barrier::Type::MEMORY:
+			vkMemoryBarriers[vkMemoryBarrierCount++] = _barrier->m_MB; continue;
+		case Barrier::Type::BUFFER:
+			vkBufferBarriers[vkBufferBarrierCount++] = _barrier->m_BMB; continue;
+		case Barrier::Type::IMAGE:
+			vkImageBarriers[vkImageBarrierCount++] = _barrier->m_IMB; continue;
+		default:
+			continue;
+		}
+	}
+
+	vkCmdPipelineBarrier(m_CmdBuffers[index],
+		static_cast<VkPipelineStageFlags>(srcStage), static_cast<VkPipelineStageFlags>(dstStage), static_cast<VkDependencyFlags>(dependencies),
+		vkMemoryBarrierCount, vkMemoryBarriers,
+		vkBufferBarrierCount, vkBufferBarriers,
+		vkImageBarrierCount, vkImageBarriers);
+}
+
+void CommandBuffer::PipelineBarrier2(uint32_t index, base::DependencyBit dependencies, const base::Barrier2Handle* pBarriers, uint32_t barrierCount)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	if (m_CI.deferBarriers)
+	{
+		for (uint32_t i = 0; i < barrierCount; i++)
+		{
+			base::Barrier2* barrier = base::GetHandleObject(pBarriers[i]);
+			MIRU_FATAL(!barrier, "ERROR: VULKAN: Invalid Barrier2Handle.");
+			QueueBarrier(index, static_cast<VkDependencyFlags>(dependencies), static_cast<const Barrier2*>(barrier));
+		}
+		return;
+	}
+
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+
+	uint32_t vkMemoryBarrierCount = 0, vkBufferBarrierCount = 0, vkImageBarrierCount = 0;
+	VkMemoryBarrier2* vkMemoryBarriers = m_Scratch[index].Allocate<VkMemoryBarrier2>(barrierCount);
+	VkBufferMemoryBarrier2* vkBufferBarriers = m_Scratch[index].Allocate<VkBufferMemoryBarrier2>(barrierCount);
+	VkImageMemoryBarrier2* vkImageBarriers = m_Scratch[index].Allocate<VkImageMemoryBarrier2>(barrierCount);
+	for (uint32_t i = 0; i < barrierCount; i++)
+	{
+		base::Barrier2* barrier = base::GetHandleObject(pBarriers[i]);
+		MIRU_FATAL(!barrier, "ERROR: VULKAN: Invalid Barrier2Handle.");
+		const Barrier2* _barrier = static_cast<const Barrier2*>(barrier);
+		switch (barrier->GetCreateInfo().type)
+		{
+		case Barrier::Type::MEMORY:
+			vkMemoryBarriers[vkMemoryBarrierCount++] = _barrier->m_MB; continue;
+		case Barrier::Type::BUFFER:
+			vkBufferBarriers[vkBufferBarrierCount++] = _barrier->m_BMB; continue;
+		case Barrier::Type::IMAGE:
+			vkImageBarriers[vkImageBarrierCount++] = _barrier->m_IMB; continue;
+		default:
+			continue;
+		}
+	}
+
+	VkDependencyInfo vkDependencyInfo;
+	vkDependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	vkDependencyInfo.pNext = nullptr;
+	vkDependencyInfo.dependencyFlags = static_cast<VkDependencyFlags>(dependencies);
+	vkDependencyInfo.memoryBarrierCount = vkMemoryBarrierCount;
+	vkDependencyInfo.pMemoryBarriers = vkMemoryBarriers;
+	vkDependencyInfo.bufferMemoryBarrierCount = vkBufferBarrierCount;
+	vkDependencyInfo.pBufferMemoryBarriers = vkBufferBarriers;
+	vkDependencyInfo.imageMemoryBarrierCount = vkImageBarrierCount;
+	vkDependencyInfo.pImageMemoryBarriers = vkImageBarriers;
+
+	vkCmdPipelineBarrier2(m_CmdBuffers[index], &vkDependencyInfo);
+}
+
+void CommandBuffer::FlushBarriers(uint32_t index)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	const PendingBarriers& pending = m_PendingBarriers[index];
+	if (pending.memoryBarriers.empty() && pending.bufferBarriers.empty() && pending.imageBarriers.empty())
+		return;
+
+	VkDependencyInfo vkDependencyInfo;
+	vkDependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	vkDependencyInfo.pNext = nullptr;
+	vkDependencyInfo.dependencyFlags = pending.dependencies;
+	vkDependencyInfo.memoryBarrierCount = static_cast<uint32_t>(pending.memoryBarriers.size());
+	vkDependencyInfo.pMemoryBarriers = pending.memoryBarriers.data();
+	vkDependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(pending.bufferBarriers.size());
+	vkDependencyInfo.pBufferMemoryBarriers = pending.bufferBarriers.data();
+	vkDependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(pending.imageBarriers.size());
+	vkDependencyInfo.pImageMemoryBarriers = pending.imageBarriers.data();
+
+	vkCmdPipelineBarrier2(m_CmdBuffers[index], &vkDependencyInfo);
+	ClearPendingBarriers(index);
+}
+
+void CommandBuffer::QueueBarrier(uint32_t index, VkDependencyFlags dependencies, const Barrier2* barrier)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	//Barriers in one command are not ordered with respect to each other. A barrier that overlaps a queued barrier,
+	//but can not be merged with it, flushes the queued barriers first; e.g. consecutive layout transitions.
+	PendingBarriers& pending = m_PendingBarriers[index];
+	if (pending.dependencies != dependencies)
+	{
+		FlushBarriers(index);
+		pending.dependencies = dependencies;
+	}
+
+	auto MergeMasks = [](auto& pendingBarrier, const auto& barrier)
+	{
+		pendingBarrier.srcStageMask |= barrier.srcStageMask;
+		pendingBarrier.srcAccessMask |= barrier.srcAccessMask;
+		pendingBarrier.dstStageMask |= barrier.dstStageMask;
+		pendingBarrier.dstAccessMask |= barrier.dstAccessMask;
+	};
+	//Ranges are [base, end). A count of VK_WHOLE_SIZE or VK_REMAINING_* extends the range to UINT64_MAX.
+	auto End = [](uint64_t base, uint64_t count, uint64_t remaining) -> uint64_t { return count == remaining ? UINT64_MAX : base + count; };
+	auto Count = [](uint64_t base, uint64_t end, uint64_t remaining) -> uint64_t { return end == UINT64_MAX ? remaining : end - base; };
+
+	switch (barrier->GetCreateInfo().type)
+	{
+	case Barrier::Type::MEMORY:
+	{
+		if (pending.memoryBarriers.empty())
+			pending.memoryBarriers.push_back(barrier->m_MB);
+		else
+			MergeMasks(pending.memoryBarriers[0], barrier->m_MB);
+		return;
+	}
+	case Barrier::Type::BUFFER:
+	{
+		const VkBufferMemoryBarrier2& bmb = barrier->m_BMB;
+		const uint64_t& end = End(bmb.offset, bmb.size, VK_WHOLE_SIZE);
+		for (VkBufferMemoryBarrier2& pendingBMB : pending.bufferBarriers)
+		{
+			if (pendingBMB.buffer != bmb.buffer)
+				continue;
+
+			const uint64_t& pendingEnd = End(pendingBMB.offset, pendingBMB.size, VK_WHOLE_SIZE);
+			const bool& sameQueueFamilies = pendingBMB.srcQueueFamilyIndex == bmb.srcQueueFamilyIndex && pendingBMB.dstQueueFamilyIndex == bmb.dstQueueFamilyIndex;
+			if (sameQueueFamilies && pendingBMB.offset <= end && bmb.offset <= pendingEnd)
+			{
+				MergeMasks(pendingBMB, bmb);
+				pendingBMB.offset = std::min(pendingBMB.offset, bmb.offset);
+				pendingBMB.size = Count(pendingBMB.offset, std::max(pendingEnd, end), VK_WHOLE_SIZE);
+				return;
+			}
+			if (pendingBMB.offset < end && bmb.offset < pendingEnd)
+			{
+				FlushBarriers(index);
+				pending.dependencies = dependencies; //Cleared by the flush.
+				break;
+			}
+		}
+		pending.bufferBarriers.push_back(bmb);
+		return;
+	}
+	case Barrier::Type::IMAGE:
+	{
+		const VkImageMemoryBarrier2& imb = barrier->m_IMB;
+		const VkImageSubresourceRange& range = imb.subresourceRange;
+		const uint64_t& mipEnd = End(range.baseMipLevel, range.levelCount, VK_REMAINING_MIP_LEVELS);
+		const uint64_t& layerEnd = End(range.baseArrayLayer, range.layerCount, VK_REMAINING_ARRAY_LAYERS);
+		for (VkImageMemoryBarrier2& pendingIMB : pending.imageBarriers)
+		{
+			if (pendingIMB.image != imb.image)
+				continue;
+
+			VkImageSubresourceRange& pendingRange = pendingIMB.subresourceRange;
+			const uint64_t& pendingMipEnd = End(pendingRange.baseMipLevel, pendingRange.levelCount, VK_REMAINING_MIP_LEVELS);
+			const uint64_t& pendingLayerEnd = End(pendingRange.baseArrayLayer, pendingRange.layerCount, VK_REMAINING_ARRAY_LAYERS);
+			const bool& sameTransition = pendingIMB.oldLayout == imb.oldLayout && pendingIMB.newLayout == imb.newLayout
+				&& pendingIMB.srcQueueFamilyIndex == imb.srcQueueFamilyIndex && pendingIMB.dstQueueFamilyIndex == imb.dstQueueFamilyIndex
+				&& pendingRange.aspectMask == range.aspectMask;
+			const bool& sameMips = pendingRange.baseMipLevel == range.baseMipLevel && pendingMipEnd == mipEnd;
+			const bool& sameLayers = pendingRange.baseArrayLayer == range.baseArrayLayer && pendingLayerEnd == layerEnd;
+			const bool& adjacentMips = pendingRange.baseMipLevel <= mipEnd && range.baseMipLevel <= pendingMipEnd;
+			const bool& adjacentLayers = pendingRange.baseArrayLayer <= layerEnd && range.baseArrayLayer <= pendingLayerEnd;
+			if (sameTransition && ((sameLayers && adjacentMips) || (sameMips && adjacentLayers)))
+			{
+				//The union of the two ranges is a single range.
+				MergeMasks(pendingIMB, imb);
+				pendingRange.baseMipLevel = std::min(pendingRange.baseMipLevel, range.baseMipLevel);
+				pendingRange.levelCount = static_cast<uint32_t>(Count(pendingRange.baseMipLevel, std::max(pendingMipEnd, mipEnd), VK_REMAINING_MIP_LEVELS));
+				pendingRange.baseArrayLayer = std::min(pendingRange.baseArrayLayer, range.baseArrayLayer);
+				pendingRange.layerCount = static_cast<uint32_t>(Count(pendingRange.baseArrayLayer, std::max(pendingLayerEnd, layerEnd), VK_REMAINING_ARRAY_LAYERS));
+				return;
+			}
+			if ((pendingRange.aspectMask & range.aspectMask) != 0
+				&& pendingRange.baseMipLevel < mipEnd && range.baseMipLevel < pendingMipEnd
+				&& pendingRange.baseArrayLayer < layerEnd && range.baseArrayLayer < pendingLayerEnd)
+			{
+				FlushBarriers(index);
+				pending.dependencies = dependencies; //Cleared by the flush.
+				break;
+			}
+		}
+		pending.imageBarriers.push_back(imb);
+		return;
+	}
+	default:
+		return;
+	}
+}
+
+void CommandBuffer::ClearPendingBarriers(uint32_t index)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	PendingBarriers& pending = m_PendingBarriers[index];
+	pending.dependencies = 0;
+	pending.memoryBarriers.clear();
+	pending.bufferBarriers.clear();
+	pending.imageBarriers.clear();
+}
+
+void CommandBuffer::ClearColourImage(uint32_t index, const base::ImageRef& image, base::Image::Layout layout, const base::Image::ClearColourValue& clear, const base::Image::SubresourceRange* pSubresourceRanges, uint32_t subresourceRangeCount)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
 
-	std::vector<VkImageSubresourceRange> vkSubResources;
-	vkSubResources.reserve(subresourceRanges.size());
-	for (auto& subresourceRange : subresourceRanges)
-		vkSubResources.push_back({
-		static_cast<VkImageAspectFlags>(subresourceRange.aspect),
-		subresourceRange.baseMipLevel,
-		subresourceRange.mipLevelCount,
-		subresourceRange.baseArrayLayer,
-		subresourceRange.arrayLayerCount });
+	VkImageSubresourceRange* vkSubResources = m_Scratch[index].Allocate<VkImageSubresourceRange>(subresourceRangeCount);
+	for (uint32_t i = 0; i < subresourceRangeCount; i++)
+		vkSubResources[i] = {
+		static_cast<VkImageAspectFlags>(pSubresourceRanges[i].aspect),
+		pSubresourceRanges[i].baseMipLevel,
+		pSubresourceRanges[i].mipLevelCount,
+		pSubresourceRanges[i].baseArrayLayer,
+		pSubresourceRanges[i].arrayLayerCount };
 
-	VkClearColorValue* vkClearColour = (VkClearColorValue*)&clear;
+	const VkClearColorValue* vkClearColour = reinterpret_cast<const VkClearColorValue*>(&clear);
 
-	vkCmdClearColorImage(m_CmdBuffers[index], ref_cast<Image>(image)->m_Image, static_cast<VkImageLayout>(layout), vkClearColour, static_cast<uint32_t>(vkSubResources.size()), vkSubResources.data());
+	vkCmdClearColorImage(m_CmdBuffers[index], static_cast<const Image*>(image.get())->m_Image, static_cast<VkImageLayout>(layout), vkClearColour, subresourceRangeCount, vkSubResources);
 }
 
-void CommandBuffer::ClearDepthStencilImage(uint32_t index, const base::ImageRef& image, base::Image::Layout layout, const base::Image::ClearDepthStencilValue& clear, const std::vector<base::Image::SubresourceRange>& subresourceRanges)
+void CommandBuffer::ClearDepthStencilImage(uint32_t index, const base::ImageRef& image, base::Image::Layout layout, const base::Image::ClearDepthStencilValue& clear, const base::Image::SubresourceRange* pSubresourceRanges, uint32_t subresourceRangeCount)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
 
-	std::vector<VkImageSubresourceRange> vkSubResources;
-	vkSubResources.reserve(subresourceRanges.size());
-	for (auto& subresourceRange : subresourceRanges)
-		vkSubResources.push_back({
-		static_cast<VkImageAspectFlags>(subresourceRange.aspect),
-		subresourceRange.baseMipLevel,
-		subresourceRange.mipLevelCount,
-		subresourceRange.baseArrayLayer,
-		subresourceRange.arrayLayerCount });
+	VkImageSubresourceRange* vkSubResources = m_Scratch[index].Allocate<VkImageSubresourceRange>(subresourceRangeCount);
+	for (uint32_t i = 0; i < subresourceRangeCount; i++)
+		vkSubResources[i] = {
+		static_cast<VkImageAspectFlags>(pSubresourceRanges[i].aspect),
+		pSubresourceRanges[i].baseMipLevel,
+		pSubresourceRanges[i].mipLevelCount,
+		pSubresourceRanges[i].baseArrayLayer,
+		pSubresourceRanges[i].arrayLayerCount };
 
-	VkClearDepthStencilValue* vkClearDepthStencil = (VkClearDepthStencilValue*)&clear;
+	const VkClearDepthStencilValue* vkClearDepthStencil = reinterpret_cast<const VkClearDepthStencilValue*>(&clear);
 
-	vkCmdClearDepthStencilImage(m_CmdBuffers[index], ref_cast<Image>(image)->m_Image, static_cast<VkImageLayout>(layout), vkClearDepthStencil, static_cast<uint32_t>(vkSubResources.size()), vkSubResources.data());
+	vkCmdClearDepthStencilImage(m_CmdBuffers[index], static_cast<const Image*>(image.get())->m_Image, static_cast<VkImageLayout>(layout), vkClearDepthStencil, subresourceRangeCount, vkSubResources);
 }
 
-void CommandBuffer::BeginRenderPass(uint32_t index, const base::FramebufferRef& framebuffer, const std::vector<base::Image::ClearValue>& clearValues)
+void CommandBuffer::BeginRenderPass(uint32_t index, const base::FramebufferRef& framebuffer, const base::Image::ClearValue* pClearValues, uint32_t clearValueCount, SubpassContents contents)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 
-	std::vector<VkClearValue> vkClearValue;
-	vkClearValue.reserve(clearValues.size());
-	for (auto& clearValue : clearValues)
-		vkClearValue.push_back(*reinterpret_cast<const VkClearValue*>(&clearValue));
+	const Framebuffer::CreateInfo& framebufferCI = framebuffer->GetCreateInfo();
 
 	VkRenderPassBeginInfo bi;
 	bi.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 	bi.pNext = nullptr;
-	bi.renderPass = ref_cast<RenderPass>(framebuffer->GetCreateInfo().renderPass)->m_RenderPass;
-	bi.framebuffer = ref_cast<Framebuffer>(framebuffer)->m_Framebuffer;
+	bi.renderPass = static_cast<const RenderPass*>(framebufferCI.renderPass.get())->m_RenderPass;
+	bi.framebuffer = static_cast<const Framebuffer*>(framebuffer.get())->m_Framebuffer;
 	bi.renderArea.offset = { 0,0 };
-	bi.renderArea.extent.width = framebuffer->GetCreateInfo().width;
-	bi.renderArea.extent.height= framebuffer->GetCreateInfo().height;
-	bi.clearValueCount = static_cast<uint32_t>(vkClearValue.size());
-	bi.pClearValues = vkClearValue.data();
+	bi.renderArea.extent.width = framebufferCI.width;
+	bi.renderArea.extent.height= framebufferCI.height;
+	bi.clearValueCount = clearValueCount;
+	bi.pClearValues = reinterpret_cast<const VkClearValue*>(pClearValues);
 
-	vkCmdBeginRenderPass(m_CmdBuffers[index], &bi, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(m_CmdBuffers[index], &bi, static_cast<VkSubpassContents>(contents));
+	InvalidateBoundState(index);
 }
 
 void CommandBuffer::EndRenderPass(uint32_t index)
@@ -508,6 +924,7 @@ void CommandBuffer::EndRenderPass(uint32_t index)
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 	vkCmdEndRenderPass(m_CmdBuffers[index]);
 }
 
@@ -516,15 +933,20 @@ void CommandBuffer::BindPipeline(uint32_t index, const base::PipelineRef& pipeli
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	if (FilterPipeline(index, pipeline.get()))
+		return;
+
 	vkCmdBindPipeline(m_CmdBuffers[index], static_cast<VkPipelineBindPoint>(pipeline->GetCreateInfo().type), ref_cast<Pipeline>(pipeline)->m_Pipeline);
 }
 
-void CommandBuffer::NextSubpass(uint32_t index)
+void CommandBuffer::NextSubpass(uint32_t index, SubpassContents contents)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
-	vkCmdNextSubpass(m_CmdBuffers[index], VK_SUBPASS_CONTENTS_INLINE);
+	FlushBarriers(index);
+	vkCmdNextSubpass(m_CmdBuffers[index], static_cast<VkSubpassContents>(contents));
+	InvalidateBoundState(index);
 }
 
 void CommandBuffer::BeginRendering(uint32_t index, const base::RenderingInfo& renderingInfo)
@@ -532,28 +954,32 @@ void CommandBuffer::BeginRendering(uint32_t index, const base::RenderingInfo& re
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 
 	auto RenderingAttachmentInfo_To_VkRenderingAttachmentInfo = [](const base::RenderingAttachmentInfo& renderingAttachment) -> VkRenderingAttachmentInfo
 	{
 		VkRenderingAttachmentInfo vkRenderingAttachment;
 		vkRenderingAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
 		vkRenderingAttachment.pNext = nullptr;
-		vkRenderingAttachment.imageView = ref_cast<ImageView>(renderingAttachment.imageView)->m_ImageView;
+		const ImageView* imageView = static_cast<const ImageView*>(renderingAttachment.imageView.get());
+		vkRenderingAttachment.imageView = imageView->m_ImageView;
 		vkRenderingAttachment.imageLayout = static_cast<VkImageLayout>(renderingAttachment.imageLayout);
 		vkRenderingAttachment.resolveMode = static_cast<VkResolveModeFlagBits>(renderingAttachment.resolveMode);
-		vkRenderingAttachment.resolveImageView = renderingAttachment.resolveImageView ? ref_cast<ImageView>(renderingAttachment.resolveImageView)->m_ImageView : VK_NULL_HANDLE;
+		vkRenderingAttachment.resolveImageView = renderingAttachment.resolveImageView ? static_cast<const ImageView*>(renderingAttachment.resolveImageView.get())->m_ImageView : VK_NULL_HANDLE;
 		vkRenderingAttachment.resolveImageLayout = static_cast<VkImageLayout>(renderingAttachment.resolveImageLayout);
 		vkRenderingAttachment.loadOp = static_cast<VkAttachmentLoadOp>(renderingAttachment.loadOp);
-		vkRenderingAttachment.storeOp = static_cast<VkAttachmentStoreOp>(renderingAttachment.storeOp);
+		const bool& transient = renderingAttachment.imageView->GetCreateInfo().image->IsTransientAttachment();
+		vkRenderingAttachment.storeOp = transient ? VK_ATTACHMENT_STORE_OP_DONT_CARE : static_cast<VkAttachmentStoreOp>(renderingAttachment.storeOp);
 		vkRenderingAttachment.clearValue = *reinterpret_cast<const VkClearValue*>(&renderingAttachment.clearValue);
 
 		return vkRenderingAttachment;
 	};
 
-	std::vector<VkRenderingAttachmentInfo> vkColourAttachments;
-	vkColourAttachments.reserve(renderingInfo.colourAttachments.size());
-	for (const auto& colourAttachment : renderingInfo.colourAttachments)
-		vkColourAttachments.push_back(RenderingAttachmentInfo_To_VkRenderingAttachmentInfo(colourAttachment));
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+	const uint32_t& colourAttachmentCount = static_cast<uint32_t>(renderingInfo.colourAttachments.size());
+	VkRenderingAttachmentInfo* vkColourAttachments = m_Scratch[index].Allocate<VkRenderingAttachmentInfo>(colourAttachmentCount);
+	for (uint32_t i = 0; i < colourAttachmentCount; i++)
+		vkColourAttachments[i] = RenderingAttachmentInfo_To_VkRenderingAttachmentInfo(renderingInfo.colourAttachments[i]);
 
 	VkRenderingAttachmentInfo vkDepthAttachment;
 	if (renderingInfo.pDepthAttachment)
@@ -573,12 +999,13 @@ void CommandBuffer::BeginRendering(uint32_t index, const base::RenderingInfo& re
 	vkRenderingInfo.renderArea.extent.height = renderingInfo.renderArea.extent.height;
 	vkRenderingInfo.layerCount = renderingInfo.layerCount;
 	vkRenderingInfo.viewMask = renderingInfo.viewMask;
-	vkRenderingInfo.colorAttachmentCount = static_cast<uint32_t>(vkColourAttachments.size());
-	vkRenderingInfo.pColorAttachments = vkColourAttachments.data();
+	vkRenderingInfo.colorAttachmentCount = colourAttachmentCount;
+	vkRenderingInfo.pColorAttachments = vkColourAttachments;
 	vkRenderingInfo.pDepthAttachment = renderingInfo.pDepthAttachment ? &vkDepthAttachment : nullptr;
 	vkRenderingInfo.pStencilAttachment = renderingInfo.pStencilAttachment ? &vkStencilAttachment : nullptr;
 
 	vkCmdBeginRendering(m_CmdBuffers[index], &vkRenderingInfo);
+	InvalidateBoundState(index);
 }
 
 void CommandBuffer::EndRendering(uint32_t index)
@@ -586,6 +1013,7 @@ void CommandBuffer::EndRendering(uint32_t index)
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 	vkCmdEndRendering(m_CmdBuffers[index]);
 }
 
@@ -594,15 +1022,21 @@ void CommandBuffer::BindVertexBuffers(uint32_t index, const std::vector<base::Bu
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
-	std::vector<VkBuffer> vkBuffers;
-	std::vector<VkDeviceSize> offsets;
-	for (auto& vertexBufferView : vertexBufferViews)
+	if (FilterVertexBuffers(index, vertexBufferViews.data(), static_cast<uint32_t>(vertexBufferViews.size())))
+		return;
+
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+
+	VkBuffer* vkBuffers = m_Scratch[index].Allocate<VkBuffer>(vertexBufferViews.size());
+	VkDeviceSize* offsets = m_Scratch[index].Allocate<VkDeviceSize>(vertexBufferViews.size());
+	for (size_t i = 0; i < vertexBufferViews.size(); i++)
 	{
-		vkBuffers.push_back(ref_cast<Buffer>(ref_cast<BufferView>(vertexBufferView)->GetCreateInfo().buffer)->m_Buffer);
-		offsets.push_back(ref_cast<BufferView>(vertexBufferView)->GetCreateInfo().offset);
+		const BufferView* vkBufferView = static_cast<const BufferView*>(vertexBufferViews[i].get());
+		vkBuffers[i] = static_cast<const Buffer*>(vertexBufferViews[i]->GetCreateInfo().buffer.get())->m_Buffer;
+		offsets[i] = vkBufferView->m_BufferViewCI.offset;
 	}
 
-	vkCmdBindVertexBuffers(m_CmdBuffers[index], 0, static_cast<uint32_t>(vkBuffers.size()), vkBuffers.data(), offsets.data());
+	vkCmdBindVertexBuffers(m_CmdBuffers[index], 0, static_cast<uint32_t>(vertexBufferViews.size()), vkBuffers, offsets);
 }
 
 void CommandBuffer::BindIndexBuffer(uint32_t index, const base::BufferViewRef& indexBufferView)
@@ -610,8 +1044,10 @@ void CommandBuffer::BindIndexBuffer(uint32_t index, const base::BufferViewRef& i
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	if (FilterIndexBuffer(index, indexBufferView.get()))
+		return;
 
-	VkBuffer& buffer = ref_cast<Buffer>(ref_cast<BufferView>(indexBufferView)->GetCreateInfo().buffer)->m_Buffer;
+	const VkBuffer& buffer = static_cast<const Buffer*>(indexBufferView->GetCreateInfo().buffer.get())->m_Buffer;
 	const BufferView::CreateInfo& ci = indexBufferView->GetCreateInfo();
 
 	VkIndexType type = VK_INDEX_TYPE_UINT16;
@@ -622,26 +1058,125 @@ void CommandBuffer::BindIndexBuffer(uint32_t index, const base::BufferViewRef& i
 	else
 		MIRU_FATAL(true, "ERROR: VULKAN: Unknown index type.");
 
-	vkCmdBindIndexBuffer(m_CmdBuffers[index], buffer, static_cast<VkDeviceSize>(ci.offset), type);
+	vkCmdBindIndexBuffer(m_CmdBuffers[index], buffer, static_cast<const BufferView*>(indexBufferView.get())->m_BufferViewCI.offset, type);
 }
 
-void CommandBuffer::BindDescriptorSets(uint32_t index, const std::vector<base::DescriptorSetRef>& descriptorSets, uint32_t firstSet, const base::PipelineRef& pipeline)
+void CommandBuffer::BindDescriptorSets(uint32_t index, const std::vector<base::DescriptorSetRef>& descriptorSets, uint32_t firstSet, const base::PipelineRef& pipeline, const std::vector<uint32_t>& dynamicOffsets)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	if (FilterDescriptorSets(index, descriptorSets.data(), static_cast<uint32_t>(descriptorSets.size()), firstSet, pipeline.get(), static_cast<uint32_t>(dynamicOffsets.size())))
+		return;
 
-	std::vector<VkDescriptorSet> vkDescriptorSets;
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+
+	size_t vkDescriptorSetCount = 0;
+	for (auto& descriptorSet : descriptorSets)
+		vkDescriptorSetCount += static_cast<const DescriptorSet*>(descriptorSet.get())->m_DescriptorSets.size();
+
+	VkDescriptorSet* vkDescriptorSets = m_Scratch[index].Allocate<VkDescriptorSet>(vkDescriptorSetCount);
+	size_t i = 0;
 	for (auto& descriptorSet : descriptorSets)
 	{
-		for (auto& vkDescriptorSet : ref_cast<const DescriptorSet>(descriptorSet)->m_DescriptorSets)
-		{		
-			vkDescriptorSets.push_back(vkDescriptorSet);
-		}
+		for (auto& vkDescriptorSet : static_cast<const DescriptorSet*>(descriptorSet.get())->m_DescriptorSets)
+			vkDescriptorSets[i++] = vkDescriptorSet;
+	}
+
+	vkCmdBindDescriptorSets(m_CmdBuffers[index], static_cast<VkPipelineBindPoint>(pipeline->GetCreateInfo().type), 
+		static_cast<const Pipeline*>(pipeline.get())->m_PipelineLayout, firstSet, static_cast<uint32_t>(vkDescriptorSetCount), vkDescriptorSets, static_cast<uint32_t>(dynamicOffsets.size()), dynamicOffsets.data());
+}
+
+void CommandBuffer::BindVertexBuffers(uint32_t index, const base::BufferViewHandle* pVertexBufferViews, uint32_t vertexBufferViewCount)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+
+	const BufferView** bufferViews = m_Scratch[index].Allocate<const BufferView*>(vertexBufferViewCount);
+	for (uint32_t i = 0; i < vertexBufferViewCount; i++)
+	{
+		base::BufferView* bufferView = base::GetHandleObject(pVertexBufferViews[i]);
+		MIRU_FATAL(!bufferView, "ERROR: VULKAN: Invalid BufferViewHandle.");
+		bufferViews[i] = static_cast<const BufferView*>(bufferView);
+	}
+	if (FilterVertexBuffers(index, bufferViews, vertexBufferViewCount))
+		return;
+
+	VkBuffer* vkBuffers = m_Scratch[index].Allocate<VkBuffer>(vertexBufferViewCount);
+	VkDeviceSize* offsets = m_Scratch[index].Allocate<VkDeviceSize>(vertexBufferViewCount);
+	for (uint32_t i = 0; i < vertexBufferViewCount; i++)
+	{
+		vkBuffers[i] = static_cast<const Buffer*>(bufferViews[i]->GetCreateInfo().buffer.get())->m_Buffer;
+		offsets[i] = bufferViews[i]->m_BufferViewCI.offset;
+	}
+
+	vkCmdBindVertexBuffers(m_CmdBuffers[index], 0, vertexBufferViewCount, vkBuffers, offsets);
+}
+
+void CommandBuffer::BindIndexBuffer(uint32_t index, const base::BufferViewHandle& indexBufferView)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+
+	base::BufferView* bufferView = base::GetHandleObject(indexBufferView);
+	MIRU_FATAL(!bufferView, "ERROR: VULKAN: Invalid BufferViewHandle.");
+	if (FilterIndexBuffer(index, bufferView))
+		return;
+
+	const BufferView::CreateInfo& ci = bufferView->GetCreateInfo();
+	const VkBuffer& buffer = static_cast<const Buffer*>(ci.buffer.get())->m_Buffer;
+
+	VkIndexType type = VK_INDEX_TYPE_UINT16;
+	if (ci.stride == 2)
+		type = VK_INDEX_TYPE_UINT16;
+	else if (ci.stride == 4)
+		type = VK_INDEX_TYPE_UINT32;
+	else
+		MIRU_FATAL(true, "ERROR: VULKAN: Unknown index type.");
+
+	vkCmdBindIndexBuffer(m_CmdBuffers[index], buffer, static_cast<const BufferView*>(bufferView)->m_BufferViewCI.offset, type);
+}
+
+void CommandBuffer::BindDescriptorSets(uint32_t index, const base::DescriptorSetHandle* pDescriptorSets, uint32_t descriptorSetCount, uint32_t firstSet, const base::PipelineRef& pipeline, const uint32_t* pDynamicOffsets, uint32_t dynamicOffsetCount)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+
+	const DescriptorSet** descriptorSets = m_Scratch[index].Allocate<const DescriptorSet*>(descriptorSetCount);
+	size_t vkDescriptorSetCount = 0;
+	for (uint32_t i = 0; i < descriptorSetCount; i++)
+	{
+		base::DescriptorSet* descriptorSet = base::GetHandleObject(pDescriptorSets[i]);
+		MIRU_FATAL(!descriptorSet, "ERROR: VULKAN: Invalid DescriptorSetHandle.");
+		descriptorSets[i] = static_cast<const DescriptorSet*>(descriptorSet);
+		vkDescriptorSetCount += descriptorSets[i]->m_DescriptorSets.size();
+	}
+	if (FilterDescriptorSets(index, descriptorSets, descriptorSetCount, firstSet, pipeline.get(), dynamicOffsetCount))
+		return;
+
+	VkDescriptorSet* vkDescriptorSets = m_Scratch[index].Allocate<VkDescriptorSet>(vkDescriptorSetCount);
+	size_t j = 0;
+	for (uint32_t i = 0; i < descriptorSetCount; i++)
+	{
+		for (auto& vkDescriptorSet : descriptorSets[i]->m_DescriptorSets)
+			vkDescriptorSets[j++] = vkDescriptorSet;
 	}
 
 	vkCmdBindDescriptorSets(m_CmdBuffers[index], static_cast<VkPipelineBindPoint>(pipeline->GetCreateInfo().type), 
-		ref_cast<Pipeline>(pipeline)->m_PipelineLayout, firstSet, static_cast<uint32_t>(vkDescriptorSets.size()), vkDescriptorSets.data(), 0, nullptr);
+		static_cast<const Pipeline*>(pipeline.get())->m_PipelineLayout, firstSet, static_cast<uint32_t>(vkDescriptorSetCount), vkDescriptorSets, dynamicOffsetCount, pDynamicOffsets);
+}
+
+void CommandBuffer::PushConstants(uint32_t index, const base::PipelineRef& pipeline, base::Shader::StageBit stages, uint32_t offset, uint32_t size, const void* pValues)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	vkCmdPushConstants(m_CmdBuffers[index], static_cast<const Pipeline*>(pipeline.get())->m_PipelineLayout, static_cast<VkShaderStageFlags>(stages), offset, size, pValues);
 }
 
 void CommandBuffer::DrawIndexed(uint32_t index, uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance)
@@ -649,6 +1184,7 @@ void CommandBuffer::DrawIndexed(uint32_t index, uint32_t indexCount, uint32_t in
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 	vkCmdDrawIndexed(m_CmdBuffers[index], indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
 }
 
@@ -657,6 +1193,7 @@ void CommandBuffer::Draw(uint32_t index, uint32_t vertexCount, uint32_t instance
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 	vkCmdDraw(m_CmdBuffers[index], vertexCount, instanceCount, firstVertex, firstInstance);
 }
 
@@ -665,6 +1202,7 @@ void CommandBuffer::DrawMeshTasks(uint32_t index, uint32_t groupCountX, uint32_t
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 	vkCmdDrawMeshTasksEXT(m_CmdBuffers[index], groupCountX, groupCountY, groupCountZ);
 }
 
@@ -673,44 +1211,115 @@ void CommandBuffer::Dispatch(uint32_t index, uint32_t groupCountX, uint32_t grou
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 	vkCmdDispatch(m_CmdBuffers[index], groupCountX, groupCountY, groupCountZ);
 }
 
-void CommandBuffer::BuildAccelerationStructure(uint32_t index, const std::vector<base::AccelerationStructureBuildInfoRef>& buildGeometryInfos, const std::vector<std::vector<base::AccelerationStructureBuildInfo::BuildRangeInfo>>& buildRangeInfos)
+void CommandBuffer::DrawIndirect(uint32_t index, const base::BufferRef& buffer, uint64_t offset, uint32_t drawCount, uint32_t stride)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	vkCmdDrawIndirect(m_CmdBuffers[index], static_cast<const Buffer*>(buffer.get())->m_Buffer, buffer->GetOffset() + offset, drawCount, stride);
+}
 
-	//BLAS and TLAS must be built in seperate commands.
-	std::vector<VkAccelerationStructureBuildGeometryInfoKHR> vkBuildGeometryInfosBLAS;
-	std::vector<VkAccelerationStructureBuildRangeInfoKHR> vkBuildRangeInfosBLAS;
-	std::vector<const VkAccelerationStructureBuildRangeInfoKHR*> vkBuildRangeInfoPtrsBLAS;
+void CommandBuffer::DrawIndexedIndirect(uint32_t index, const base::BufferRef& buffer, uint64_t offset, uint32_t drawCount, uint32_t stride)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	vkCmdDrawIndexedIndirect(m_CmdBuffers[index], static_cast<const Buffer*>(buffer.get())->m_Buffer, buffer->GetOffset() + offset, drawCount, stride);
+}
+
+void CommandBuffer::DrawIndirectCount(uint32_t index, const base::BufferRef& buffer, uint64_t offset, const base::BufferRef& countBuffer, uint64_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	MIRU_FATAL(!vkCmdDrawIndirectCount, "ERROR: VULKAN: vkCmdDrawIndirectCount requires Vulkan 1.2.");
+	vkCmdDrawIndirectCount(m_CmdBuffers[index], static_cast<const Buffer*>(buffer.get())->m_Buffer, buffer->GetOffset() + offset,
+		static_cast<const Buffer*>(countBuffer.get())->m_Buffer, countBuffer->GetOffset() + countBufferOffset, maxDrawCount, stride);
+}
+
+void CommandBuffer::DrawIndexedIndirectCount(uint32_t index, const base::BufferRef& buffer, uint64_t offset, const base::BufferRef& countBuffer, uint64_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
 
-	std::vector<VkAccelerationStructureBuildGeometryInfoKHR> vkBuildGeometryInfosTLAS;
-	std::vector<VkAccelerationStructureBuildRangeInfoKHR> vkBuildRangeInfosTLAS;
-	std::vector<const VkAccelerationStructureBuildRangeInfoKHR*> vkBuildRangeInfoPtrsTLAS;
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	MIRU_FATAL(!vkCmdDrawIndexedIndirectCount, "ERROR: VULKAN: vkCmdDrawIndexedIndirectCount requires Vulkan 1.2.");
+	vkCmdDrawIndexedIndirectCount(m_CmdBuffers[index], static_cast<const Buffer*>(buffer.get())->m_Buffer, buffer->GetOffset() + offset,
+		static_cast<const Buffer*>(countBuffer.get())->m_Buffer, countBuffer->GetOffset() + countBufferOffset, maxDrawCount, stride);
+}
 
-	for (size_t i = 0; i < buildGeometryInfos.size(); i++)
+void CommandBuffer::DrawMeshTasksIndirect(uint32_t index, const base::BufferRef& buffer, uint64_t offset, uint32_t drawCount, uint32_t stride)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	vkCmdDrawMeshTasksIndirectEXT(m_CmdBuffers[index], static_cast<const Buffer*>(buffer.get())->m_Buffer, buffer->GetOffset() + offset, drawCount, stride);
+}
+
+void CommandBuffer::DrawMeshTasksIndirectCount(uint32_t index, const base::BufferRef& buffer, uint64_t offset, const base::BufferRef& countBuffer, uint64_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	vkCmdDrawMeshTasksIndirectCountEXT(m_CmdBuffers[index], static_cast<const Buffer*>(buffer.get())->m_Buffer, buffer->GetOffset() + offset,
+		static_cast<const Buffer*>(countBuffer.get())->m_Buffer, countBuffer->GetOffset() + countBufferOffset, maxDrawCount, stride);
+}
+
+void CommandBuffer::DispatchIndirect(uint32_t index, const base::BufferRef& buffer, uint64_t offset)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	vkCmdDispatchIndirect(m_CmdBuffers[index], static_cast<const Buffer*>(buffer.get())->m_Buffer, buffer->GetOffset() + offset);
+}
+
+void CommandBuffer::BuildAccelerationStructure(uint32_t index, const base::AccelerationStructureBuildInfoRef* pBuildGeometryInfos, uint32_t buildGeometryInfoCount, const base::AccelerationStructureBuildInfo::BuildRangeInfo* const* ppBuildRangeInfos)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+
+	//BLAS and TLAS must be built in seperate commands.
+	uint32_t vkBuildGeometryInfoCountBLAS = 0, vkBuildGeometryInfoCountTLAS = 0;
+	VkAccelerationStructureBuildGeometryInfoKHR* vkBuildGeometryInfosBLAS = m_Scratch[index].Allocate<VkAccelerationStructureBuildGeometryInfoKHR>(buildGeometryInfoCount);
+	VkAccelerationStructureBuildGeometryInfoKHR* vkBuildGeometryInfosTLAS = m_Scratch[index].Allocate<VkAccelerationStructureBuildGeometryInfoKHR>(buildGeometryInfoCount);
+	const VkAccelerationStructureBuildRangeInfoKHR** vkBuildRangeInfoPtrsBLAS = m_Scratch[index].Allocate<const VkAccelerationStructureBuildRangeInfoKHR*>(buildGeometryInfoCount);
+	const VkAccelerationStructureBuildRangeInfoKHR** vkBuildRangeInfoPtrsTLAS = m_Scratch[index].Allocate<const VkAccelerationStructureBuildRangeInfoKHR*>(buildGeometryInfoCount);
+
+	for (uint32_t i = 0; i < buildGeometryInfoCount; i++)
 	{
-		VkAccelerationStructureBuildGeometryInfoKHR asbgi = ref_cast<AccelerationStructureBuildInfo>(buildGeometryInfos[i])->m_ASBGI;
-		if (asbgi.geometryCount != buildRangeInfos[i].size())
+		const VkAccelerationStructureBuildGeometryInfoKHR& asbgi = static_cast<const AccelerationStructureBuildInfo*>(pBuildGeometryInfos[i].get())->m_ASBGI;
+
+		VkAccelerationStructureBuildRangeInfoKHR* vkBuildRangeInfos = m_Scratch[index].Allocate<VkAccelerationStructureBuildRangeInfoKHR>(asbgi.geometryCount);
+		for (uint32_t j = 0; j < asbgi.geometryCount; j++)
 		{
-			MIRU_FATAL(true, "ERROR: VULKAN: Size mismatch between VkAccelerationStructureBuildGeometryInfoKHR::geometryCount and buildRangeInfos[i].size().");
+			const base::AccelerationStructureBuildInfo::BuildRangeInfo& bri = ppBuildRangeInfos[i][j];
+			vkBuildRangeInfos[j] = { bri.primitiveCount, bri.primitiveOffset, bri.firstVertex, bri.transformOffset };
 		}
 		
 		if (asbgi.type == VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR)
 		{
-			vkBuildGeometryInfosBLAS.push_back(asbgi);
-			for (auto& bri : buildRangeInfos[i])
-				vkBuildRangeInfosBLAS.push_back({ bri.primitiveCount, bri.primitiveOffset, bri.firstVertex, bri.transformOffset });
-
+			vkBuildGeometryInfosBLAS[vkBuildGeometryInfoCountBLAS] = asbgi;
+			vkBuildRangeInfoPtrsBLAS[vkBuildGeometryInfoCountBLAS] = vkBuildRangeInfos;
+			vkBuildGeometryInfoCountBLAS++;
 		}
 		else if (asbgi.type == VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR)
 		{
-			vkBuildGeometryInfosTLAS.push_back(asbgi);
-			for (auto& bri : buildRangeInfos[i])
-				vkBuildRangeInfosTLAS.push_back({ bri.primitiveCount, bri.primitiveOffset, bri.firstVertex, bri.transformOffset });
+			vkBuildGeometryInfosTLAS[vkBuildGeometryInfoCountTLAS] = asbgi;
+			vkBuildRangeInfoPtrsTLAS[vkBuildGeometryInfoCountTLAS] = vkBuildRangeInfos;
+			vkBuildGeometryInfoCountTLAS++;
 		}
 		else
 		{
@@ -718,13 +1327,7 @@ void CommandBuffer::BuildAccelerationStructure(uint32_t index, const std::vector
 		}
 	}
 
-	for (const VkAccelerationStructureBuildRangeInfoKHR& vkBuildRangeInfoBLAS : vkBuildRangeInfosBLAS)
-		vkBuildRangeInfoPtrsBLAS.push_back(&vkBuildRangeInfoBLAS);
-
-	for (const VkAccelerationStructureBuildRangeInfoKHR& vkBuildRangeInfoTLAS : vkBuildRangeInfosTLAS)
-		vkBuildRangeInfoPtrsTLAS.push_back(&vkBuildRangeInfoTLAS);
-
-	if (!vkBuildGeometryInfosBLAS.empty())
+	if (vkBuildGeometryInfoCountBLAS > 0)
 	{
 		VkMemoryBarrier barrier;
 		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
@@ -732,9 +1335,9 @@ void CommandBuffer::BuildAccelerationStructure(uint32_t index, const std::vector
 		barrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
 		barrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_SHADER_READ_BIT;
 		vkCmdPipelineBarrier(m_CmdBuffers[index], VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &barrier, 0, nullptr, 0, nullptr);
-		vkCmdBuildAccelerationStructuresKHR(m_CmdBuffers[index], static_cast<uint32_t>(vkBuildGeometryInfosBLAS.size()), vkBuildGeometryInfosBLAS.data(), reinterpret_cast<const VkAccelerationStructureBuildRangeInfoKHR* const*>(vkBuildRangeInfoPtrsBLAS.data()));
+		vkCmdBuildAccelerationStructuresKHR(m_CmdBuffers[index], vkBuildGeometryInfoCountBLAS, vkBuildGeometryInfosBLAS, vkBuildRangeInfoPtrsBLAS);
 	}
-	if (!vkBuildGeometryInfosTLAS.empty())
+	if (vkBuildGeometryInfoCountTLAS > 0)
 	{
 		VkMemoryBarrier barrier;
 		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
@@ -742,7 +1345,7 @@ void CommandBuffer::BuildAccelerationStructure(uint32_t index, const std::vector
 		barrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
 		barrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_SHADER_READ_BIT;
 		vkCmdPipelineBarrier(m_CmdBuffers[index], VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR, 0, 1, &barrier, 0, nullptr, 0, nullptr);
-		vkCmdBuildAccelerationStructuresKHR(m_CmdBuffers[index], static_cast<uint32_t>(vkBuildGeometryInfosTLAS.size()), vkBuildGeometryInfosTLAS.data(), reinterpret_cast<const VkAccelerationStructureBuildRangeInfoKHR* const*>(vkBuildRangeInfoPtrsTLAS.data()));
+		vkCmdBuildAccelerationStructuresKHR(m_CmdBuffers[index], vkBuildGeometryInfoCountTLAS, vkBuildGeometryInfosTLAS, vkBuildRangeInfoPtrsTLAS);
 	}
 }
 
@@ -751,6 +1354,7 @@ void CommandBuffer::TraceRays(uint32_t index, const base::StridedDeviceAddressRe
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
 	VkStridedDeviceAddressRegionKHR emptySbtEntry;
 	emptySbtEntry.deviceAddress = 0;
 	emptySbtEntry.stride = 0;
@@ -763,104 +1367,184 @@ void CommandBuffer::TraceRays(uint32_t index, const base::StridedDeviceAddressRe
 	vkCmdTraceRaysKHR(m_CmdBuffers[index], raygenSBT, missSBT, hitSBT, callableSBT, width, height, depth);
 }
 
-void CommandBuffer::CopyBuffer(uint32_t index, const base::BufferRef& srcBuffer, const base::BufferRef& dstBuffer, const std::vector<Buffer::Copy>& copyRegions)
+void CommandBuffer::CopyBuffer(uint32_t index, const base::BufferRef& srcBuffer, const base::BufferRef& dstBuffer, const base::Buffer::Copy* pCopyRegions, uint32_t copyRegionCount)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
 
-	std::vector<VkBufferCopy> vkBufferCopy;
-	vkBufferCopy.reserve(copyRegions.size());
-	for (auto& copyRegion : copyRegions)
-		vkBufferCopy.push_back({ copyRegion.srcOffset, copyRegion.dstOffset, copyRegion.size});
+	const size_t& srcOffset = srcBuffer->GetOffset();
+	const size_t& dstOffset = dstBuffer->GetOffset();
+	VkBufferCopy* vkBufferCopy = m_Scratch[index].Allocate<VkBufferCopy>(copyRegionCount);
+	for (uint32_t i = 0; i < copyRegionCount; i++)
+		vkBufferCopy[i] = { srcOffset + pCopyRegions[i].srcOffset, dstOffset + pCopyRegions[i].dstOffset, pCopyRegions[i].size };
 
-	vkCmdCopyBuffer(m_CmdBuffers[index], ref_cast<Buffer>(srcBuffer)->m_Buffer, ref_cast<Buffer>(dstBuffer)->m_Buffer, static_cast<uint32_t>(vkBufferCopy.size()), vkBufferCopy.data());
+	vkCmdCopyBuffer(m_CmdBuffers[index], static_cast<const Buffer*>(srcBuffer.get())->m_Buffer, static_cast<const Buffer*>(dstBuffer.get())->m_Buffer, copyRegionCount, vkBufferCopy);
 }
 
-void CommandBuffer::CopyImage(uint32_t index, const base::ImageRef& srcImage, base::Image::Layout srcImageLayout, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const std::vector<Image::Copy>& copyRegions)
+void CommandBuffer::CopyImage(uint32_t index, const base::ImageRef& srcImage, base::Image::Layout srcImageLayout, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const base::Image::Copy* pCopyRegions, uint32_t copyRegionCount)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
-	std::vector<VkImageCopy> vkImageCopy;
-	vkImageCopy.reserve(copyRegions.size());
-	for (auto& copyRegion : copyRegions)
+	FlushBarriers(index);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+
+	VkImageCopy* vkImageCopy = m_Scratch[index].Allocate<VkImageCopy>(copyRegionCount);
+	for (uint32_t i = 0; i < copyRegionCount; i++)
 	{
-		VkImageCopy ic;
+		const base::Image::Copy& copyRegion = pCopyRegions[i];
+		VkImageCopy& ic = vkImageCopy[i];
 		ic.srcSubresource = { static_cast<VkImageAspectFlags>(copyRegion.srcSubresource.aspectMask), copyRegion.srcSubresource.mipLevel, copyRegion.srcSubresource.baseArrayLayer, copyRegion.srcSubresource.arrayLayerCount };
 		ic.srcOffset = { copyRegion.srcOffset.x, copyRegion.srcOffset.y, copyRegion.srcOffset.z };
 		ic.dstSubresource = { static_cast<VkImageAspectFlags>(copyRegion.dstSubresource.aspectMask), copyRegion.dstSubresource.mipLevel, copyRegion.dstSubresource.baseArrayLayer, copyRegion.dstSubresource.arrayLayerCount };
 		ic.dstOffset = { copyRegion.dstOffset.x, copyRegion.dstOffset.y, copyRegion.dstOffset.z };
 		ic.extent = { copyRegion.extent.width, copyRegion.extent.height, copyRegion.extent.depth};
-		vkImageCopy.push_back(ic);
 	}
 	
-	vkCmdCopyImage(m_CmdBuffers[index], ref_cast<Image>(srcImage)->m_Image, static_cast<VkImageLayout>(srcImageLayout),
-		ref_cast<Image>(dstImage)->m_Image, static_cast<VkImageLayout>(dstImageLayout), static_cast<uint32_t>(vkImageCopy.size()), vkImageCopy.data());
+	vkCmdCopyImage(m_CmdBuffers[index], static_cast<const Image*>(srcImage.get())->m_Image, static_cast<VkImageLayout>(srcImageLayout),
+		static_cast<const Image*>(dstImage.get())->m_Image, static_cast<VkImageLayout>(dstImageLayout), copyRegionCount, vkImageCopy);
 }
 
-void CommandBuffer::CopyBufferToImage(uint32_t index, const base::BufferRef& srcBuffer, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const std::vector<base::Image::BufferImageCopy>& regions)
+void CommandBuffer::CopyBufferToImage(uint32_t index, const base::BufferRef& srcBuffer, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const base::Image::BufferImageCopy* pRegions, uint32_t regionCount)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
-	std::vector<VkBufferImageCopy> vkBufferImageCopy;
-	for (auto& region : regions)
+	FlushBarriers(index);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+
+	const size_t& bufferOffset = srcBuffer->GetOffset();
+	VkBufferImageCopy* vkBufferImageCopy = m_Scratch[index].Allocate<VkBufferImageCopy>(regionCount);
+	for (uint32_t i = 0; i < regionCount; i++)
 	{
-		VkBufferImageCopy bic;
-		bic.bufferOffset = static_cast<VkDeviceSize>(region.bufferOffset);
+		const base::Image::BufferImageCopy& region = pRegions[i];
+		VkBufferImageCopy& bic = vkBufferImageCopy[i];
+		bic.bufferOffset = static_cast<VkDeviceSize>(bufferOffset + region.bufferOffset);
 		bic.bufferRowLength = region.bufferRowLength;
 		bic.bufferImageHeight = region.bufferImageHeight;
 		bic.imageSubresource = { static_cast<VkImageAspectFlags>(region.imageSubresource.aspectMask), region.imageSubresource.mipLevel, region.imageSubresource.baseArrayLayer, region.imageSubresource.arrayLayerCount };
 		bic.imageOffset = { region.imageOffset.x, region.imageOffset.y, region.imageOffset.z };
 		bic.imageExtent = { region.imageExtent.width, region.imageExtent.height, region.imageExtent.depth };
-		vkBufferImageCopy.push_back(bic);
 	}
 
-	vkCmdCopyBufferToImage(m_CmdBuffers[index], ref_cast<Buffer>(srcBuffer)->m_Buffer, ref_cast<Image>(dstImage)->m_Image, static_cast<VkImageLayout>(dstImageLayout), static_cast<uint32_t>(vkBufferImageCopy.size()), vkBufferImageCopy.data());
+	vkCmdCopyBufferToImage(m_CmdBuffers[index], static_cast<const Buffer*>(srcBuffer.get())->m_Buffer, static_cast<const Image*>(dstImage.get())->m_Image, static_cast<VkImageLayout>(dstImageLayout), regionCount, vkBufferImageCopy);
 }
 
-void CommandBuffer::CopyImageToBuffer(uint32_t index, const base::ImageRef& srcImage, const base::BufferRef& dstBuffer, base::Image::Layout srcImageLayout, const std::vector<base::Image::BufferImageCopy>& regions)
+void CommandBuffer::CopyImageToBuffer(uint32_t index, const base::ImageRef& srcImage, const base::BufferRef& dstBuffer, base::Image::Layout srcImageLayout, const base::Image::BufferImageCopy* pRegions, uint32_t regionCount)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
-	std::vector<VkBufferImageCopy> vkBufferImageCopy;
-	for (auto& region : regions)
+	FlushBarriers(index);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+
+	const size_t& bufferOffset = dstBuffer->GetOffset();
+	VkBufferImageCopy* vkBufferImageCopy = m_Scratch[index].Allocate<VkBufferImageCopy>(regionCount);
+	for (uint32_t i = 0; i < regionCount; i++)
 	{
-		VkBufferImageCopy bic;
-		bic.bufferOffset = static_cast<VkDeviceSize>(region.bufferOffset);
+		const base::Image::BufferImageCopy& region = pRegions[i];
+		VkBufferImageCopy& bic = vkBufferImageCopy[i];
+		bic.bufferOffset = static_cast<VkDeviceSize>(bufferOffset + region.bufferOffset);
 		bic.bufferRowLength = region.bufferRowLength;
 		bic.bufferImageHeight = region.bufferImageHeight;
 		bic.imageSubresource = { static_cast<VkImageAspectFlags>(region.imageSubresource.aspectMask), region.imageSubresource.mipLevel, region.imageSubresource.baseArrayLayer, region.imageSubresource.arrayLayerCount };
 		bic.imageOffset = { region.imageOffset.x, region.imageOffset.y, region.imageOffset.z };
 		bic.imageExtent = { region.imageExtent.width, region.imageExtent.height, region.imageExtent.depth };
-		vkBufferImageCopy.push_back(bic);
 	}
 
-	vkCmdCopyImageToBuffer(m_CmdBuffers[index], ref_cast<Image>(srcImage)->m_Image, static_cast<VkImageLayout>(srcImageLayout), ref_cast<Buffer>(dstBuffer)->m_Buffer, static_cast<uint32_t>(vkBufferImageCopy.size()), vkBufferImageCopy.data());
+	vkCmdCopyImageToBuffer(m_CmdBuffers[index], static_cast<const Image*>(srcImage.get())->m_Image, static_cast<VkImageLayout>(srcImageLayout), static_cast<const Buffer*>(dstBuffer.get())->m_Buffer, regionCount, vkBufferImageCopy);
 }
 
-void CommandBuffer::ResolveImage(uint32_t index, const base::ImageRef& srcImage, base::Image::Layout srcImageLayout, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const std::vector<base::Image::Resolve>& resolveRegions)
+void CommandBuffer::ResolveImage(uint32_t index, const base::ImageRef& srcImage, base::Image::Layout srcImageLayout, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const base::Image::Resolve* pResolveRegions, uint32_t resolveRegionCount)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
-	std::vector<VkImageResolve> vkImageResolve;
-	vkImageResolve.reserve(resolveRegions.size());
-	for (auto& resolveRegion : resolveRegions)
+	FlushBarriers(index);
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+
+	VkImageResolve* vkImageResolve = m_Scratch[index].Allocate<VkImageResolve>(resolveRegionCount);
+	for (uint32_t i = 0; i < resolveRegionCount; i++)
 	{
-		VkImageResolve ir;
+		const base::Image::Resolve& resolveRegion = pResolveRegions[i];
+		VkImageResolve& ir = vkImageResolve[i];
 		ir.srcSubresource = { static_cast<VkImageAspectFlags>(resolveRegion.srcSubresource.aspectMask), resolveRegion.srcSubresource.mipLevel, resolveRegion.srcSubresource.baseArrayLayer, resolveRegion.srcSubresource.arrayLayerCount };
 		ir.srcOffset = { resolveRegion.srcOffset.x, resolveRegion.srcOffset.y, resolveRegion.srcOffset.z };
 		ir.dstSubresource = { static_cast<VkImageAspectFlags>(resolveRegion.dstSubresource.aspectMask), resolveRegion.dstSubresource.mipLevel, resolveRegion.dstSubresource.baseArrayLayer, resolveRegion.dstSubresource.arrayLayerCount };
 		ir.dstOffset = { resolveRegion.dstOffset.x, resolveRegion.dstOffset.y, resolveRegion.dstOffset.z };
 		ir.extent = { resolveRegion.extent.width, resolveRegion.extent.height, resolveRegion.extent.depth };
-		vkImageResolve.push_back(ir);
 	}
 
-	vkCmdResolveImage(m_CmdBuffers[index], ref_cast<Image>(srcImage)->m_Image, static_cast<VkImageLayout>(srcImageLayout), 
-		ref_cast<Image>(dstImage)->m_Image, static_cast<VkImageLayout>(dstImageLayout), static_cast<uint32_t>(vkImageResolve.size()), vkImageResolve.data());
+	vkCmdResolveImage(m_CmdBuffers[index], static_cast<const Image*>(srcImage.get())->m_Image, static_cast<VkImageLayout>(srcImageLayout), 
+		static_cast<const Image*>(dstImage.get())->m_Image, static_cast<VkImageLayout>(dstImageLayout), resolveRegionCount, vkImageResolve);
+}
+
+void CommandBuffer::ResetQueryPool(uint32_t index, const base::QueryPoolRef& queryPool, uint32_t firstQuery, uint32_t queryCount)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	vkCmdResetQueryPool(m_CmdBuffers[index], ref_cast<QueryPool>(queryPool)->m_QueryPool, firstQuery, queryCount);
+}
+
+void CommandBuffer::BeginQuery(uint32_t index, const base::QueryPoolRef& queryPool, uint32_t query, bool precise)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	vkCmdBeginQuery(m_CmdBuffers[index], ref_cast<QueryPool>(queryPool)->m_QueryPool, query, precise ? VK_QUERY_CONTROL_PRECISE_BIT : 0);
+}
+
+void CommandBuffer::EndQuery(uint32_t index, const base::QueryPoolRef& queryPool, uint32_t query)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	vkCmdEndQuery(m_CmdBuffers[index], ref_cast<QueryPool>(queryPool)->m_QueryPool, query);
+}
+
+void CommandBuffer::WriteTimestamp(uint32_t index, base::PipelineStageBit stage, const base::QueryPoolRef& queryPool, uint32_t query)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	const VkQueryPool& vkQueryPool = ref_cast<QueryPool>(queryPool)->m_QueryPool;
+
+	const bool& useTimestamp2 = arc::BitwiseCheck(m_CI.commandPool->GetCreateInfo().context->GetResultInfo().activeExtensions, base::Context::ExtensionsBit::SYNCHRONISATION_2);
+	if (useTimestamp2)
+	{
+		vkCmdWriteTimestamp2(m_CmdBuffers[index], static_cast<VkPipelineStageFlags2>(stage), vkQueryPool, query);
+	}
+	else
+	{
+		//vkCmdWriteTimestamp() takes a single legacy stage. Multiple stages or SYNCHRONISATION_2 only stages
+		//are conservatively written at the bottom of the pipe, which is valid for any stage.
+		const uint64_t& stageBits = static_cast<uint64_t>(stage);
+		VkPipelineStageFlagBits vkStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+		if (stageBits == 0)
+			vkStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		else if (stageBits <= 0xFFFFFFFF && (stageBits & (stageBits - 1)) == 0)
+			vkStage = static_cast<VkPipelineStageFlagBits>(stageBits);
+
+		vkCmdWriteTimestamp(m_CmdBuffers[index], vkStage, vkQueryPool, query);
+	}
+}
+
+void CommandBuffer::CopyQueryPoolResults(uint32_t index, const base::QueryPoolRef& queryPool, uint32_t firstQuery, uint32_t queryCount, const base::BufferRef& dstBuffer, uint64_t dstOffset)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	CHECK_VALID_INDEX_RETURN(index);
+	FlushBarriers(index);
+	vkCmdCopyQueryPoolResults(m_CmdBuffers[index], ref_cast<QueryPool>(queryPool)->m_QueryPool, firstQuery, queryCount,
+		static_cast<const Buffer*>(dstBuffer.get())->m_Buffer, dstBuffer->GetOffset() + dstOffset, queryPool->GetResultSize(), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
 }
 
 void CommandBuffer::BeginDebugLabel(uint32_t index, const std::string& label, std::array<float, 4> rgba)
@@ -878,6 +1562,8 @@ void CommandBuffer::BeginDebugLabel(uint32_t index, const std::string& label, st
 	vkLabel.color[3] = rgba[3];
 	if (vkCmdBeginDebugUtilsLabelEXT)
 		vkCmdBeginDebugUtilsLabelEXT(m_CmdBuffers[index], &vkLabel);
+	if (m_GpuProfiler)
+		m_GpuProfiler->BeginScope(this, index, label);
 }
 
 void CommandBuffer::EndDebugLabel(uint32_t index)
@@ -885,32 +1571,162 @@ void CommandBuffer::EndDebugLabel(uint32_t index)
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
+	if (m_GpuProfiler)
+		m_GpuProfiler->EndScope(this, index);
 	if (vkCmdEndDebugUtilsLabelEXT)
 		vkCmdEndDebugUtilsLabelEXT(m_CmdBuffers[index]);
 }
 
-void CommandBuffer::SetViewport(uint32_t index, const std::vector<base::Viewport>& viewports)
+void CommandBuffer::SetViewport(uint32_t index, const base::Viewport* pViewports, uint32_t viewportCount)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
-	std::vector<VkViewport> vkViewports;
-	vkViewports.reserve(viewports.size());
-	for (auto& viewport : viewports)
-		vkViewports.push_back({ viewport.x, viewport.y, viewport.width, viewport.height, viewport.minDepth, viewport.maxDepth });
+	if (FilterViewports(index, pViewports, viewportCount))
+		return;
+
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+
+	VkViewport* vkViewports = m_Scratch[index].Allocate<VkViewport>(viewportCount);
+	for (uint32_t i = 0; i < viewportCount; i++)
+	{
+		const base::Viewport& viewport = pViewports[i];
+		vkViewports[i] = { viewport.x, viewport.y, viewport.width, viewport.height, viewport.minDepth, viewport.maxDepth };
+	}
 
-	vkCmdSetViewport(m_CmdBuffers[index], 0, static_cast<uint32_t>(vkViewports.size()), vkViewports.data());
+	vkCmdSetViewport(m_CmdBuffers[index], 0, viewportCount, vkViewports);
 }
 
-void CommandBuffer::SetScissor(uint32_t index, const std::vector<base::Rect2D>& scissors)
+void CommandBuffer::SetScissor(uint32_t index, const base::Rect2D* pScissors, uint32_t scissorCount)
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
 	CHECK_VALID_INDEX_RETURN(index);
-	std::vector<VkRect2D> vkRect2D;
-	vkRect2D.reserve(scissors.size());
-	for (auto& scissor : scissors)
-		vkRect2D.push_back({ {scissor.offset.x, scissor.offset.y}, {scissor.extent.width, scissor.extent.height} });
+	if (FilterScissors(index, pScissors, scissorCount))
+		return;
+
+	base::ScratchAllocator::Scope scope(m_Scratch[index]);
+
+	VkRect2D* vkRect2D = m_Scratch[index].Allocate<VkRect2D>(scissorCount);
+	for (uint32_t i = 0; i < scissorCount; i++)
+	{
+		const base::Rect2D& scissor = pScissors[i];
+		vkRect2D[i] = { {scissor.offset.x, scissor.offset.y}, {scissor.extent.width, scissor.extent.height} };
+	}
+
+	vkCmdSetScissor(m_CmdBuffers[index], 0, scissorCount, vkRect2D);
+}
+
+//SubmissionQueue
+SubmissionQueue::SubmissionQueue(SubmissionQueue::CreateInfo* pCreateInfo)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_CI = *pCreateInfo;
+
+	const CommandPoolRef& pool = ref_cast<CommandPool>(m_CI.commandPool);
+	m_Queue = pool->m_Queue;
+	m_QueueMutex = pool->m_QueueMutex;
+}
 
-	vkCmdSetScissor(m_CmdBuffers[index], 0, static_cast<uint32_t>(vkRect2D.size()), vkRect2D.data());
+SubmissionQueue::~SubmissionQueue()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	MIRU_WARN(m_BatchCount > 0, "WARN: VULKAN: SubmissionQueue destroyed with pending batches that were not flushed.");
+}
+
+void SubmissionQueue::Add(const base::CommandBufferRef& commandBuffer, const std::vector<base::CommandBuffer::SubmitInfo2>& submitInfo2s)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	const CommandBufferRef& cmdBuffer = ref_cast<CommandBuffer>(commandBuffer);
+	const CommandPoolRef& pool = ref_cast<CommandPool>(cmdBuffer->GetCreateInfo().commandPool);
+	MIRU_FATAL(pool->m_Queue != m_Queue, "ERROR: VULKAN: The CommandBuffer's CommandPool does not submit to the queue of the SubmissionQueue.");
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	m_CommandBuffers.push_back(commandBuffer);
+
+	for (const auto& submitInfo2 : submitInfo2s)
+	{
+		const bool& merge = m_BatchCount > 0 && submitInfo2.waitSemaphoreInfos.empty() && m_Batches[m_BatchCount - 1].signalSemaphoreInfos.empty();
+		if (!merge)
+		{
+			if (m_BatchCount == m_Batches.size())
+				m_Batches.push_back({});
+			m_BatchCount++;
+		}
+		Batch& batch = m_Batches[m_BatchCount - 1];
+
+		for (const auto& waitInfo : submitInfo2.waitSemaphoreInfos)
+			batch.waitSemaphoreInfos.push_back(GetSemaphoreSubmitInfo(waitInfo));
+
+		for (const auto& commandBufferInfo : submitInfo2.commandBufferInfos)
+		{
+			VkCommandBufferSubmitInfo commandBufferSubmitInfo;
+			commandBufferSubmitInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+			commandBufferSubmitInfo.pNext = nullptr;
+			commandBufferSubmitInfo.commandBuffer = cmdBuffer->m_CmdBuffers[commandBufferInfo.index];
+			commandBufferSubmitInfo.deviceMask = commandBufferInfo.deviceMask;
+			batch.commandBufferInfos.push_back(commandBufferSubmitInfo);
+			CommitResourceStates(commandBuffer, commandBufferInfo.index);
+		}
+
+		for (const auto& signalInfo : submitInfo2.signalSemaphoreInfos)
+			batch.signalSemaphoreInfos.push_back(GetSemaphoreSubmitInfo(signalInfo));
+	}
+}
+
+void SubmissionQueue::Flush(const base::FenceRef& fence)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (m_BatchCount == 0 && !fence)
+		return;
+
+	m_SubmitInfo2s.clear();
+	for (size_t i = 0; i < m_BatchCount; i++)
+	{
+		const Batch& batch = m_Batches[i];
+
+		VkSubmitInfo2 vkSubmitInfo2;
+		vkSubmitInfo2.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+		vkSubmitInfo2.pNext = nullptr;
+		vkSubmitInfo2.flags = 0;
+		vkSubmitInfo2.waitSemaphoreInfoCount = static_cast<uint32_t>(batch.waitSemaphoreInfos.size());
+		vkSubmitInfo2.pWaitSemaphoreInfos = batch.waitSemaphoreInfos.data();
+		vkSubmitInfo2.commandBufferInfoCount = static_cast<uint32_t>(batch.commandBufferInfos.size());
+		vkSubmitInfo2.pCommandBufferInfos = batch.commandBufferInfos.data();
+		vkSubmitInfo2.signalSemaphoreInfoCount = static_cast<uint32_t>(batch.signalSemaphoreInfos.size());
+		vkSubmitInfo2.pSignalSemaphoreInfos = batch.signalSemaphoreInfos.data();
+		m_SubmitInfo2s.push_back(vkSubmitInfo2);
+	}
+
+	VkFence vkFence = fence ? ref_cast<Fence>(fence)->m_Fence : VK_NULL_HANDLE;
+	{
+		std::lock_guard<std::mutex> queueLock(*m_QueueMutex);
+		MIRU_FATAL(vkQueueSubmit2(m_Queue, static_cast<uint32_t>(m_SubmitInfo2s.size()), m_SubmitInfo2s.data(), vkFence), "ERROR: VULKAN: Failed to submit Queue.");
+	}
+
+	for (size_t i = 0; i < m_BatchCount; i++)
+	{
+		m_Batches[i].waitSemaphoreInfos.clear();
+		m_Batches[i].commandBufferInfos.clear();
+		m_Batches[i].signalSemaphoreInfos.clear();
+	}
+	m_BatchCount = 0;
+	m_CommandBuffers.clear();
+}
+
+VkSemaphoreSubmitInfo SubmissionQueue::GetSemaphoreSubmitInfo(const base::CommandBuffer::SemaphoreSubmitInfo& semaphoreInfo)
+{
+	VkSemaphoreSubmitInfo semaphoreSubmitInfo;
+	semaphoreSubmitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+	semaphoreSubmitInfo.pNext = nullptr;
+	semaphoreSubmitInfo.semaphore = ref_cast<Semaphore>(semaphoreInfo.semaphore)->m_Semaphore;
+	semaphoreSubmitInfo.value = semaphoreInfo.value;
+	semaphoreSubmitInfo.stageMask = static_cast<VkPipelineStageFlags2>(semaphoreInfo.stage);
+	semaphoreSubmitInfo.deviceIndex = semaphoreInfo.deviceIndex;
+	return semaphoreSubmitInfo;
 }
\ No newline at end of file
@@ -15,6 +15,8 @@ namespace vulkan
 
 		void Trim() override;
 		void Reset(bool releaseResources) override;
+		bool GetCalibratedTimestamps(uint64_t& gpuTimestamp, uint64_t& cpuTimestamp) override;
+		uint32_t GetQueueFamilyIndex() override { return m_QueueFamilyIndex; }
 
 		uint32_t GetQueueFamilyIndex(const CommandPool::QueueType& type);
 
@@ -23,6 +25,11 @@ namespace vulkan
 		VkDevice& m_Device;
 		VkCommandPool m_CmdPool;
 		VkCommandPoolCreateInfo m_CmdPoolCI;
+
+		uint32_t m_QueueFamilyIndex;
+		uint32_t m_QueueIndex;
+		VkQueue m_Queue;
+		std::mutex* m_QueueMutex;
 	};
 
 	class CommandBuffer final : public base::CommandBuffer
@@ -33,6 +40,7 @@ namespace vulkan
 		~CommandBuffer();
 
 		void Begin(uint32_t index, UsageBit usage) override;
+		void Begin(uint32_t index, UsageBit usage, const InheritanceInfo& inheritanceInfo) override;
 		void End(uint32_t index) override;
 		void Reset(uint32_t index, bool releaseResources) override;
 		void ExecuteSecondaryCommandBuffers(uint32_t index, const base::CommandBufferRef& commandBuffer, const std::vector<uint32_t>& secondaryCommandBufferIndices) override;
@@ -42,15 +50,19 @@ namespace vulkan
 		void SetEvent(uint32_t index, const base::EventRef& event, base::PipelineStageBit pipelineStage) override;
 		void ResetEvent(uint32_t index, const base::EventRef& event, base::PipelineStageBit pipelineStage) override;
 		void WaitEvents(uint32_t, const std::vector<base::EventRef>& events, base::PipelineStageBit srcStage, base::PipelineStageBit dstStage, const std::vector<base::BarrierRef>& barriers) override;
+		void WaitEvents(uint32_t index, const base::EventRef* pEvents, uint32_t eventCount, base::PipelineStageBit srcStage, base::PipelineStageBit dstStage, const base::BarrierHandle* pBarriers, uint32_t barrierCount) override;
 		void PipelineBarrier(uint32_t index, base::PipelineStageBit srcStage, base::PipelineStageBit dstStage, base::DependencyBit dependencies, const std::vector<base::BarrierRef>& barriers) override;
 		void PipelineBarrier2(uint32_t index, const base::CommandBuffer::DependencyInfo& dependencyInfo) override;
+		void PipelineBarrier(uint32_t index, base::PipelineStageBit srcStage, base::PipelineStageBit dstStage, base::DependencyBit dependencies, const base::BarrierHandle* pBarriers, uint32_t barrierCount) override;
+		void PipelineBarrier2(uint32_t index, base::DependencyBit dependencies, const base::Barrier2Handle* pBarriers, uint32_t barrierCount) override;
+		void FlushBarriers(uint32_t index) override;
 
-		void ClearColourImage(uint32_t index, const base::ImageRef& image, base::Image::Layout layout, const base::Image::ClearColourValue& clear, const std::vector<base::Image::SubresourceRange>& subresourceRanges) override;
-		void ClearDepthStencilImage(uint32_t index, const base::ImageRef& image, base::Image::Layout layout, const base::Image::ClearDepthStencilValue& clear, const std::vector<base::Image::SubresourceRange>& subresourceRanges) override;
+		void ClearColourImage(uint32_t index, const base::ImageRef& image, base::Image::Layout layout, const base::Image::ClearColourValue& clear, const base::Image::SubresourceRange* pSubresourceRanges, uint32_t subresourceRangeCount) override;
+		void ClearDepthStencilImage(uint32_t index, const base::ImageRef& image, base::Image::Layout layout, const base::Image::ClearDepthStencilValue& clear, const base::Image::SubresourceRange* pSubresourceRanges, uint32_t subresourceRangeCount) override;
 
-		void BeginRenderPass(uint32_t index, const base::FramebufferRef& framebuffer, const std::vector<base::Image::ClearValue>& clearValues) override;
+		void BeginRenderPass(uint32_t index, const base::FramebufferRef& framebuffer, const base::Image::ClearValue* pClearValues, uint32_t clearValueCount, SubpassContents contents = SubpassContents::INLINE) override;
 		void EndRenderPass(uint32_t index) override;
-		void NextSubpass(uint32_t index) override;
+		void NextSubpass(uint32_t index, SubpassContents contents = SubpassContents::INLINE) override;
 
 		void BeginRendering(uint32_t index, const base::RenderingInfo& renderingInfo) override;
 		void EndRendering(uint32_t index) override;
@@ -59,8 +71,13 @@ namespace vulkan
 		
 		void BindVertexBuffers(uint32_t index, const std::vector<base::BufferViewRef>& vertexBufferViews) override;
 		void BindIndexBuffer(uint32_t index, const base::BufferViewRef& indexBufferView) override;
+		void BindVertexBuffers(uint32_t index, const base::BufferViewHandle* pVertexBufferViews, uint32_t vertexBufferViewCount) override;
+		void BindIndexBuffer(uint32_t index, const base::BufferViewHandle& indexBufferView) override;
+
+		void BindDescriptorSets(uint32_t index, const std::vector<base::DescriptorSetRef>& descriptorSets, uint32_t firstSet, const base::PipelineRef& pipeline, const std::vector<uint32_t>& dynamicOffsets = {}) override;
+		void BindDescriptorSets(uint32_t index, const base::DescriptorSetHandle* pDescriptorSets, uint32_t descriptorSetCount, uint32_t firstSet, const base::PipelineRef& pipeline, const uint32_t* pDynamicOffsets = nullptr, uint32_t dynamicOffsetCount = 0) override;
 
-		void BindDescriptorSets(uint32_t index, const std::vector<base::DescriptorSetRef>& descriptorSets, uint32_t firstSet, const base::PipelineRef& pipeline) override;
+		void PushConstants(uint32_t index, const base::PipelineRef& pipeline, base::Shader::StageBit stages, uint32_t offset, uint32_t size, const void* pValues) override;
 
 		void DrawIndexed(uint32_t index, uint32_t indexCount, uint32_t instanceCount = 1, uint32_t firstIndex = 0, int32_t vertexOffset = 0, uint32_t firstInstance = 0) override;
 		void Draw(uint32_t index, uint32_t vertexCount, uint32_t instanceCount = 1, uint32_t firstVertex = 0, uint32_t firstInstance = 0) override;
@@ -68,21 +85,39 @@ namespace vulkan
 
 		void Dispatch(uint32_t index, uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ) override;
 
-		void BuildAccelerationStructure(uint32_t index, const std::vector<base::AccelerationStructureBuildInfoRef>& buildGeometryInfos, const std::vector<std::vector<base::AccelerationStructureBuildInfo::BuildRangeInfo>>& buildRangeInfos) override;
+		void DrawIndirect(uint32_t index, const base::BufferRef& buffer, uint64_t offset, uint32_t drawCount, uint32_t stride = sizeof(DrawIndirectCommand)) override;
+		void DrawIndexedIndirect(uint32_t index, const base::BufferRef& buffer, uint64_t offset, uint32_t drawCount, uint32_t stride = sizeof(DrawIndexedIndirectCommand)) override;
+		void DrawIndirectCount(uint32_t index, const base::BufferRef& buffer, uint64_t offset, const base::BufferRef& countBuffer, uint64_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride = sizeof(DrawIndirectCommand)) override;
+		void DrawIndexedIndirectCount(uint32_t index, const base::BufferRef& buffer, uint64_t offset, const base::BufferRef& countBuffer, uint64_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride = sizeof(DrawIndexedIndirectCommand)) override;
+		void DrawMeshTasksIndirect(uint32_t index, const base::BufferRef& buffer, uint64_t offset, uint32_t drawCount, uint32_t stride = sizeof(DrawMeshTasksIndirectCommand)) override;
+		void DrawMeshTasksIndirectCount(uint32_t index, const base::BufferRef& buffer, uint64_t offset, const base::BufferRef& countBuffer, uint64_t countBufferOffset, uint32_t maxDrawCount, uint32_t stride = sizeof(DrawMeshTasksIndirectCommand)) override;
+		void DispatchIndirect(uint32_t index, const base::BufferRef& buffer, uint64_t offset) override;
+
+		void BuildAccelerationStructure(uint32_t index, const base::AccelerationStructureBuildInfoRef* pBuildGeometryInfos, uint32_t buildGeometryInfoCount, const base::AccelerationStructureBuildInfo::BuildRangeInfo* const* ppBuildRangeInfos) override;
 		void TraceRays(uint32_t index, const base::StridedDeviceAddressRegion* pRaygenShaderBindingTable, const base::StridedDeviceAddressRegion* pMissShaderBindingTable, const base::StridedDeviceAddressRegion* pHitShaderBindingTable, const base::StridedDeviceAddressRegion* pCallableShaderBindingTable, uint32_t width, uint32_t height, uint32_t depth) override;
 
-		void CopyBuffer(uint32_t index, const base::BufferRef& srcBuffer, const base::BufferRef& dstBuffer, const std::vector<base::Buffer::Copy>& copyRegions) override;
-		void CopyImage(uint32_t index, const base::ImageRef& srcImage, base::Image::Layout srcImageLayout, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const std::vector<base::Image::Copy>& copyRegions) override;
-		void CopyBufferToImage(uint32_t index, const base::BufferRef& srcBuffer, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const std::vector<base::Image::BufferImageCopy>& regions) override;
-		void CopyImageToBuffer(uint32_t index, const base::ImageRef& srcImage, const base::BufferRef& dstBuffer, base::Image::Layout srcImageLayout, const std::vector<base::Image::BufferImageCopy>& regions) override;
+		void CopyBuffer(uint32_t index, const base::BufferRef& srcBuffer, const base::BufferRef& dstBuffer, const base::Buffer::Copy* pCopyRegions, uint32_t copyRegionCount) override;
+		void CopyImage(uint32_t index, const base::ImageRef& srcImage, base::Image::Layout srcImageLayout, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const base::Image::Copy* pCopyRegions, uint32_t copyRegionCount) override;
+		void CopyBufferToImage(uint32_t index, const base::BufferRef& srcBuffer, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const base::Image::BufferImageCopy* pRegions, uint32_t regionCount) override;
+		void CopyImageToBuffer(uint32_t index, const base::ImageRef& srcImage, const base::BufferRef& dstBuffer, base::Image::Layout srcImageLayout, const base::Image::BufferImageCopy* pRegions, uint32_t regionCount) override;
+
+		void ResolveImage(uint32_t index, const base::ImageRef& srcImage, base::Image::Layout srcImageLayout, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const base::Image::Resolve* pResolveRegions, uint32_t resolveRegionCount) override;
 
-		void ResolveImage(uint32_t index, const base::ImageRef& srcImage, base::Image::Layout srcImageLayout, const base::ImageRef& dstImage, base::Image::Layout dstImageLayout, const std::vector<base::Image::Resolve>& resolveRegions) override;
+		void ResetQueryPool(uint32_t index, const base::QueryPoolRef& queryPool, uint32_t firstQuery, uint32_t queryCount) override;
+		void BeginQuery(uint32_t index, const base::QueryPoolRef& queryPool, uint32_t query, bool precise = false) override;
+		void EndQuery(uint32_t index, const base::QueryPoolRef& queryPool, uint32_t query) override;
+		void WriteTimestamp(uint32_t index, base::PipelineStageBit stage, const base::QueryPoolRef& queryPool, uint32_t query) override;
+		void CopyQueryPoolResults(uint32_t index, const base::QueryPoolRef& queryPool, uint32_t firstQuery, uint32_t queryCount, const base::BufferRef& dstBuffer, uint64_t dstOffset) override;
 
 		void BeginDebugLabel(uint32_t index, const std::string& label, std::array<float, 4> rgba = { 0.0f, 0.0f , 0.0f, 0.0f }) override;
 		void EndDebugLabel(uint32_t index) override;
 
-		void SetViewport(uint32_t index, const std::vector<base::Viewport>& viewports) override;
-		void SetScissor(uint32_t index, const std::vector<base::Rect2D>& scissors) override;
+		void SetViewport(uint32_t index, const base::Viewport* pViewports, uint32_t viewportCount) override;
+		void SetScissor(uint32_t index, const base::Rect2D* pScissors, uint32_t scissorCount) override;
+
+	private:
+		void QueueBarrier(uint32_t index, VkDependencyFlags dependencies, const Barrier2* barrier);
+		void ClearPendingBarriers(uint32_t index);
 
 		//Members
 	public:
@@ -93,6 +128,50 @@ namespace vulkan
 		VkCommandBufferAllocateInfo m_CmdBufferAI;
 		
 		std::vector<VkCommandBufferBeginInfo> m_CmdBufferBIs;
+
+	private:
+		//Barriers queued by PipelineBarrier2() for CreateInfo::deferBarriers.
+		struct PendingBarriers
+		{
+			VkDependencyFlags					dependencies;
+			std::vector<VkMemoryBarrier2>		memoryBarriers;
+			std::vector<VkBufferMemoryBarrier2>	bufferBarriers;
+			std::vector<VkImageMemoryBarrier2>	imageBarriers;
+		};
+		std::vector<PendingBarriers> m_PendingBarriers;
+	};
+
+	class SubmissionQueue final : public base::SubmissionQueue
+	{
+		//Methods
+	public:
+		SubmissionQueue(SubmissionQueue::CreateInfo* pCreateInfo);
+		~SubmissionQueue();
+
+		void Add(const base::CommandBufferRef& commandBuffer, const std::vector<base::CommandBuffer::SubmitInfo2>& submitInfo2s) override;
+		void Flush(const base::FenceRef& fence) override;
+
+	private:
+		static VkSemaphoreSubmitInfo GetSemaphoreSubmitInfo(const base::CommandBuffer::SemaphoreSubmitInfo& semaphoreInfo);
+
+		//Members
+	public:
+		VkQueue m_Queue;
+		std::mutex* m_QueueMutex;
+
+	private:
+		//Vectors are cleared rather than destroyed at Flush(), so that steady state batching does not allocate.
+		struct Batch
+		{
+			std::vector<VkSemaphoreSubmitInfo>		waitSemaphoreInfos;
+			std::vector<VkCommandBufferSubmitInfo>	commandBufferInfos;
+			std::vector<VkSemaphoreSubmitInfo>		signalSemaphoreInfos;
+		};
+		std::vector<Batch> m_Batches;
+		size_t m_BatchCount = 0;
+		std::vector<VkSubmitInfo2> m_SubmitInfo2s;
+		std::vector<base::CommandBufferRef> m_CommandBuffers;	//Kept alive until Flush().
+		std::mutex m_Mutex;
 	};
 }
 }
\ No newline at end of file
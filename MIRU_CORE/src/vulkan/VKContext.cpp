@@ -1,4 +1,5 @@
 #include "VKContext.h"
+#include "base/HandlePool.h"
 #include <sstream>
 
 using namespace miru;
@@ -256,11 +257,13 @@ Context::Context(Context::CreateInfo* pCreateInfo)
 	for (size_t i = 0; i < m_DeviceQueueCIs.size(); i++)
 	{
 		std::vector<VkQueue>localQueues;
+		std::vector<std::unique_ptr<std::mutex>> localQueueMutexes;
 		for (size_t j = 0; j < m_DeviceQueueCIs[i].queueCount; j++)
 		{
 			VkQueue queue;
 			vkGetDeviceQueue(m_Device, static_cast<uint32_t>(i), static_cast<uint32_t>(j), &queue);
 			localQueues.push_back(queue);
+			localQueueMutexes.push_back(std::make_unique<std::mutex>());
 			
 			VkQueueFlagBits flags = static_cast<VkQueueFlagBits>(m_QueueFamilyProperties[i].queueFlags);
 			std::string typeStr("");
@@ -273,6 +276,7 @@ Context::Context(Context::CreateInfo* pCreateInfo)
 			VKSetName<VkQueue>(m_Device, queue, m_CI.deviceDebugName + ": Queue - " + typeStr);
 		}
 		m_Queues.push_back(localQueues);
+		m_QueueMutexes.push_back(std::move(localQueueMutexes));
 		localQueues.clear();
 	}
 }
@@ -281,6 +285,8 @@ Context::~Context()
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
+	base::ClearHandlePools();
+
 	if (IsActive(m_ActiveInstanceExtensions, VK_EXT_DEBUG_UTILS_EXTENSION_NAME))
 		vkDestroyDebugUtilsMessengerEXT(m_Instance, m_DebugUtilsMessenger, nullptr);
 
@@ -398,6 +404,14 @@ void Context::AddExtensions()
 			m_InstanceExtensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
 			//Promoted to Vulkan 1.1
 		}
+		//Used by the Allocator for heap budgets.
+		m_DeviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		//Required by VK_EXT_memory_budget.
+		//VK_KHR_get_physical_device_properties2 already loaded, if needed.
+		//Used by the GpuProfiler to correlate timestamps with the CPU clock.
+		m_DeviceExtensions.push_back(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME);
+		//Required by VK_EXT_calibrated_timestamps.
+		//VK_KHR_get_physical_device_properties2 already loaded, if needed.
 		if (arc::BitwiseCheck(m_CI.extensions, ExtensionsBit::TIMELINE_SEMAPHORE))
 		{
 			m_DeviceExtensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
@@ -550,6 +564,10 @@ void Context::LoadDeviceExtensionPFNs()
 
 	//VK_KHR_dynamic_rendering
 	MIRU_VULKAN_LOAD_DEVICE_EXTENSION(KHR_dynamic_rendering);
+
+	//VK_EXT_calibrated_timestamps - Also loads vkGetPhysicalDeviceCalibrateableTimeDomainsEXT from the instance.
+	if (IsActive(m_ActiveDeviceExtensions, VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME))
+		LoadPFN_VK_EXT_calibrated_timestamps(m_Instance, m_Device);
 }
 
 Context::PhysicalDevices::PhysicalDevices(const VkInstance& instance)
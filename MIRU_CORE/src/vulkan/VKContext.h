@@ -1,6 +1,7 @@
 #pragma once
 #include "base/Context.h"
 #include "vulkan/VK_Include.h"
+#include <mutex>
 
 namespace miru
 {
@@ -147,6 +148,7 @@ namespace vulkan
 		std::vector<VkDeviceQueueCreateInfo> m_DeviceQueueCIs;
 		std::vector<VkQueueFamilyProperties> m_QueueFamilyProperties;
 		std::vector<std::vector<float>> m_QueuePriorities;
+		std::vector<std::vector<std::unique_ptr<std::mutex>>> m_QueueMutexes; //VkQueue access must be externally synchronised.
 	};
 }
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "VKImage.h"
+#include "VKAllocator.h"
 
 using namespace miru;
 using namespace vulkan;
@@ -26,22 +27,59 @@ Image::Image(Image::CreateInfo* pCreateInfo)
 	m_ImageCI.pQueueFamilyIndices = nullptr;
 	m_ImageCI.initialLayout = static_cast<VkImageLayout>(m_CI.layout);
 
+	const bool& transient = IsTransientAttachment();
+	if (transient)
+	{
+		//Transient attachments may only have attachment usages.
+		const VkImageUsageFlags attachmentUsages = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+		MIRU_WARN((m_ImageCI.usage & ~attachmentUsages) != 0, "WARN: VULKAN: Transient attachment Image has non-attachment usages, which are ignored.");
+		m_ImageCI.usage = (m_ImageCI.usage & attachmentUsages) | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+	}
+
 	if (m_CI.externalImage)
 	{
 		m_Image = reinterpret_cast<VkImage>(m_CI.externalImage);
 		return;
 	}
 
+	if (!m_CI.allocator)
+	{
+		//Created without memory. The memory is bound by an AliasingHeap.
+		MIRU_FATAL(vkCreateImage(m_Device, &m_ImageCI, nullptr, &m_Image), "ERROR: VULKAN: Failed to create Image.");
+		VKSetName<VkImage>(m_Device, m_Image, m_CI.debugName);
+		m_VmaAllocation = VK_NULL_HANDLE;
+		m_Allocation = {};
+		return;
+	}
+
 	m_VmaACI.flags = 0;
 	m_VmaACI.usage = VMA_MEMORY_USAGE_UNKNOWN;
 	m_VmaACI.requiredFlags = static_cast<VkMemoryPropertyFlags>(m_CI.allocator->GetCreateInfo().properties);
-	m_VmaACI.preferredFlags = 0;
+	m_VmaACI.preferredFlags = transient ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0;
 	m_VmaACI.memoryTypeBits = 0;
 	m_VmaACI.pool = VK_NULL_HANDLE;
-	m_VmaACI.pUserData = nullptr;
+	m_VmaACI.pUserData = &m_AllocationOwner; //Used to find the owner of the VmaAllocation during defragmentation.
+
+	//Transient attachments are not pooled, so that they can use a lazily allocated memory type.
+	const AllocatorRef& allocatorRef = ref_cast<Allocator>(m_CI.allocator);
+	m_VmaACI.pool = transient ? VK_NULL_HANDLE : allocatorRef->GetPool(m_ImageCI, m_VmaACI);
 
 	VmaAllocator& allocator = *reinterpret_cast<VmaAllocator*>(m_CI.allocator->GetNativeAllocator());
-	MIRU_FATAL(vmaCreateImage(allocator, &m_ImageCI, &m_VmaACI, &m_Image, &m_VmaAllocation, &m_VmaAI), "ERROR: VULKAN: Failed to create Image.");
+	VkResult result = vmaCreateImage(allocator, &m_ImageCI, &m_VmaACI, &m_Image, &m_VmaAllocation, &m_VmaAI);
+	if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY && m_VmaACI.pool && allocatorRef->CanFallbackFromPool())
+	{
+		//The Image is larger than the pool's block size.
+		m_VmaACI.pool = VK_NULL_HANDLE;
+		result = vmaCreateImage(allocator, &m_ImageCI, &m_VmaACI, &m_Image, &m_VmaAllocation, &m_VmaAI);
+	}
+	if (result == VK_ERROR_FEATURE_NOT_PRESENT && (m_VmaACI.requiredFlags & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT))
+	{
+		//The device has no lazily allocated memory type.
+		MIRU_WARN(true, "WARN: VULKAN: No lazily allocated memory available. Falling back to the Allocator's other memory properties.");
+		m_VmaACI.requiredFlags &= ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+		result = vmaCreateImage(allocator, &m_ImageCI, &m_VmaACI, &m_Image, &m_VmaAllocation, &m_VmaAI);
+	}
+	MIRU_FATAL(result, "ERROR: VULKAN: Failed to create Image.");
 	VKSetName<VkImage>(m_Device, m_Image, m_CI.debugName);
 
 	m_Allocation.nativeAllocation = (base::NativeAllocation)&m_VmaAllocation;
@@ -61,13 +99,28 @@ Image::~Image()
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
-	if (!m_SwapchainImage && !m_CI.externalImage)
+	if (!m_SwapchainImage && !m_CI.externalImage && !m_CI.allocator)
+	{
+		vkDestroyImage(m_Device, m_Image, nullptr);
+	}
+	else if (!m_SwapchainImage && !m_CI.externalImage)
 	{
+		if (ref_cast<Allocator>(m_CI.allocator)->ReleaseMovingAllocation(m_VmaAllocation, VK_NULL_HANDLE, m_Image))
+			return;
+
 		VmaAllocator& allocator = *reinterpret_cast<VmaAllocator*>(m_CI.allocator->GetNativeAllocator());
 		vmaDestroyImage(allocator, m_Image, m_VmaAllocation);
 	}
 }
 
+void Image::Rebind(VkImage image)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_Image = image;
+	VKSetName<VkImage>(m_Device, m_Image, m_CI.debugName);
+}
+
 void Image::GenerateMipmaps()
 {
 	/*VkCommandBuffer cmdBuffer = MemoryBlock::GetNextCommandBuffer();
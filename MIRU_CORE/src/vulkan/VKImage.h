@@ -1,6 +1,7 @@
 #pragma once
 #include "base/Image.h"
 #include "vulkan/VK_Include.h"
+#include "vulkan/VKAllocator.h"
 
 namespace miru
 {
@@ -13,9 +14,14 @@ namespace vulkan
 		Image(Image::CreateInfo* pCreateInfo);
 		~Image();
 
+		//Replaces the VkImage with one bound to the VmaAllocation's new memory during defragmentation.
+		//The Allocator destroys the previous VkImage once the device has finished using it.
+		void Rebind(VkImage image);
+
+		VkImageAspectFlags GetVkImageAspect(Image::Format format);
+
 	private:
 		void GenerateMipmaps();
-		VkImageAspectFlags GetVkImageAspect(Image::Format format);
 
 		//Members
 	public:
@@ -27,6 +33,7 @@ namespace vulkan
 		VmaAllocation m_VmaAllocation;
 		VmaAllocationCreateInfo m_VmaACI;
 		VmaAllocationInfo m_VmaAI;
+		Allocator::AllocationOwner m_AllocationOwner = { nullptr, this };
 	};
 
 	class ImageView final : public base::ImageView
@@ -21,9 +21,9 @@ RenderPass::RenderPass(RenderPass::CreateInfo* pCreateInfo)
 		static_cast<VkFormat>(attachment.format),
 		static_cast<VkSampleCountFlagBits>(attachment.samples),
 		static_cast<VkAttachmentLoadOp>(attachment.loadOp),
-		static_cast<VkAttachmentStoreOp>(attachment.storeOp),
+		attachment.transient ? VK_ATTACHMENT_STORE_OP_DONT_CARE : static_cast<VkAttachmentStoreOp>(attachment.storeOp),
 		static_cast<VkAttachmentLoadOp>(attachment.stencilLoadOp),
-		static_cast<VkAttachmentStoreOp>(attachment.stencilStoreOp),
+		attachment.transient ? VK_ATTACHMENT_STORE_OP_DONT_CARE : static_cast<VkAttachmentStoreOp>(attachment.stencilStoreOp),
 		static_cast<VkImageLayout>(attachment.initialLayout),
 		static_cast<VkImageLayout>(attachment.finalLayout),
 			});
@@ -0,0 +1,86 @@
+#include "VKQueryPool.h"
+#include "VKContext.h"
+
+using namespace miru;
+using namespace vulkan;
+
+QueryPool::QueryPool(QueryPool::CreateInfo* pCreateInfo)
+	:m_Device(*reinterpret_cast<VkDevice*>(pCreateInfo->context->GetDevice()))
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	m_CI = *pCreateInfo;
+
+	m_QueryPoolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	m_QueryPoolCI.pNext = nullptr;
+	m_QueryPoolCI.flags = 0;
+	m_QueryPoolCI.queryType = m_CI.type == Type::TIMESTAMP ? VK_QUERY_TYPE_TIMESTAMP : m_CI.type == Type::OCCLUSION ? VK_QUERY_TYPE_OCCLUSION : VK_QUERY_TYPE_PIPELINE_STATISTICS;
+	m_QueryPoolCI.queryCount = m_CI.queryCount;
+	m_QueryPoolCI.pipelineStatistics = 0;
+	if (m_CI.type == Type::PIPELINE_STATISTICS)
+	{
+		//In the order of base::QueryPool::PipelineStatistics.
+		m_QueryPoolCI.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT
+			| VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT
+			| VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT
+			| VK_QUERY_PIPELINE_STATISTIC_GEOMETRY_SHADER_INVOCATIONS_BIT
+			| VK_QUERY_PIPELINE_STATISTIC_GEOMETRY_SHADER_PRIMITIVES_BIT
+			| VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT
+			| VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT
+			| VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT
+			| VK_QUERY_PIPELINE_STATISTIC_TESSELLATION_CONTROL_SHADER_PATCHES_BIT
+			| VK_QUERY_PIPELINE_STATISTIC_TESSELLATION_EVALUATION_SHADER_INVOCATIONS_BIT
+			| VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+	}
+
+	MIRU_FATAL(vkCreateQueryPool(m_Device, &m_QueryPoolCI, nullptr, &m_QueryPool), "ERROR: VULKAN: Failed to create QueryPool.");
+	VKSetName<VkQueryPool>(m_Device, m_QueryPool, m_CI.debugName);
+}
+
+QueryPool::~QueryPool()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	vkDestroyQueryPool(m_Device, m_QueryPool, nullptr);
+}
+
+double QueryPool::GetTimestampPeriod()
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	const ContextRef& context = ref_cast<Context>(m_CI.context);
+	return static_cast<double>(context->m_PhysicalDevices.m_PDIs[context->m_PhysicalDeviceIndex].m_Properties.limits.timestampPeriod);
+}
+
+bool QueryPool::GetResults(uint32_t firstQuery, uint32_t queryCount, void* pResults, bool* pAvailable)
+{
+	MIRU_CPU_PROFILE_FUNCTION();
+
+	if (queryCount == 0)
+		return true;
+
+	//Each query's values are followed by its availability value.
+	const size_t& valueCount = GetResultSize() / sizeof(uint64_t);
+	const size_t& stride = (valueCount + 1) * sizeof(uint64_t);
+	std::vector<uint64_t> data((valueCount + 1) * queryCount, 0);
+
+	VkResult result = vkGetQueryPoolResults(m_Device, m_QueryPool, firstQuery, queryCount, data.size() * sizeof(uint64_t), data.data(), stride, VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	if (result != VK_SUCCESS && result != VK_NOT_READY)
+	{
+		MIRU_FATAL(result, "ERROR: VULKAN: Failed to get QueryPool results.");
+		return false;
+	}
+
+	bool allAvailable = true;
+	for (uint32_t i = 0; i < queryCount; i++)
+	{
+		const uint64_t* queryData = data.data() + (valueCount + 1) * i;
+		const bool& available = queryData[valueCount] != 0;
+		if (available)
+			memcpy(reinterpret_cast<uint8_t*>(pResults) + GetResultSize() * i, queryData, GetResultSize());
+		if (pAvailable)
+			pAvailable[i] = available;
+		allAvailable &= available;
+	}
+	return allAvailable;
+}
\ No newline at end of file
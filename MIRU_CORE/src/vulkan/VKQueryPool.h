@@ -0,0 +1,27 @@
+#pragma once
+#include "base/QueryPool.h"
+#include "vulkan/VK_Include.h"
+
+namespace miru
+{
+namespace vulkan
+{
+	class QueryPool final : public base::QueryPool
+	{
+		//Methods
+	public:
+		QueryPool(QueryPool::CreateInfo* pCreateInfo);
+		~QueryPool();
+
+		double GetTimestampPeriod() override;
+		bool GetResults(uint32_t firstQuery, uint32_t queryCount, void* pResults, bool* pAvailable = nullptr) override;
+
+		//Members
+	public:
+		VkDevice& m_Device;
+
+		VkQueryPool m_QueryPool;
+		VkQueryPoolCreateInfo m_QueryPoolCI;
+	};
+}
+}
\ No newline at end of file
@@ -251,10 +251,8 @@ void Swapchain::Present(const base::CommandPoolRef& cmdPool, const base::Semapho
 {
 	MIRU_CPU_PROFILE_FUNCTION();
 
-	const ContextRef& context = ref_cast<Context>(m_CI.context);
 	const CommandPoolRef& pool = ref_cast<CommandPool>(cmdPool);
-
-	VkQueue vkQueue = context->m_Queues[pool->GetQueueFamilyIndex(pool->GetCreateInfo().queueType)][0];
+	VkQueue vkQueue = pool->m_Queue;
 
 	VkPresentInfoKHR pi = {};
 	pi.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -266,7 +264,9 @@ void Swapchain::Present(const base::CommandPoolRef& cmdPool, const base::Semapho
 	pi.pImageIndices = &imageIndex;
 	pi.pResults = nullptr;
 
+	std::unique_lock<std::mutex> lock(*pool->m_QueueMutex);
 	VkResult result = vkQueuePresentKHR(vkQueue, &pi);
+	lock.unlock();
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
 	{
 		m_Resized = true;
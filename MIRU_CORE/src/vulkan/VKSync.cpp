@@ -242,7 +242,7 @@ Barrier::Barrier(Barrier::CreateInfo* pCreateInfo)
 		m_BMB.srcQueueFamilyIndex = m_CI.srcQueueFamilyIndex;
 		m_BMB.dstQueueFamilyIndex = m_CI.dstQueueFamilyIndex;
 		m_BMB.buffer = ref_cast<vulkan::Buffer>(m_CI.buffer)->m_Buffer;
-		m_BMB.offset = m_CI.offset;
+		m_BMB.offset = m_CI.buffer->GetOffset() + m_CI.offset;
 		m_BMB.size = m_CI.size;
 	}
 	else if (m_CI.type == Barrier::Type::IMAGE)
@@ -299,7 +299,7 @@ Barrier2::Barrier2(Barrier2::CreateInfo* pCreateInfo)
 		m_BMB.srcQueueFamilyIndex = m_CI.srcQueueFamilyIndex;
 		m_BMB.dstQueueFamilyIndex = m_CI.dstQueueFamilyIndex;
 		m_BMB.buffer = ref_cast<vulkan::Buffer>(m_CI.buffer)->m_Buffer;
-		m_BMB.offset = m_CI.offset;
+		m_BMB.offset = m_CI.buffer->GetOffset() + m_CI.offset;
 		m_BMB.size = m_CI.size;
 	}
 	else if (m_CI.type == Barrier::Type::IMAGE)
@@ -139,6 +139,19 @@ namespace miru
 			return true;
 		}
 
+		//VK_EXT_calibrated_timestamps - Requires support for Vulkan 1.0
+
+		MIRU_PFN_DEFINITION_NULL(vkGetPhysicalDeviceCalibrateableTimeDomainsEXT);
+		MIRU_PFN_DEFINITION_NULL(vkGetCalibratedTimestampsEXT);
+
+		inline bool LoadPFN_VK_EXT_calibrated_timestamps(VkInstance& instance, VkDevice& device)
+		{
+			MIRU_PFN_VK_GET_INSTANCE_PROC_ADDR(vkGetPhysicalDeviceCalibrateableTimeDomainsEXT);
+			MIRU_PFN_VK_GET_DEVICE_PROC_ADDR(vkGetCalibratedTimestampsEXT);
+
+			return true;
+		}
+
 		//VK_KHR_ray_tracing_pipeline - Requires support for Vulkan 1.1
 
 		MIRU_PFN_DEFINITION_NULL(vkCmdTraceRaysKHR);
@@ -260,6 +273,15 @@ namespace miru
 			return true;
 		}
 
+		//VK_KHR_draw_indirect_count - Promoted to Vulkan 1.2
+#if MIRU_VK_API_VERSION_1_2
+		MIRU_PFN_DEFINITION_LOAD(vkCmdDrawIndirectCount);
+		MIRU_PFN_DEFINITION_LOAD(vkCmdDrawIndexedIndirectCount);
+#else
+		MIRU_PFN_DEFINITION_NULL(vkCmdDrawIndirectCount);
+		MIRU_PFN_DEFINITION_NULL(vkCmdDrawIndexedIndirectCount);
+#endif
+
 		//VK_KHR_synchronization2 - Promoted to Vulkan 1.3
 #if MIRU_VK_API_VERSION_1_3
 		MIRU_PFN_DEFINITION_LOAD(vkCmdPipelineBarrier2);
@@ -0,0 +1,6 @@
+#include "msc_common.h"
+
+[numthreads(1, 1, 1)]
+void cs_main(uint3 id : SV_DispatchThreadID)
+{
+}
\ No newline at end of file
@@ -0,0 +1,488 @@
+#include "miru_core.h"
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#if defined(_MSC_VER) && defined(_DEBUG)
+#include <crtdbg.h>
+#endif
+
+using namespace miru;
+using namespace base;
+
+//Counts the heap allocations made while g_CountAllocations is set.
+static std::atomic<bool> g_CountAllocations = { false };
+static std::atomic<uint64_t> g_AllocationCount = { 0 };
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+//MIRU_CORE is a DLL with its own operator new, so the allocations are counted in the shared debug CRT heap.
+static int AllocHook(int allocType, void*, size_t, int, long, const unsigned char*, int)
+{
+	if (allocType == _HOOK_ALLOC && g_CountAllocations)
+		g_AllocationCount++;
+	return TRUE;
+}
+#else
+void* operator new(size_t size)
+{
+	if (g_CountAllocations)
+		g_AllocationCount++;
+
+	void* ptr = malloc(size ? size : 1);
+	if (!ptr)
+		throw std::bad_alloc();
+	return ptr;
+}
+void operator delete(void* ptr) noexcept
+{
+	free(ptr);
+}
+#endif
+
+//Records every command that has an overload taking Handles or pointers, twice per CommandBuffer, and checks that
+//the second recording makes no heap allocations. The CommandBuffers are never submitted, so the Images are not
+//transitioned to the layouts that the commands are recorded with.
+//Vulkan only: D3D12 ClearColourImage(), ResolveImage() and BeginRenderPass() create descriptor heaps or Barriers.
+void AllocationFreeRecording()
+{
+	GraphicsAPI::SetAPI(GraphicsAPI::API::VULKAN);
+	GraphicsAPI::AllowSetName();
+	GraphicsAPI::LoadGraphicsDebugger(debug::GraphicsDebugger::DebuggerType::NONE);
+
+	//The validation layers allocate as they track each command, so they are disabled.
+	Context::CreateInfo contextCI;
+	contextCI.applicationName = "MIRU_TEST";
+	contextCI.extensions = Context::ExtensionsBit::SYNCHRONISATION_2 | Context::ExtensionsBit::DYNAMIC_RENDERING | Context::ExtensionsBit::RAY_TRACING;
+	contextCI.debugValidationLayers = false;
+	contextCI.deviceDebugName = "GPU Device";
+	contextCI.pNext = nullptr;
+	ContextRef context = Context::Create(&contextCI);
+	const bool rayTracing = arc::BitwiseCheck(context->GetResultInfo().activeExtensions, Context::ExtensionsBit::RAY_TRACING);
+
+	//Shaders
+	auto compileArguments = base::Shader::LoadCompileArgumentsFromFile("../shaderbin/basic_hlsl.json", { { "$SOLUTION_DIR", SOLUTION_DIR }, { "$BUILD_DIR", BUILD_DIR } });
+	Shader::CreateInfo shaderCI;
+	shaderCI.debugName = "Basic: Vertex Shader Module";
+	shaderCI.device = context->GetDevice();
+	shaderCI.stageAndEntryPoints = { {Shader::StageBit::VERTEX_BIT, "vs_main"} };
+	shaderCI.binaryFilepath = "../shaderbin/basic_vs_6_0_vs_main.spv";
+	shaderCI.binaryCode = {};
+	shaderCI.recompileArguments = compileArguments[0];
+	ShaderRef vertexShader = Shader::Create(&shaderCI);
+	shaderCI.debugName = "Basic: Fragment Shader Module";
+	shaderCI.stageAndEntryPoints = { { Shader::StageBit::PIXEL_BIT, "ps_main"} };
+	shaderCI.binaryFilepath = "../shaderbin/basic_ps_6_0_ps_main.spv";
+	shaderCI.recompileArguments = compileArguments[1];
+	ShaderRef fragmentShader = Shader::Create(&shaderCI);
+	shaderCI.debugName = "Compute: Compute Shader Module";
+	shaderCI.stageAndEntryPoints = { { Shader::StageBit::COMPUTE_BIT, "cs_main"} };
+	shaderCI.binaryFilepath = "../shaderbin/compute_cs_6_0_cs_main.spv";
+	shaderCI.recompileArguments = base::Shader::LoadCompileArgumentsFromFile("../shaderbin/compute_hlsl.json", { { "$SOLUTION_DIR", SOLUTION_DIR }, { "$BUILD_DIR", BUILD_DIR } })[0];
+	ShaderRef computeShader = Shader::Create(&shaderCI);
+
+	CommandPool::CreateInfo cmdPoolCI;
+	cmdPoolCI.debugName = "CmdPool";
+	cmdPoolCI.context = context;
+	cmdPoolCI.flags = CommandPool::FlagBit::RESET_COMMAND_BUFFER_BIT;
+	cmdPoolCI.queueType = CommandPool::QueueType::GRAPHICS;
+	CommandPoolRef cmdPool = CommandPool::Create(&cmdPoolCI);
+
+	CommandBuffer::CreateInfo cmdBufferCI;
+	cmdBufferCI.debugName = "CmdBuffer";
+	cmdBufferCI.commandPool = cmdPool;
+	cmdBufferCI.level = CommandBuffer::Level::PRIMARY;
+	cmdBufferCI.commandBufferCount = 2;
+	CommandBufferRef cmdBuffer = CommandBuffer::Create(&cmdBufferCI);
+
+	Allocator::CreateInfo allocCI;
+	allocCI.debugName = "CPU_ALLOC_0";
+	allocCI.context = context;
+	allocCI.blockSize = Allocator::BlockSize::BLOCK_SIZE_64MB;
+	allocCI.properties = Allocator::PropertiesBit::HOST_VISIBLE_BIT | Allocator::PropertiesBit::HOST_COHERENT_BIT;
+	AllocatorRef cpu_alloc_0 = Allocator::Create(&allocCI);
+	allocCI.debugName = "GPU_ALLOC_0";
+	allocCI.properties = Allocator::PropertiesBit::DEVICE_LOCAL_BIT;
+	AllocatorRef gpu_alloc_0 = Allocator::Create(&allocCI);
+
+	//Buffers
+	Buffer::CreateInfo bufferCI;
+	bufferCI.debugName = "Vertices Buffer";
+	bufferCI.device = context->GetDevice();
+	bufferCI.usage = Buffer::UsageBit::TRANSFER_DST_BIT | Buffer::UsageBit::VERTEX_BIT;
+	bufferCI.size = 1024;
+	bufferCI.data = nullptr;
+	bufferCI.allocator = gpu_alloc_0;
+	BufferRef buffer = Buffer::Create(&bufferCI);
+	bufferCI.debugName = "Indices Buffer";
+	bufferCI.usage = Buffer::UsageBit::TRANSFER_DST_BIT | Buffer::UsageBit::INDEX_BIT;
+	bufferCI.size = 36 * sizeof(uint32_t);
+	BufferRef indexBuffer = Buffer::Create(&bufferCI);
+	bufferCI.debugName = "Transfer Buffer";
+	bufferCI.usage = Buffer::UsageBit::TRANSFER_SRC_BIT | Buffer::UsageBit::TRANSFER_DST_BIT;
+	bufferCI.size = 64 * 64 * 4;
+	bufferCI.allocator = cpu_alloc_0;
+	BufferRef transferBuffer = Buffer::Create(&bufferCI);
+	bufferCI.debugName = "Camera and Model UB";
+	bufferCI.usage = Buffer::UsageBit::UNIFORM_BIT;
+	bufferCI.size = 3 * 16 * sizeof(float);
+	BufferRef ub = Buffer::Create(&bufferCI);
+
+	BufferView::CreateInfo vbViewCI;
+	vbViewCI.debugName = "VerticesBufferView";
+	vbViewCI.device = context->GetDevice();
+	vbViewCI.type = BufferView::Type::VERTEX;
+	vbViewCI.buffer = buffer;
+	vbViewCI.offset = 0;
+	vbViewCI.size = 1024;
+	vbViewCI.stride = 4 * sizeof(float);
+	BufferViewHandle vbvs[2] = { CreateHandle(BufferView::Create(&vbViewCI)), CreateHandle(BufferView::Create(&vbViewCI)) };
+
+	BufferView::CreateInfo ibViewCI;
+	ibViewCI.debugName = "IndicesBufferView";
+	ibViewCI.device = context->GetDevice();
+	ibViewCI.type = BufferView::Type::INDEX;
+	ibViewCI.buffer = indexBuffer;
+	ibViewCI.offset = 0;
+	ibViewCI.size = 36 * sizeof(uint32_t);
+	ibViewCI.stride = sizeof(uint32_t);
+	BufferViewHandle ibv = CreateHandle(BufferView::Create(&ibViewCI));
+
+	BufferView::CreateInfo ubViewCI;
+	ubViewCI.debugName = "Camera UBView";
+	ubViewCI.device = context->GetDevice();
+	ubViewCI.type = BufferView::Type::UNIFORM;
+	ubViewCI.buffer = ub;
+	ubViewCI.offset = 0;
+	ubViewCI.size = 2 * 16 * sizeof(float);
+	ubViewCI.stride = 0;
+	BufferViewRef ubViewCam = BufferView::Create(&ubViewCI);
+	ubViewCI.debugName = "Model UBView";
+	ubViewCI.offset = 2 * 16 * sizeof(float);
+	ubViewCI.size = 16 * sizeof(float);
+	BufferViewRef ubViewMdl = BufferView::Create(&ubViewCI);
+
+	//Images
+	Image::CreateInfo imageCI;
+	imageCI.debugName = "Colour Image";
+	imageCI.device = context->GetDevice();
+	imageCI.type = Image::Type::TYPE_2D;
+	imageCI.format = Image::Format::R8G8B8A8_UNORM;
+	imageCI.width = 64;
+	imageCI.height = 64;
+	imageCI.depth = 1;
+	imageCI.mipLevels = 1;
+	imageCI.arrayLayers = 1;
+	imageCI.sampleCount = Image::SampleCountBit::SAMPLE_COUNT_1_BIT;
+	imageCI.usage = Image::UsageBit::COLOUR_ATTACHMENT_BIT | Image::UsageBit::TRANSFER_SRC_BIT | Image::UsageBit::TRANSFER_DST_BIT;
+	imageCI.layout = Image::Layout::UNKNOWN;
+	imageCI.size = 0;
+	imageCI.data = nullptr;
+	imageCI.allocator = gpu_alloc_0;
+	imageCI.externalImage = nullptr;
+	ImageRef colourImage = Image::Create(&imageCI);
+	imageCI.debugName = "Copy Image";
+	imageCI.usage = Image::UsageBit::TRANSFER_SRC_BIT | Image::UsageBit::TRANSFER_DST_BIT;
+	ImageRef copyImage = Image::Create(&imageCI);
+	imageCI.debugName = "Multisample Image";
+	imageCI.sampleCount = Image::SampleCountBit::SAMPLE_COUNT_4_BIT;
+	imageCI.usage = Image::UsageBit::COLOUR_ATTACHMENT_BIT | Image::UsageBit::TRANSFER_SRC_BIT | Image::UsageBit::TRANSFER_DST_BIT;
+	ImageRef msaaImage = Image::Create(&imageCI);
+	imageCI.debugName = "Cube Image";
+	imageCI.type = Image::Type::TYPE_CUBE;
+	imageCI.width = 1;
+	imageCI.height = 1;
+	imageCI.arrayLayers = 6;
+	imageCI.sampleCount = Image::SampleCountBit::SAMPLE_COUNT_1_BIT;
+	imageCI.usage = Image::UsageBit::SAMPLED_BIT;
+	ImageRef cubeImage = Image::Create(&imageCI);
+
+	ImageView::CreateInfo imageViewCI;
+	imageViewCI.debugName = "Colour ImageView";
+	imageViewCI.device = context->GetDevice();
+	imageViewCI.image = colourImage;
+	imageViewCI.viewType = Image::Type::TYPE_2D;
+	imageViewCI.subresourceRange = { Image::AspectBit::COLOUR_BIT, 0, 1, 0, 1 };
+	ImageViewRef colourImageView = ImageView::Create(&imageViewCI);
+	imageViewCI.debugName = "Cube ImageView";
+	imageViewCI.image = cubeImage;
+	imageViewCI.viewType = Image::Type::TYPE_CUBE;
+	imageViewCI.subresourceRange = { Image::AspectBit::COLOUR_BIT, 0, 1, 0, 6 };
+	ImageViewRef cubeImageView = ImageView::Create(&imageViewCI);
+
+	Sampler::CreateInfo samplerCI;
+	samplerCI.debugName = "Default Sampler";
+	samplerCI.device = context->GetDevice();
+	samplerCI.magFilter = Sampler::Filter::NEAREST;
+	samplerCI.minFilter = Sampler::Filter::NEAREST;
+	samplerCI.mipmapMode = Sampler::MipmapMode::NEAREST;
+	samplerCI.addressModeU = Sampler::AddressMode::REPEAT;
+	samplerCI.addressModeV = Sampler::AddressMode::REPEAT;
+	samplerCI.addressModeW = Sampler::AddressMode::REPEAT;
+	samplerCI.mipLodBias = 1;
+	samplerCI.anisotropyEnable = false;
+	samplerCI.maxAnisotropy = 1.0f;
+	samplerCI.compareEnable = false;
+	samplerCI.compareOp = CompareOp::NEVER;
+	samplerCI.minLod = 0;
+	samplerCI.maxLod = 1;
+	samplerCI.borderColour = Sampler::BorderColour::FLOAT_OPAQUE_BLACK;
+	samplerCI.unnormalisedCoordinates = false;
+	SamplerRef sampler = Sampler::Create(&samplerCI);
+
+	//Descriptor sets
+	DescriptorPool::CreateInfo descriptorPoolCI;
+	descriptorPoolCI.debugName = "Basic: Descriptor Pool";
+	descriptorPoolCI.device = context->GetDevice();
+	descriptorPoolCI.poolSizes = { {DescriptorType::COMBINED_IMAGE_SAMPLER, 1}, {DescriptorType::UNIFORM_BUFFER, 2} };
+	descriptorPoolCI.maxSets = 2;
+	DescriptorPoolRef descriptorPool = DescriptorPool::Create(&descriptorPoolCI);
+	DescriptorSetLayout::CreateInfo setLayoutCI;
+	setLayoutCI.debugName = "Basic: DescSetLayout1";
+	setLayoutCI.device = context->GetDevice();
+	setLayoutCI.descriptorSetLayoutBinding = { {0, DescriptorType::UNIFORM_BUFFER, 1, Shader::StageBit::VERTEX_BIT } };
+	DescriptorSetLayoutRef setLayout1 = DescriptorSetLayout::Create(&setLayoutCI);
+	setLayoutCI.debugName = "Basic: DescSetLayout2";
+	setLayoutCI.descriptorSetLayoutBinding = {
+		{0, DescriptorType::UNIFORM_BUFFER, 1, Shader::StageBit::VERTEX_BIT },
+		{1, DescriptorType::COMBINED_IMAGE_SAMPLER, 1, Shader::StageBit::FRAGMENT_BIT }
+	};
+	DescriptorSetLayoutRef setLayout2 = DescriptorSetLayout::Create(&setLayoutCI);
+	DescriptorSet::CreateInfo descriptorSetCI;
+	descriptorSetCI.debugName = "Basic: Descriptor Set 0";
+	descriptorSetCI.descriptorPool = descriptorPool;
+	descriptorSetCI.descriptorSetLayouts = { setLayout1 };
+	DescriptorSetRef descriptorSet_p0 = DescriptorSet::Create(&descriptorSetCI);
+	descriptorSetCI.debugName = "Basic: Descriptor Set 1";
+	descriptorSetCI.descriptorSetLayouts = { setLayout2 };
+	DescriptorSetRef descriptorSet_p1 = DescriptorSet::Create(&descriptorSetCI);
+	descriptorSet_p0->AddBuffer(0, 0, { { ubViewCam } });
+	descriptorSet_p1->AddBuffer(0, 0, { { ubViewMdl } });
+	descriptorSet_p1->AddImage(0, 1, { { sampler, cubeImageView, Image::Layout::SHADER_READ_ONLY_OPTIMAL } });
+	descriptorSet_p0->Update();
+	descriptorSet_p1->Update();
+	DescriptorSetHandle descriptorSets[2] = { CreateHandle(descriptorSet_p0), CreateHandle(descriptorSet_p1) };
+
+	//Pipelines
+	Pipeline::CreateInfo pCI;
+	pCI.debugName = "Basic";
+	pCI.device = context->GetDevice();
+	pCI.type = PipelineType::GRAPHICS;
+	pCI.shaders = { vertexShader, fragmentShader };
+	pCI.vertexInputState.vertexInputBindingDescriptions = { {0, 4 * sizeof(float), VertexInputRate::VERTEX} };
+	pCI.vertexInputState.vertexInputAttributeDescriptions = { {0, 0, VertexType::VEC4, 0, "POSITION"} };
+	pCI.inputAssemblyState = { PrimitiveTopology::TRIANGLE_LIST, false };
+	pCI.tessellationState = {};
+	pCI.viewportState.viewports = { {} };
+	pCI.viewportState.scissors = { {} };
+	pCI.rasterisationState = { false, false, PolygonMode::FILL, CullModeBit::BACK_BIT, FrontFace::CLOCKWISE, false, 0.0f, 0.0f, 0.0f, 1.0f };
+	pCI.multisampleState = { Image::SampleCountBit::SAMPLE_COUNT_1_BIT, false, 1.0f, UINT32_MAX, false, false };
+	pCI.depthStencilState = { false, false, CompareOp::GREATER, false, false, {}, {}, 0.0f, 1.0f };
+	pCI.colourBlendState.logicOpEnable = false;
+	pCI.colourBlendState.logicOp = LogicOp::COPY;
+	pCI.colourBlendState.attachments = { {true, BlendFactor::SRC_ALPHA, BlendFactor::ONE_MINUS_SRC_ALPHA, BlendOp::ADD,
+											BlendFactor::ONE, BlendFactor::ZERO, BlendOp::ADD, (ColourComponentBit)15 } };
+	pCI.colourBlendState.blendConstants[0] = 0.0f;
+	pCI.colourBlendState.blendConstants[1] = 0.0f;
+	pCI.colourBlendState.blendConstants[2] = 0.0f;
+	pCI.colourBlendState.blendConstants[3] = 0.0f;
+	pCI.dynamicStates = { { DynamicState::VIEWPORT, DynamicState::SCISSOR } };
+	pCI.layout = { { setLayout1, setLayout2 }, { { Shader::StageBit::VERTEX_BIT, 0, 4 * sizeof(float) } } };
+	pCI.renderPass = nullptr;
+	pCI.dynamicRendering = { 0, { imageCI.format }, Image::Format::UNKNOWN, Image::Format::UNKNOWN };
+	PipelineRef pipeline = Pipeline::Create(&pCI);
+
+	Pipeline::CreateInfo computePipelineCI;
+	computePipelineCI.debugName = "Compute";
+	computePipelineCI.device = context->GetDevice();
+	computePipelineCI.type = PipelineType::COMPUTE;
+	computePipelineCI.shaders = { computeShader };
+	computePipelineCI.layout = { {}, {} };
+	PipelineRef computePipeline = Pipeline::Create(&computePipelineCI);
+
+	//Synchronisation
+	Event::CreateInfo eventCI = { "Event", context->GetDevice() };
+	EventRef events[1] = { Event::Create(&eventCI) };
+
+	Barrier::CreateInfo bCI;
+	bCI.type = Barrier::Type::BUFFER;
+	bCI.srcAccess = Barrier::AccessBit::TRANSFER_WRITE_BIT;
+	bCI.dstAccess = Barrier::AccessBit::TRANSFER_READ_BIT;
+	bCI.srcQueueFamilyIndex = Barrier::QueueFamilyIgnored;
+	bCI.dstQueueFamilyIndex = Barrier::QueueFamilyIgnored;
+	bCI.buffer = transferBuffer;
+	bCI.offset = 0;
+	bCI.size = transferBuffer->GetCreateInfo().size;
+	BarrierHandle eventBarriers[1] = { CreateHandle(Barrier::Create(&bCI)) };
+
+	Barrier2::CreateInfo b2CI;
+	b2CI.type = Barrier::Type::BUFFER;
+	b2CI.srcStageMask = PipelineStageBit::TRANSFER_BIT;
+	b2CI.srcAccess = Barrier::AccessBit::TRANSFER_WRITE_BIT;
+	b2CI.dstStageMask = PipelineStageBit::VERTEX_INPUT_BIT;
+	b2CI.dstAccess = Barrier::AccessBit::VERTEX_ATTRIBUTE_READ_BIT;
+	b2CI.srcQueueFamilyIndex = Barrier::QueueFamilyIgnored;
+	b2CI.dstQueueFamilyIndex = Barrier::QueueFamilyIgnored;
+	b2CI.buffer = buffer;
+	b2CI.offset = 0;
+	b2CI.size = 1024;
+	Barrier2Handle barriers[1] = { CreateHandle(Barrier2::Create(&b2CI)) };
+
+	//Acceleration structure
+	AccelerationStructureBuildInfoRef buildInfos[1];
+	AccelerationStructureBuildInfo::BuildRangeInfo buildRangeInfo = { 1, 0, 0, 0 };
+	const AccelerationStructureBuildInfo::BuildRangeInfo* buildRangeInfos[1] = { &buildRangeInfo };
+	BufferRef asVertexBuffer, asBuffer, asScratchBuffer;
+	AccelerationStructureRef blas;
+	if (rayTracing)
+	{
+		float asVertices[12] =
+		{
+			-0.5f, -0.5f, 0.0f, 1.0f,
+			+0.5f, -0.5f, 0.0f, 1.0f,
+			+0.0f, +0.5f, 0.0f, 1.0f,
+		};
+		Buffer::CreateInfo asBufferCI;
+		asBufferCI.debugName = "BLASVertices";
+		asBufferCI.device = context->GetDevice();
+		asBufferCI.usage = Buffer::UsageBit::SHADER_DEVICE_ADDRESS_BIT | Buffer::UsageBit::ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT;
+		asBufferCI.size = sizeof(asVertices);
+		asBufferCI.data = asVertices;
+		asBufferCI.allocator = cpu_alloc_0;
+		asVertexBuffer = Buffer::Create(&asBufferCI);
+
+		AccelerationStructureBuildInfo::BuildGeometryInfo asbiGBI;
+		asbiGBI.device = context->GetDevice();
+		asbiGBI.type = AccelerationStructureBuildInfo::BuildGeometryInfo::Type::BOTTOM_LEVEL;
+		asbiGBI.flags = AccelerationStructureBuildInfo::BuildGeometryInfo::FlagBit::PREFER_FAST_TRACE_BIT;
+		asbiGBI.mode = AccelerationStructureBuildInfo::BuildGeometryInfo::Mode::BUILD;
+		asbiGBI.srcAccelerationStructure = nullptr;
+		asbiGBI.dstAccelerationStructure = nullptr;
+		asbiGBI.geometries.push_back({});
+		asbiGBI.geometries[0].type = AccelerationStructureBuildInfo::BuildGeometryInfo::Geometry::Type::TRIANGLES;
+		asbiGBI.geometries[0].triangles = {
+					VertexType::VEC3,
+					GetBufferDeviceAddress(context->GetDevice(), asVertexBuffer),
+					static_cast<uint64_t>(4 * sizeof(float)),
+					3,
+					IndexType::NONE,
+					DeviceOrHostAddressConstNull,
+					0,
+					DeviceOrHostAddressConstNull
+		};
+		asbiGBI.geometries[0].flags = AccelerationStructureBuildInfo::BuildGeometryInfo::Geometry::FlagBit::OPAQUE_BIT;
+		asbiGBI.scratchData = DeviceOrHostAddressNull;
+		asbiGBI.buildType = AccelerationStructureBuildInfo::BuildGeometryInfo::BuildType::DEVICE;
+		asbiGBI.maxPrimitiveCounts = 1;
+		AccelerationStructureBuildInfoRef blas_asbi = AccelerationStructureBuildInfo::Create(&asbiGBI);
+
+		asBufferCI.debugName = "BLASBuffer";
+		asBufferCI.usage = Buffer::UsageBit::ACCELERATION_STRUCTURE_STORAGE_BIT | Buffer::UsageBit::SHADER_DEVICE_ADDRESS_BIT;
+		asBufferCI.size = blas_asbi->GetBuildSizesInfo().accelerationStructureSize;
+		asBufferCI.data = nullptr;
+		asBufferCI.allocator = gpu_alloc_0;
+		asBuffer = Buffer::Create(&asBufferCI);
+		asBufferCI.debugName = "BLASScratchBuffer";
+		asBufferCI.usage = Buffer::UsageBit::STORAGE_BIT | Buffer::UsageBit::SHADER_DEVICE_ADDRESS_BIT;
+		asBufferCI.size = blas_asbi->GetBuildSizesInfo().buildScratchSize;
+		asScratchBuffer = Buffer::Create(&asBufferCI);
+
+		AccelerationStructure::CreateInfo asCI;
+		asCI.debugName = "BLAS";
+		asCI.device = context->GetDevice();
+		asCI.flags = AccelerationStructure::FlagBit::NONE_BIT;
+		asCI.buffer = asBuffer;
+		asCI.offset = 0;
+		asCI.size = asBuffer->GetCreateInfo().size;
+		asCI.type = AccelerationStructure::Type::BOTTOM_LEVEL;
+		asCI.deviceAddress = DeviceAddressNull;
+		blas = AccelerationStructure::Create(&asCI);
+
+		asbiGBI.dstAccelerationStructure = blas;
+		asbiGBI.scratchData.deviceAddress = GetBufferDeviceAddress(context->GetDevice(), asScratchBuffer);
+		buildInfos[0] = AccelerationStructureBuildInfo::Create(&asbiGBI);
+	}
+
+	//Commands
+	const Viewport viewports[1] = { { 0.0f, 0.0f, 64.0f, 64.0f, 0.0f, 1.0f } };
+	const Rect2D scissors[1] = { { { 0, 0 }, { 64, 64 } } };
+	const Image::ClearColourValue clearColour = { 0.0f, 0.0f, 0.0f, 1.0f };
+	const Image::SubresourceRange subresourceRanges[1] = { { Image::AspectBit::COLOUR_BIT, 0, 1, 0, 1 } };
+	const Image::SubresourceLayers subresourceLayers = { Image::AspectBit::COLOUR_BIT, 0, 0, 1 };
+	const Buffer::Copy bufferCopies[1] = { { 0, 0, 1024 } };
+	const Image::Copy imageCopies[1] = { { subresourceLayers, { 0, 0, 0 }, subresourceLayers, { 0, 0, 0 }, { 64, 64, 1 } } };
+	const Image::Resolve imageResolves[1] = { imageCopies[0] };
+	const Image::BufferImageCopy bufferImageCopies[1] = { { 0, 0, 0, subresourceLayers, { 0, 0, 0 }, { 64, 64, 1 } } };
+	const float pushConstants[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	RenderingAttachmentInfo colourRAI = { colourImageView, Image::Layout::COLOUR_ATTACHMENT_OPTIMAL, ResolveModeBits::NONE_BIT, nullptr, Image::Layout::UNKNOWN, RenderPass::AttachmentLoadOp::CLEAR, RenderPass::AttachmentStoreOp::STORE, { 0.0f, 0.0f, 0.0f, 1.0f } };
+	RenderingInfo renderingInfo = { RenderingFlagBits::NONE_BIT, { { 0, 0 }, { 64, 64 } }, 1, 0, { colourRAI }, nullptr, nullptr };
+
+	//Each CommandBuffer records with the overloads taking Handles and pointers.
+	auto Record = [&](uint32_t index)
+	{
+		cmdBuffer->Begin(index, CommandBuffer::UsageBit::ONE_TIME_SUBMIT);
+
+		cmdBuffer->ClearColourImage(index, colourImage, Image::Layout::TRANSFER_DST_OPTIMAL, clearColour, subresourceRanges, 1);
+		cmdBuffer->ClearColourImage(index, msaaImage, Image::Layout::TRANSFER_DST_OPTIMAL, clearColour, subresourceRanges, 1);
+		cmdBuffer->ResolveImage(index, msaaImage, Image::Layout::TRANSFER_SRC_OPTIMAL, colourImage, Image::Layout::TRANSFER_DST_OPTIMAL, imageResolves, 1);
+		cmdBuffer->CopyImage(index, colourImage, Image::Layout::TRANSFER_SRC_OPTIMAL, copyImage, Image::Layout::TRANSFER_DST_OPTIMAL, imageCopies, 1);
+		cmdBuffer->CopyImageToBuffer(index, copyImage, transferBuffer, Image::Layout::TRANSFER_SRC_OPTIMAL, bufferImageCopies, 1);
+		cmdBuffer->CopyBufferToImage(index, transferBuffer, copyImage, Image::Layout::TRANSFER_DST_OPTIMAL, bufferImageCopies, 1);
+		cmdBuffer->CopyBuffer(index, transferBuffer, buffer, bufferCopies, 1);
+		cmdBuffer->SetEvent(index, events[0], PipelineStageBit::TRANSFER_BIT);
+		cmdBuffer->WaitEvents(index, events, 1, PipelineStageBit::TRANSFER_BIT, PipelineStageBit::TRANSFER_BIT, eventBarriers, 1);
+		cmdBuffer->PipelineBarrier2(index, DependencyBit::NONE_BIT, barriers, 1);
+
+		if (rayTracing)
+			cmdBuffer->BuildAccelerationStructure(index, buildInfos, 1, buildRangeInfos);
+
+		cmdBuffer->BindPipeline(index, computePipeline);
+		cmdBuffer->Dispatch(index, 1, 1, 1);
+
+		cmdBuffer->BeginRendering(index, renderingInfo);
+		cmdBuffer->BindPipeline(index, pipeline);
+		cmdBuffer->SetViewport(index, viewports, 1);
+		cmdBuffer->SetScissor(index, scissors, 1);
+		cmdBuffer->BindVertexBuffers(index, vbvs, 2);
+		cmdBuffer->BindIndexBuffer(index, ibv);
+		cmdBuffer->BindDescriptorSets(index, descriptorSets, 2, 0, pipeline);
+		cmdBuffer->PushConstants(index, pipeline, Shader::StageBit::VERTEX_BIT, 0, sizeof(pushConstants), pushConstants);
+		cmdBuffer->Draw(index, 3);
+		cmdBuffer->DrawIndexed(index, 36);
+		cmdBuffer->EndRendering(index);
+
+		cmdBuffer->End(index);
+	};
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+	_CrtSetAllocHook(AllocHook);
+#endif
+
+	//The first recording warms up the scratch memory of each CommandBuffer.
+	for (uint32_t index = 0; index < cmdBufferCI.commandBufferCount; index++)
+		Record(index);
+
+	g_AllocationCount = 0;
+	g_CountAllocations = true;
+	for (uint32_t index = 0; index < cmdBufferCI.commandBufferCount; index++)
+	{
+		cmdBuffer->Reset(index, false);
+		Record(index);
+	}
+	g_CountAllocations = false;
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+	_CrtSetAllocHook(nullptr);
+#endif
+
+	printf("AllocationFreeRecording: %llu allocations while recording.\n", static_cast<unsigned long long>(g_AllocationCount.load()));
+	MIRU_FATAL(g_AllocationCount != 0, "ERROR: MIRU_TEST: Recording with Handles allocated memory.");
+
+	context->DeviceWaitIdle();
+	DestroyHandle(barriers[0]);
+	DestroyHandle(eventBarriers[0]);
+	DestroyHandle(descriptorSets[0]);
+	DestroyHandle(descriptorSets[1]);
+	DestroyHandle(ibv);
+	DestroyHandle(vbvs[0]);
+	DestroyHandle(vbvs[1]);
+}
\ No newline at end of file
@@ -681,6 +681,34 @@ void Basic()
 	p1CI.subpassIndex = 1;
 	PipelineRef postProcessPipeline = Pipeline::Create(&p1CI);
 
+	//Redundant state filtering: Rebinding a Pipeline must not filter the next bind of the same DescriptorSet on D3D12,
+	//where setting the root signature clears the descriptor tables.
+	{
+		Pipeline::CreateInfo p2CI = pCI;
+		p2CI.debugName = "Basic: No Culling";
+		p2CI.rasterisationState.cullMode = CullModeBit::NONE_BIT;
+		PipelineRef noCullingPipeline = Pipeline::Create(&p2CI);
+
+		CommandBuffer::CreateInfo filterCmdBufferCI = cmdBufferCI;
+		filterCmdBufferCI.debugName = "FilterCmdBuffer";
+		filterCmdBufferCI.commandBufferCount = 1;
+		filterCmdBufferCI.filterRedundantState = true;
+		CommandBufferRef filterCmdBuffer = CommandBuffer::Create(&filterCmdBufferCI);
+
+		filterCmdBuffer->Begin(0, CommandBuffer::UsageBit::ONE_TIME_SUBMIT);
+		filterCmdBuffer->BindPipeline(0, pipeline);
+		filterCmdBuffer->BindDescriptorSets(0, { descriptorSet_p0 }, 0, pipeline);
+		filterCmdBuffer->BindPipeline(0, noCullingPipeline);
+		filterCmdBuffer->BindPipeline(0, pipeline);
+		filterCmdBuffer->BindDescriptorSets(0, { descriptorSet_p0 }, 0, pipeline);
+		filterCmdBuffer->End(0);
+
+		//Vulkan keeps the DescriptorSet bound across Pipelines with compatible layouts.
+		const CommandBuffer::StateFilterStatistics& statistics = filterCmdBuffer->GetStateFilterStatistics(0);
+		MIRU_FATAL(statistics.issuedCount != (GraphicsAPI::IsD3D12() ? 5 : 4), "ERROR: MIRU_TEST: Unexpected number of binds issued.");
+		MIRU_FATAL(statistics.filteredCount != (GraphicsAPI::IsD3D12() ? 0 : 1), "ERROR: MIRU_TEST: Unexpected number of binds filtered.");
+	}
+
 	Framebuffer::CreateInfo framebufferCI_0, framebufferCI_1;
 	framebufferCI_0.debugName = "Framebuffer0";
 	framebufferCI_0.device = context->GetDevice();
@@ -9,12 +9,16 @@ void DynamicRendering();
 void Multiview();
 void MeshShader();
 void Sync2();
+void AllocationFreeRecording();
+void QueryPoolResults();
 
 #define MIRU_TEST_RAYTRACING 0
 #define MIRU_TEST_DYNAMIC_RENDERING 0
 #define MIRU_TEST_MULTIVIEW 0
 #define MIRU_TEST_MESH_SHADER 1
 #define MIRU_TEST_SYNC2 0
+#define MIRU_TEST_ALLOCATION_FREE_RECORDING 0
+#define MIRU_TEST_QUERY_POOL_RESULTS 0
 
 int main()
 {
@@ -28,6 +32,10 @@ int main()
 	MeshShader();
 #elif MIRU_TEST_SYNC2
 	Sync2();
+#elif MIRU_TEST_ALLOCATION_FREE_RECORDING
+	AllocationFreeRecording();
+#elif MIRU_TEST_QUERY_POOL_RESULTS
+	QueryPoolResults();
 #else
 	Basic();
 #endif
@@ -0,0 +1,124 @@
+#include "miru_core.h"
+#include <cstdio>
+
+using namespace miru;
+using namespace base;
+
+//Writes two timestamps, with and without SYNCHRONISATION_2, and checks that GetResults() and CopyQueryPoolResults() agree.
+//Vulkan only: D3D12 host visible Allocators use upload heaps, which CopyQueryPoolResults() can not write to.
+static void TestQueryPoolResults(Context::ExtensionsBit extensions)
+{
+	Context::CreateInfo contextCI;
+	contextCI.applicationName = "MIRU_TEST";
+	contextCI.extensions = extensions;
+	contextCI.debugValidationLayers = true;
+	contextCI.deviceDebugName = "GPU Device";
+	contextCI.pNext = nullptr;
+	ContextRef context = Context::Create(&contextCI);
+
+	CommandPool::CreateInfo cmdPoolCI;
+	cmdPoolCI.debugName = "CmdPool";
+	cmdPoolCI.context = context;
+	cmdPoolCI.flags = CommandPool::FlagBit::RESET_COMMAND_BUFFER_BIT;
+	cmdPoolCI.queueType = CommandPool::QueueType::GRAPHICS;
+	CommandPoolRef cmdPool = CommandPool::Create(&cmdPoolCI);
+
+	CommandBuffer::CreateInfo cmdBufferCI;
+	cmdBufferCI.debugName = "CmdBuffer";
+	cmdBufferCI.commandPool = cmdPool;
+	cmdBufferCI.level = CommandBuffer::Level::PRIMARY;
+	cmdBufferCI.commandBufferCount = 2;
+	CommandBufferRef cmdBuffer = CommandBuffer::Create(&cmdBufferCI);
+
+	QueryPool::CreateInfo queryPoolCI;
+	queryPoolCI.debugName = "TimestampQueryPool";
+	queryPoolCI.context = context;
+	queryPoolCI.type = QueryPool::Type::TIMESTAMP;
+	queryPoolCI.queryCount = 2;
+	QueryPoolRef queryPool = QueryPool::Create(&queryPoolCI);
+
+	Allocator::CreateInfo allocCI;
+	allocCI.debugName = "CPU_ALLOC_0";
+	allocCI.context = context;
+	allocCI.blockSize = Allocator::BlockSize::BLOCK_SIZE_1MB;
+	allocCI.properties = Allocator::PropertiesBit::HOST_VISIBLE_BIT | Allocator::PropertiesBit::HOST_COHERENT_BIT;
+	AllocatorRef cpu_alloc_0 = Allocator::Create(&allocCI);
+
+	const size_t resultsSize = static_cast<size_t>(queryPool->GetResultSize()) * queryPoolCI.queryCount;
+	Buffer::CreateInfo bufferCI;
+	bufferCI.debugName = "QueryResultsBuffer";
+	bufferCI.device = context->GetDevice();
+	bufferCI.usage = Buffer::UsageBit::TRANSFER_DST_BIT;
+	bufferCI.size = resultsSize;
+	bufferCI.data = nullptr;
+	bufferCI.allocator = cpu_alloc_0;
+	BufferRef resultsBuffer = Buffer::Create(&bufferCI);
+
+	Fence::CreateInfo fenceCI = { "QueryFence", context->GetDevice(), false, UINT64_MAX };
+	FenceRef resetFence = Fence::Create(&fenceCI);
+	FenceRef timestampFence = Fence::Create(&fenceCI);
+
+	//Reset the queries, so that they are unavailable.
+	{
+		cmdBuffer->Begin(0, CommandBuffer::UsageBit::ONE_TIME_SUBMIT);
+		cmdBuffer->ResetQueryPool(0, queryPool, 0, queryPoolCI.queryCount);
+		cmdBuffer->End(0);
+	}
+	CommandBuffer::SubmitInfo resetSI = { { 0 }, {}, {}, {}, {}, {} };
+	cmdBuffer->Submit({ resetSI }, resetFence);
+	resetFence->Wait();
+
+	uint64_t results[2] = { 0, 0 };
+	bool available[2] = { true, true };
+	MIRU_FATAL(queryPool->GetResults(0, queryPoolCI.queryCount, results, available), "ERROR: MIRU_TEST: Reset queries are available.");
+	MIRU_FATAL(available[0] || available[1], "ERROR: MIRU_TEST: Reset queries are available.");
+
+	//Write the timestamps and copy them into the Buffer.
+	{
+		cmdBuffer->Begin(1, CommandBuffer::UsageBit::ONE_TIME_SUBMIT);
+		cmdBuffer->WriteTimestamp(1, PipelineStageBit::TOP_OF_PIPE_BIT, queryPool, 0);
+		cmdBuffer->WriteTimestamp(1, PipelineStageBit::BOTTOM_OF_PIPE_BIT, queryPool, 1);
+		cmdBuffer->CopyQueryPoolResults(1, queryPool, 0, queryPoolCI.queryCount, resultsBuffer, 0);
+
+		Barrier::CreateInfo bCI;
+		bCI.type = Barrier::Type::BUFFER;
+		bCI.srcAccess = Barrier::AccessBit::TRANSFER_WRITE_BIT;
+		bCI.dstAccess = Barrier::AccessBit::HOST_READ_BIT;
+		bCI.srcQueueFamilyIndex = Barrier::QueueFamilyIgnored;
+		bCI.dstQueueFamilyIndex = Barrier::QueueFamilyIgnored;
+		bCI.buffer = resultsBuffer;
+		bCI.offset = 0;
+		bCI.size = resultsSize;
+		BarrierRef b = Barrier::Create(&bCI);
+		cmdBuffer->PipelineBarrier(1, PipelineStageBit::TRANSFER_BIT, PipelineStageBit::HOST_BIT, DependencyBit::NONE_BIT, { b });
+
+		cmdBuffer->End(1);
+	}
+	CommandBuffer::SubmitInfo timestampSI = { { 1 }, {}, {}, {}, {}, {} };
+	cmdBuffer->Submit({ timestampSI }, timestampFence);
+	timestampFence->Wait();
+
+	MIRU_FATAL(!queryPool->GetResults(0, queryPoolCI.queryCount, results, available), "ERROR: MIRU_TEST: Written queries are unavailable.");
+	MIRU_FATAL(!available[0] || !available[1], "ERROR: MIRU_TEST: Written queries are unavailable.");
+	MIRU_FATAL(results[1] < results[0], "ERROR: MIRU_TEST: Timestamps are out of order.");
+
+	uint64_t copiedResults[2] = { 0, 0 };
+	cpu_alloc_0->AccessData(resultsBuffer->GetAllocation(), 0, resultsSize, copiedResults);
+	MIRU_FATAL(copiedResults[0] != results[0] || copiedResults[1] != results[1], "ERROR: MIRU_TEST: CopyQueryPoolResults() and GetResults() differ.");
+
+	printf("QueryPool: %s: %.3f us between timestamps.\n",
+		arc::BitwiseCheck(extensions, Context::ExtensionsBit::SYNCHRONISATION_2) ? "vkCmdWriteTimestamp2" : "vkCmdWriteTimestamp",
+		static_cast<double>(results[1] - results[0]) * queryPool->GetTimestampPeriod() / 1000.0);
+
+	context->DeviceWaitIdle();
+}
+
+void QueryPoolResults()
+{
+	GraphicsAPI::SetAPI(GraphicsAPI::API::VULKAN);
+	GraphicsAPI::AllowSetName();
+	GraphicsAPI::LoadGraphicsDebugger(debug::GraphicsDebugger::DebuggerType::NONE);
+
+	TestQueryPoolResults(Context::ExtensionsBit::SYNCHRONISATION_2);
+	TestQueryPoolResults(Context::ExtensionsBit::NONE);
+}
\ No newline at end of file